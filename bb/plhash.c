@@ -19,6 +19,7 @@
 #include <string.h>
 #include <strings.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include <sys/types.h>
 
 /* DISABLE 'restrict' keyword usage pending further testing by Systems Group */
@@ -89,14 +90,29 @@ struct hash {
     hashmalloc_t *malloc_fn;
     hashfree_t *free_fn;
     enum hash_scheme scheme;
+    struct hash_stripe *stripes; /* set by hash_config_concurrent() */
+    unsigned int nstripes;
 };
 
+/* One independently locked sub-table of a concurrent hash.  Aligned so that
+ * neighbouring stripes' mutexes don't share a cache line. */
+struct hash_stripe {
+    pthread_mutex_t lk;
+    hash_t *h;
+} __attribute__((aligned(64)));
+
 enum { PRIME = 8388013 };
 
 #define HASH(h, key) ((h)->hashfunc(key, (h)->keysz))
 #define CMP(h, a, b) ((h)->cmpfunc(a, b, (h)->keysz))
 #define BUCKET(hash, ntbl) ((hash) % (ntbl))
 
+/* Pick the stripe from the high bits of a multiplicative mix of the hash.
+ * The sub-tables bucket on the low bits (modulo, or mask for power of 2
+ * tables), so using those here would leave most of each sub-table empty. */
+#define STRIPE(h, hash)                                                        \
+    (&(h)->stripes[((uint64_t)((hash)*2654435761U) * (h)->nstripes) >> 32])
+
 /* The hash find functions.  Since finding is a common operation I want these
  * to be very fast.  There are several versions with very minor changes to
  * suit different types of hash table. */
@@ -1029,6 +1045,53 @@ void hash_config_query_stats(hash_t *const h, const int enable)
     }
 }
 
+static hash_t *hash_init_int(hashfunc_t *hashfunc, cmpfunc_t *cmpfunc,
+                             hashmalloc_t *hashmalloc, hashfree_t *hashfree,
+                             int keyoff, int keysz, hash_kfnd_t *hash_kfnd,
+                             enum hash_scheme scheme);
+
+/* split an empty hash into nstripes sub-tables, each behind its own mutex.
+ * Every hash routine except hash_first()/hash_next() then does its own
+ * locking.  Objects returned by finds are not protected once the call
+ * returns; the caller still has to make sure they aren't freed under it. */
+int hash_config_concurrent(hash_t *const h, int nstripes)
+{
+    unsigned int ii;
+    if (nstripes < 1 || h->stripes != NULL || h->nents != 0)
+        return -1;
+    h->stripes = h->malloc_fn(nstripes * sizeof(struct hash_stripe));
+    if (h->stripes == NULL)
+        return -1;
+    for (ii = 0; ii < (unsigned int)nstripes; ii++) {
+        struct hash_stripe *s = &h->stripes[ii];
+        s->h = hash_init_int(h->hashfunc, h->cmpfunc, h->malloc_fn, h->free_fn,
+                             h->keyoff, h->keysz, h->hash_kfnd_fn, h->scheme);
+        if (s->h == NULL) {
+            while (ii-- > 0) {
+                pthread_mutex_destroy(&h->stripes[ii].lk);
+                hash_free(h->stripes[ii].h);
+            }
+            h->free_fn(h->stripes);
+            h->stripes = NULL;
+            return -1;
+        }
+        pthread_mutex_init(&s->lk, NULL);
+    }
+    h->nstripes = nstripes;
+    return 0;
+}
+
+static void *hash_find_striped(hash_t *const h, const void *const key,
+                               int readonly)
+{
+    struct hash_stripe *s = STRIPE(h, HASH(h, key));
+    void *obj;
+    pthread_mutex_lock(&s->lk);
+    obj = readonly ? hash_find_readonly(s->h, key) : hash_find(s->h, key);
+    pthread_mutex_unlock(&s->lk);
+    return obj;
+}
+
 static hash_t *hash_init_int(hashfunc_t *hashfunc, cmpfunc_t *cmpfunc,
                              hashmalloc_t *hashmalloc, hashfree_t *hashfree,
                              int keyoff, int keysz, hash_kfnd_t *hash_kfnd,
@@ -1155,6 +1218,20 @@ int hash_initsize(hash_t *h, unsigned int sz)
     if (sz == 0 || h->htab != STARTER_HTAB)
         return -1;
 
+    if (h->stripes) {
+        unsigned int ii, ssz = (sz + h->nstripes - 1) / h->nstripes;
+        int rc = 0;
+        if (h->scheme == HASH_BY_POWER2) {
+            /* keep the sub-tables a power of 2 */
+            for (ii = 1; ii < ssz; ii <<= 1)
+                ;
+            ssz = ii;
+        }
+        for (ii = 0; ii < h->nstripes; ii++)
+            rc |= hash_initsize(h->stripes[ii].h, ssz);
+        return rc;
+    }
+
     if ((h->htab = h->malloc_fn(tsz)) != 0) {
         memset(h->htab, 0, tsz);
         h->htab->ntbl = sz;
@@ -1170,17 +1247,25 @@ int hash_initsize(hash_t *h, unsigned int sz)
 
 void *hash_findobj(hash_t *const restrict h, const void *const restrict vobj)
 {
+    if (h->stripes)
+        return hash_find_striped(h, ((const unsigned char *)vobj) + h->keyoff,
+                                 0);
     return h->hash_kfnd_fn(h, (((const unsigned char *)vobj) + h->keyoff));
 }
 
 void *hash_find(hash_t *const restrict h, const void *const restrict key)
 {
+    if (h->stripes)
+        return hash_find_striped(h, key, 0);
     return h->hash_kfnd_fn(h, key);
 }
 
 void *hash_findobj_readonly(hash_t *const restrict h,
                             const void *const restrict vobj)
 {
+    if (h->stripes)
+        return hash_find_striped(h, ((const unsigned char *)vobj) + h->keyoff,
+                                 1);
     return h->hash_kfnd_fn_readonly(h,
                                     ((const unsigned char *)vobj) + h->keyoff);
 }
@@ -1188,6 +1273,8 @@ void *hash_findobj_readonly(hash_t *const restrict h,
 void *hash_find_readonly(hash_t *const restrict h,
                          const void *const restrict key)
 {
+    if (h->stripes)
+        return hash_find_striped(h, key, 1);
     return h->hash_kfnd_fn_readonly(h, key);
 }
 
@@ -1396,6 +1483,14 @@ int hash_add(hash_t *h, void *vobj)
     hashtable *restrict htab = h->htab;
     hashent *restrict he;
     hashent **tbl;
+    if (h->stripes) {
+        struct hash_stripe *s = STRIPE(h, HASH(h, &obj[h->keyoff]));
+        int rc;
+        pthread_mutex_lock(&s->lk);
+        rc = hash_add(s->h, vobj);
+        pthread_mutex_unlock(&s->lk);
+        return rc;
+    }
     if (h->nents >= htab->ntbl >> 1) {
         if ((htab = hash_inctbl(h)) == STARTER_HTAB)
             return -1; /*(failed to resize starter_htab)*/
@@ -1420,6 +1515,14 @@ int hash_delk(hash_t *const h, const void *const key)
     hashtable *const restrict htab = h->htab;
     unsigned int nsteps = 0;
     const unsigned int hh = HASH(h, key);
+    if (h->stripes) {
+        struct hash_stripe *s = STRIPE(h, hh);
+        int rc;
+        pthread_mutex_lock(&s->lk);
+        rc = hash_delk(s->h, key);
+        pthread_mutex_unlock(&s->lk);
+        return rc;
+    }
     hashent **const chead = htab->tbl + BUCKET(hh, htab->ntbl);
     hashent **phe = chead;
     hashent *he = *chead;
@@ -1486,6 +1589,15 @@ void hash_clear(hash_t *const h)
 {
     hashfree_t *const h_free = h->free_fn;
     hashtable *nxtab, *restrict htab = h->htab;
+    if (h->stripes) {
+        unsigned int ii;
+        for (ii = 0; ii < h->nstripes; ii++) {
+            pthread_mutex_lock(&h->stripes[ii].lk);
+            hash_clear(h->stripes[ii].h);
+            pthread_mutex_unlock(&h->stripes[ii].lk);
+        }
+        return;
+    }
     if (htab != STARTER_HTAB) {
         /* pool_clear() below will reclaim hashents) */
         memset(htab->tbl, 0, htab->ntbl * sizeof(hashent *));
@@ -1505,6 +1617,14 @@ void hash_free(hash_t *const h)
 {
     hashfree_t *const h_free = h->free_fn;
     hashtable *restrict htab, *nxtab = h->htab->freed;
+    if (h->stripes) {
+        unsigned int ii;
+        for (ii = 0; ii < h->nstripes; ii++) {
+            pthread_mutex_destroy(&h->stripes[ii].lk);
+            hash_free(h->stripes[ii].h);
+        }
+        h_free(h->stripes);
+    }
     while ((htab = nxtab)) {
         nxtab = htab->freed;
         h_free(htab);
@@ -1528,6 +1648,15 @@ void hash_free_resized_tables(hash_t *const h)
     hashent *he, *nhe, **tbl;
     size_t i, sz;
 
+    if (h->stripes) {
+        for (i = 0; i < h->nstripes; i++) {
+            pthread_mutex_lock(&h->stripes[i].lk);
+            hash_free_resized_tables(h->stripes[i].h);
+            pthread_mutex_unlock(&h->stripes[i].lk);
+        }
+        return;
+    }
+
     /* First clear out any lingering stale hashents we own */
     /* 'delayed' is a list of hashents whose objects are deleted hashents */
     for (he = h->delayed; he != 0; he = nhe) {
@@ -1566,6 +1695,16 @@ void hash_dump_stats(hash_t *h, FILE *out, FILE *detail_out)
     int nused;
     char buf[160];
     hashent *he;
+    if (h->stripes) {
+        for (ii = 0; ii < h->nstripes; ii++) {
+            logmsgf(LOGMSG_USER, out, "Stripe %u of %u\n", ii + 1,
+                    h->nstripes);
+            pthread_mutex_lock(&h->stripes[ii].lk);
+            hash_dump_stats(h->stripes[ii].h, out, detail_out);
+            pthread_mutex_unlock(&h->stripes[ii].lk);
+        }
+        return;
+    }
     pool_info(h->ents, 0, &nused, 0);
     logmsgf(LOGMSG_USER, out, "Key Size = %-10u      #Ents = %-10u\n", h->keysz, h->nents);
     logmsgf(LOGMSG_USER, out, "#Table   = %-10u      #Used = %-10d\n", ntbl, nused);
@@ -1605,6 +1744,18 @@ int hash_for(hash_t *const h, hashforfunc_t *const func,
     hashent **const tbl = htab->tbl;
     const unsigned int ntbl = htab->ntbl;
 
+    /* func runs with the stripe locked, so must not call back into h */
+    if (h->stripes) {
+        for (ii = 0; ii < h->nstripes; ii++) {
+            pthread_mutex_lock(&h->stripes[ii].lk);
+            rc = hash_for(h->stripes[ii].h, func, arg);
+            pthread_mutex_unlock(&h->stripes[ii].lk);
+            if (rc != 0)
+                return rc;
+        }
+        return 0;
+    }
+
     for (ii = 0; ii < ntbl; ii++) {
         for (he = tbl[ii]; he; he = nhe) {
             nhe = he->next;
@@ -1658,6 +1809,38 @@ void hash_info2(hash_t *h, int *nhits, int *nmisses, int *nsteps, int *ntbl,
                 int *nents, int *nadds, int *ndels, int *maxsteps)
 /*added maxsteps*/
 {
+    if (h->stripes) {
+        unsigned int ii;
+        int v[8] = {0};
+        for (ii = 0; ii < h->nstripes; ii++) {
+            int s[8];
+            pthread_mutex_lock(&h->stripes[ii].lk);
+            hash_info2(h->stripes[ii].h, &s[0], &s[1], &s[2], &s[3], &s[4],
+                       &s[5], &s[6], &s[7]);
+            pthread_mutex_unlock(&h->stripes[ii].lk);
+            for (int jj = 0; jj < 7; jj++)
+                v[jj] += s[jj];
+            if (s[7] > v[7])
+                v[7] = s[7];
+        }
+        if (nhits)
+            *nhits = v[0];
+        if (nmisses)
+            *nmisses = v[1];
+        if (nsteps)
+            *nsteps = v[2];
+        if (ntbl)
+            *ntbl = v[3];
+        if (nents)
+            *nents = v[4];
+        if (nadds)
+            *nadds = v[5];
+        if (ndels)
+            *ndels = v[6];
+        if (maxsteps)
+            *maxsteps = v[7];
+        return;
+    }
     if (nhits)
         *nhits = h->nhits;
     if (nmisses)
@@ -1682,7 +1865,15 @@ void hash_info(hash_t *h, int *nhits, int *nmisses, int *nsteps, int *ntbl,
     hash_info2(h, nhits, nmisses, nsteps, ntbl, nents, nadds, ndels, 0);
 }
 
-int hash_get_num_entries(hash_t *h) { return h->nents; }
+int hash_get_num_entries(hash_t *h)
+{
+    if (h->stripes) {
+        int nents;
+        hash_info2(h, 0, 0, 0, 0, &nents, 0, 0, 0);
+        return nents;
+    }
+    return h->nents;
+}
 
 #ifdef HASH_TEST_PROGRAM
 
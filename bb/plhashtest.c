@@ -0,0 +1,155 @@
+/*
+   Copyright 2015 Bloomberg Finance L.P.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+/* Lookup throughput of a hash shared by several threads: one behind a single
+ * mutex, the way most callers use it, against hash_config_concurrent().
+ *
+ *   plhashtest [maxthreads] [nkeys] [ops per thread] [update percent]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include <plhash.h>
+
+struct obj {
+    int key;
+    int dat;
+};
+
+static struct obj *objs;
+static int nkeys = 100000;
+static int nops = 1000000;
+static int update_pct = 10;
+static int nthreads;
+static int striped;
+static hash_t *h;
+static pthread_mutex_t lk = PTHREAD_MUTEX_INITIALIZER;
+
+static void *worker(void *arg)
+{
+    int id = (int)(intptr_t)arg;
+    unsigned int seed = id + 1;
+    long errs = 0;
+
+    for (int ii = 0; ii < nops; ii++) {
+        int k = rand_r(&seed) % nkeys;
+        if (rand_r(&seed) % 100 < update_pct) {
+            /* writers own the keys congruent to their id, so no two threads
+             * delete and re-add the same object */
+            k -= k % nthreads;
+            k += id;
+            if (k >= nkeys)
+                continue;
+            if (!striped)
+                pthread_mutex_lock(&lk);
+            if (hash_del(h, &objs[k]) != 0 || hash_add(h, &objs[k]) != 0)
+                errs++;
+            if (!striped)
+                pthread_mutex_unlock(&lk);
+        } else {
+            struct obj *o;
+            if (!striped)
+                pthread_mutex_lock(&lk);
+            o = hash_find_readonly(h, &k);
+            if (!striped)
+                pthread_mutex_unlock(&lk);
+            /* an update in flight may hide the key for a moment */
+            if (o != NULL && o->dat != k)
+                errs++;
+        }
+    }
+    return (void *)errs;
+}
+
+static double now(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static int run(int threads, int concurrent)
+{
+    pthread_t tids[threads];
+    long errs = 0;
+    void *rc;
+
+    h = hash_init_i4(offsetof(struct obj, key));
+    striped = concurrent;
+    if (striped && hash_config_concurrent(h, 64) != 0) {
+        printf("FAILED TO CONFIGURE CONCURRENT HASH\n");
+        exit(-1);
+    }
+    for (int ii = 0; ii < nkeys; ii++)
+        hash_add(h, &objs[ii]);
+
+    nthreads = threads;
+    double start = now();
+    for (int ii = 0; ii < threads; ii++)
+        pthread_create(&tids[ii], NULL, worker, (void *)(intptr_t)ii);
+    for (int ii = 0; ii < threads; ii++) {
+        pthread_join(tids[ii], &rc);
+        errs += (long)rc;
+    }
+    double elapsed = now() - start;
+
+    int nents = hash_get_num_entries(h);
+    printf("%-8s %3d threads %10.0f ops/s\n", striped ? "striped" : "mutex",
+           threads, (double)threads * nops / elapsed);
+    hash_free(h);
+    if (errs || nents != nkeys) {
+        printf("ERR: %ld bad results, %d entries, expected %d\n", errs, nents,
+               nkeys);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int maxthreads = argc > 1 ? atoi(argv[1]) : 16;
+    int bad = 0;
+
+    if (argc > 2)
+        nkeys = atoi(argv[2]);
+    if (argc > 3)
+        nops = atoi(argv[3]);
+    if (argc > 4)
+        update_pct = atoi(argv[4]);
+    if (maxthreads < 1 || nkeys < 1 || nops < 1) {
+        printf("usage: %s [maxthreads] [nkeys] [ops per thread] [update %%]\n",
+               argv[0]);
+        return 1;
+    }
+
+    objs = malloc(nkeys * sizeof(struct obj));
+    for (int ii = 0; ii < nkeys; ii++)
+        objs[ii].key = objs[ii].dat = ii;
+
+    for (int threads = 1; threads <= maxthreads; threads *= 2) {
+        bad |= run(threads, 0);
+        bad |= run(threads, 1);
+    }
+    printf(bad ? "FAILED.\n" : "DONE.\n");
+    free(objs);
+    return bad;
+}
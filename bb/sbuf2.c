@@ -712,6 +712,43 @@ int SBUF2_FUNC(sbuf2setbufsize)(SBUF2 *sb, unsigned int size)
     return 0;
 }
 
+int SBUF2_FUNC(sbuf2growbuf)(SBUF2 *sb, unsigned int size)
+{
+    unsigned char *rbuf, *wbuf;
+    int n;
+
+    if (sb == NULL)
+        return -1;
+    if (size <= sb->lbuf)
+        return 0;
+    if (sbuf2flush(sb) < 0)
+        return -1;
+    rbuf = malloc(size);
+    wbuf = malloc(size);
+    if (rbuf == NULL || wbuf == NULL) {
+        if (rbuf)
+            free(rbuf);
+        if (wbuf)
+            free(wbuf);
+        return ENOMEM;
+    }
+    /* reads only refill an empty buffer, so read-ahead is contiguous */
+    n = sb->rhd - sb->rtl;
+    if (n > 0)
+        memcpy(rbuf, sb->rbuf + sb->rtl, n);
+    else
+        n = 0;
+    free(sb->rbuf);
+    free(sb->wbuf);
+    sb->rbuf = rbuf;
+    sb->wbuf = wbuf;
+    sb->rtl = 0;
+    sb->rhd = n;
+    sb->whd = sb->wtl = 0;
+    sb->lbuf = size;
+    return 0;
+}
+
 void SBUF2_FUNC(sbuf2setflags)(SBUF2 *sb, int flags)
 {
     sb->flags |= flags;
@@ -812,6 +849,26 @@ void *SBUF2_FUNC(sbuf2getuserptr)(SBUF2 *sb)
     return sb->userptr;
 }
 
+int SBUF2_FUNC(sbuf2pending)(SBUF2 *sb)
+{
+    int n;
+
+    if (sb == NULL)
+        return 0;
+
+    n = sb->rhd - sb->rtl;
+    if (n < 0)
+        n += sb->lbuf;
+#if SBUF2_UNGETC
+    n += sb->ungetc_buf_len;
+#endif
+#if WITH_SSL
+    if (sb->ssl != NULL)
+        n += SSL_pending(sb->ssl);
+#endif
+    return n;
+}
+
 #if WITH_SSL
 #  ifdef my_ssl_println
 #    undef my_ssl_println
@@ -0,0 +1,386 @@
+/*
+   Copyright 2017 Bloomberg Finance L.P.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "sketch.h"
+#include "mem_bb.h"
+#include "mem_override.h"
+
+uint64_t sketch_hash(const void *key, int len)
+{
+    const uint8_t *p = key;
+    uint64_t h = 0xcbf29ce484222325ULL; /* FNV-1a */
+    int i;
+
+    for (i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 0x100000001b3ULL;
+    }
+    /* FNV leaves the high bits poorly mixed; HLL needs every bit */
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/* 2^14 registers: 16KB and a standard error of 1.04/sqrt(2^14), under 1% */
+#define HLL_P 14
+#define HLL_M (1 << HLL_P)
+
+struct hll {
+    uint8_t reg[HLL_M];
+};
+
+struct hll *hll_new(void)
+{
+    return calloc(1, sizeof(struct hll));
+}
+
+void hll_add(struct hll *h, const void *key, int len)
+{
+    uint64_t hash = sketch_hash(key, len);
+    uint32_t idx = hash >> (64 - HLL_P);
+    uint64_t rest = hash << HLL_P;
+    uint8_t rho = 1;
+
+    while (rho <= 64 - HLL_P && !(rest & (1ULL << 63))) {
+        rest <<= 1;
+        rho++;
+    }
+    if (rho > h->reg[idx])
+        h->reg[idx] = rho;
+}
+
+void hll_merge(struct hll *into, const struct hll *from)
+{
+    int i;
+    for (i = 0; i < HLL_M; i++) {
+        if (from->reg[i] > into->reg[i])
+            into->reg[i] = from->reg[i];
+    }
+}
+
+double hll_count(const struct hll *h)
+{
+    double alpha = 0.7213 / (1.0 + 1.079 / HLL_M);
+    double sum = 0;
+    int zeros = 0;
+    int i;
+
+    for (i = 0; i < HLL_M; i++) {
+        sum += ldexp(1.0, -h->reg[i]);
+        if (h->reg[i] == 0)
+            zeros++;
+    }
+    double est = alpha * HLL_M * HLL_M / sum;
+    /* linear counting is much better while many registers are still empty */
+    if (est <= 2.5 * HLL_M && zeros)
+        est = HLL_M * log((double)HLL_M / zeros);
+    return est;
+}
+
+void hll_free(struct hll *h) { free(h); }
+
+/* A KLL sketch is a stack of compactors.  Items at level h each stand for 2^h
+ * of the items added.  When the sketch is over capacity the lowest full level
+ * is sorted and every other item (starting at a random one of the first two)
+ * is promoted to the next level; the rest are dropped.  Capacities shrink by
+ * 2/3 per level going down from the top one, which holds k. */
+struct kll_level {
+    uint8_t *items;
+    int count;
+    int alloc;
+};
+
+struct kll {
+    int k;
+    int itemsz;
+    unsigned int seed;
+    uint64_t n;
+    int nlevels;
+    struct kll_level *levels;
+    uint8_t *tmp; /* one level's worth of sort space */
+    int tmpalloc;
+};
+
+static int kll_capacity(const struct kll *s, int level)
+{
+    double cap = s->k;
+    int i;
+    for (i = level; i < s->nlevels - 1; i++)
+        cap *= 2.0 / 3.0;
+    return cap < 2 ? 2 : (int)cap;
+}
+
+static int kll_add_level(struct kll *s)
+{
+    struct kll_level *l =
+        realloc(s->levels, (s->nlevels + 1) * sizeof(struct kll_level));
+    if (l == NULL)
+        return -1;
+    s->levels = l;
+    memset(&s->levels[s->nlevels], 0, sizeof(struct kll_level));
+    s->nlevels++;
+    return 0;
+}
+
+static int kll_reserve(struct kll *s, struct kll_level *l, int count)
+{
+    if (count <= l->alloc)
+        return 0;
+    int alloc = l->alloc ? l->alloc : 16;
+    while (alloc < count)
+        alloc *= 2;
+    uint8_t *items = realloc(l->items, (size_t)alloc * s->itemsz);
+    if (items == NULL)
+        return -1;
+    l->items = items;
+    l->alloc = alloc;
+    return 0;
+}
+
+/* Sort n records of recsz bytes by the keylen bytes at keyoff.  Bottom up
+ * merge sort, so tmp must have room for n records. */
+static void sort_recs(uint8_t *base, int n, int recsz, int keyoff, int keylen,
+                      uint8_t *tmp)
+{
+    uint8_t *from = base, *to = tmp, *swap;
+    int width, i;
+
+    for (width = 1; width < n; width *= 2) {
+        for (i = 0; i < n; i += 2 * width) {
+            int a = i, amax = i + width < n ? i + width : n;
+            int b = amax, bmax = i + 2 * width < n ? i + 2 * width : n;
+            int o = i;
+            while (a < amax || b < bmax) {
+                if (b >= bmax ||
+                    (a < amax && memcmp(from + (size_t)a * recsz + keyoff,
+                                        from + (size_t)b * recsz + keyoff,
+                                        keylen) <= 0)) {
+                    memcpy(to + (size_t)o * recsz, from + (size_t)a * recsz,
+                           recsz);
+                    a++;
+                } else {
+                    memcpy(to + (size_t)o * recsz, from + (size_t)b * recsz,
+                           recsz);
+                    b++;
+                }
+                o++;
+            }
+        }
+        swap = from;
+        from = to;
+        to = swap;
+    }
+    if (from != base)
+        memcpy(base, from, (size_t)n * recsz);
+}
+
+static int kll_size(const struct kll *s)
+{
+    int i, size = 0;
+    for (i = 0; i < s->nlevels; i++)
+        size += s->levels[i].count;
+    return size;
+}
+
+static int kll_total_capacity(const struct kll *s)
+{
+    int i, cap = 0;
+    for (i = 0; i < s->nlevels; i++)
+        cap += kll_capacity(s, i);
+    return cap;
+}
+
+static int kll_compress(struct kll *s)
+{
+    while (kll_size(s) > kll_total_capacity(s)) {
+        int h;
+        for (h = 0; h < s->nlevels; h++) {
+            if (s->levels[h].count >= kll_capacity(s, h))
+                break;
+        }
+        if (h == s->nlevels - 1 && kll_add_level(s))
+            return -1;
+
+        struct kll_level *l = &s->levels[h];
+        struct kll_level *up = &s->levels[h + 1];
+        if (l->count > s->tmpalloc) {
+            uint8_t *tmp = realloc(s->tmp, (size_t)l->count * s->itemsz);
+            if (tmp == NULL)
+                return -1;
+            s->tmp = tmp;
+            s->tmpalloc = l->count;
+        }
+        sort_recs(l->items, l->count, s->itemsz, 0, s->itemsz, s->tmp);
+
+        /* an odd one out stays behind */
+        int npair = l->count / 2;
+        int i, off = rand_r(&s->seed) & 1;
+        if (kll_reserve(s, up, up->count + npair))
+            return -1;
+        for (i = 0; i < npair; i++) {
+            memcpy(up->items + (size_t)(up->count + i) * s->itemsz,
+                   l->items + (size_t)(2 * i + off) * s->itemsz, s->itemsz);
+        }
+        up->count += npair;
+        if (l->count & 1)
+            memmove(l->items, l->items + (size_t)(l->count - 1) * s->itemsz,
+                    s->itemsz);
+        l->count &= 1;
+    }
+    return 0;
+}
+
+struct kll *kll_new(int k, int itemsz, unsigned int seed)
+{
+    struct kll *s = calloc(1, sizeof(struct kll));
+    if (s == NULL)
+        return NULL;
+    s->k = k;
+    s->itemsz = itemsz;
+    s->seed = seed;
+    if (kll_add_level(s)) {
+        free(s);
+        return NULL;
+    }
+    return s;
+}
+
+int kll_add(struct kll *s, const void *item)
+{
+    struct kll_level *l = &s->levels[0];
+    if (kll_reserve(s, l, l->count + 1))
+        return -1;
+    memcpy(l->items + (size_t)l->count * s->itemsz, item, s->itemsz);
+    l->count++;
+    s->n++;
+    if (l->count >= kll_capacity(s, 0))
+        return kll_compress(s);
+    return 0;
+}
+
+int kll_merge(struct kll *into, const struct kll *from)
+{
+    int h;
+    if (into->itemsz != from->itemsz)
+        return -1;
+    while (into->nlevels < from->nlevels) {
+        if (kll_add_level(into))
+            return -1;
+    }
+    for (h = 0; h < from->nlevels; h++) {
+        const struct kll_level *fl = &from->levels[h];
+        struct kll_level *l = &into->levels[h];
+        if (kll_reserve(into, l, l->count + fl->count))
+            return -1;
+        memcpy(l->items + (size_t)l->count * into->itemsz, fl->items,
+               (size_t)fl->count * into->itemsz);
+        l->count += fl->count;
+    }
+    into->n += from->n;
+    return kll_compress(into);
+}
+
+uint64_t kll_count(const struct kll *s) { return s->n; }
+
+uint64_t kll_rank(const struct kll *s, const void *key, int len, int inclusive)
+{
+    uint64_t rank = 0;
+    int h, i;
+    for (h = 0; h < s->nlevels; h++) {
+        const struct kll_level *l = &s->levels[h];
+        for (i = 0; i < l->count; i++) {
+            int cmp = memcmp(l->items + (size_t)i * s->itemsz, key, len);
+            if (cmp < 0 || (inclusive && cmp == 0))
+                rank += 1ULL << h;
+        }
+    }
+    return rank;
+}
+
+int kll_quantiles(const struct kll *s, int nq, void *out)
+{
+    int recsz = sizeof(uint64_t) + s->itemsz;
+    int size = kll_size(s);
+    uint64_t total = 0, cum = 0;
+    uint8_t *recs, *tmp, *o = out;
+    int h, i, j, nout = 0;
+
+    if (size == 0)
+        return 0;
+    recs = malloc((size_t)size * recsz);
+    tmp = malloc((size_t)size * recsz);
+    if (recs == NULL || tmp == NULL) {
+        free(recs);
+        free(tmp);
+        return -1;
+    }
+
+    /* each record is the item's weight followed by the item */
+    for (h = 0, j = 0; h < s->nlevels; h++) {
+        const struct kll_level *l = &s->levels[h];
+        uint64_t w = 1ULL << h;
+        for (i = 0; i < l->count; i++, j++) {
+            memcpy(recs + (size_t)j * recsz, &w, sizeof(w));
+            memcpy(recs + (size_t)j * recsz + sizeof(w),
+                   l->items + (size_t)i * s->itemsz, s->itemsz);
+            total += w;
+        }
+    }
+    sort_recs(recs, size, recsz, sizeof(uint64_t), s->itemsz, tmp);
+
+    for (i = 0, j = 0; i < nq; i++) {
+        /* the first item whose cumulative weight passes (i+0.5)/nq */
+        double target = (i + 0.5) * total / nq;
+        while (j < size - 1) {
+            uint64_t w;
+            memcpy(&w, recs + (size_t)j * recsz, sizeof(w));
+            if (cum + w > target)
+                break;
+            cum += w;
+            j++;
+        }
+        const uint8_t *item = recs + (size_t)j * recsz + sizeof(uint64_t);
+        if (nout && memcmp(o + (size_t)(nout - 1) * s->itemsz, item,
+                           s->itemsz) == 0)
+            continue;
+        memcpy(o + (size_t)nout * s->itemsz, item, s->itemsz);
+        nout++;
+    }
+
+    free(recs);
+    free(tmp);
+    return nout;
+}
+
+void kll_free(struct kll *s)
+{
+    int h;
+    if (s == NULL)
+        return;
+    for (h = 0; h < s->nlevels; h++)
+        free(s->levels[h].items);
+    free(s->levels);
+    free(s->tmp);
+    free(s);
+}
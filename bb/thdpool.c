@@ -24,7 +24,9 @@
 #include "limit_fortify.h"
 #include <alloca.h>
 #include <errno.h>
+#include <poll.h>
 #include <pthread.h>
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -77,6 +79,10 @@ struct thd {
     /* To signal thread if there is work for it. */
     pthread_cond_t cond;
 
+    /* Protects work.persistent_info against the dump on full queue when the
+     * thread picks up queued work without the pool lock (lockfree pools). */
+    pthread_mutex_t info_lk;
+
     int on_freelist;
 
     LINKC_T(struct thd) thdlist_linkv;
@@ -134,6 +140,23 @@ struct thdpool {
     pool_t *pool;
     LISTC_T(struct workitem) queue;
 
+    /* Lockfree pools queue work on a bounded lock-free ring instead, so that
+     * once every thread is busy enqueuers and workers don't serialize on the
+     * pool mutex.  The ring is sized from maxq + maxqover the first time it
+     * is needed, and grows under the pool mutex if they are raised. */
+    int lockfree;
+    unsigned nfree; /* listc_size(&freelist), readable without the mutex */
+    struct lfq_cell *lfq;
+    unsigned lfq_mask;
+    unsigned lfq_count; /* queued items, reserved before they are published */
+    unsigned lfq_users; /* threads using the ring without the pool mutex */
+    int lfq_resizing;   /* set while the ring is being swapped */
+    char lfq_pad0[64];
+    unsigned long long lfq_head; /* next ring position to enqueue */
+    char lfq_pad1[64];
+    unsigned long long lfq_tail; /* next ring position to dequeue */
+    char lfq_pad2[64];
+
     int exit_on_create_fail;
 
     /* slow enqueue request to block until we have an available thread */
@@ -155,6 +178,14 @@ struct thdpool {
 #endif
 };
 
+struct lfq_cell {
+    unsigned long long seq;
+    struct workitem item;
+};
+
+/* Create pools with a lock-free work queue */
+int gbl_thdpool_lockfree_queue = 0;
+
 pthread_mutex_t pool_list_lk = PTHREAD_MUTEX_INITIALIZER;
 LISTC_T(struct thdpool) threadpools;
 pthread_once_t init_pool_list_once = PTHREAD_ONCE_INIT;
@@ -262,6 +293,7 @@ struct thdpool *thdpool_create(const char *name, size_t per_thread_data_sz)
     pool->wait = 0;
     pool->exit_on_create_fail = 1;
     pool->dump_on_full = 0;
+    pool->lockfree = gbl_thdpool_lockfree_queue;
 
     pthread_cond_init(&pool->wait_for_thread, NULL);
 
@@ -341,6 +373,12 @@ void thdpool_set_delt_fn(struct thdpool *pool, thdpool_thddelt_fn delt_fn)
 
 void thdpool_set_wait(struct thdpool *pool, int wait) { pool->wait = wait; }
 
+/* Only before the pool gets its first work item */
+void thdpool_set_lockfree(struct thdpool *pool, int onoff)
+{
+    pool->lockfree = onoff;
+}
+
 void thdpool_set_dump_on_full(struct thdpool *pool, int onoff)
 {
     pool->dump_on_full = onoff;
@@ -372,7 +410,10 @@ void thdpool_print_stats(FILE *fh, struct thdpool *pool)
         logmsgf(LOGMSG_USER, fh, "  Work queue peak size      : %u\n", pool->peakqueue);
         logmsgf(LOGMSG_USER, fh, "  Work queue maximum size   : %u\n", pool->maxqueue);
         logmsgf(LOGMSG_USER, fh, "  Work queue current size   : %u\n",
-                listc_size(&pool->queue));
+                thdpool_get_nqueuedworks(pool));
+        if (pool->lockfree)
+            logmsgf(LOGMSG_USER, fh, "  Lock-free queue capacity  : %u\n",
+                    pool->lfq ? pool->lfq_mask + 1 : 0);
         logmsgf(LOGMSG_USER, fh, "  Long wait alarm threshold : %u ms\n", pool->longwaitms);
         logmsgf(LOGMSG_USER, fh, "  Thread linger time        : %u seconds\n",
                 pool->lingersecs);
@@ -551,6 +592,146 @@ void thdpool_resume(struct thdpool *pool)
     UNLOCK(&pool->mutex);
 }
 
+/* Bounded MPMC ring: a cell is free for position pos when its seq is pos and
+ * holds the item for pos when its seq is pos + 1.  Returns -1 if full. */
+static int lfq_push(struct thdpool *pool, const struct workitem *item)
+{
+    struct lfq_cell *cell;
+    unsigned long long pos, seq;
+    long long diff;
+
+    __atomic_add_fetch(&pool->lfq_count, 1, __ATOMIC_SEQ_CST);
+    pos = __atomic_load_n(&pool->lfq_head, __ATOMIC_RELAXED);
+    for (;;) {
+        cell = &pool->lfq[pos & pool->lfq_mask];
+        seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        diff = (long long)(seq - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&pool->lfq_head, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        } else if (diff < 0) {
+            __atomic_sub_fetch(&pool->lfq_count, 1, __ATOMIC_SEQ_CST);
+            return -1;
+        } else {
+            pos = __atomic_load_n(&pool->lfq_head, __ATOMIC_RELAXED);
+        }
+    }
+    cell->item = *item;
+    __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/* Returns 1 and the oldest item, 0 if the ring is empty. */
+static int lfq_pop(struct thdpool *pool, struct workitem *item)
+{
+    struct lfq_cell *cell;
+    unsigned long long pos, seq;
+    long long diff;
+
+    if (!__atomic_load_n(&pool->lfq, __ATOMIC_ACQUIRE))
+        return 0;
+    pos = __atomic_load_n(&pool->lfq_tail, __ATOMIC_RELAXED);
+    for (;;) {
+        cell = &pool->lfq[pos & pool->lfq_mask];
+        seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        diff = (long long)(seq - (pos + 1));
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&pool->lfq_tail, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        } else if (diff < 0) {
+            return 0;
+        } else {
+            pos = __atomic_load_n(&pool->lfq_tail, __ATOMIC_RELAXED);
+        }
+    }
+    *item = cell->item;
+    __atomic_store_n(&cell->seq, pos + pool->lfq_mask + 1, __ATOMIC_RELEASE);
+    __atomic_sub_fetch(&pool->lfq_count, 1, __ATOMIC_SEQ_CST);
+    return 1;
+}
+
+/* Allocate the ring of a lockfree pool, or swap it for a bigger one once
+ * maxq + maxqover no longer fit; call with the pool lock held.  The lock
+ * keeps out the locked users of the ring, and the others are waited out.
+ * Queued items move to the new ring in order. */
+static int lfq_fit_ll(struct thdpool *pool)
+{
+    struct lfq_cell *old = pool->lfq, *lfq;
+    unsigned want = pool->maxqueue + pool->maxqueueoverride;
+    unsigned sz = 64;
+    unsigned ii, n = 0;
+    struct workitem item;
+
+    while (sz < want && sz < (1U << 30))
+        sz <<= 1;
+    if (old && sz <= pool->lfq_mask + 1)
+        return 0;
+    lfq = calloc(sz, sizeof(struct lfq_cell));
+    if (!lfq)
+        return -1;
+    for (ii = 0; ii < sz; ii++)
+        lfq[ii].seq = ii;
+    if (old) {
+        __atomic_store_n(&pool->lfq_resizing, 1, __ATOMIC_SEQ_CST);
+        while (__atomic_load_n(&pool->lfq_users, __ATOMIC_SEQ_CST))
+            sched_yield();
+        while (lfq_pop(pool, &item)) {
+            lfq[n].item = item;
+            lfq[n].seq = n + 1;
+            n++;
+        }
+        __atomic_add_fetch(&pool->lfq_count, n, __ATOMIC_SEQ_CST);
+    }
+    pool->lfq_mask = sz - 1;
+    __atomic_store_n(&pool->lfq_head, n, __ATOMIC_RELAXED);
+    __atomic_store_n(&pool->lfq_tail, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&pool->lfq, lfq, __ATOMIC_RELEASE);
+    if (old) {
+        __atomic_store_n(&pool->lfq_resizing, 0, __ATOMIC_SEQ_CST);
+        free(old);
+    }
+    return 0;
+}
+
+/* Threads using the ring without the pool lock bracket each use with these,
+ * so lfq_fit_ll can tell when none of them is left inside.  lfq_enter fails
+ * while the ring is being swapped; use the locked path then. */
+static int lfq_enter(struct thdpool *pool)
+{
+    __atomic_add_fetch(&pool->lfq_users, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&pool->lfq_resizing, __ATOMIC_SEQ_CST)) {
+        __atomic_sub_fetch(&pool->lfq_users, 1, __ATOMIC_SEQ_CST);
+        return 0;
+    }
+    return 1;
+}
+
+static void lfq_leave(struct thdpool *pool)
+{
+    __atomic_sub_fetch(&pool->lfq_users, 1, __ATOMIC_SEQ_CST);
+}
+
+/* Take the next queued item of a lockfree pool, dropping the ones that sat in
+ * the queue longer than maxqueueagems.  No lock needed. */
+static int lfq_get_work(struct thdpool *pool, struct workitem *work)
+{
+    while (lfq_pop(pool, work)) {
+        if (pool->maxqueueagems > 0 &&
+            time_epochms() - work->queue_time_ms > pool->maxqueueagems) {
+            free(work->persistent_info);
+            work->persistent_info = NULL;
+            work->work_fn(pool, work->work, NULL, THD_FREE);
+            __atomic_add_fetch(&pool->num_timeout, 1, __ATOMIC_RELAXED);
+            continue;
+        }
+        __atomic_add_fetch(&pool->num_dequeued, 1, __ATOMIC_RELAXED);
+        return 1;
+    }
+    return 0;
+}
+
 /* Get the next item of work for this thread to do.  Returns 0 if there
  * is no work. */
 static int get_work_ll(struct thd *thd, struct workitem *work)
@@ -561,6 +742,11 @@ static int get_work_ll(struct thd *thd, struct workitem *work)
         memcpy(work, &thd->work, sizeof(*work));
         thd->work.available = 0;
         return 1;
+    } else if (thd->pool->lockfree) {
+        if (!lfq_get_work(thd->pool, work))
+            return 0;
+        thd->work.persistent_info = work->persistent_info;
+        return 1;
     } else {
         while ((next = listc_rtl(&thd->pool->queue)) != NULL) {
             if (thd->pool->maxqueueagems > 0 &&
@@ -627,6 +813,23 @@ static void *thdpool_thd(void *voidarg)
     while (1) {
         int diffms;
 
+        /* Once every thread is busy, workers of a lockfree pool keep taking
+         * queued work without going through the pool lock. */
+        if (pool->lockfree && lfq_enter(pool)) {
+            struct workitem next;
+            int got = lfq_get_work(pool, &next);
+            lfq_leave(pool);
+            if (got) {
+                pthread_mutex_lock(&thd->info_lk);
+                if (work.persistent_info)
+                    free(work.persistent_info);
+                thd->work.persistent_info = next.persistent_info;
+                pthread_mutex_unlock(&thd->info_lk);
+                work = next;
+                goto run;
+            }
+        }
+
         LOCK(&pool->mutex)
         {
             if (work.persistent_info) {
@@ -660,8 +863,10 @@ static void *thdpool_thd(void *voidarg)
                 if (pool->stopped || thr_exit) {
                     /* Thread exiting - remove from pools lists */
                     listc_rfl(&pool->thdlist, thd);
-                    if (thd->on_freelist)
+                    if (thd->on_freelist) {
                         listc_rfl(&pool->freelist, thd);
+                        __atomic_sub_fetch(&pool->nfree, 1, __ATOMIC_SEQ_CST);
+                    }
                     pool->num_exits++;
                     errUNLOCK(&pool->mutex);
 
@@ -676,6 +881,16 @@ static void *thdpool_thd(void *voidarg)
                 if (!thd->on_freelist) {
                     listc_atl(&pool->freelist, thd);
                     thd->on_freelist = 1;
+                    __atomic_add_fetch(&pool->nfree, 1, __ATOMIC_SEQ_CST);
+                }
+                /* An enqueuer that saw no free thread may have queued work
+                 * after we looked; see thdpool_enqueue. */
+                if (pool->lockfree &&
+                    __atomic_load_n(&pool->lfq_count, __ATOMIC_SEQ_CST)) {
+                    listc_rfl(&pool->freelist, thd);
+                    thd->on_freelist = 0;
+                    __atomic_sub_fetch(&pool->nfree, 1, __ATOMIC_SEQ_CST);
+                    continue;
                 }
                 if (ts) {
                     rc = pthread_cond_timedwait(&thd->cond, &pool->mutex, ts);
@@ -695,10 +910,18 @@ static void *thdpool_thd(void *voidarg)
 
             /* We have work.  We will already have been removed from the
              * free list by the enqueue function so just take our work
-             * parameters, release lock and do it. */
+             * parameters, release lock and do it.  Lockfree pools can also
+             * hand us queued work while we are still on the free list. */
+            if (thd->on_freelist) {
+                listc_rfl(&pool->freelist, thd);
+                thd->on_freelist = 0;
+                __atomic_sub_fetch(&pool->nfree, 1, __ATOMIC_SEQ_CST);
+            }
         }
         UNLOCK(&pool->mutex);
 
+    run:
+
         diffms = time_epochms() - work.queue_time_ms;
         if (diffms > pool->longwaitms) {
             logmsg(LOGMSG_WARN, "%s(%s): long wait %d ms\n", __func__, pool->name,
@@ -725,6 +948,7 @@ thread_exit:
         delt_fn(pool, thddata);
 
     pthread_cond_destroy(&thd->cond);
+    pthread_mutex_destroy(&thd->info_lk);
 
     thread_memdestroy();
 
@@ -741,11 +965,57 @@ int thdpool_enqueue(struct thdpool *pool, thdpool_work_fn work_fn, void *work,
     size_t mem_sz;
     extern comdb2bma blobmem;
 
+    /* Fast path for a saturated lockfree pool: every thread is busy and we
+     * can't create more, so queue the work without taking the pool lock.
+     * Anything near a limit goes through the locked path below. */
+    if (pool->lockfree && !pool->stopped && !pool->wait && pool->maxnthd &&
+        __atomic_load_n(&pool->lfq, __ATOMIC_ACQUIRE) &&
+        __atomic_load_n(&pool->nfree, __ATOMIC_SEQ_CST) == 0 &&
+        listc_size(&pool->thdlist) >= pool->maxnthd &&
+        __atomic_load_n(&pool->lfq_count, __ATOMIC_RELAXED) < pool->maxqueue) {
+        struct workitem qitem = {0};
+        qitem.work = work;
+        qitem.work_fn = work_fn;
+        qitem.persistent_info = persistent_info;
+        qitem.queue_time_ms = time_epochms();
+        qitem.available = 1;
+        int pushed = 0;
+        if (lfq_enter(pool)) {
+            pushed = (lfq_push(pool, &qitem) == 0);
+            lfq_leave(pool);
+        }
+        if (pushed) {
+            unsigned nqueued;
+            __atomic_add_fetch(&pool->num_enqueued, 1, __ATOMIC_RELAXED);
+            nqueued = __atomic_load_n(&pool->lfq_count, __ATOMIC_RELAXED);
+            if (nqueued > pool->peakqueue)
+                pool->peakqueue = nqueued;
+            /* Pairs with the worker adding itself to the free list and then
+             * rechecking the queue: one of us sees the other. */
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+            if (__atomic_load_n(&pool->nfree, __ATOMIC_SEQ_CST)) {
+                LOCK(&pool->mutex)
+                {
+                    struct thd *thd = listc_rtl(&pool->freelist);
+                    if (thd) {
+                        thd->on_freelist = 0;
+                        __atomic_sub_fetch(&pool->nfree, 1, __ATOMIC_SEQ_CST);
+                        pthread_cond_signal(&thd->cond);
+                    }
+                }
+                UNLOCK(&pool->mutex);
+            }
+            comdb2bma_yield_all();
+            return 0;
+        }
+    }
+
     LOCK(&pool->mutex)
     {
         struct thd *thd;
         struct workitem *item = NULL;
-        unsigned nbusy;
+        struct workitem qitem = {0};
+        unsigned nbusy, nqueued;
 
         if (pool->stopped) {
             pool->num_failed_dispatches++;
@@ -786,6 +1056,8 @@ int thdpool_enqueue(struct thdpool *pool, thdpool_work_fn work_fn, void *work,
      * work item to the new thread. */
     again:
         thd = listc_rtl(&pool->freelist);
+        if (thd)
+            __atomic_sub_fetch(&pool->nfree, 1, __ATOMIC_SEQ_CST);
         if (!thd && (pool->maxnthd == 0 ||
                      listc_size(&pool->thdlist) < pool->maxnthd)) {
             int rc;
@@ -800,6 +1072,7 @@ int thdpool_enqueue(struct thdpool *pool, thdpool_work_fn work_fn, void *work,
             }
 
             pthread_cond_init(&thd->cond, NULL);
+            pthread_mutex_init(&thd->info_lk, NULL);
             thd->pool = pool;
             listc_atl(&pool->thdlist, thd);
 
@@ -825,6 +1098,7 @@ int thdpool_enqueue(struct thdpool *pool, thdpool_work_fn work_fn, void *work,
                 logmsg(LOGMSG_ERROR, "%s(%s):pthread_create: %d %s\n", __func__,
                         pool->name, rc, strerror(rc));
                 pthread_cond_destroy(&thd->cond);
+                pthread_mutex_destroy(&thd->info_lk);
                 free(thd);
                 return -1;
             }
@@ -857,24 +1131,25 @@ int thdpool_enqueue(struct thdpool *pool, thdpool_work_fn work_fn, void *work,
             pool->num_passed++;
         } else {
             /* queue work */
-            if (listc_size(&pool->queue) >= pool->maxqueue) {
+            nqueued = thdpool_get_nqueuedworks(pool);
+            if (nqueued >= pool->maxqueue) {
                 if (queue_override &&
                     (!pool->maxqueueoverride ||
-                     listc_size(&pool->queue) <
+                     nqueued <
                          (pool->maxqueue + pool->maxqueueoverride))) {
-                    if (thdpool_alarm_on_queing(listc_size(&pool->queue))) {
+                    if (thdpool_alarm_on_queing(nqueued)) {
                         int now = time_epoch();
 
                         if (now > pool->last_queue_alarm ||
-                            listc_size(&pool->queue) > pool->last_alarm_max) {
+                            nqueued > pool->last_alarm_max) {
                             logmsg(LOGMSG_USER, "%d Queing sql, queue size=%d. "
                                             "max_queue=%d "
                                             "max_queue_override=%d\n",
-                                    __LINE__, listc_size(&pool->queue),
+                                    __LINE__, nqueued,
                                     pool->maxqueue, pool->maxqueueoverride);
 
                             pool->last_queue_alarm = now;
-                            pool->last_alarm_max = listc_size(&pool->queue);
+                            pool->last_alarm_max = nqueued;
                         }
                     }
                 } else {
@@ -882,7 +1157,7 @@ int thdpool_enqueue(struct thdpool *pool, thdpool_work_fn work_fn, void *work,
                         logmsg(LOGMSG_USER, "%d FAILED to queue sql, queue "
                                         "size=%d. max_queue=%d "
                                         "max_queue_override=%d\n",
-                                __LINE__, listc_size(&pool->queue),
+                                __LINE__, nqueued,
                                 pool->maxqueue, pool->maxqueueoverride);
                     }
 
@@ -904,10 +1179,12 @@ int thdpool_enqueue(struct thdpool *pool, thdpool_work_fn work_fn, void *work,
                             LISTC_FOR_EACH(&pool->thdlist, thd, thdlist_linkv)
                             {
                                 crt++;
+                                pthread_mutex_lock(&thd->info_lk);
                                 ctrace("%d. %s\n", crt,
                                        (thd->work.persistent_info)
                                            ? thd->work.persistent_info
                                            : "NULL");
+                                pthread_mutex_unlock(&thd->info_lk);
                             }
                             ctrace(" === Done (%d sql queries)\n", crt);
                             last_dump = time(
@@ -925,7 +1202,18 @@ int thdpool_enqueue(struct thdpool *pool, thdpool_work_fn work_fn, void *work,
                     return -1;
                 }
             }
-            item = pool_getablk(pool->pool);
+            if (pool->lockfree) {
+                if (lfq_fit_ll(pool)) {
+                    pool->num_failed_dispatches++;
+                    errUNLOCK(&pool->mutex);
+                    logmsg(LOGMSG_ERROR, "%s(%s):lfq_fit_ll failed\n",
+                           __func__, pool->name);
+                    return -1;
+                }
+                item = &qitem;
+            } else {
+                item = pool_getablk(pool->pool);
+            }
             if (!item) {
                 pool->num_failed_dispatches++;
                 errUNLOCK(&pool->mutex);
@@ -933,11 +1221,12 @@ int thdpool_enqueue(struct thdpool *pool, thdpool_work_fn work_fn, void *work,
                         pool->name);
                 return -1;
             }
-            pool->num_enqueued++;
-            listc_abl(&pool->queue, item);
-
-            if (listc_size(&pool->queue) > pool->peakqueue) {
-                pool->peakqueue = listc_size(&pool->queue);
+            if (!pool->lockfree) {
+                pool->num_enqueued++;
+                listc_abl(&pool->queue, item);
+                if (listc_size(&pool->queue) > pool->peakqueue) {
+                    pool->peakqueue = listc_size(&pool->queue);
+                }
             }
         }
 
@@ -947,6 +1236,21 @@ int thdpool_enqueue(struct thdpool *pool, thdpool_work_fn work_fn, void *work,
         item->queue_time_ms = time_epochms();
         item->available = 1;
 
+        if (item == &qitem) {
+            if (lfq_push(pool, item)) {
+                pool->num_failed_dispatches++;
+                errUNLOCK(&pool->mutex);
+                logmsg(LOGMSG_ERROR, "%s(%s):lock-free queue full\n", __func__,
+                       pool->name);
+                return -1;
+            }
+            __atomic_add_fetch(&pool->num_enqueued, 1, __ATOMIC_RELAXED);
+            nqueued = thdpool_get_nqueuedworks(pool);
+            if (nqueued > pool->peakqueue) {
+                pool->peakqueue = nqueued;
+            }
+        }
+
         /* Now wake up the thread with work to do. */
         if (!thd) {
             comdb2bma_yield_all();
@@ -1048,6 +1352,8 @@ int thdpool_get_maxqueue(struct thdpool *pool)
 
 int thdpool_get_nqueuedworks(struct thdpool *pool)
 {
+    if (pool->lockfree)
+        return __atomic_load_n(&pool->lfq_count, __ATOMIC_RELAXED);
     return listc_size(&pool->queue);
 }
 
@@ -1100,3 +1406,103 @@ struct thdpool *thdpool_next_pool(struct thdpool *pool)
 {
     return (pool) ? pool->lnk.next : 0;
 }
+
+/* thdpool_bench: enqueue/dequeue throughput of a mutex queued pool against a
+ * lockfree one, with as many producers as pool threads. */
+static unsigned bench_done;
+
+static void bench_work(struct thdpool *pool, void *work, void *thddata, int op)
+{
+    if (op == THD_RUN)
+        __atomic_add_fetch(&bench_done, 1, __ATOMIC_RELAXED);
+}
+
+struct bench_producer {
+    pthread_t tid;
+    struct thdpool *pool;
+    int nitems;
+    int nfailed;
+};
+
+static void *bench_producer(void *arg)
+{
+    struct bench_producer *p = arg;
+    int ii;
+    for (ii = 0; ii < p->nitems; ii++) {
+        if (thdpool_enqueue(p->pool, bench_work, NULL, 0, NULL))
+            p->nfailed++;
+    }
+    return NULL;
+}
+
+static int bench_run(struct thdpool *pool, int nthds, int nitems)
+{
+    struct bench_producer *prod = calloc(nthds, sizeof(*prod));
+    unsigned expected = 0;
+    int ii, start;
+
+    if (!prod)
+        return -1;
+    thdpool_set_minthds(pool, nthds);
+    thdpool_set_maxthds(pool, nthds);
+    __atomic_store_n(&bench_done, 0, __ATOMIC_SEQ_CST);
+    start = time_epochms();
+    for (ii = 0; ii < nthds; ii++) {
+        prod[ii].pool = pool;
+        prod[ii].nitems = nitems / nthds;
+        if (pthread_create(&prod[ii].tid, NULL, bench_producer, &prod[ii])) {
+            prod[ii].nitems = 0;
+            prod[ii].tid = 0;
+        }
+    }
+    for (ii = 0; ii < nthds; ii++) {
+        if (prod[ii].tid)
+            pthread_join(prod[ii].tid, NULL);
+        expected += prod[ii].nitems - prod[ii].nfailed;
+    }
+    while (__atomic_load_n(&bench_done, __ATOMIC_SEQ_CST) < expected)
+        poll(NULL, 0, 1);
+    free(prod);
+    return time_epochms() - start;
+}
+
+void thdpool_bench(int maxthreads, int nitems)
+{
+    static struct thdpool *pools[2];
+    static pthread_mutex_t lk = PTHREAD_MUTEX_INITIALIZER;
+    int nthds, ii;
+
+    pthread_mutex_lock(&lk);
+    for (ii = 0; ii < 2; ii++) {
+        if (pools[ii])
+            continue;
+        pools[ii] = thdpool_create(ii ? "benchlockfree" : "benchlocked", 0);
+        if (!pools[ii]) {
+            pthread_mutex_unlock(&lk);
+            logmsg(LOGMSG_ERROR, "%s: thdpool_create failed\n", __func__);
+            return;
+        }
+        thdpool_set_lockfree(pools[ii], ii);
+        thdpool_set_linger(pools[ii], 1);
+        thdpool_set_longwaitms(pools[ii], 1000000);
+    }
+    for (ii = 0; ii < 2; ii++) {
+        if (thdpool_get_maxqueue(pools[ii]) < nitems)
+            thdpool_set_maxqueue(pools[ii], nitems);
+    }
+    for (nthds = 1; nthds <= maxthreads; nthds *= 2) {
+        for (ii = 0; ii < 2; ii++) {
+            int ms = bench_run(pools[ii], nthds, nitems);
+            if (ms < 0)
+                continue;
+            logmsg(LOGMSG_USER,
+                   "thdpool_bench %-8s %3d threads %d items %6d ms "
+                   "%.0f items/sec\n",
+                   ii ? "lockfree" : "locked", nthds, nitems, ms,
+                   ms ? (nitems / nthds * nthds) * 1000.0 / ms : 0.0);
+        }
+    }
+    for (ii = 0; ii < 2; ii++)
+        thdpool_set_minthds(pools[ii], 0);
+    pthread_mutex_unlock(&lk);
+}
@@ -150,6 +150,13 @@ void hash_free_resized_tables(hash_t *h);
  */
 void hash_config_lockfree_query(hash_t *h);
 
+/* split an empty hash into nstripes independently locked sub-tables, so that
+ * threads can share it without a mutex of their own.  Returns 0 on success.
+ * All routines except hash_first()/hash_next() then lock internally; hash_for()
+ * holds a stripe's lock while calling func, so func must not use the hash.
+ * Objects returned by the find routines are not locked; keeping them alive is
+ * still up to the caller. */
+int hash_config_concurrent(hash_t *h, int nstripes);
 /* enable/disable stat collection for hash queries */
 void hash_config_query_stats(hash_t *h, const int enable);
 
@@ -90,6 +90,11 @@ int SBUF2_FUNC(sbuf2flush)(SBUF2 *sb);
 int SBUF2_FUNC(sbuf2setbufsize)(SBUF2 *sb, unsigned int size);
 #define sbuf2setbufsize SBUF2_FUNC(sbuf2setbufsize)
 
+/* grows the buffers without losing anything already read ahead. pending
+   writes are flushed first. never shrinks. returns 0 on success */
+int SBUF2_FUNC(sbuf2growbuf)(SBUF2 *sb, unsigned int size);
+#define sbuf2growbuf SBUF2_FUNC(sbuf2growbuf)
+
 /* put character. returns # of bytes written (always 1) or <0 for err */
 int SBUF2_FUNC(sbuf2putc)(SBUF2 *sb, char c);
 #define sbuf2putc SBUF2_FUNC(sbuf2putc)
@@ -167,6 +172,10 @@ void SBUF2_FUNC(sbuf2setuserptr)(SBUF2 *sb, void *userptr);
 void *SBUF2_FUNC(sbuf2getuserptr)(SBUF2 *sb);
 #define sbuf2getuserptr SBUF2_FUNC(sbuf2getuserptr)
 
+/* number of bytes that can be read without going to the socket */
+int SBUF2_FUNC(sbuf2pending)(SBUF2 *sb);
+#define sbuf2pending SBUF2_FUNC(sbuf2pending)
+
 #if SBUF2_UNGETC
 int SBUF2_FUNC(sbuf2ungetc)(char c, SBUF2 *sb);
 #  define sbuf2ungetc SBUF2_FUNC(sbuf2ungetc)
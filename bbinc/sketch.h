@@ -0,0 +1,52 @@
+/*
+   Copyright 2017 Bloomberg Finance L.P.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef INCLUDED_SKETCH_H
+#define INCLUDED_SKETCH_H
+
+#include <stdint.h>
+
+/* Streaming summaries that take each value once, in any order, in bounded
+ * memory, and that can be merged.  Neither is thread safe; give each thread
+ * its own and merge them at the end. */
+
+uint64_t sketch_hash(const void *key, int len);
+
+/* HyperLogLog distinct value counter, about 1% error. */
+struct hll;
+struct hll *hll_new(void);
+void hll_add(struct hll *h, const void *key, int len);
+void hll_merge(struct hll *into, const struct hll *from);
+double hll_count(const struct hll *h);
+void hll_free(struct hll *h);
+
+/* KLL quantile sketch over fixed size byte strings ordered by memcmp.  k
+ * trades memory for accuracy; ranks are within about 1.7/k of n with k=200. */
+struct kll;
+struct kll *kll_new(int k, int itemsz, unsigned int seed);
+int kll_add(struct kll *s, const void *item);
+int kll_merge(struct kll *into, const struct kll *from);
+uint64_t kll_count(const struct kll *s);
+/* Estimated number of items whose first len bytes compare below the first
+ * len bytes of key, or below or equal to them if inclusive is set. */
+uint64_t kll_rank(const struct kll *s, const void *key, int len, int inclusive);
+/* Write the items at quantiles (i+0.5)/nq for i in 0..nq-1 into out, which
+ * has room for nq items, skipping repeats.  Returns the number written or -1
+ * if out of memory. */
+int kll_quantiles(const struct kll *s, int nq, void *out);
+void kll_free(struct kll *s);
+
+#endif
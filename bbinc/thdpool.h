@@ -112,6 +112,8 @@ int thdpool_get_dump_on_full(struct thdpool *pool);
 void thdpool_list_pools(void);
 void thdpool_command_to_all(char *line, int lline, int st);
 void thdpool_set_dump_on_full(struct thdpool *pool, int onoff);
+void thdpool_set_lockfree(struct thdpool *pool, int onoff);
+void thdpool_bench(int maxthreads, int nitems);
 
 int thdpool_lock(struct thdpool *pool);
 int thdpool_unlock(struct thdpool *pool);
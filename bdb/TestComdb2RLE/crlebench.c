@@ -0,0 +1,168 @@
+/*
+   Copyright 2015 Bloomberg Finance L.P.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+/* Compress/decompress throughput over the testcrle corpus, once per run
+ * scanner this cpu supports.  Every scanner has to produce the same bytes.
+ *
+ *   cc -O2 -I../../comdb2rle -o crlebench crlebench.c
+ *   ./crlebench [passes]
+ */
+
+#include <comdb2rle.c> // need access to the scanners
+
+#include <dirent.h>
+#include <limits.h>
+#include <sys/time.h>
+
+#define MAXIN 32768
+
+struct corpus {
+    char name[PATH_MAX];
+    uint8_t *data;
+    size_t sz;
+    uint8_t *enc; // reference encoding from the scalar scanner
+    size_t encsz;
+};
+
+static struct corpus files[256];
+static int nfiles;
+static size_t corpus_bytes;
+
+static void add_file(const char *path)
+{
+    if (nfiles == CNT(files))
+        return;
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+        return;
+    struct corpus *c = &files[nfiles];
+    c->data = malloc(MAXIN);
+    c->sz = fread(c->data, 1, MAXIN, f);
+    fclose(f);
+    if (c->sz == 0) {
+        free(c->data);
+        return;
+    }
+    snprintf(c->name, sizeof(c->name), "%s", path);
+    corpus_bytes += c->sz;
+    ++nfiles;
+}
+
+static void add_dir(const char *dirpath)
+{
+    char path[PATH_MAX];
+    DIR *dir = opendir(dirpath);
+    if (dir == NULL)
+        return;
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        if (ent->d_name[0] == '.')
+            continue;
+        if (strcmp(ent->d_name, "crlebench") == 0 ||
+            strstr(ent->d_name, ".c") != NULL)
+            continue;
+        snprintf(path, sizeof(path), "%s/%s", dirpath, ent->d_name);
+        add_file(path);
+    }
+    closedir(dir);
+}
+
+static double now(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static int run(const char *name, match_len_t fn, int passes)
+{
+    uint8_t out[MAXIN * 2], back[MAXIN];
+    size_t comp = 0;
+    int bad = 0;
+    match_len = fn;
+
+    double start = now();
+    for (int p = 0; p < passes; ++p) {
+        for (int i = 0; i < nfiles; ++i) {
+            struct corpus *c = &files[i];
+            Comdb2RLE e = {
+                .in = c->data, .insz = c->sz, .out = out, .outsz = sizeof(out)};
+            if (compressComdb2RLE(&e) != 0) {
+                fprintf(stderr, "%s: compress failed %s\n", name, c->name);
+                return 1;
+            }
+            if (p == 0) {
+                comp += e.outsz;
+                if (c->enc == NULL) {
+                    c->enc = malloc(e.outsz);
+                    memcpy(c->enc, out, e.outsz);
+                    c->encsz = e.outsz;
+                } else if (c->encsz != e.outsz ||
+                           memcmp(c->enc, out, e.outsz) != 0) {
+                    fprintf(stderr, "%s: output differs from scalar for %s\n",
+                            name, c->name);
+                    bad = 1;
+                }
+            }
+        }
+    }
+    double ctime = now() - start;
+
+    start = now();
+    for (int p = 0; p < passes; ++p) {
+        for (int i = 0; i < nfiles; ++i) {
+            struct corpus *c = &files[i];
+            Comdb2RLE d = {
+                .in = c->enc, .insz = c->encsz, .out = back, .outsz = c->sz};
+            if (decompressComdb2RLE(&d) != 0 || d.outsz != c->sz ||
+                memcmp(back, c->data, c->sz) != 0) {
+                fprintf(stderr, "%s: roundtrip failed %s\n", name, c->name);
+                return 1;
+            }
+        }
+    }
+    double dtime = now() - start;
+
+    double mb = (double)corpus_bytes * passes / (1024 * 1024);
+    printf("%-8s compress %9.1f MB/s  decompress %9.1f MB/s  ratio %.3f\n",
+           name, mb / ctime, mb / dtime, (double)comp / corpus_bytes);
+    return bad;
+}
+
+int main(int argc, char *argv[])
+{
+    int passes = argc > 1 ? atoi(argv[1]) : 2000;
+    if (passes <= 0)
+        passes = 1;
+
+    add_dir(".");
+    add_dir("inputs");
+    if (nfiles == 0) {
+        fprintf(stderr, "no corpus; run from bdb/TestComdb2RLE\n");
+        return 1;
+    }
+    printf("%d files, %zu bytes, %d passes\n", nfiles, corpus_bytes, passes);
+
+    int bad = run("scalar", match_len_scalar, passes);
+#ifdef CRLE_SIMD
+    bad |= run("sse2", match_len_sse2, passes);
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        bad |= run("avx2", match_len_avx2, passes);
+#endif
+    comdb2rle_init(1);
+    return bad;
+}
@@ -250,6 +250,11 @@ DEF_ATTR(TEMPTABLE_MEM_THRESHOLD, temptable_mem_threshold, QUANTITY, 512,
 DEF_ATTR(TEMPTABLE_CACHESZ, temptable_cachesz, BYTES, 262144,
          "Cache size for temporary tables. Temp tables do not share the "
          "database's main buffer pool.")
+DEF_ATTR(TEMPTABLE_SKIPLIST, temptable_skiplist, BOOLEAN, 0,
+         "Keep ordered temp tables in an in-memory skiplist until they outgrow "
+         "temptable_skiplist_budget, then spill them to a btree.")
+DEF_ATTR(TEMPTABLE_SKIPLIST_BUDGET, temptable_skiplist_budget, BYTES, 8388608,
+         "Memory an in-memory temp table may use before it spills to disk.")
 DEF_ATTR(PARTICIPANTID_BITS, participantid_bits, QUANTITY, 0,
          "Number of bits allocated for the participant stripe ID (remaining "
          "bits are used for the update ID).")
@@ -274,6 +279,9 @@ DEF_ATTR(BULK_SQL_THRESHOLD, bulk_sql_threshold, QUANTITY, 2, NULL)
 DEF_ATTR(DEBUG_BDB_LOCK_STACK, debug_bdb_lock_stack, BOOLEAN, 0, NULL)
 DEF_ATTR(LLMETA, llmeta, BOOLEAN, 1, NULL)
 DEF_ATTR(SQL_OPTIMIZE_SHADOWS, sql_optimize_shadows, BOOLEAN, 0, NULL)
+DEF_ATTR(SNAPISOL_VERSION_STORE, snapisol_version_store, MBYTES, 64,
+         "Memory for row before-images shared by snapshot/serializable "
+         "transactions replaying the log. 0 disables the store.")
 DEF_ATTR(CHECK_LOCKER_LOCKS, check_locker_locks, BOOLEAN, 0,
          "Sanity check locks at end of transaction.")
 DEF_ATTR(DEADLOCK_MOST_WRITES, deadlock_most_writes, BOOLEAN, 0,
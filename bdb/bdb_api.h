@@ -884,6 +884,15 @@ int bdb_queue_get(bdb_state_type *bdb_state, int consumer,
                   struct bdb_queue_cursor *fndcursor, unsigned int *epoch,
                   int *bdberr);
 
+/* get up to maxitems items unconsumed by this consumer in one pass, after
+ * prevcursor and before maxgenid (0 for no limit).  *nfound items are
+ * returned in fnd[] and fnddtalen[]; the data of each is at the offset
+ * bdb_queue_get_found_info() gives and the caller frees every fnd[i]. */
+int bdb_queue_get_batch(bdb_state_type *bdb_state, int consumer,
+                        const struct bdb_queue_cursor *prevcursor,
+                        unsigned long long maxgenid, int maxitems, void **fnd,
+                        size_t *fnddtalen, int *nfound, int *bdberr);
+
 /* Get the genid of a queue item that was retrieved by bdb_queue_get() */
 unsigned long long bdb_queue_item_genid(const void *dta);
 
@@ -914,6 +923,12 @@ int bdb_queue_dump(bdb_state_type *bdb_state, FILE *out, int *bdberr);
 int bdb_queue_consume(bdb_state_type *bdb_state, tran_type *tran, int consumer,
                       const void *prevfnd, int *bdberr);
 
+/* consume items previously found by bdb_queue_get_batch.  Items that have
+ * already been consumed are skipped. */
+int bdb_queue_consume_batch(bdb_state_type *bdb_state, tran_type *tran,
+                            int consumer, void *const *fnds, int nfnds,
+                            int *bdberr);
+
 /* work out the best page size to use for the given average item size */
 int bdb_queue_best_pagesize(int avg_item_sz);
 
@@ -1175,6 +1190,7 @@ int bdb_temp_table_find_exact(bdb_state_type *bdb_state,
                               struct temp_cursor *cursor, void *key, int keylen,
                               int *bdberr);
 void bdb_temp_table_reset_datapointers(struct temp_cursor *cur);
+void *bdb_temp_table_detach_data(struct temp_cursor *cur);
 
 void *bdb_temp_table_get_cur(struct temp_cursor *skippy);
 
@@ -1518,7 +1534,20 @@ int bdb_get_index_filename(bdb_state_type *bdb_state, int ixnum, char *nameout,
 int bdb_get_data_filename(bdb_state_type *bdb_state, int stripe, int blob,
                           char *nameout, int namelen, int *bdberr);
 
+struct kll;
+/* Passed to bdb_summarize_table to stream every key of the index through
+ * sketches instead of sampling keys into a temp table.  The caller sets ncols,
+ * colend (the offset just past each key column) and ndistinct (room for ncols
+ * estimates); summarize fills in the rest.  The caller frees kll. */
+struct summarize_sketch {
+    int ncols;
+    const int *colend;
+    double *ndistinct; /* distinct prefixes of 1..ncols columns */
+    struct kll *kll;   /* quantiles over the full ncols column prefix */
+};
+
 int bdb_summarize_table(bdb_state_type *bdb_state, int ixnum, int comp_pct,
+                        struct summarize_sketch *sketch,
                         struct temp_table **outtbl, unsigned long long *outrecs,
                         unsigned long long *cmprecs, int *bdberr);
 
@@ -1702,6 +1731,7 @@ int send_myseqnum_to_master(bdb_state_type *, int nodelay);
 
 const char *bdb_temp_table_filename(struct temp_table *);
 void bdb_temp_table_flush(struct temp_table *);
+void bdb_temp_table_bench(bdb_state_type *bdb_state, int nrows, int passes);
 
 int bdb_tran_free_shadows(bdb_state_type *bdb_state, tran_type *tran);
 
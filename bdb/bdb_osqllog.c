@@ -31,6 +31,7 @@
 #include <bdb_osqltrn.h>
 #include <bdb_int.h>
 #include <bdb_osqlcur.h>
+#include <bdb_osqlvers.h>
 #include <flibc.h>
 #include <locks.h>
 
@@ -135,6 +136,111 @@ static int bdb_osql_log_run_unoptimized(bdb_cursor_impl_t *cur, DB_LOGC *curlog,
                                         void *llog_dta, bdb_osql_trn_t *trn,
                                         int *dirty, int trak, int *bdberr);
 
+/**
+ * The reconstruct routines below go through the version store first; a
+ * version missing from the store is rebuilt from the log and stored for
+ * the next session replaying the same undo record
+ *
+ */
+static int vers_reconstruct_delete(bdb_state_type *bdb_state, DB_LSN *lsn,
+                                   int *page, int *index, void *key,
+                                   int keylen, void *dta, int dtalen,
+                                   int *outdtalen)
+{
+    int pg = 0, ix = 0;
+    unsigned int truncates;
+    int rc;
+
+    if (bdb_osql_vers_get(lsn, BDB_OSQL_VERS_DELETE, page, index, key, keylen,
+                          dta, dtalen) == 0) {
+        if (outdtalen)
+            *outdtalen = dtalen;
+        return 0;
+    }
+
+    truncates = bdb_osql_vers_truncates();
+    rc = bdb_reconstruct_delete(bdb_state, lsn, &pg, &ix, key, keylen, dta,
+                                dtalen, outdtalen);
+    if (rc)
+        return rc;
+
+    if (page)
+        *page = pg;
+    if (index)
+        *index = ix;
+    if (dta)
+        bdb_osql_vers_put(bdb_state, truncates, lsn, BDB_OSQL_VERS_DELETE, pg,
+                          ix, key, keylen, dta, dtalen);
+    return 0;
+}
+
+static int vers_reconstruct_update(bdb_state_type *bdb_state, DB_LSN *lsn,
+                                   int *page, int *index, void *dta,
+                                   int dtalen)
+{
+    int pg = 0, ix = 0;
+    unsigned int truncates;
+    int rc;
+
+    if (bdb_osql_vers_get(lsn, BDB_OSQL_VERS_UPDATE, page, index, NULL, 0, dta,
+                          dtalen) == 0)
+        return 0;
+
+    truncates = bdb_osql_vers_truncates();
+    rc = bdb_reconstruct_update(bdb_state, lsn, &pg, &ix, NULL, 0, dta,
+                                dtalen);
+    if (rc)
+        return rc;
+
+    if (page)
+        *page = pg;
+    if (index)
+        *index = ix;
+    if (dta)
+        bdb_osql_vers_put(bdb_state, truncates, lsn, BDB_OSQL_VERS_UPDATE, pg,
+                          ix, NULL, 0, dta, dtalen);
+    return 0;
+}
+
+static int vers_reconstruct_inplace_update(bdb_state_type *bdb_state,
+                                           DB_LSN *lsn, void *dta, int dtalen,
+                                           int *offset, int *outlen,
+                                           int *page, int *index)
+{
+    int pg = 0, ix = 0, off = 0, len = 0;
+    unsigned int truncates;
+    int rc;
+
+    if (bdb_osql_vers_get(lsn, BDB_OSQL_VERS_INPLACE, page, index, NULL, 0,
+                          dta, dtalen) == 0) {
+        if (offset)
+            *offset = 0;
+        if (outlen)
+            *outlen = dtalen;
+        return 0;
+    }
+
+    truncates = bdb_osql_vers_truncates();
+    rc = bdb_reconstruct_inplace_update(bdb_state, lsn, dta, dtalen, &off,
+                                        &len, &pg, &ix);
+    if (rc)
+        return rc;
+
+    if (offset)
+        *offset = off;
+    if (outlen)
+        *outlen = len;
+    if (page)
+        *page = pg;
+    if (index)
+        *index = ix;
+    /* only whole rows are worth keeping */
+    if (dta && off == 0 && len == dtalen)
+        bdb_osql_vers_put(bdb_state, truncates, lsn, BDB_OSQL_VERS_INPLACE, pg,
+                          ix, NULL, 0, dta, dtalen);
+    return 0;
+}
+
 /**
  * Initialize bdb_osql log repository
  *
@@ -3630,8 +3736,8 @@ static int bdb_osql_log_run_unoptimized(bdb_cursor_impl_t *cur, DB_LOGC *curlog,
         }
 
         /* Reconstruct the delete. */
-        rc = bdb_reconstruct_delete(bdb_state, &rec->lsn, &page, &index, NULL,
-                                    0, dtabuf, dtalen, NULL);
+        rc = vers_reconstruct_delete(bdb_state, &rec->lsn, &page, &index,
+                                     NULL, 0, dtabuf, dtalen, NULL);
         if (rc) {
             if (rc == BDBERR_NO_LOG)
                 *bdberr = rc;
@@ -3724,7 +3830,7 @@ static int bdb_osql_log_run_unoptimized(bdb_cursor_impl_t *cur, DB_LOGC *curlog,
         keybuf = malloc(keylen);
         dtabuf = malloc(dtalen + bdb_state->ixcollattr[ix]);
         outdatalen = 0;
-        rc = bdb_reconstruct_delete(
+        rc = vers_reconstruct_delete(
             bdb_state, &rec->lsn, NULL, NULL, keybuf, keylen, dtabuf,
             dtalen + bdb_state->ixcollattr[ix], &outdatalen);
         if (rc) {
@@ -3930,9 +4036,9 @@ static int bdb_osql_log_run_unoptimized(bdb_cursor_impl_t *cur, DB_LOGC *curlog,
 
         /* If this is inplace, search for a berkley repl log entry.  */
         if (inplace && old_dta_len > 0) {
-            rc = bdb_reconstruct_inplace_update(bdb_state, &rec->lsn, dtabuf,
-                                                old_dta_len, &offset, &updlen,
-                                                &page, &index);
+            rc = vers_reconstruct_inplace_update(bdb_state, &rec->lsn, dtabuf,
+                                                 old_dta_len, &offset, &updlen,
+                                                 &page, &index);
 
             /* Sanity check results. */
             if (0 == rc)
@@ -3940,8 +4046,8 @@ static int bdb_osql_log_run_unoptimized(bdb_cursor_impl_t *cur, DB_LOGC *curlog,
         }
         /* Get the addrem's which correlate to this logical update. */
         else {
-            rc = bdb_reconstruct_update(bdb_state, &rec->lsn, &page, &index,
-                                        NULL, 0, dtabuf, old_dta_len);
+            rc = vers_reconstruct_update(bdb_state, &rec->lsn, &page, &index,
+                                         dtabuf, old_dta_len);
         }
         if (rc) {
             if (rc == BDBERR_NO_LOG)
@@ -4192,8 +4298,8 @@ static int bdb_osql_log_get_optim_data_int(bdb_state_type *bdb_state,
             ptr = dtabuf;
         }
 
-        rc = bdb_reconstruct_delete(bdb_state, lsn, NULL, NULL, NULL, 0, ptr,
-                                    del_dta->dtalen, NULL);
+        rc = vers_reconstruct_delete(bdb_state, lsn, NULL, NULL, NULL, 0, ptr,
+                                     del_dta->dtalen, NULL);
         if (rc) {
             if (rc == BDBERR_NO_LOG)
                 *bdberr = rc;
@@ -4237,13 +4343,13 @@ static int bdb_osql_log_get_optim_data_int(bdb_state_type *bdb_state,
         }
 
         if (inplace) {
-            rc = bdb_reconstruct_inplace_update(bdb_state, lsn, ptr,
-                                                upd_dta->old_dta_len, &offset,
-                                                &updlen, NULL, NULL);
+            rc = vers_reconstruct_inplace_update(bdb_state, lsn, ptr,
+                                                 upd_dta->old_dta_len, &offset,
+                                                 &updlen, NULL, NULL);
 
         } else {
-            rc = bdb_reconstruct_delete(bdb_state, lsn, NULL, NULL, NULL, 0,
-                                        ptr, upd_dta->old_dta_len, NULL);
+            rc = vers_reconstruct_delete(bdb_state, lsn, NULL, NULL, NULL, 0,
+                                         ptr, upd_dta->old_dta_len, NULL);
         }
         if (rc) {
             if (rc == BDBERR_NO_LOG)
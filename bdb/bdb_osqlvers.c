@@ -0,0 +1,205 @@
+/*
+   Copyright 2017 Bloomberg Finance L.P.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <list.h>
+#include <plhash.h>
+#include <logmsg.h>
+
+#include "bdb_int.h"
+#include "bdb_osqlvers.h"
+
+/* bumped by berkdb every time the log is truncated; lsns handed out after a
+   truncate may name different records than the ones we have stored */
+extern unsigned int gbl_log_truncates;
+
+typedef struct bdb_osql_vers_key {
+    DB_LSN lsn;
+    int kind;
+} bdb_osql_vers_key_t;
+
+typedef struct bdb_osql_vers {
+    bdb_osql_vers_key_t key; /* must be first, it's the hash key */
+    int page;
+    int index;
+    int keylen;
+    int dtalen;
+    LINKC_T(struct bdb_osql_vers) lnk;
+    char buf[1]; /* key, followed by data */
+} bdb_osql_vers_t;
+
+static pthread_mutex_t vers_lk = PTHREAD_MUTEX_INITIALIZER;
+static hash_t *vers_hash;
+static LISTC_T(bdb_osql_vers_t) vers_lru; /* most recently used on top */
+static size_t vers_bytes;
+static unsigned int vers_truncates;
+
+static unsigned long long vers_hits;
+static unsigned long long vers_misses;
+static unsigned long long vers_evicts;
+
+static inline size_t vers_size(const bdb_osql_vers_t *v)
+{
+    return offsetof(bdb_osql_vers_t, buf) + v->keylen + v->dtalen;
+}
+
+static void vers_remove(bdb_osql_vers_t *v)
+{
+    hash_del(vers_hash, v);
+    listc_rfl(&vers_lru, v);
+    vers_bytes -= vers_size(v);
+    free(v);
+}
+
+static void vers_clear_int(void)
+{
+    bdb_osql_vers_t *v;
+    while ((v = LISTC_TOP(&vers_lru)) != NULL)
+        vers_remove(v);
+}
+
+/* call with vers_lk held; returns 0 if the store can be used */
+static int vers_check(void)
+{
+    if (vers_hash == NULL) {
+        vers_hash = hash_init(sizeof(bdb_osql_vers_key_t));
+        if (vers_hash == NULL)
+            return -1;
+        listc_init(&vers_lru, offsetof(bdb_osql_vers_t, lnk));
+        vers_truncates = gbl_log_truncates;
+    }
+    if (vers_truncates != gbl_log_truncates) {
+        vers_clear_int();
+        vers_truncates = gbl_log_truncates;
+    }
+    return 0;
+}
+
+int bdb_osql_vers_get(const DB_LSN *lsn, int kind, int *page, int *index,
+                      void *key, int keylen, void *dta, int dtalen)
+{
+    bdb_osql_vers_key_t k;
+    bdb_osql_vers_t *v;
+    int rc = 1;
+
+    memset(&k, 0, sizeof(k));
+    k.lsn = *lsn;
+    k.kind = kind;
+
+    pthread_mutex_lock(&vers_lk);
+    if (vers_check() == 0 && (v = hash_find(vers_hash, &k)) != NULL &&
+        (!key || keylen == v->keylen) && (!dta || dtalen == v->dtalen)) {
+        if (page)
+            *page = v->page;
+        if (index)
+            *index = v->index;
+        if (key)
+            memcpy(key, v->buf, keylen);
+        if (dta)
+            memcpy(dta, v->buf + v->keylen, dtalen);
+        listc_rfl(&vers_lru, v);
+        listc_atl(&vers_lru, v);
+        vers_hits++;
+        rc = 0;
+    } else {
+        vers_misses++;
+    }
+    pthread_mutex_unlock(&vers_lk);
+
+    return rc;
+}
+
+unsigned int bdb_osql_vers_truncates(void)
+{
+    return gbl_log_truncates;
+}
+
+void bdb_osql_vers_put(bdb_state_type *bdb_state, unsigned int truncates,
+                       const DB_LSN *lsn, int kind, int page, int index,
+                       const void *key, int keylen, const void *dta,
+                       int dtalen)
+{
+    size_t budget;
+    bdb_osql_vers_t *v, *old;
+
+    budget = (size_t)bdb_attr_get(bdb_state->attr,
+                                  BDB_ATTR_SNAPISOL_VERSION_STORE) *
+             1024 * 1024;
+    if (!key)
+        keylen = 0;
+    if (!dta)
+        dtalen = 0;
+    if (offsetof(bdb_osql_vers_t, buf) + keylen + dtalen > budget)
+        return;
+
+    v = malloc(offsetof(bdb_osql_vers_t, buf) + keylen + dtalen);
+    if (v == NULL)
+        return;
+    memset(&v->key, 0, sizeof(v->key));
+    v->key.lsn = *lsn;
+    v->key.kind = kind;
+    v->page = page;
+    v->index = index;
+    v->keylen = keylen;
+    v->dtalen = dtalen;
+    if (keylen)
+        memcpy(v->buf, key, keylen);
+    if (dtalen)
+        memcpy(v->buf + keylen, dta, dtalen);
+
+    pthread_mutex_lock(&vers_lk);
+    /* the log was truncated while this version was rebuilt: it may be a
+       pre-truncate image, and its lsn may already name a different record */
+    if (vers_check() != 0 || truncates != vers_truncates) {
+        pthread_mutex_unlock(&vers_lk);
+        free(v);
+        return;
+    }
+    /* another session may have beaten us to it; keep the newer copy */
+    if ((old = hash_find(vers_hash, &v->key)) != NULL)
+        vers_remove(old);
+    while (vers_bytes + vers_size(v) > budget &&
+           (old = LISTC_BOT(&vers_lru)) != NULL) {
+        vers_remove(old);
+        vers_evicts++;
+    }
+    hash_add(vers_hash, v);
+    listc_atl(&vers_lru, v);
+    vers_bytes += vers_size(v);
+    pthread_mutex_unlock(&vers_lk);
+}
+
+void bdb_osql_vers_clear(void)
+{
+    pthread_mutex_lock(&vers_lk);
+    if (vers_hash)
+        vers_clear_int();
+    pthread_mutex_unlock(&vers_lk);
+}
+
+void bdb_osql_vers_stat(void)
+{
+    pthread_mutex_lock(&vers_lk);
+    logmsg(LOGMSG_USER, "version store: %d versions, %zu bytes\n",
+           vers_hash ? vers_lru.count : 0, vers_bytes);
+    logmsg(LOGMSG_USER, "version store: %llu hits, %llu misses, %llu evicted\n",
+           vers_hits, vers_misses, vers_evicts);
+    pthread_mutex_unlock(&vers_lk);
+}
@@ -0,0 +1,81 @@
+/*
+   Copyright 2017 Bloomberg Finance L.P.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+/**
+ *  Snapisol/Serial sql support: the row version store
+ *
+ *  Every snapshot/serializable session that replays a committed transaction
+ *  reconstructs the same before-images from the log.  The version store
+ *  keeps the reconstructed images in memory, keyed by the lsn of the undo
+ *  record that retired them, so that only the first session pays for the
+ *  log walk.  The store is bounded by the snapisol_version_store attribute;
+ *  trimmed versions are simply reconstructed from the log again.
+ *
+ */
+#ifndef _BDB_OSQL_VERS_H_
+#define _BDB_OSQL_VERS_H_
+
+#include <build/db.h>
+#include "bdb_int.h"
+
+/* How a version was pulled out of the log; the same undo lsn yields
+   different images depending on which reconstruct routine reads it */
+enum {
+    BDB_OSQL_VERS_DELETE = 1,  /* bdb_reconstruct_delete */
+    BDB_OSQL_VERS_UPDATE = 2,  /* bdb_reconstruct_update */
+    BDB_OSQL_VERS_INPLACE = 3  /* bdb_reconstruct_inplace_update */
+};
+
+/**
+ * Retrieve a version.  Fills in whichever of page/index/key/dta the caller
+ * passes; keylen and dtalen must match what the version was stored with.
+ * Returns 0 on a hit, 1 on a miss.
+ *
+ */
+int bdb_osql_vers_get(const DB_LSN *lsn, int kind, int *page, int *index,
+                      void *key, int keylen, void *dta, int dtalen);
+
+/**
+ * Returns the log truncate count; read it before reconstructing a version
+ * and pass it to bdb_osql_vers_put
+ *
+ */
+unsigned int bdb_osql_vers_truncates(void);
+
+/**
+ * Store a version reconstructed from the log, evicting the least recently
+ * used ones to stay within budget.  The version is dropped if the log was
+ * truncated since "truncates" was read.
+ *
+ */
+void bdb_osql_vers_put(bdb_state_type *bdb_state, unsigned int truncates,
+                       const DB_LSN *lsn, int kind, int page, int index,
+                       const void *key, int keylen, const void *dta,
+                       int dtalen);
+
+/**
+ * Drop every version
+ *
+ */
+void bdb_osql_vers_clear(void);
+
+/**
+ * Print version store statistics
+ *
+ */
+void bdb_osql_vers_stat(void);
+
+#endif
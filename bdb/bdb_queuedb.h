@@ -41,6 +41,16 @@ int bdb_queuedb_get(bdb_state_type *bdb_state, int consumer,
 int bdb_queuedb_consume(bdb_state_type *bdb_state, tran_type *tran,
                         int consumer, const void *prevfnd, int *bdberr);
 
+int bdb_queuedb_get_batch(bdb_state_type *bdb_state, int consumer,
+                          const struct bdb_queue_cursor *prevcursor,
+                          unsigned long long maxgenid, int maxitems,
+                          void **fnd, size_t *fnddtalen, int *nfound,
+                          int *bdberr);
+
+int bdb_queuedb_consume_batch(bdb_state_type *bdb_state, tran_type *tran,
+                              int consumer, void *const *fnds, int nfnds,
+                              int *bdberr);
+
 const struct bdb_queue_stats *bdb_queuedb_get_stats(bdb_state_type *bdb_state);
 
 int bdb_trigger_subscribe(bdb_state_type *, pthread_cond_t **,
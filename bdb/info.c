@@ -297,6 +297,11 @@ static void lock_stats(FILE *out, bdb_state_type *bdb_state)
     prn_stat(st_nnowaits);
 #endif
     prn_stat(st_ndeadlocks);
+    prn_stat(st_ndetects);
+    prn_lstat(st_detect_usecs);
+    prn_stat(st_detect_max_usecs);
+    prn_stat(st_detect_waiters);
+    prn_stat(st_detect_max_waiters);
     prn_stat(st_locktimeout);
     prn_stat(st_nlocktimeouts);
     prn_stat(st_txntimeout);
@@ -320,7 +325,10 @@ static void rep_stats(FILE *out, bdb_state_type *bdb_state)
     char str[80];
     extern int64_t gbl_rep_trans_parallel, gbl_rep_trans_serial,
         gbl_rep_trans_deadlocked, gbl_rep_trans_inline,
-        gbl_rep_rowlocks_multifile;
+        gbl_rep_rowlocks_multifile, gbl_rep_trans_deps_parked,
+        gbl_rep_trans_deps_waits, gbl_rep_trans_deps_inflight_max,
+        gbl_rep_trans_deps_retired, gbl_rep_trans_deps_lag_us,
+        gbl_rep_trans_deps_lag_max_us;
 
     bdb_state->dbenv->rep_stat(bdb_state->dbenv, &stats, 0);
 
@@ -375,6 +383,18 @@ static void rep_stats(FILE *out, bdb_state_type *bdb_state)
             gbl_rep_rowlocks_multifile);
     logmsgf(LOGMSG_USER, out, "txn deadlocked: %ld\n",
             gbl_rep_trans_deadlocked);
+    logmsgf(LOGMSG_USER, out, "txn page-dependency parked: %ld\n",
+            gbl_rep_trans_deps_parked);
+    logmsgf(LOGMSG_USER, out, "txn page-dependency waits: %ld\n",
+            gbl_rep_trans_deps_waits);
+    logmsgf(LOGMSG_USER, out, "txn inflight max: %ld\n",
+            gbl_rep_trans_deps_inflight_max);
+    logmsgf(LOGMSG_USER, out, "txn apply lag avg usec: %ld\n",
+            gbl_rep_trans_deps_retired
+                ? gbl_rep_trans_deps_lag_us / gbl_rep_trans_deps_retired
+                : 0);
+    logmsgf(LOGMSG_USER, out, "txn apply lag max usec: %ld\n",
+            gbl_rep_trans_deps_lag_max_us);
     prn_lstat(lc_cache_hits);
     prn_lstat(lc_cache_misses);
     prn_stat(lc_cache_size);
@@ -1004,3 +1004,78 @@ void bdb_locktest(void *_bdb_state)
             (double)diff / 1000.0);
     return BDB5RET;
 }
+
+#ifndef MYBDB5
+/* Shared page lock get/put rate for 1..maxthreads readers on one hot page,
+ * through the lock table and through the per-locker fast path. */
+extern int gbl_lock_fastpath;
+static int pagelock_nops;
+
+static void *pagelock_reader(void *_)
+{
+    DB_LOCK_ILOCK ilock = {.pgno = 1, .type = DB_PAGE_LOCK};
+    DBT obj = {.data = &ilock, .size = sizeof(ilock)};
+    DB_LOCK lock;
+    u_int32_t locker;
+    ssize_t rc;
+
+    if ((rc = dbenv->lock_id(dbenv, &locker)) != 0) {
+        logmsg(LOGMSG_ERROR, "lock_id rc: %zd\n", rc);
+        return (void *)rc;
+    }
+    for (int i = 0; i < pagelock_nops; ++i) {
+        if ((rc = dbenv->lock_get(dbenv, locker, 0, &obj, DB_LOCK_READ,
+                                  &lock)) != 0) {
+            logmsg(LOGMSG_ERROR, "lock_get rc: %zd\n", rc);
+            break;
+        }
+        if ((rc = dbenv->lock_put(dbenv, &lock)) != 0) {
+            logmsg(LOGMSG_ERROR, "lock_put rc: %zd\n", rc);
+            break;
+        }
+    }
+    rc |= dbenv->lock_id_free(dbenv, locker);
+    return (void *)rc;
+}
+
+static uint64_t pagelock_run(int nthreads)
+{
+    pthread_t t[nthreads];
+    void *rc;
+    int fail = 0;
+    uint64_t begin = gettimeofday_ms();
+    for (int i = 0; i < nthreads; ++i)
+        pthread_create(&t[i], &locktest_attr, pagelock_reader, NULL);
+    for (int i = 0; i < nthreads; ++i) {
+        pthread_join(t[i], &rc);
+        if (rc)
+            ++fail;
+    }
+    uint64_t ms = gettimeofday_ms() - begin;
+    if (fail)
+        logmsg(LOGMSG_ERROR, "%d threads failed\n", fail);
+    return (uint64_t)nthreads * pagelock_nops * 1000 / (ms ? ms : 1);
+}
+
+void bdb_pagelock_bench(void *_bdb_state, int maxthreads, int nops)
+{
+    bdb_state_type *bdb_state = _bdb_state;
+    int fastpath = gbl_lock_fastpath;
+    dbenv = bdb_state->dbenv;
+    pagelock_nops = nops;
+    pthread_attr_init(&locktest_attr);
+    pthread_attr_setstacksize(&locktest_attr, 3 * 1024 * 1024);
+    logmsg(LOGMSG_USER, "%8s %20s %20s\n", "threads", "table get+put/s",
+           "fastpath get+put/s");
+    for (int n = 1; n <= maxthreads; n *= 2) {
+        gbl_lock_fastpath = 0;
+        uint64_t table = pagelock_run(n);
+        gbl_lock_fastpath = 1;
+        uint64_t fast = pagelock_run(n);
+        logmsg(LOGMSG_USER, "%8d %20" PRIu64 " %20" PRIu64 "\n", n, table,
+               fast);
+    }
+    gbl_lock_fastpath = fastpath;
+    pthread_attr_destroy(&locktest_attr);
+}
+#endif
@@ -1681,6 +1681,40 @@ int bdb_queue_get(bdb_state_type *bdb_state, int consumer,
     return rc;
 }
 
+/* get up to maxitems items unconsumed by this consumer number, after
+ * prevcursor and before maxgenid (if non-zero), in one pass.  berkeley queues
+ * hand back one item per call. */
+int bdb_queue_get_batch(bdb_state_type *bdb_state, int consumer,
+                        const struct bdb_queue_cursor *prevcursor,
+                        unsigned long long maxgenid, int maxitems, void **fnd,
+                        size_t *fnddtalen, int *nfound, int *bdberr)
+{
+    int rc;
+    size_t dtaoff;
+    unsigned int epoch;
+
+    BDB_READLOCK("bdb_queue_get_batch");
+    if (bdb_state->bdbtype == BDBTYPE_QUEUEDB) {
+        rc = bdb_queuedb_get_batch(bdb_state, consumer, prevcursor, maxgenid,
+                                   maxitems, fnd, fnddtalen, nfound, bdberr);
+    } else {
+        *nfound = 0;
+        rc = bdb_queue_get_int(bdb_state, consumer, prevcursor, &fnd[0],
+                               &fnddtalen[0], &dtaoff, NULL, &epoch, bdberr);
+        if (rc == 0 && maxgenid &&
+            bdb_cmp_genids(bdb_queue_item_genid(fnd[0]), maxgenid) >= 0) {
+            free(fnd[0]);
+            *bdberr = BDBERR_FETCH_DTA;
+            rc = -1;
+        }
+        if (rc == 0)
+            *nfound = 1;
+    }
+    BDB_RELLOCK();
+
+    return rc;
+}
+
 static int bdb_queue_consume_int(bdb_state_type *bdb_state, tran_type *intran,
                                  int consumer, const void *prevfnd, int *bdberr)
 {
@@ -2048,6 +2082,33 @@ int bdb_queue_consume(bdb_state_type *bdb_state, tran_type *tran, int consumer,
     return rc;
 }
 
+/* consume a batch of items found by bdb_queue_get_batch in one transaction */
+int bdb_queue_consume_batch(bdb_state_type *bdb_state, tran_type *tran,
+                            int consumer, void *const *fnds, int nfnds,
+                            int *bdberr)
+{
+    int rc = 0;
+    *bdberr = BDBERR_NOERROR;
+
+    BDB_READLOCK("bdb_queue_consume_batch");
+    if (bdb_state->bdbtype == BDBTYPE_QUEUEDB) {
+        rc = bdb_queuedb_consume_batch(bdb_state, tran, consumer, fnds, nfnds,
+                                       bdberr);
+    } else {
+        for (int i = 0; i < nfnds && rc == 0; i++) {
+            rc = bdb_queue_consume_int(bdb_state, tran, consumer, fnds[i],
+                                       bdberr);
+            if (rc && *bdberr == BDBERR_DELNOTFOUND) {
+                *bdberr = BDBERR_NOERROR;
+                rc = 0;
+            }
+        }
+    }
+    BDB_RELLOCK();
+
+    return rc;
+}
+
 void bdb_queue_get_found_info(const void *fnd, size_t *dtaoff, size_t *dtalen)
 {
     struct bdb_queue_found found;
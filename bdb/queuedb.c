@@ -629,6 +629,226 @@ done:
     return rc;
 }
 
+/* Fetch up to maxitems items for this consumer in one cursor pass, starting
+ * after prevcursor (or at the head of the queue) and stopping before maxgenid
+ * if that is non-zero.  Handing workers disjoint genid ranges lets them drain
+ * one queue in parallel.  Each fnd[i] is a malloced item laid out like the
+ * ones bdb_queuedb_get returns; the caller frees them. */
+int bdb_queuedb_get_batch(bdb_state_type *bdb_state, int consumer,
+                          const struct bdb_queue_cursor *prevcursor,
+                          unsigned long long maxgenid, int maxitems,
+                          void **fnd, size_t *fnddtalen, int *nfound,
+                          int *bdberr)
+{
+    struct queuedb_key k;
+    DBT dbt_key = {0}, dbt_data = {0};
+    DBC *dbcp = NULL;
+    int rc;
+    uint8_t key[QUEUEDB_KEY_LEN] = {0};
+    uint8_t prevkey[QUEUEDB_KEY_LEN] = {0};
+    uint8_t endkey[QUEUEDB_KEY_LEN] = {0};
+    struct queuedb_key fndk;
+    struct bdb_queue_priv *qstate = bdb_state->qpriv;
+
+    *nfound = 0;
+    if (bdb_state->dbp_data[0][0] == NULL) { // trigger dropped?
+        *bdberr = BDBERR_BADARGS;
+        return -1;
+    }
+
+    if (gbl_debug_queuedb)
+        logmsg(LOGMSG_USER, ">> bdb_queuedb_get_batch %s max %d\n",
+               bdb_state->name, maxitems);
+
+    k.consumer = consumer;
+    if (prevcursor)
+        memcpy(&k.genid, prevcursor->genid, sizeof(uint64_t));
+    else
+        k.genid = 0;
+    if (queuedb_key_put(&k, prevkey, prevkey + QUEUEDB_KEY_LEN) == NULL) {
+        logmsg(LOGMSG_ERROR, "%s:%d failed to encode key for queue %s consumer %d\n",
+               __func__, __LINE__, bdb_state->name, consumer);
+        *bdberr = BDBERR_MISC;
+        return -1;
+    }
+    if (maxgenid) {
+        k.genid = maxgenid;
+        queuedb_key_put(&k, endkey, endkey + QUEUEDB_KEY_LEN);
+    }
+    memcpy(key, prevkey, QUEUEDB_KEY_LEN);
+
+    rc = bdb_state->dbp_data[0][0]->cursor(bdb_state->dbp_data[0][0], NULL,
+                                           &dbcp, 0);
+    if (rc != 0) {
+        *bdberr = BDBERR_MISC;
+        return -1;
+    }
+
+    dbt_key.data = key;
+    dbt_key.size = QUEUEDB_KEY_LEN;
+    dbt_key.ulen = QUEUEDB_KEY_LEN;
+    dbt_key.flags = DB_DBT_USERMEM;
+    dbt_data.flags = DB_DBT_MALLOC;
+
+    qstate->stats.n_physical_gets++;
+    rc = dbcp->c_get(dbcp, &dbt_key, &dbt_data, DB_SET_RANGE);
+    while (rc == 0 && *nfound < maxitems) {
+        if (dbt_key.size != QUEUEDB_KEY_LEN ||
+            queuedb_key_get(&fndk, key, key + QUEUEDB_KEY_LEN) == NULL) {
+            logmsg(LOGMSG_ERROR, "%s: bad key size %u in queue %s\n", __func__,
+                   dbt_key.size, bdb_state->name);
+            rc = -1;
+            *bdberr = BDBERR_MISC;
+            goto done;
+        }
+        /* past this consumer's items or the end of our range */
+        if (fndk.consumer != consumer ||
+            (maxgenid && memcmp(key, endkey, QUEUEDB_KEY_LEN) >= 0))
+            break;
+        if (prevcursor && memcmp(key, prevkey, QUEUEDB_KEY_LEN) == 0) {
+            /* the previous item, not consumed yet */
+            free(dbt_data.data);
+        } else if (dbt_data.size < sizeof(struct bdb_queue_found)) {
+            logmsg(LOGMSG_ERROR, "%s: invalid queue entry size %d in queue %s\n",
+                   __func__, dbt_data.size, bdb_state->name);
+            free(dbt_data.data);
+            rc = -1;
+            *bdberr = BDBERR_MISC;
+            goto done;
+        } else {
+            fnd[*nfound] = dbt_data.data;
+            fnddtalen[*nfound] = dbt_data.size;
+            ++*nfound;
+        }
+        dbt_data.data = NULL;
+        rc = dbcp->c_get(dbcp, &dbt_key, &dbt_data, DB_NEXT);
+    }
+    if (rc == 0 || rc == DB_NOTFOUND) {
+        if (*nfound == 0) {
+            qstate->stats.n_get_not_founds++;
+            *bdberr = BDBERR_FETCH_DTA;
+            rc = -1;
+        } else {
+            *bdberr = BDBERR_NOERROR;
+            rc = 0;
+        }
+    } else if (rc == DB_LOCK_DEADLOCK) {
+        qstate->stats.n_get_deadlocks++;
+        *bdberr = BDBERR_DEADLOCK;
+        rc = -1;
+    } else {
+        logmsg(LOGMSG_ERROR, "%s %s get rc %d\n", __func__, bdb_state->name, rc);
+        *bdberr = BDBERR_MISC;
+        rc = -1;
+    }
+
+done:
+    if (dbcp) {
+        int crc = dbcp->c_close(dbcp);
+        if (crc == DB_LOCK_DEADLOCK) {
+            *bdberr = BDBERR_DEADLOCK;
+            rc = -1;
+        } else if (crc) {
+            logmsg(LOGMSG_ERROR, "%s: c_close berk rc %d\n", __func__, crc);
+            *bdberr = BDBERR_MISC;
+            rc = -1;
+        }
+    }
+    if (rc) {
+        for (int i = 0; i < *nfound; i++)
+            free(fnd[i]);
+        *nfound = 0;
+    }
+    return rc;
+}
+
+/* Consume a batch of items found by bdb_queuedb_get_batch through a single
+ * cursor.  Items that are already gone are skipped. */
+int bdb_queuedb_consume_batch(bdb_state_type *bdb_state, tran_type *tran,
+                              int consumer, void *const *fnds, int nfnds,
+                              int *bdberr)
+{
+    struct bdb_queue_found qfnd;
+    struct queuedb_key k;
+    uint8_t key[QUEUEDB_KEY_LEN];
+    DBT dbt_key = {0}, dbt_data = {0};
+    DBC *dbcp = NULL;
+    int rc = 0;
+    struct bdb_queue_priv *qstate = bdb_state->qpriv;
+
+    if (gbl_debug_queuedb)
+        logmsg(LOGMSG_USER, ">> bdb_queuedb_consume_batch %s %d items\n",
+               bdb_state->name, nfnds);
+
+    *bdberr = BDBERR_NOERROR;
+    rc = bdb_state->dbp_data[0][0]->cursor(bdb_state->dbp_data[0][0], tran->tid,
+                                           &dbcp, 0);
+    if (rc != 0) {
+        *bdberr = BDBERR_MISC;
+        return -1;
+    }
+
+    /* position only, don't fetch the data */
+    dbt_data.flags = DB_DBT_PARTIAL;
+    dbt_key.data = key;
+    dbt_key.size = QUEUEDB_KEY_LEN;
+    dbt_key.ulen = QUEUEDB_KEY_LEN;
+    dbt_key.flags = DB_DBT_USERMEM;
+
+    for (int i = 0; i < nfnds; i++) {
+        if (queue_found_get(&qfnd, fnds[i],
+                            (uint8_t *)fnds[i] +
+                                sizeof(struct bdb_queue_found)) == NULL) {
+            logmsg(LOGMSG_ERROR,
+                   "%s: can't decode queue header for queue %s consumer %d\n",
+                   __func__, bdb_state->name, consumer);
+            *bdberr = BDBERR_MISC;
+            rc = -1;
+            goto done;
+        }
+        k.consumer = consumer;
+        k.genid = qfnd.genid;
+        queuedb_key_put(&k, key, key + QUEUEDB_KEY_LEN);
+
+        rc = dbcp->c_get(dbcp, &dbt_key, &dbt_data, DB_SET);
+        if (rc == DB_NOTFOUND) {
+            if (gbl_debug_queuedb)
+                logmsg(LOGMSG_USER, "genid %016llx already consumed\n",
+                       qfnd.genid);
+            rc = 0;
+            continue;
+        }
+        if (rc == 0)
+            rc = dbcp->c_del(dbcp, 0);
+        if (rc == DB_LOCK_DEADLOCK) {
+            qstate->stats.n_consume_deadlocks++;
+            *bdberr = BDBERR_DEADLOCK;
+            rc = -1;
+            goto done;
+        } else if (rc) {
+            logmsg(LOGMSG_ERROR, "%s: consume queue %s consumer %d berk rc %d\n",
+                   __func__, bdb_state->name, consumer, rc);
+            *bdberr = BDBERR_MISC;
+            rc = -1;
+            goto done;
+        }
+    }
+
+done:
+    if (dbcp) {
+        int crc = dbcp->c_close(dbcp);
+        if (crc == DB_LOCK_DEADLOCK) {
+            *bdberr = BDBERR_DEADLOCK;
+            rc = -1;
+        } else if (crc) {
+            logmsg(LOGMSG_ERROR, "%s: c_close berk rc %d\n", __func__, crc);
+            *bdberr = BDBERR_MISC;
+            rc = -1;
+        }
+    }
+    return rc;
+}
+
 const struct bdb_queue_stats *bdb_queuedb_get_stats(bdb_state_type *bdb_state)
 {
     struct bdb_queue_priv *qstate = bdb_state->qpriv;
@@ -933,9 +933,20 @@ int berkdb_send_rtn(DB_ENV *dbenv, const DBT *control, const DBT *rec,
     }
 
     if (host == db_eid_broadcast) {
+        net_buf_t *reftail = NULL;
+
         /* send to all */
         count =
             net_get_all_nodes_connected(bdb_state->repinfo->netinfo, hostlist);
+
+        /* every node gets the same record after its seqnum, so queue one
+         * shared copy of it rather than one per node */
+        if (count > 1)
+            reftail = net_buf_alloc(bufsz - sizeof(int));
+        if (reftail)
+            memcpy(reftail->data, (char *)buf + sizeof(int),
+                   bufsz - sizeof(int));
+
         for (i = 0; i < count; i++) {
             int tmpseq;
             uint8_t *p_seq_num = (uint8_t *)seqnum;
@@ -986,7 +997,13 @@ int berkdb_send_rtn(DB_ENV *dbenv, const DBT *control, const DBT *rec,
                 }
 
             if (!dontsend) {
-                if (!is_logput) {
+                if (reftail) {
+                    rc = net_send_ref(
+                        bdb_state->repinfo->netinfo, hostlist[i],
+                        USER_TYPE_BERKDB_REP, buf, sizeof(int), nodelay,
+                        reftail, !is_logput,
+                        is_logput && bdb_state->attr->net_inorder_logputs);
+                } else if (!is_logput) {
                     rc = net_send_nodrop(bdb_state->repinfo->netinfo,
                                          hostlist[i], USER_TYPE_BERKDB_REP, buf,
                                          bufsz, nodelay);
@@ -1005,6 +1022,8 @@ int berkdb_send_rtn(DB_ENV *dbenv, const DBT *control, const DBT *rec,
                     rc = 1; /* haha, keep ignoring it */
             }
         }
+        if (reftail)
+            net_buf_unref(reftail);
     } else {
         int tmpseq;
         uint8_t *p_seq_num = (uint8_t *)seqnum;
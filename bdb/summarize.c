@@ -35,6 +35,7 @@
 #include <string.h>
 #include <strings.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/socketvar.h>
@@ -72,6 +73,7 @@
 
 #include "flibc.h"
 #include "logmsg.h"
+#include "sketch.h"
 
 extern volatile int gbl_schema_change_in_progress;
 static double analyze_headroom = 6;
@@ -120,27 +122,314 @@ static DB *dbp_from_meta(DB *dbp, DBMETA *meta)
     return dbp;
 }
 
+/* Number of threads that scan disjoint page ranges of one index file. */
+int gbl_analyze_comp_ranges = 4;
+/* Read budget shared by every summarize scan, in KB/s.  0 means unlimited. */
+int gbl_analyze_comp_max_kbps = 0;
+
+/* don't bother splitting files smaller than this many pages per range */
+#define MIN_PAGES_PER_RANGE 1024
+
+/* KLL accuracy parameter for sketched indexes: ranks within about 1% */
+#define SKETCH_KLL_K 200
+
+static pthread_mutex_t io_budget_lk = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t io_budget_next_us;
+
+static uint64_t now_us(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/* Pace page reads so that all concurrent summarize scans together stay under
+ * gbl_analyze_comp_max_kbps.  Each read books the next slot on a shared
+ * schedule and sleeps until its slot comes up. */
+static void io_budget_wait(int bytes)
+{
+    int kbps = gbl_analyze_comp_max_kbps;
+    uint64_t now, at;
+
+    if (kbps <= 0)
+        return;
+
+    now = now_us();
+    pthread_mutex_lock(&io_budget_lk);
+    /* don't let an idle budget accumulate into a burst */
+    if (io_budget_next_us < now)
+        io_budget_next_us = now;
+    at = io_budget_next_us;
+    io_budget_next_us += (uint64_t)bytes * 1000000 / ((uint64_t)kbps * 1024);
+    pthread_mutex_unlock(&io_budget_lk);
+
+    if (at > now)
+        usleep(at - now);
+}
+
+struct summarize_scan {
+    bdb_state_type *bdb_state;
+    DB *dbp;
+    int fd;
+    int comp_pct;
+    struct temp_table *tbl;
+    struct summarize_sketch *sketch; /* set to sketch every key instead */
+    pthread_mutex_t put_lk; /* temp tables aren't safe for concurrent puts */
+    volatile int stop;      /* set by the first range to fail */
+};
+
+struct summarize_range {
+    struct summarize_scan *scan;
+    pthread_t tid;
+    unsigned int first; /* first page, inclusive */
+    unsigned int last;  /* last page, exclusive */
+    unsigned int seed;
+    unsigned long long nrecs;
+    unsigned long long looked_at;
+    struct hll **hll; /* per column prefix, when sketching */
+    struct kll *kll;
+    int rc;
+    int bdberr;
+};
+
+/* Add one key to this range's sketches.  Keys shorter than the schema says
+ * can't be split into columns and are left out. */
+static int sketch_key(struct summarize_range *r, const uint8_t *key, int len)
+{
+    struct summarize_sketch *sk = r->scan->sketch;
+    int i;
+
+    if (len < sk->colend[sk->ncols - 1])
+        return 0;
+    for (i = 0; i < sk->ncols; i++)
+        hll_add(r->hll[i], key, sk->colend[i]);
+    return kll_add(r->kll, key);
+}
+
+static int sketch_range_init(struct summarize_range *r)
+{
+    struct summarize_sketch *sk = r->scan->sketch;
+    int i;
+
+    if ((r->hll = calloc(sk->ncols, sizeof(struct hll *))) == NULL)
+        return -1;
+    for (i = 0; i < sk->ncols; i++) {
+        if ((r->hll[i] = hll_new()) == NULL)
+            return -1;
+    }
+    r->kll = kll_new(SKETCH_KLL_K, sk->colend[sk->ncols - 1], r->seed);
+    return r->kll ? 0 : -1;
+}
+
+static void sketch_range_free(struct summarize_range *r)
+{
+    struct summarize_sketch *sk = r->scan->sketch;
+    int i;
+
+    if (r->hll) {
+        for (i = 0; i < sk->ncols; i++)
+            hll_free(r->hll[i]);
+        free(r->hll);
+    }
+    kll_free(r->kll);
+}
+
+/* Verify/decrypt one page and add comp_pct percent of its keys to the output
+ * table, or all of them to the range's sketches.  Pages that fail
+ * verification are skipped. */
+static int summarize_page(struct summarize_range *r, PAGE *page,
+                          uint8_t *pfxbuf, int *last)
+{
+    struct summarize_scan *scan = r->scan;
+    DB_ENV *dbenv = scan->bdb_state->dbenv;
+    DB *dbp = scan->dbp;
+    int is_hmac = CRYPTO_ON(dbenv);
+    int pgsz = dbp->pgsize;
+    uint8_t *max = (uint8_t *)page + pgsz;
+    int i, ret, rc, now;
+    uint8_t *chksum = NULL;
+    size_t sumlen = pgsz;
+
+    if (!ISLEAF(page))
+        return 0;
+
+    /* If we have checksums, use them to verify we don't have a partial page.
+       If the checksum doesn't match, just skip the page. This should be rare
+       (only happen for pagesizes larger than default). */
+    if (F_ISSET(dbp, DB_AM_CHKSUM)) {
+        chksum_t algo = IS_CRC32C(page) ? algo_crc32c : algo_hash4;
+        switch (TYPE(page)) {
+        case P_HASHMETA:
+        case P_BTREEMETA:
+        case P_QAMMETA:
+            chksum = ((BTMETA *)page)->chksum;
+            sumlen = DBMETASIZE;
+            break;
+        default:
+            chksum = P_CHKSUM(dbp, page);
+            sumlen = pgsz;
+            break;
+        }
+        if (F_ISSET(dbp, DB_AM_SWAP))
+            P_32_SWAP(chksum);
+        if ((ret = __db_check_chksum_algo(dbenv, dbenv->crypto_handle,
+                                          (void *)chksum, page, sumlen, is_hmac,
+                                          algo)) != 0) {
+            logmsg(LOGMSG_ERROR, "pgno %u invalid checksum\n",
+                   F_ISSET(dbp, DB_AM_SWAP) ? flibc_intflip(page->pgno)
+                                            : page->pgno);
+            return 0;
+        }
+    }
+
+    if (is_hmac) {
+        DB_CIPHER *db_cipher = dbenv->crypto_handle;
+        void *iv = P_IV(dbp, page);
+        size_t skip = P_OVERHEAD(dbp);
+        uint8_t *ciphertext = (uint8_t *)page + skip;
+        if ((ret = db_cipher->decrypt(dbenv, db_cipher->data, iv, ciphertext,
+                                      sumlen - skip)) != 0) {
+            logmsg(LOGMSG_ERROR, "pgno %u decryption failed\n", page->pgno);
+            return 0;
+        }
+    }
+
+    if (IS_PREFIX(page) && F_ISSET(dbp, DB_AM_SWAP))
+        prefix_tocpu(dbp, page);
+
+    db_indx_t n = NUM_ENT(page);
+    if (F_ISSET(dbp, DB_AM_SWAP))
+        n = flibc_shortflip(n);
+
+    db_indx_t *inp = P_INP(dbp, page);
+    /* entries on the page are paired as (key, data).  we only want keys) */
+    for (i = 0; i < n; i += 2) {
+        /* we have a candidate */
+        unsigned long long c = 0;
+        if (F_ISSET(dbp, DB_AM_SWAP))
+            inp[i] = flibc_shortflip(inp[i]);
+        BKEYDATA *data = GET_BKEYDATA(dbp, page, i);
+        assert((uint8_t *)data < max);
+        /* skip deleted */
+        if (B_DISSET(data))
+            continue;
+        if (B_TYPE(data) != B_KEYDATA)
+            continue;
+        /* sketches see every key, else select comp_pct / 100 records */
+        if (scan->sketch || rand_r(&r->seed) % 100 < scan->comp_pct) {
+            now = time_epoch();
+            if (!scan->sketch && now - *last >= 10) {
+                *last = now;
+                rc = check_free_space(scan->bdb_state->dir);
+                if (rc != BDBERR_NOERROR) {
+                    r->bdberr = rc;
+                    return -1;
+                }
+            }
+            if (F_ISSET(dbp, DB_AM_SWAP))
+                data->len = flibc_shortflip(data->len);
+            db_indx_t len;
+            ASSIGN_ALIGN(db_indx_t, len, data->len);
+            assert(((uint8_t *)data + len) < max);
+            if ((rc = bk_decompress(dbp, page, &data, pfxbuf, KEYBUF)) != 0) {
+                logmsg(LOGMSG_ERROR,
+                       "\ndecompress failed page:%d i:%d total:%d\n",
+                       page->pgno, i, n);
+                return rc;
+            }
+            ASSIGN_ALIGN(db_indx_t, len, data->len);
+            if (scan->sketch) {
+                rc = sketch_key(r, data->data, len);
+            } else {
+                pthread_mutex_lock(&scan->put_lk);
+                rc = bdb_temp_table_put(scan->bdb_state->parent, scan->tbl,
+                                        data->data, len, &c,
+                                        sizeof(unsigned long long), NULL,
+                                        &r->bdberr);
+                pthread_mutex_unlock(&scan->put_lk);
+            }
+            if (rc)
+                return rc;
+            r->nrecs++;
+        }
+        r->looked_at++;
+    }
+    return 0;
+}
+
+static void *summarize_range_thd(void *arg)
+{
+    struct summarize_range *r = arg;
+    struct summarize_scan *scan = r->scan;
+    int pgsz = scan->dbp->pgsize;
+    uint8_t pfxbuf[KEYBUF];
+    PAGE *page;
+    unsigned int pgno;
+    int last = time_epoch();
+    ssize_t nread;
+
+    if ((page = malloc(pgsz)) == NULL) {
+        r->rc = -1;
+        scan->stop = 1;
+        return NULL;
+    }
+
+    for (pgno = r->first; pgno < r->last && !scan->stop; pgno++) {
+        io_budget_wait(pgsz);
+        nread = pread(scan->fd, page, pgsz, (off_t)pgno * pgsz);
+        if (nread == 0)
+            break;
+        if (nread != pgsz) {
+            logmsg(LOGMSG_ERROR, "Problem reading dta file: %d %s\n", errno,
+                   strerror(errno));
+            r->rc = -1;
+            break;
+        }
+        if ((r->rc = summarize_page(r, page, pfxbuf, &last)) != 0)
+            break;
+
+        int get_analyze_abort_requested();
+        if (gbl_schema_change_in_progress || get_analyze_abort_requested()) {
+            if (gbl_schema_change_in_progress)
+                logmsg(LOGMSG_ERROR, "%s: Aborting Analyze because "
+                                     "schema_change_in_progress\n",
+                       __func__);
+            if (get_analyze_abort_requested())
+                logmsg(LOGMSG_ERROR, "%s: Aborting Analyze because "
+                                     "of send analyze abort\n",
+                       __func__);
+            r->rc = -1;
+            break;
+        }
+    }
+
+    if (r->rc)
+        scan->stop = 1;
+    free(page);
+    return NULL;
+}
+
 int bdb_summarize_table(bdb_state_type *bdb_state, int ixnum, int comp_pct,
+                        struct summarize_sketch *sketch,
                         struct temp_table **outtbl, unsigned long long *outrecs,
                         unsigned long long *cmprecs, int *bdberr)
 {
-    DB_ENV *dbenv = bdb_state->dbenv;
-    int is_hmac = CRYPTO_ON(dbenv);
-    uint8_t pfxbuf[KEYBUF];
     char tmpname[255];
     char tran_tmpname[255];
     int rc = 0;
     DB dbp_ = {0}, *dbp;
-    PAGE *page = NULL;
     unsigned char metabuf[512];
-    int pgsz;
     int created_temp_table = 0;
-    int nrecs = 0;
+    unsigned long long nrecs = 0;
     unsigned long long recs_looked_at = 0;
-    int have_checksums = 0;
-    unsigned int pgno = 0;
+    struct summarize_scan scan = {0};
+    struct summarize_range *ranges = NULL;
+    struct stat st;
+    unsigned int npages;
+    int nranges = 0;
+    int nsketched = 0;
     int fd = -1;
-    int last, now;
+    int i;
 
     if (comp_pct > 100 || comp_pct < 1) {
         *bdberr = BDBERR_BADARGS;
@@ -161,7 +450,8 @@ int bdb_summarize_table(bdb_state_type *bdb_state, int ixnum, int comp_pct,
         goto done;
     }
 
-    if (*outtbl == NULL) {
+    /* nothing is materialized when sketching */
+    if (sketch == NULL && *outtbl == NULL) {
         *outtbl = bdb_temp_table_create(bdb_state->parent, bdberr);
         if (*outtbl == NULL) {
             rc = -1;
@@ -205,14 +495,14 @@ int bdb_summarize_table(bdb_state_type *bdb_state, int ixnum, int comp_pct,
         rc = -1;
         goto done;
     }
-    pgsz = dbp->pgsize;
-    page = malloc(pgsz);
-    uint8_t *max = (uint8_t *)page + pgsz;
-    rc = lseek(fd, 0, SEEK_SET);
-    if (rc) {
-        logmsg(LOGMSG_ERROR, "can't rewind to start of file\n");
+    if (fstat(fd, &st) != 0) {
+        logmsg(LOGMSG_ERROR, "can't stat input db: %d %s\n", errno,
+               strerror(errno));
+        rc = -1;
         goto done;
     }
+    npages = st.st_size / dbp->pgsize;
+    rc = 0;
 
 #if defined(_IBM_SOURCE) || defined(__linux__)
     // inform kernel that we will be accessing file sequentially
@@ -221,142 +511,100 @@ int bdb_summarize_table(bdb_state_type *bdb_state, int ixnum, int comp_pct,
     posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED | POSIX_FADV_SEQUENTIAL);
 #endif
 
-    rc = read(fd, page, pgsz);
-    last = time_epoch();
-    while (rc == pgsz) {
-        if (ISLEAF(page)) {
-            int i, ret;
-            uint8_t *chksum = NULL;
-            /* If we have checksums, use them to verify we don't have a partial
-               page.
-               If the checksum doesn't match, just skip the page. This should be
-               rare
-               (only happen for pagesizes larger than default). */
-            size_t sumlen;
-            if (F_ISSET(dbp, DB_AM_CHKSUM)) {
-                chksum_t algo = IS_CRC32C(page) ? algo_crc32c : algo_hash4;
-                switch (TYPE(page)) {
-                case P_HASHMETA:
-                case P_BTREEMETA:
-                case P_QAMMETA:
-                    chksum = ((BTMETA *)page)->chksum;
-                    sumlen = DBMETASIZE;
-                    break;
-                default:
-                    chksum = P_CHKSUM(dbp, page);
-                    sumlen = pgsz;
-                    break;
-                }
-                if (F_ISSET(dbp, DB_AM_SWAP))
-                    P_32_SWAP(chksum);
-                if ((ret = __db_check_chksum_algo(dbenv, dbenv->crypto_handle,
-                                                  (void *)chksum, page, sumlen,
-                                                  is_hmac, algo)) != 0) {
-                    logmsg(LOGMSG_ERROR, "pgno %u invalid checksum\n",
-                           F_ISSET(dbp, DB_AM_SWAP) ? flibc_intflip(page->pgno)
-                                                    : page->pgno);
-                    continue;
-                }
-            }
+    /* Each range is a contiguous run of pages read sequentially by its own
+     * thread.  The file may grow while we scan; pages past what we stat'ed
+     * are picked up by the last range. */
+    nranges = gbl_analyze_comp_ranges;
+    if (nranges > npages / MIN_PAGES_PER_RANGE)
+        nranges = npages / MIN_PAGES_PER_RANGE;
+    if (nranges < 1)
+        nranges = 1;
 
-            if (is_hmac) {
-                DB_CIPHER *db_cipher = dbenv->crypto_handle;
-                void *iv = P_IV(dbp, page);
-                size_t skip = P_OVERHEAD(dbp);
-                uint8_t *ciphertext = (uint8_t *)page + skip;
-                if ((ret = db_cipher->decrypt(dbenv, db_cipher->data, iv,
-                                              ciphertext, sumlen - skip)) !=
-                    0) {
-                    logmsg(LOGMSG_ERROR, "pgno %u decryption failed\n", page->pgno);
-                    continue;
-                }
-            }
-
-            if (IS_PREFIX(page) && F_ISSET(dbp, DB_AM_SWAP))
-                prefix_tocpu(dbp, page);
+    ranges = calloc(nranges, sizeof(struct summarize_range));
+    if (ranges == NULL) {
+        rc = -1;
+        goto done;
+    }
+    scan.bdb_state = bdb_state;
+    scan.dbp = dbp;
+    scan.fd = fd;
+    scan.comp_pct = comp_pct;
+    scan.tbl = *outtbl;
+    scan.sketch = sketch;
+    pthread_mutex_init(&scan.put_lk, NULL);
 
-            db_indx_t n = NUM_ENT(page);
-            if (F_ISSET(dbp, DB_AM_SWAP))
-                n = flibc_shortflip(n);
-
-            db_indx_t *inp = P_INP(dbp, page);
-            /* entries on the page are paired as (key, data).  we only want
-             * keys) */
-            for (i = 0; i < n; i += 2) {
-                /* we have a candidate */
-                unsigned long long c = 0;
-                if (F_ISSET(dbp, DB_AM_SWAP))
-                    inp[i] = flibc_shortflip(inp[i]);
-                BKEYDATA *data = GET_BKEYDATA(dbp, page, i);
-                assert((uint8_t *)data < max);
-                /* skip deleted */
-                if (B_DISSET(data))
-                    continue;
-                if (B_TYPE(data) != B_KEYDATA)
-                    continue;
-                /* select comp_pct / 100 records */
-                if (rand() % 100 < comp_pct) {
-                    now = time_epoch();
-                    if (now - last >= 10) {
-                        last = now;
-                        rc = check_free_space(bdb_state->dir);
-                        if (rc != BDBERR_NOERROR) {
-                            *bdberr = rc;
-                            rc = -1;
-                            goto done;
-                        }
-                    }
-                    if (F_ISSET(dbp, DB_AM_SWAP))
-                        data->len = flibc_shortflip(data->len);
-                    db_indx_t len;
-                    ASSIGN_ALIGN(db_indx_t, len, data->len);
-                    assert(((uint8_t *)data + len) < max);
-                    if ((rc = bk_decompress(dbp, page, &data, pfxbuf,
-                                            sizeof(pfxbuf))) != 0) {
-                        logmsg(LOGMSG_ERROR, 
-                                "\ndecompress failed page:%d i:%d total:%d\n",
-                                page->pgno, i, n);
-                        goto done;
-                    }
-                    ASSIGN_ALIGN(db_indx_t, len, data->len);
-                    rc = bdb_temp_table_put(
-                        bdb_state->parent, *outtbl, data->data, len, &c,
-                        sizeof(unsigned long long), NULL, bdberr);
-                    if (rc)
-                        goto done;
-                    nrecs++;
-                }
-                recs_looked_at++;
+    for (i = 0; i < nranges; i++) {
+        struct summarize_range *r = &ranges[i];
+        r->scan = &scan;
+        r->first = (unsigned long long)npages * i / nranges;
+        r->last = i == nranges - 1 ? UINT_MAX
+                                   : (unsigned long long)npages * (i + 1) /
+                                         nranges;
+        r->seed = rand();
+        if (sketch) {
+            nsketched = i + 1;
+            if (sketch_range_init(r)) {
+                logmsg(LOGMSG_ERROR, "%s: can't allocate sketches\n",
+                       __func__);
+                rc = -1;
+                goto done;
             }
         }
+    }
+    /* the first range runs on this thread */
+    for (i = 1; i < nranges; i++) {
+        if ((rc = pthread_create(&ranges[i].tid, NULL, summarize_range_thd,
+                                 &ranges[i])) != 0) {
+            logmsg(LOGMSG_ERROR, "%s: can't create range thread rc %d\n",
+                   __func__, rc);
+            scan.stop = 1;
+            nranges = i;
+            break;
+        }
+    }
+    summarize_range_thd(&ranges[0]);
+    for (i = 1; i < nranges; i++)
+        pthread_join(ranges[i].tid, NULL);
+    pthread_mutex_destroy(&scan.put_lk);
 
-        int get_analyze_abort_requested();
-        if (gbl_schema_change_in_progress || get_analyze_abort_requested()) {
-            if (gbl_schema_change_in_progress) 
-                logmsg(LOGMSG_ERROR, "%s: Aborting Analyze because "
-                        "schema_change_in_progress\n", __func__);
-            if (get_analyze_abort_requested())
-                logmsg(LOGMSG_ERROR, "%s: Aborting Analyze because "
-                        "of send analyze abort\n", __func__);
-            rc = -1;
-            goto done;
+    for (i = 0; i < nranges; i++) {
+        struct summarize_range *r = &ranges[i];
+        nrecs += r->nrecs;
+        recs_looked_at += r->looked_at;
+        if (r->rc && !rc) {
+            rc = r->rc;
+            *bdberr = r->bdberr;
         }
-        rc = read(fd, page, pgsz);
-        pgno++;
     }
-    if (rc != 0) {
-        logmsg(LOGMSG_ERROR, "Problem reading dta file: %d %s\n", errno,
-                strerror(errno));
-        rc = -1;
+    if (rc)
         goto done;
+
+    if (sketch) {
+        /* fold every range into the first */
+        for (i = 1; i < nranges; i++) {
+            int j;
+            for (j = 0; j < sketch->ncols; j++)
+                hll_merge(ranges[0].hll[j], ranges[i].hll[j]);
+            if ((rc = kll_merge(ranges[0].kll, ranges[i].kll)) != 0)
+                goto done;
+        }
+        for (i = 0; i < sketch->ncols; i++)
+            sketch->ndistinct[i] = hll_count(ranges[0].hll[i]);
+        sketch->kll = ranges[0].kll;
+        ranges[0].kll = NULL;
+        logmsg(LOGMSG_INFO, "summarize sketched %llu records in %d ranges\n",
+               nrecs, nranges);
+    } else {
+        logmsg(LOGMSG_INFO, "summarize added %llu records, traversed %llu in "
+                            "%d ranges\n",
+               nrecs, recs_looked_at, nranges);
     }
-    logmsg(LOGMSG_INFO, "summarize added %d records, traversed %lld\n", nrecs,
-           recs_looked_at);
 done:
     if (fd != -1)
         close(fd);
-    if (page)
-        free(page);
+    for (i = 0; i < nsketched; i++)
+        sketch_range_free(&ranges[i]);
+    free(ranges);
     if (rc && *outtbl && created_temp_table) {
         int crc;
         int cbdberr;
@@ -370,4 +618,3 @@ done:
     *cmprecs = recs_looked_at;
     return rc;
 }
-
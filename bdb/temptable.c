@@ -17,6 +17,7 @@
 #include <alloca.h>
 
 #include <errno.h>
+#include <inttypes.h>
 #include <pthread.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -37,6 +38,7 @@
 #include <execinfo.h>
 #endif
 #include <logmsg.h>
+#include <gettimeofday_ms.h>
 
 /* One of the difference between using b-tree and hash is that in using hash, we
  * get pointer of data in hash table,
@@ -88,6 +90,34 @@ struct temp_list_node {
     void *data;
 };
 
+/* In-memory ordered temp tables are a skiplist whose nodes are carved out of
+ * a per-table arena.  A node carries its forward pointers, then the key, then
+ * the data, so a lookup touches one contiguous allocation per hop.  The
+ * bottom level is doubly linked for prev/last. */
+#define TEMP_SL_MAXLEVEL 16
+#define TEMP_ARENA_BLKSZ (64 * 1024)
+#define TEMP_ALIGN(n) (((size_t)(n) + 7) & ~(size_t)7)
+
+struct temp_sl_node {
+    struct temp_sl_node *prev;
+    void *data;
+    int keylen;
+    int datalen;
+    int datacap;
+    short height;
+    short deleted;
+    struct temp_sl_node *next[/*height*/];
+};
+
+#define temp_sl_key(n) ((uint8_t *)&(n)->next[(n)->height])
+
+struct temp_arena_blk {
+    struct temp_arena_blk *next;
+    size_t size;
+    size_t used;
+    uint8_t mem[];
+};
+
 /* code for SQL temp table support */
 struct temp_cursor {
     DBC *cur;
@@ -100,12 +130,18 @@ struct temp_cursor {
     struct temp_table *tbl;
     int curid;
     struct temp_list_node *list_cur;
+    struct temp_sl_node *sl_cur;
     void *hash_cur;
     unsigned int hash_cur_buk;
     LINKC_T(struct temp_cursor) lnk;
 };
 
-enum { TEMP_TABLE_TYPE_BTREE, TEMP_TABLE_TYPE_HASH, TEMP_TABLE_TYPE_LIST };
+enum {
+    TEMP_TABLE_TYPE_BTREE,
+    TEMP_TABLE_TYPE_HASH,
+    TEMP_TABLE_TYPE_LIST,
+    TEMP_TABLE_TYPE_SKIPLIST
+};
 
 struct temp_table {
     DB_ENV *dbenv_temp;
@@ -115,6 +151,15 @@ struct temp_table {
     LISTC_T(struct temp_list_node) temp_tbl_list;
     hash_t *temp_hash_tbl;
 
+    struct temp_sl_node *sl_head;
+    struct temp_sl_node *sl_tail;
+    int sl_level;
+    unsigned int sl_seed;
+    struct temp_arena_blk *arena;
+    struct temp_arena_blk *arena_retired; /* rows spilled to tmpdb */
+    size_t arena_bytes;
+    size_t mem_budget;
+
     tmptbl_cmp cmpfunc;
     void *usermem;
     char filename[512];
@@ -146,7 +191,9 @@ static int temp_table_compare(DB *db, const DBT *dbt1, const DBT *dbt2);
 /* refactored both insert and put code paths here */
 static int bdb_temp_table_insert_put(bdb_state_type *, struct temp_table *,
                                      void *key, int keylen, void *data,
-                                     int dtalen, int *bdberr);
+                                     int dtalen, void *unpacked, int *bdberr);
+static int bdb_temp_table_init_env(bdb_state_type *, struct temp_table *,
+                                   int *bdberr);
 
 void *bdb_temp_table_get_cur(struct temp_cursor *skippy) { return skippy->cur; }
 
@@ -174,6 +221,10 @@ static int bdb_hash_table_copy_to_temp_db(bdb_state_type *bdb_state,
     unsigned int hash_cur_buk;
     char *data;
 
+    rc = bdb_temp_table_init_env(bdb_state, tbl, bdberr);
+    if (rc)
+        return rc;
+
     /* copy the hash to a btree */
     data = hash_first(tbl->temp_hash_tbl, &hash_cur, &hash_cur_buk);
     while (data) {
@@ -236,6 +287,340 @@ done:
     return rc;
 }
 
+static void *temp_arena_alloc(struct temp_table *tbl, size_t sz)
+{
+    struct temp_arena_blk *blk = tbl->arena;
+    void *p;
+
+    sz = TEMP_ALIGN(sz);
+    if (blk == NULL || blk->used + sz > blk->size) {
+        size_t blksz = sz > TEMP_ARENA_BLKSZ ? sz : TEMP_ARENA_BLKSZ;
+        blk = malloc(offsetof(struct temp_arena_blk, mem) + blksz);
+        if (blk == NULL)
+            return NULL;
+        blk->size = blksz;
+        blk->used = 0;
+        blk->next = tbl->arena;
+        tbl->arena = blk;
+        tbl->arena_bytes += blksz;
+    }
+    p = blk->mem + blk->used;
+    blk->used += sz;
+    return p;
+}
+
+static void temp_arena_free_list(struct temp_arena_blk *blk)
+{
+    struct temp_arena_blk *next;
+    for (; blk; blk = next) {
+        next = blk->next;
+        free(blk);
+    }
+}
+
+/* Drop every row but keep the first block around so a pooled table does
+ * not go back to malloc for its first rows. */
+static void temp_arena_reset(struct temp_table *tbl)
+{
+    struct temp_arena_blk *blk = tbl->arena, *keep = NULL;
+
+    /* the oldest block is last on the list */
+    while (blk && blk->next) {
+        struct temp_arena_blk *next = blk->next;
+        free(blk);
+        blk = next;
+    }
+    if (blk && blk->size == TEMP_ARENA_BLKSZ) {
+        keep = blk;
+        keep->used = 0;
+    } else {
+        free(blk);
+    }
+    tbl->arena = keep;
+    tbl->arena_bytes = keep ? keep->size : 0;
+
+    temp_arena_free_list(tbl->arena_retired);
+    tbl->arena_retired = NULL;
+}
+
+static void temp_sl_init(struct temp_table *tbl)
+{
+    memset(tbl->sl_head->next, 0,
+           sizeof(struct temp_sl_node *) * TEMP_SL_MAXLEVEL);
+    tbl->sl_tail = NULL;
+    tbl->sl_level = 1;
+}
+
+static int temp_sl_random_level(struct temp_table *tbl)
+{
+    unsigned int r;
+    int level = 1;
+
+    /* xorshift; a quarter of the nodes reach each next level */
+    r = tbl->sl_seed;
+    r ^= r << 13;
+    r ^= r >> 17;
+    r ^= r << 5;
+    tbl->sl_seed = r;
+    while ((r & 3) == 0 && level < TEMP_SL_MAXLEVEL) {
+        level++;
+        r >>= 2;
+    }
+    return level;
+}
+
+/* same argument order as temp_table_compare: <0 if key sorts before n */
+static inline int temp_sl_cmp(struct temp_table *tbl, const void *key,
+                              int keylen, void *unpacked,
+                              struct temp_sl_node *n)
+{
+    if (unpacked)
+        return -tbl->cmpfunc(NULL, n->keylen, temp_sl_key(n), -1, unpacked);
+    return tbl->cmpfunc(tbl->usermem, keylen, key, n->keylen, temp_sl_key(n));
+}
+
+/* Return the first node >= key, and its comparison against key in *cmp.
+ * If update is given, fill it with the last node < key on every level. */
+static struct temp_sl_node *temp_sl_seek(struct temp_table *tbl,
+                                         const void *key, int keylen,
+                                         void *unpacked,
+                                         struct temp_sl_node **update,
+                                         int *cmp)
+{
+    struct temp_sl_node *x = tbl->sl_head, *n = NULL;
+    int c = 1;
+
+    for (int i = tbl->sl_level - 1; i >= 0; i--) {
+        while ((n = x->next[i]) != NULL &&
+               (c = temp_sl_cmp(tbl, key, keylen, unpacked, n)) > 0)
+            x = n;
+        if (update)
+            update[i] = x;
+    }
+    *cmp = n ? c : 1;
+    return n;
+}
+
+static int temp_sl_set_data(struct temp_table *tbl, struct temp_sl_node *n,
+                            void *data, int dtalen)
+{
+    if (dtalen > n->datacap) {
+        void *p = temp_arena_alloc(tbl, dtalen);
+        if (p == NULL)
+            return ENOMEM;
+        n->data = p;
+        n->datacap = dtalen;
+    }
+    memcpy(n->data, data, dtalen);
+    n->datalen = dtalen;
+    return 0;
+}
+
+static int temp_sl_insert(struct temp_table *tbl, void *key, int keylen,
+                          void *data, int dtalen, void *unpacked)
+{
+    struct temp_sl_node *update[TEMP_SL_MAXLEVEL];
+    struct temp_sl_node *n, *x;
+    int cmp, height;
+
+    n = temp_sl_seek(tbl, key, keylen, unpacked, update, &cmp);
+    if (n && cmp == 0) {
+        /* a put into the non-dup btree replaces the data, so do we */
+        return temp_sl_set_data(tbl, n, data, dtalen);
+    }
+
+    height = temp_sl_random_level(tbl);
+    x = temp_arena_alloc(tbl, offsetof(struct temp_sl_node, next) +
+                                  height * sizeof(struct temp_sl_node *) +
+                                  TEMP_ALIGN(keylen) + dtalen);
+    if (x == NULL)
+        return ENOMEM;
+    if (height > tbl->sl_level) {
+        for (int i = tbl->sl_level; i < height; i++)
+            update[i] = tbl->sl_head;
+        tbl->sl_level = height;
+    }
+
+    x->height = height;
+    x->deleted = 0;
+    x->keylen = keylen;
+    x->datalen = x->datacap = dtalen;
+    memcpy(temp_sl_key(x), key, keylen);
+    x->data = temp_sl_key(x) + TEMP_ALIGN(keylen);
+    memcpy(x->data, data, dtalen);
+
+    for (int i = 0; i < height; i++) {
+        x->next[i] = update[i]->next[i];
+        update[i]->next[i] = x;
+    }
+    x->prev = (update[0] == tbl->sl_head) ? NULL : update[0];
+    if (x->next[0])
+        x->next[0]->prev = x;
+    else
+        tbl->sl_tail = x;
+
+    tbl->num_mem_entries++;
+    return 0;
+}
+
+/* Unlink n.  Its memory stays in the arena until the table is truncated,
+ * so cursors (and callers) still looking at it keep a valid row. */
+static void temp_sl_delete(struct temp_table *tbl, struct temp_sl_node *n)
+{
+    struct temp_sl_node *update[TEMP_SL_MAXLEVEL];
+    int cmp;
+
+    if (n->deleted)
+        return;
+
+    temp_sl_seek(tbl, temp_sl_key(n), n->keylen, NULL, update, &cmp);
+    for (int i = 0; i < n->height; i++) {
+        if (update[i]->next[i] == n)
+            update[i]->next[i] = n->next[i];
+    }
+    if (n->next[0])
+        n->next[0]->prev = n->prev;
+    else
+        tbl->sl_tail = n->prev;
+    while (tbl->sl_level > 1 && tbl->sl_head->next[tbl->sl_level - 1] == NULL)
+        tbl->sl_level--;
+
+    n->deleted = 1;
+    tbl->num_mem_entries--;
+}
+
+static struct temp_sl_node *temp_sl_next(struct temp_table *tbl,
+                                         struct temp_sl_node *n)
+{
+    if (n->deleted) {
+        /* the links of a deleted node are stale; find where it used to be */
+        int cmp;
+        struct temp_sl_node *x =
+            temp_sl_seek(tbl, temp_sl_key(n), n->keylen, NULL, NULL, &cmp);
+        if (x && cmp == 0)
+            x = x->next[0];
+        return x;
+    }
+    return n->next[0];
+}
+
+static struct temp_sl_node *temp_sl_prev(struct temp_table *tbl,
+                                         struct temp_sl_node *n)
+{
+    if (n->deleted) {
+        struct temp_sl_node *update[TEMP_SL_MAXLEVEL];
+        int cmp;
+        temp_sl_seek(tbl, temp_sl_key(n), n->keylen, NULL, update, &cmp);
+        return (update[0] == tbl->sl_head) ? NULL : update[0];
+    }
+    return n->prev;
+}
+
+static int temp_sl_setcur(struct temp_cursor *cur, struct temp_sl_node *n)
+{
+    cur->sl_cur = n;
+    if (n == NULL) {
+        cur->valid = 0;
+        return IX_PASTEOF;
+    }
+    cur->key = temp_sl_key(n);
+    cur->keylen = n->keylen;
+    cur->data = n->data;
+    cur->datalen = n->datalen;
+    cur->valid = 1;
+    return IX_FND;
+}
+
+/* The skiplist outgrew its memory budget.  Load it, already sorted, into the
+ * btree and carry on as a btree table.  The arena is retired rather than
+ * freed until the next truncate, since callers may still hold row pointers
+ * they got from a cursor. */
+static int bdb_skiplist_copy_to_temp_db(bdb_state_type *bdb_state,
+                                        struct temp_table *tbl, int *bdberr)
+{
+    int rc = 0;
+    DBT dbt_key, dbt_data;
+    struct temp_sl_node *n;
+    struct temp_cursor *cur;
+    struct temp_arena_blk *blk;
+
+    rc = bdb_temp_table_init_env(bdb_state, tbl, bdberr);
+    if (rc)
+        return rc;
+
+    bzero(&dbt_key, sizeof(DBT));
+    bzero(&dbt_data, sizeof(DBT));
+
+    for (n = tbl->sl_head->next[0]; n; n = n->next[0]) {
+        dbt_key.data = temp_sl_key(n);
+        dbt_key.ulen = dbt_key.size = n->keylen;
+        dbt_data.data = n->data;
+        dbt_data.ulen = dbt_data.size = n->datalen;
+        rc = tbl->tmpdb->put(tbl->tmpdb, NULL, &dbt_key, &dbt_data, 0);
+        if (rc) {
+            logmsg(LOGMSG_ERROR, "%s:%d put rc %d\n", __FILE__, __LINE__, rc);
+            *bdberr = rc;
+            return rc;
+        }
+    }
+
+    /* Btree cursors own malloced copies of their current row; give every
+       positioned cursor one and move it to the same key in the btree. */
+    LISTC_FOR_EACH(&tbl->cursors, cur, lnk)
+    {
+        rc = tbl->tmpdb->cursor(tbl->tmpdb, NULL, &cur->cur, 0);
+        if (rc) {
+            cur->cur = NULL;
+            logmsg(LOGMSG_ERROR, "%s:%d cursor rc %d\n", __FILE__, __LINE__, rc);
+            *bdberr = rc;
+            return rc;
+        }
+        cur->sl_cur = NULL;
+        if (!cur->valid) {
+            cur->key = cur->data = NULL;
+            cur->keylen = cur->datalen = 0;
+            continue;
+        }
+
+        void *key = malloc(cur->keylen);
+        void *data = malloc(cur->datalen ? cur->datalen : 1);
+        memcpy(key, cur->key, cur->keylen);
+        memcpy(data, cur->data, cur->datalen);
+        cur->key = key;
+        cur->data = data;
+
+        bzero(&dbt_key, sizeof(DBT));
+        bzero(&dbt_data, sizeof(DBT));
+        dbt_key.data = key;
+        dbt_key.size = cur->keylen;
+        dbt_data.flags = DB_DBT_USERMEM | DB_DBT_PARTIAL;
+        rc = cur->cur->c_get(cur->cur, &dbt_key, &dbt_data, DB_SET_RANGE);
+        if (rc == DB_NOTFOUND)
+            rc = cur->cur->c_get(cur->cur, &dbt_key, &dbt_data, DB_LAST);
+        if (rc && rc != DB_NOTFOUND) {
+            logmsg(LOGMSG_ERROR, "%s:%d c_get rc %d\n", __FILE__, __LINE__, rc);
+            *bdberr = rc;
+            return rc;
+        }
+        rc = 0;
+    }
+
+    /* retire the arena */
+    for (blk = tbl->arena; blk && blk->next; blk = blk->next)
+        ;
+    if (blk) {
+        blk->next = tbl->arena_retired;
+        tbl->arena_retired = tbl->arena;
+    }
+    tbl->arena = NULL;
+    tbl->arena_bytes = 0;
+    temp_sl_init(tbl);
+
+    /* its now a btree! */
+    tbl->temp_table_type = TEMP_TABLE_TYPE_BTREE;
+    return 0;
+}
+
 static int bdb_temp_table_init_temp_db(bdb_state_type *bdb_state,
                                        struct temp_table *tbl, int *bdberr)
 {
@@ -307,6 +692,10 @@ static int bdb_temp_table_env_close(bdb_state_type *bdb_state,
         }
         tbl->tmpdb = NULL;
     }
+    if (tbl->dbenv_temp == NULL) {
+        *bdberr = 0;
+        return 0;
+    }
     rc = tbl->dbenv_temp->close(tbl->dbenv_temp, 0);
     if (rc) {
         logmsg(LOGMSG_ERROR, "%s: failed to close dbenv_temp rc=%d\n", __func__, rc);
@@ -317,99 +706,128 @@ static int bdb_temp_table_env_close(bdb_state_type *bdb_state,
     return 0;
 }
 
-pthread_key_t current_sql_query_key;
-int gbl_debug_temptables = 0;
-
-static struct temp_table *bdb_temp_table_create_main(bdb_state_type *bdb_state,
-                                                     int *bdberr)
+/* Open the table's private berkeley environment and create its btree, if
+   that hasn't been done yet.  In-memory tables defer this to their first
+   spill, so short-lived ones never pay for an environment. */
+static int bdb_temp_table_init_env(bdb_state_type *bdb_state,
+                                   struct temp_table *tbl, int *bdberr)
 {
     int rc;
-    struct temp_table *tbl;
     bdb_state_type *parent;
-    int id;
     DB_ENV *dbenv_temp;
     unsigned int gb = 0, bytes = 0;
+    unsigned long long rowid;
+    int num_mem_entries;
+
+    if (tbl->tmpdb)
+        return 0;
 
     if (bdb_state->parent)
         parent = bdb_state->parent;
     else
         parent = bdb_state;
 
-    tbl = malloc(sizeof(struct temp_table));
-    tbl->next = NULL;
-    tbl->tmpdb = NULL;
-    tbl->cmpfunc = key_memcmp;
+    if (tbl->dbenv_temp == NULL) {
+        rc = db_env_create(&dbenv_temp, 0);
+        if (rc != 0) {
+            logmsg(LOGMSG_ERROR, "couldnt create temp table env\n");
+            *bdberr = rc;
+            return rc;
+        }
 
-    rc = db_env_create(&dbenv_temp, 0);
-    if (rc != 0) {
-        logmsg(LOGMSG_ERROR, "couldnt create temp table env\n");
-        free(tbl);
-        tbl = NULL;
-        goto done;
-    }
+        if (gbl_crypto) {
+            // generate random password for temp tables
+            char passwd[64]; passwd[0] = 0;
+            while (passwd[0] == 0) {
+                RAND_bytes(passwd, 63);
+            }
+            passwd[63] = 0;
+            if ((rc = dbenv_temp->set_encrypt(dbenv_temp, passwd,
+                                              DB_ENCRYPT_AES)) != 0) {
+                fprintf(stderr, "%s set_encrypt rc:%d\n", __func__, rc);
+                goto err;
+            }
+            memset(passwd, 0xff, sizeof(passwd));
+        }
 
-    if (gbl_crypto) {
-        // generate random password for temp tables
-        char passwd[64]; passwd[0] = 0;
-        while (passwd[0] == 0) {
-            RAND_bytes(passwd, 63);
+        rc = dbenv_temp->set_is_tmp_tbl(dbenv_temp, 1);
+        if (rc != 0) {
+            logmsg(LOGMSG_ERROR, "couldnt set property is_tmp_tbl\n");
+            goto err;
         }
-        passwd[63] = 0;
-        if ((rc = dbenv_temp->set_encrypt(dbenv_temp, passwd,
-                                          DB_ENCRYPT_AES)) != 0) {
-            fprintf(stderr, "%s set_encrypt rc:%d\n", __func__, rc);
-            free(tbl);
-            tbl = NULL;
-            goto done;
+
+        bytes = bdb_state->attr->temptable_cachesz;
+
+        /* 512k minimim cache */
+        if (bytes < 524288)
+            bytes = 524288;
+
+        rc = dbenv_temp->set_tmp_dir(dbenv_temp, parent->tmpdir);
+        if (rc) {
+            logmsg(LOGMSG_ERROR, "can't set temp table environment's temp directory");
+            /* continue anyway */
         }
-        memset(passwd, 0xff, sizeof(passwd));
-    }
 
-    rc = dbenv_temp->set_is_tmp_tbl(dbenv_temp, 1);
-    if (rc != 0) {
-        logmsg(LOGMSG_ERROR, "couldnt set property is_tmp_tbl\n");
-        free(tbl);
-        tbl = NULL;
-        goto done;
-    }
+        rc = dbenv_temp->set_cachesize(dbenv_temp, gb, bytes, 1);
+        if (rc != 0) {
+            logmsg(LOGMSG_ERROR, "invalid set_cache_size call: gb %d bytes %d\n", gb, bytes);
+            goto err;
+        }
 
-    bytes = bdb_state->attr->temptable_cachesz;
+        rc = dbenv_temp->set_tmp_dir(dbenv_temp, parent->tmpdir);
+        if (rc) {
+            logmsg(LOGMSG_ERROR, "can't set temp table environment's temp directory");
+            /* continue anyway */
+        }
 
-    /* 512k minimim cache */
-    if (bytes < 524288)
-        bytes = 524288;
+        rc = dbenv_temp->open(dbenv_temp, parent->tmpdir,
+                              DB_INIT_MPOOL | DB_CREATE | DB_PRIVATE, 0666);
+        if (rc != 0) {
+            logmsg(LOGMSG_ERROR, "couldnt open temp table env\n");
+            goto err;
+        }
 
-    rc = dbenv_temp->set_tmp_dir(dbenv_temp, parent->tmpdir);
-    if (rc) {
-        logmsg(LOGMSG_ERROR, "can't set temp table environment's temp directory");
-        /* continue anyway */
+        tbl->dbenv_temp = dbenv_temp;
     }
 
-    rc = dbenv_temp->set_cachesize(dbenv_temp, gb, bytes, 1);
-    if (rc != 0) {
-        logmsg(LOGMSG_ERROR, "invalid set_cache_size call: gb %d bytes %d\n", gb, bytes);
-        free(tbl);
-        *bdberr = rc;
-        tbl = NULL;
-        goto done;
-    }
+    /* a spilling table keeps its rowids and entry count */
+    rowid = tbl->rowid;
+    num_mem_entries = tbl->num_mem_entries;
+    rc = bdb_temp_table_init_temp_db(bdb_state, tbl, bdberr);
+    if (rc)
+        return rc;
+    tbl->rowid = rowid;
+    tbl->num_mem_entries = num_mem_entries;
+    return 0;
 
-    rc = dbenv_temp->set_tmp_dir(dbenv_temp, parent->tmpdir);
-    if (rc) {
-        logmsg(LOGMSG_ERROR, "can't set temp table environment's temp directory");
-        /* continue anyway */
-    }
+err:
+    dbenv_temp->close(dbenv_temp, 0);
+    *bdberr = rc;
+    return rc;
+}
 
-    rc = dbenv_temp->open(dbenv_temp, parent->tmpdir,
-                          DB_INIT_MPOOL | DB_CREATE | DB_PRIVATE, 0666);
-    if (rc != 0) {
-        logmsg(LOGMSG_ERROR, "couldnt open temp table env\n");
-        free(tbl);
-        tbl = NULL;
-        goto done;
-    }
+pthread_key_t current_sql_query_key;
+int gbl_debug_temptables = 0;
+
+static struct temp_table *bdb_temp_table_create_main(bdb_state_type *bdb_state,
+                                                     int *bdberr)
+{
+    int rc;
+    struct temp_table *tbl;
+    bdb_state_type *parent;
+    int id;
 
-    tbl->dbenv_temp = dbenv_temp;
+    if (bdb_state->parent)
+        parent = bdb_state->parent;
+    else
+        parent = bdb_state;
+
+    tbl = malloc(sizeof(struct temp_table));
+    tbl->next = NULL;
+    tbl->tmpdb = NULL;
+    tbl->cmpfunc = key_memcmp;
+
+    tbl->dbenv_temp = NULL;
 
     if (gbl_temptable_pool_capacity == 0) {
         Pthread_mutex_lock(&parent->temp_list_lock);
@@ -428,17 +846,23 @@ static struct temp_table *bdb_temp_table_create_main(bdb_state_type *bdb_state,
 
     tbl->max_mem_entries = bdb_state->attr->temptable_mem_threshold;
 
-    rc = bdb_temp_table_init_temp_db(bdb_state, tbl, bdberr);
-    if (rc) {
-        free(tbl);
-        tbl = NULL;
-        goto done;
-    }
+    /* The berkeley env and btree are only built once the table needs them
+       (a btree table, or a list/hash/skiplist spilling to disk). */
+    tbl->rowid = 2;
+    tbl->num_mem_entries = 0;
 
     listc_init(&tbl->temp_tbl_list, offsetof(struct temp_list_node, lnk));
 
     tbl->temp_hash_tbl = hash_init_user(hashfunc, hashcmpfunc, 0, 0);
 
+    tbl->sl_head = malloc(offsetof(struct temp_sl_node, next) +
+                          TEMP_SL_MAXLEVEL * sizeof(struct temp_sl_node *));
+    tbl->sl_head->height = TEMP_SL_MAXLEVEL;
+    tbl->sl_seed = (unsigned int)id * 2654435761U | 1;
+    tbl->arena = tbl->arena_retired = NULL;
+    tbl->arena_bytes = 0;
+    temp_sl_init(tbl);
+
 #ifdef _LINUX_SOURCE
     if (gbl_debug_temptables) {
         char *sql;
@@ -552,23 +976,42 @@ static struct temp_table *bdb_temp_table_create_type(bdb_state_type *bdb_state,
     table->num_mem_entries = 0;
     table->cmpfunc = key_memcmp;
     table->temp_table_type = temp_table_type;
+    table->mem_budget = bdb_state->attr->temptable_skiplist_budget;
+
+    if (temp_table_type == TEMP_TABLE_TYPE_BTREE &&
+        bdb_temp_table_init_env(bdb_state, table, bdberr)) {
+        int err;
+        bdb_temp_table_close(bdb_state, table, &err);
+        return NULL;
+    }
 
     return table;
 }
 
+/* ordered temp tables start in memory if the skiplist backend is enabled */
+static int bdb_temp_table_ordered_type(bdb_state_type *bdb_state)
+{
+    if (bdb_state->parent)
+        bdb_state = bdb_state->parent;
+    if (bdb_state->attr->temptable_skiplist)
+        return TEMP_TABLE_TYPE_SKIPLIST;
+    return TEMP_TABLE_TYPE_BTREE;
+}
+
 struct temp_table *bdb_temp_table_create_flags(bdb_state_type *bdb_state,
                                                int flags, int *bdberr)
 {
     int temptype;
 
-    temptype = TEMP_TABLE_TYPE_BTREE;
+    temptype = bdb_temp_table_ordered_type(bdb_state);
 
     return bdb_temp_table_create_type(bdb_state, temptype, bdberr);
 }
 
 struct temp_table *bdb_temp_table_create(bdb_state_type *bdb_state, int *bdberr)
 {
-    return bdb_temp_table_create_type(bdb_state, TEMP_TABLE_TYPE_BTREE, bdberr);
+    return bdb_temp_table_create_type(
+        bdb_state, bdb_temp_table_ordered_type(bdb_state), bdberr);
 }
 
 struct temp_table *bdb_temp_list_create(bdb_state_type *bdb_state, int *bdberr)
@@ -609,6 +1052,11 @@ struct temp_cursor *bdb_temp_table_cursor(bdb_state_type *bdb_state,
         rc = 0;
         break;
 
+    case TEMP_TABLE_TYPE_SKIPLIST:
+        cur->sl_cur = NULL;
+        rc = 0;
+        break;
+
     case TEMP_TABLE_TYPE_BTREE:
         rc = tbl->tmpdb->cursor(tbl->tmpdb, NULL, &cur->cur, 0);
         break;
@@ -645,7 +1093,7 @@ int bdb_temp_table_insert(bdb_state_type *bdb_state, struct temp_cursor *cur,
     struct temp_table *tbl = cur->tbl;
 
     int rc = bdb_temp_table_insert_put(bdb_state, tbl, key, keylen, data,
-                                       dtalen, bdberr);
+                                       dtalen, NULL, bdberr);
     if (rc <= 0)
         goto done;
 
@@ -681,6 +1129,26 @@ int bdb_temp_table_update(bdb_state_type *bdb_state, struct temp_cursor *cur,
     DBT dkey, ddata;
     int rc = 0;
 
+    if (cur->tbl->temp_table_type == TEMP_TABLE_TYPE_SKIPLIST) {
+        if (!cur->valid || cur->sl_cur == NULL)
+            return -1;
+        rc = temp_sl_set_data(cur->tbl, cur->sl_cur, data, dtalen);
+        if (rc) {
+            *bdberr = rc;
+            return -1;
+        }
+        cur->data = cur->sl_cur->data;
+        cur->datalen = cur->sl_cur->datalen;
+
+        /* a bigger row may push the arena past its budget, same as insert */
+        if (cur->tbl->arena_bytes > cur->tbl->mem_budget) {
+            rc = bdb_skiplist_copy_to_temp_db(bdb_state, cur->tbl, bdberr);
+            if (unlikely(rc))
+                return -1;
+        }
+        return 0;
+    }
+
     if (cur->tbl->temp_table_type != TEMP_TABLE_TYPE_BTREE) {
         logmsg(LOGMSG_ERROR, "bdb_temp_table_update operation "
                         "only supported for btree.\n");
@@ -725,7 +1193,7 @@ int bdb_temp_table_put(bdb_state_type *bdb_state, struct temp_table *tbl,
     DBT dkey, ddata;
 
     int rc = bdb_temp_table_insert_put(bdb_state, tbl, key, keylen, data,
-                                       dtalen, bdberr);
+                                       dtalen, unpacked, bdberr);
     if (rc <= 0)
         goto done;
 
@@ -798,6 +1266,14 @@ static int bdb_temp_table_first_last(bdb_state_type *bdb_state,
         return 0;
     }
 
+    if (cur->tbl->temp_table_type == TEMP_TABLE_TYPE_SKIPLIST) {
+        struct temp_table *tbl = cur->tbl;
+        if (temp_sl_setcur(cur, how == DB_FIRST ? tbl->sl_head->next[0]
+                                                : tbl->sl_tail) != IX_FND)
+            return IX_EMPTY;
+        return 0;
+    }
+
     /* if cursor was deleted, need to reopen */
     if (cur->cur == NULL) {
         int rc = cur->tbl->tmpdb->cursor(cur->tbl->tmpdb, NULL, &cur->cur, 0);
@@ -890,6 +1366,13 @@ static int bdb_temp_table_next_prev_norewind(bdb_state_type *bdb_state,
         return 0;
     }
 
+    if (cur->tbl->temp_table_type == TEMP_TABLE_TYPE_SKIPLIST) {
+        struct temp_sl_node *n = cur->sl_cur;
+        n = (how == DB_NEXT) ? temp_sl_next(cur->tbl, n)
+                             : temp_sl_prev(cur->tbl, n);
+        return temp_sl_setcur(cur, n);
+    }
+
     /* if cursor was deleted, need to reopen */
     if (cur->cur == NULL) {
         int rc = cur->tbl->tmpdb->cursor(cur->tbl->tmpdb, NULL, &cur->cur, 0);
@@ -1160,7 +1643,23 @@ int bdb_temp_table_truncate(bdb_state_type *bdb_state, struct temp_table *tbl,
         }
         break;
 
+    case TEMP_TABLE_TYPE_SKIPLIST: {
+        struct temp_cursor *cur;
+        LISTC_FOR_EACH(&tbl->cursors, cur, lnk)
+        {
+            cur->sl_cur = NULL;
+            cur->key = cur->data = NULL;
+            cur->valid = 0;
+        }
+        temp_arena_reset(tbl);
+        temp_sl_init(tbl);
+        tbl->num_mem_entries = 0;
+    } break;
+
     case TEMP_TABLE_TYPE_BTREE:
+        /* a spilled skiplist may have left retired rows behind */
+        if (tbl->arena_retired)
+            temp_arena_reset(tbl);
 
         if (tbl->num_mem_entries < 100)
             rc = bdb_temp_table_truncate_temp_db(bdb_state, tbl, bdberr);
@@ -1211,7 +1710,8 @@ int bdb_temp_table_close(bdb_state_type *bdb_state, struct temp_table *tbl,
 
     Pthread_mutex_lock(&(bdb_state->temp_list_lock));
 
-    if ((tbl->dbenv_temp->memp_stat(tbl->dbenv_temp, &tmp, NULL,
+    if (tbl->dbenv_temp &&
+        (tbl->dbenv_temp->memp_stat(tbl->dbenv_temp, &tmp, NULL,
                                     DB_STAT_CLEAR)) == 0) {
         bdb_state->temp_stats->st_gbytes += tmp->st_gbytes;
         bdb_state->temp_stats->st_bytes += tmp->st_bytes;
@@ -1310,7 +1810,8 @@ int bdb_temp_table_destroy_lru(struct temp_table *tbl,
     bdb_state->temp_list = tbl->next;
     *last = 0;
 
-    if ((tbl->dbenv_temp->memp_stat(tbl->dbenv_temp, &tmp, NULL,
+    if (tbl->dbenv_temp &&
+        (tbl->dbenv_temp->memp_stat(tbl->dbenv_temp, &tmp, NULL,
                                     DB_STAT_CLEAR)) == 0) {
         bdb_state->temp_stats->st_gbytes += tmp->st_gbytes;
         bdb_state->temp_stats->st_bytes += tmp->st_bytes;
@@ -1385,6 +1886,7 @@ int bdb_temp_table_destroy_lru(struct temp_table *tbl,
         hash_clear(tbl->temp_hash_tbl);
     } break;
 
+    case TEMP_TABLE_TYPE_SKIPLIST:
     case TEMP_TABLE_TYPE_BTREE:
         break;
     }
@@ -1392,6 +1894,10 @@ int bdb_temp_table_destroy_lru(struct temp_table *tbl,
     hash_free(tbl->temp_hash_tbl);
     tbl->temp_hash_tbl = NULL;
 
+    temp_arena_free_list(tbl->arena);
+    temp_arena_free_list(tbl->arena_retired);
+    free(tbl->sl_head);
+
     /* close the environments*/
     rc = bdb_temp_table_env_close(bdb_state, tbl, bdberr);
 
@@ -1424,6 +1930,16 @@ int bdb_temp_table_delete(bdb_state_type *bdb_state, struct temp_cursor *cur,
         goto done;
     }
 
+    if (cur->tbl->temp_table_type == TEMP_TABLE_TYPE_SKIPLIST) {
+        if (!cur->valid || cur->sl_cur == NULL) {
+            rc = -1;
+            goto done;
+        }
+        temp_sl_delete(cur->tbl, cur->sl_cur);
+        rc = 0;
+        goto done;
+    }
+
     /*pthread_setspecific(cur->tbl->curkey, cur);*/
     if (!cur->valid) {
         rc = -1;
@@ -1526,6 +2042,21 @@ int bdb_temp_table_find(bdb_state_type *bdb_state, struct temp_cursor *cur,
         return 0;
     }
 
+    if (cur->tbl->temp_table_type == TEMP_TABLE_TYPE_SKIPLIST) {
+        int cmp;
+        struct temp_sl_node *n;
+        cur->valid = 0;
+        n = temp_sl_seek(cur->tbl, key, keylen, unpacked, NULL, &cmp);
+        if (n == NULL) {
+            /* find anything at all if possible */
+            rc = bdb_temp_table_last(bdb_state, cur, bdberr);
+            goto done;
+        }
+        temp_sl_setcur(cur, n);
+        rc = 0;
+        goto done;
+    }
+
     assert(cur->cur != NULL);
 
     /*pthread_setspecific(cur->tbl->curkey, cur);*/
@@ -1628,6 +2159,17 @@ int bdb_temp_table_find_exact(bdb_state_type *bdb_state,
         return 0;
     }
 
+    if (cur->tbl->temp_table_type == TEMP_TABLE_TYPE_SKIPLIST) {
+        int cmp;
+        struct temp_sl_node *n;
+        cur->valid = 0;
+        n = temp_sl_seek(cur->tbl, key, keylen, NULL, NULL, &cmp);
+        if (n == NULL || cmp != 0)
+            return IX_NOTFND;
+        temp_sl_setcur(cur, n);
+        return IX_FND;
+    }
+
     /*pthread_setspecific(cur->tbl->curkey, cur);*/
 
     memset(&dkey, 0, sizeof(DBT));
@@ -1754,6 +2296,27 @@ void bdb_temp_table_reset_datapointers(struct temp_cursor *cur)
     }
 }
 
+/* Hand the current row's data to the caller, who must free it.  Only btree
+   cursors own a malloced copy; for the others make one. */
+void *bdb_temp_table_detach_data(struct temp_cursor *cur)
+{
+    void *data;
+
+    if (!cur->valid)
+        return NULL;
+
+    if (cur->tbl->temp_table_type != TEMP_TABLE_TYPE_BTREE) {
+        data = malloc(cur->datalen ? cur->datalen : 1);
+        if (data)
+            memcpy(data, cur->data, cur->datalen);
+        return data;
+    }
+
+    data = cur->data;
+    bdb_temp_table_reset_datapointers(cur);
+    return data;
+}
+
 /* the only move routine you should have */
 int bdb_temp_table_move(bdb_state_type *bdb_state, struct temp_cursor *cursor,
                         int how, int *bdberr)
@@ -1828,10 +2391,27 @@ int bdb_is_hashtable(struct temp_table *tt)
 static int bdb_temp_table_insert_put(bdb_state_type *bdb_state,
                                      struct temp_table *tbl, void *key,
                                      int keylen, void *data, int dtalen,
-                                     int *bdberr)
+                                     void *unpacked, int *bdberr)
 {
     int rc;
 
+    if (tbl->temp_table_type == TEMP_TABLE_TYPE_SKIPLIST) {
+        rc = temp_sl_insert(tbl, key, keylen, data, dtalen, unpacked);
+        if (unlikely(rc)) {
+            *bdberr = rc;
+            return -1;
+        }
+
+        if (tbl->arena_bytes > tbl->mem_budget) {
+            rc = bdb_skiplist_copy_to_temp_db(bdb_state, tbl, bdberr);
+            if (unlikely(rc)) {
+                return -1;
+            }
+        }
+
+        return 0;
+    }
+
     if (tbl->temp_table_type == TEMP_TABLE_TYPE_LIST) {
         struct temp_list_node *c_node = malloc(sizeof(struct temp_list_node));
         void *list_data = malloc(dtalen);
@@ -1888,7 +2468,8 @@ const char *bdb_temp_table_filename(struct temp_table *tbl)
 void bdb_temp_table_flush(struct temp_table *tbl)
 {
     DB *db = tbl->tmpdb;
-    db->sync(db, 0);
+    if (db)
+        db->sync(db, 0);
 }
 
 int bdb_temp_table_stat(bdb_state_type *bdb_state, DB_MPOOL_STAT **gspp)
@@ -1952,3 +2533,113 @@ int bdb_temp_table_stat(bdb_state_type *bdb_state, DB_MPOOL_STAT **gspp)
 
     return 0;
 }
+
+#define TEMPTABLE_BENCH_DTALEN 64
+
+static void bdb_temp_table_bench_type(bdb_state_type *bdb_state, int type,
+                                      const char *name,
+                                      unsigned long long *keys, int nrows,
+                                      int passes)
+{
+    struct temp_table *tbl;
+    struct temp_cursor *cur;
+    uint8_t data[TEMPTABLE_BENCH_DTALEN] = {0};
+    uint64_t start, insert_ms = 0, find_ms = 0, next_ms = 0;
+    long long nfound = 0, nnext = 0;
+    int bdberr = 0, spilled = 0, rc, i;
+
+    tbl = bdb_temp_table_create_type(bdb_state, type, &bdberr);
+    if (tbl == NULL) {
+        logmsg(LOGMSG_ERROR, "temptable_bench: create rc %d\n", bdberr);
+        return;
+    }
+    cur = bdb_temp_table_cursor(bdb_state, tbl, NULL, &bdberr);
+    if (cur == NULL) {
+        logmsg(LOGMSG_ERROR, "temptable_bench: cursor rc %d\n", bdberr);
+        bdb_temp_table_close(bdb_state, tbl, &bdberr);
+        return;
+    }
+
+    for (int pass = 0; pass < passes; pass++) {
+        if (pass > 0) {
+            /* truncate leaves a spilled table a btree; start over in memory */
+            bdb_temp_table_truncate(bdb_state, tbl, &bdberr);
+            tbl->temp_table_type = type;
+            tbl->num_mem_entries = 0;
+        }
+
+        start = gettimeofday_ms();
+        for (i = 0; i < nrows; i++) {
+            memcpy(data, &keys[i], sizeof(keys[i]));
+            rc = bdb_temp_table_put(bdb_state, tbl, &keys[i], sizeof(keys[i]),
+                                    data, sizeof(data), NULL, &bdberr);
+            if (rc) {
+                logmsg(LOGMSG_ERROR, "temptable_bench: put rc %d %d\n", rc,
+                       bdberr);
+                goto done;
+            }
+        }
+        insert_ms += gettimeofday_ms() - start;
+        if (tbl->temp_table_type != type)
+            spilled = 1;
+
+        start = gettimeofday_ms();
+        for (i = 0; i < nrows; i++) {
+            rc = bdb_temp_table_find_exact(bdb_state, cur, &keys[i],
+                                           sizeof(keys[i]), &bdberr);
+            if (rc == IX_FND)
+                nfound++;
+        }
+        find_ms += gettimeofday_ms() - start;
+
+        start = gettimeofday_ms();
+        rc = bdb_temp_table_first(bdb_state, cur, &bdberr);
+        while (rc == IX_FND) {
+            nnext++;
+            rc = bdb_temp_table_next(bdb_state, cur, &bdberr);
+        }
+        next_ms += gettimeofday_ms() - start;
+    }
+
+    logmsg(LOGMSG_USER,
+           "  %-8s insert %6" PRIu64 " ms %10.0f/sec, find %6" PRIu64
+           " ms %10.0f/sec, next %6" PRIu64 " ms %10.0f/sec%s\n",
+           name, insert_ms,
+           insert_ms ? (double)nrows * passes * 1000 / insert_ms : 0.0,
+           find_ms, find_ms ? (double)nfound * 1000 / find_ms : 0.0, next_ms,
+           next_ms ? (double)nnext * 1000 / next_ms : 0.0,
+           spilled ? " (spilled)" : "");
+    if (nfound != (long long)nrows * passes || nnext != nfound)
+        logmsg(LOGMSG_ERROR, "  %s: found %lld, scanned %lld, expected %lld\n",
+               name, nfound, nnext, (long long)nrows * passes);
+
+done:
+    bdb_temp_table_close_cursor(bdb_state, cur, &bdberr);
+    bdb_temp_table_close(bdb_state, tbl, &bdberr);
+}
+
+/* Compare the berkdb btree against the in-memory skiplist on random 8 byte
+ * keys with TEMPTABLE_BENCH_DTALEN bytes of data. */
+void bdb_temp_table_bench(bdb_state_type *bdb_state, int nrows, int passes)
+{
+    unsigned long long *keys;
+    unsigned int seed = 1;
+
+    keys = malloc(sizeof(unsigned long long) * nrows);
+    if (keys == NULL) {
+        logmsg(LOGMSG_ERROR, "temptable_bench: out of memory\n");
+        return;
+    }
+    /* distinct keys in random order */
+    for (int i = 0; i < nrows; i++)
+        keys[i] = ((unsigned long long)rand_r(&seed) << 32) | i;
+
+    logmsg(LOGMSG_USER,
+           "temptable_bench: %d rows x %d passes, skiplist budget %d bytes\n",
+           nrows, passes, bdb_state->attr->temptable_skiplist_budget);
+    bdb_temp_table_bench_type(bdb_state, TEMP_TABLE_TYPE_BTREE, "btree", keys,
+                              nrows, passes);
+    bdb_temp_table_bench_type(bdb_state, TEMP_TABLE_TYPE_SKIPLIST, "skiplist",
+                              keys, nrows, passes);
+    free(keys);
+}
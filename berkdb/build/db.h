@@ -514,6 +514,11 @@ struct __db_lock_stat {
 	u_int32_t st_nnowaits;		/* Number of requests that would have
 					   waited, but NOWAIT was set. */
 	u_int32_t st_ndeadlocks;	/* Number of lock deadlocks. */
+	u_int32_t st_ndetects;		/* Number of detector passes. */
+	u_int32_t st_detect_waiters;	/* Waiting lockers in last pass. */
+	u_int32_t st_detect_max_waiters;/* Most waiting lockers in a pass. */
+	u_int32_t st_detect_max_usecs;	/* Longest detector pass. */
+	u_int64_t st_detect_usecs;	/* Time spent in the detector. */
 	db_timeout_t st_locktimeout;	/* Lock timeout. */
 	u_int32_t st_nlocktimeouts;	/* Number of lock timeouts. */
 	db_timeout_t st_txntimeout;	/* Transaction timeout. */
@@ -2798,6 +2803,22 @@ struct __recovery_processor {
 	LINKC_T(struct __recovery_processor) lnk;
 	comdb2ma msp;
 	int mspsize;
+
+	/* Page-ownership scheduling (rep_apply_page_deps) */
+	int deps_mode;
+	int deps_applied;
+	int deps_parked;
+	int deps_hold;
+	int ndeps;
+	u_int64_t *pgkeys;
+	int npgkeys;
+	int maxpgkeys;
+	struct __recovery_processor **dependents;
+	int ndependents;
+	int maxdependents;
+	DBT deps_locks;
+	u_int64_t dispatch_us;
+	LINKC_T(struct __recovery_processor) deps_lnk;
 };
 
 struct __rowlock_list {
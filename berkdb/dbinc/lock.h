@@ -34,6 +34,8 @@ extern size_t gbl_lkr_hash;
 #define	LOCK_INVALID		INVALID_ROFF
 #define LATCH_OFFSET		-1
 #define LOCK_ISLATCH(lock)	((lock).off == LATCH_OFFSET)
+#define FASTPATH_OFFSET		-2
+#define LOCK_ISFASTPATH(lock)	((lock).off == FASTPATH_OFFSET)
 #define	LOCK_ISSET(lock)	((lock).off != LOCK_INVALID)
 #define	LOCK_INIT(lock)		((lock).off = LOCK_INVALID)
 
@@ -124,6 +126,21 @@ struct __db_latch;
 struct __db_lock_lsn;
 struct __db_lockerid_latch_node;
 struct __db_lockerid_latch_list;
+struct __db_fplock;
+
+/*
+ * Fast-path read locks.  A DB_LOCK_READ page lock which nobody could conflict
+ * with is kept in a small array on its locker instead of the object table.
+ * Page locks in modes that conflict with DB_LOCK_READ are counted per hash
+ * bucket in fp_strong; a reader may only use the fast path while its bucket
+ * count is zero, and a conflicting request moves any fast locks in its bucket
+ * into the object table before it looks for conflicts.
+ */
+#define	DB_LOCK_FP_SLOTS	16	/* Fast locks per locker. */
+#define	DB_LOCK_FP_BUCKETS	1024	/* Power of two. */
+#define	FP_BUCKET(hash)		((hash) & (DB_LOCK_FP_BUCKETS - 1))
+#define	FP_REFS(reg, lpart, bucket)					\
+	(&(reg)->fp_refs[(lpart) * DB_LOCK_FP_BUCKETS + (bucket)])
 
 /*
  * DB_LOCKREGION --
@@ -134,6 +151,8 @@ typedef struct __db_lockregion {
 	u_int32_t	detect;		/* run dd on every conflict */
 	db_timeval_t	next_timeout;	/* next time to expire a lock */
 	SH_TAILQ_HEAD(__dobj, __db_lockobj) dd_objs;	/* objects with waiters */
+	SH_TAILQ_HEAD(__wlkrs, __db_locker) dd_lockers;	/* waiting master lockers */
+	u_int32_t	ndd_lockers;	/* number of lockers on dd_lockers */
 	SH_TAILQ_HEAD(__lkrs, __db_locker) lockers;	/* list of lockers */
 	db_timeout_t	lk_timeout;	/* timeout for locks. */
 	db_timeout_t	tx_timeout;	/* timeout for txns. */
@@ -180,6 +199,12 @@ typedef struct __db_lockregion {
 	struct __db_lockerid_latch_node	*lockerid_node_head;
 	pthread_mutex_t 	db_lock_lsn_lk;
 	SH_LIST_HEAD(_regionlsns, __db_lock_lsn) db_lock_lsn_head;
+
+	/* Fast-path read locks. */
+	SH_TAILQ_HEAD(__fplkrs, __db_locker) *fp_lockers; /* per locker partition */
+	u_int32_t		*fp_refs;	/* fast locks by locker partition/bucket */
+	u_int32_t		*fp_strong;	/* conflicting page locks by bucket */
+	u_int32_t		fp_used;	/* fast path has been used */
 } DB_LOCKREGION;
 
 typedef struct __sh_dbt {
@@ -268,6 +293,7 @@ typedef struct __db_locker {
 					   list. */
 	SH_TAILQ_ENTRY(__db_locker) links;		/* Links for free and hash list. */
 	SH_TAILQ_ENTRY(__db_locker) ulinks;	/* Links in-use list. */
+	SH_TAILQ_ENTRY(__db_locker) dd_links;	/* Links waiting list. */
 	SH_LIST_HEAD(_held, __db_lock) heldby;	/* Locks held by this locker. */
 	db_timeval_t	lk_expire;	/* When current lock expires. */
 	db_timeval_t	tx_expire;	/* When this txn expires. */
@@ -297,8 +323,35 @@ typedef struct __db_locker {
 	u_int32_t flags;
 	u_int8_t has_pglk_lsn;
 	u_int8_t wstatus;  /* master locker waiting, for deadlock detection */
+	struct __db_fplock *fplocks;	/* Fast-path read locks, or NULL. */
+	u_int32_t nfplocks;		/* Slots in use. */
+	u_int32_t nfastlocks;		/* Slots not yet moved to the table. */
+	SH_TAILQ_ENTRY(__db_locker) fp_links;	/* Lockers with fast locks. */
 } DB_LOCKER;
 
+/*
+ * A fast-path read lock.  Protected by its locker's partition mutex.  Once a
+ * conflicting request has moved it into the object table, off/lgen/ndx/
+ * partition describe the table lock, which then owns the locker's counts.
+ */
+struct __db_fplock {
+	u_int8_t	lock[sizeof(DB_LOCK_ILOCK)];
+	u_int32_t	bucket;
+	u_int32_t	refcount;
+	u_int32_t	gen;
+#define	DB_FPLOCK_FREE		0
+#define	DB_FPLOCK_FAST		1
+#define	DB_FPLOCK_MOVED		2
+	u_int32_t	state;
+	DB_LOCKER	*holderp;
+	roff_t		off;
+	u_int32_t	lgen;
+	u_int32_t	ndx;
+	u_int32_t	partition;
+};
+
+#define	DD_INVALID_ID	((u_int32_t) -1)
+
 /*
  * DB_LOCKTAB --
  *	The primary library lock data structure (i.e., the one referenced
@@ -351,6 +404,7 @@ struct __db_lock {
 	DB_LOCKER	*holderp;
 	DBT		*dbtobj;
 	u_int32_t	lpartition;
+	int		fpbucket;	/* counted in fp_strong[], or -1 */
 
 	pthread_mutex_t	lsns_mtx;
 	SH_LIST_HEAD(_lsns, __db_lock_lsn) lsns;	/* logical lsns that hold this lock. */
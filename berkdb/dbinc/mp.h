@@ -161,6 +161,7 @@ struct __mpool {
 	roff_t	  htab;		/* Hash table offset. */
 	u_int32_t last_checked;	/* Last bucket checked for free. */
 	u_int32_t lru_count;	/* Counter for buffer LRU */
+	int	  numa_node;	/* NUMA node backing this cache, or -1. */
 
 	/*
 	 * The stat fields are generally not thread protected, and cannot be
@@ -69,17 +69,25 @@ extern int gbl_replicant_latches;
 int gbl_berkdb_track_locks = 0;
 int gbl_lock_conflict_trace;
 unsigned gbl_ddlk = 0;
+int gbl_lock_fastpath = 0;
 
 void (*gbl_bb_log_lock_waits_fn) (const void *, size_t sz, int waitms) = NULL;
 
 static int __lock_freelock __P((DB_LOCKTAB *,
 	struct __db_lock *, DB_LOCKER *, u_int32_t));
 static void __lock_expires __P((DB_ENV *, db_timeval_t *, db_timeout_t));
+static void __lock_fastpath_drop __P((DB_LOCKREGION *, struct __db_fplock *));
+static int __lock_fastpath_flush __P((DB_LOCKTAB *, DB_LOCKER *));
+static void __lock_fastpath_putall __P((DB_LOCKREGION *, DB_LOCKER *));
+static int __lock_fastpath_unfast __P((DB_LOCKTAB *, DB_LOCK *));
 static void __lock_freelocker
 __P((DB_LOCKTAB *, DB_LOCKREGION *, DB_LOCKER *, u_int32_t));
+static void __lock_set_wstatus
+__P((DB_LOCKTAB *, DB_LOCKREGION *, DB_LOCKER *, int));
 static int __lock_get_internal
 __P((DB_LOCKTAB *, u_int32_t, DB_LOCKER *,
 	u_int32_t, const DBT *, db_lockmode_t, db_timeout_t, DB_LOCK *));
+static int __lock_getfree __P((DB_LOCKTAB *, u_int32_t, struct __db_lock **));
 static int __lock_getobj
 __P((DB_LOCKTAB *, const DBT *, u_int32_t, u_int32_t,
 	int, DB_LOCKOBJ **));
@@ -89,6 +97,8 @@ static int __lock_put_internal
 __P((DB_LOCKTAB *,
 	struct __db_lock *, DB_LOCK * lock, u_int32_t, u_int32_t *, u_int32_t));
 static int __lock_put_nolock __P((DB_ENV *, DB_LOCK *, u_int32_t *, u_int32_t));
+static int __lock_put_fastpath
+__P((DB_ENV *, DB_LOCK *, u_int32_t *, u_int32_t));
 static void __lock_remove_waiter __P((DB_LOCKTAB *,
 	DB_LOCKOBJ *, struct __db_lock *, db_status_t));
 static int __lock_set_timeout_internal
@@ -778,6 +788,20 @@ is_pagelock(lockobj)
 	return (ilock->type == DB_PAGE_LOCK);
 }
 
+/*
+ * Count a page lock whose mode conflicts with DB_LOCK_READ against its
+ * fast-path bucket until the lock is freed.
+ */
+static inline void
+__lock_fastpath_count(region, lp)
+	DB_LOCKREGION *region;
+	struct __db_lock *lp;
+{
+	lp->fpbucket = FP_BUCKET(__lock_lhash(lp->lockobj));
+	__atomic_add_fetch(&region->fp_strong[lp->fpbucket], 1,
+	    __ATOMIC_RELAXED);
+}
+
 int
 use_page_latches(dbenv)
 	DB_ENV *dbenv;
@@ -1500,8 +1524,13 @@ __lock_vec(dbenv, locker, flags, list, nlist, elistp)
 				np = NULL;
 			}
 
-			if (sh_locker)
+			if (sh_locker) {
 				F_SET(sh_locker, DB_LOCKER_DELETED);
+				/* Fast-path locks are all read locks. */
+				if (sh_locker->nfplocks != 0)
+					__lock_fastpath_putall(region,
+					    sh_locker);
+			}
 
 			/* Now traverse the locks, releasing each one. */
 			lp = NULL;
@@ -2474,43 +2503,20 @@ __lock_get_internal_int(lt, locker, in_locker, flags, obj, lock_mode, timeout,
 		if (++region->stat.st_nlocks > region->stat.st_maxnlocks)
 			region->stat.st_maxnlocks = region->stat.st_nlocks;
 
-		if ((newl =
-			SH_TAILQ_FIRST(&region->free_locks[partition],
-			    __db_lock)) == NULL) {
-			unsigned num;
-			++region->nwlk_scale[partition];
-			num = region->object_p_size
-			    * region->nwlk_scale[partition];
-			PRINTF(nwlk_scale, "add  lk:%d part:%d sc:%d\n",
-			    num, partition, region->nwlk_scale[partition]);
-			ret = __os_malloc(dbenv,
-			    sizeof(struct __db_lock) * num, &newl);
-			if (ret != 0) {
-				__db_err(dbenv, __db_lock_err, "locks");
-				unlock_obj_partition(region, partition);
-				unlock_locker_partition(region, lpartition);
-				if (holdarr)
-					__os_free(dbenv, holdarr);
-				return (ENOMEM);
-			}
-			ret =
-			    add_to_lock_partition(dbenv, lt, partition, num,
-			    newl);
-			if (ret != 0) {
-				if (holdarr)
-					__os_free(dbenv, holdarr);
-				return ret;
-			}
-			newl =
-			    SH_TAILQ_FIRST(&region->free_locks[partition],
-			    __db_lock);
+		if ((ret = __lock_getfree(lt, partition, &newl)) != 0) {
+			unlock_obj_partition(region, partition);
+			unlock_locker_partition(region, lpartition);
+			if (holdarr)
+				__os_free(dbenv, holdarr);
+			return (ret);
 		}
-		SH_TAILQ_REMOVE(&region->free_locks[partition], newl,
-		    links, __db_lock);
 		newl->holderp = sh_locker;
 		newl->refcount = 1;
 		newl->mode = lock_mode;
 		newl->lockobj = sh_obj;
+		if (is_pagelock(sh_obj) &&
+		    CONFLICTS(lt, region, lock_mode, DB_LOCK_READ))
+			__lock_fastpath_count(region, newl);
 
 		/*
 		 * Now, insert the lock onto its locker's list.
@@ -2553,6 +2559,9 @@ upgrade:
 		if (IS_WRITELOCK(lock_mode) && !IS_WRITELOCK(lp->mode))
 			sh_locker->nwrites++;
 		lp->mode = lock_mode;
+		if (lp->fpbucket < 0 && is_pagelock(sh_obj) &&
+		    CONFLICTS(lt, region, lock_mode, DB_LOCK_READ))
+			__lock_fastpath_count(region, lp);
 		if (is_pagelock(sh_obj) &&
 		    IS_WRITELOCK(lock_mode) &&
 		    F_ISSET(sh_locker, DB_LOCKER_TRACK_WRITELOCKS) &&
@@ -2689,11 +2698,7 @@ upgrade:
 			region->next_timeout = sh_locker->lk_expire;
 
 		/* set waiting status for master_locker */
-		if (sh_locker->master_locker == INVALID_ROFF)
-			sh_locker->wstatus = 1;
-		else
-			((DB_LOCKER *)R_ADDR(&lt->reginfo,
-				sh_locker->master_locker))->wstatus = 1;
+		__lock_set_wstatus(lt, region, sh_locker, 1);
 
 		unlock_locker_partition(region, lpartition);
 
@@ -2853,11 +2858,7 @@ expired:			obj_ndx = sh_obj->index;
 
 
 	/* clear waiting status for master_locker */
-	if (sh_locker->master_locker == INVALID_ROFF)
-		sh_locker->wstatus = 0;
-	else
-		((DB_LOCKER *)R_ADDR(&lt->reginfo,
-			sh_locker->master_locker))->wstatus = 0;
+	__lock_set_wstatus(lt, region, sh_locker, 0);
 
 	if (is_pagelock(sh_obj))
 		sh_locker->npagelocks++;
@@ -2910,6 +2911,358 @@ err:
 	return (ret);
 }
 
+/*
+ * __lock_get_fastpath --
+ *	Try to grant a DB_LOCK_READ page lock from the locker's fast-path slots
+ * without touching the object table.  Sets *grantedp if it did; otherwise the
+ * caller takes the regular path.
+ */
+static int
+__lock_get_fastpath(lt, locker, obj, lock, grantedp)
+	DB_LOCKTAB *lt;
+	u_int32_t locker;
+	const DBT *obj;
+	DB_LOCK *lock;
+	int *grantedp;
+{
+	struct __db_fplock *fp, *freefp;
+	DB_LOCKER *sh_locker;
+	DB_LOCKREGION *region;
+	u_int32_t bucket, i, lpartition, ndx, *refs;
+	int ret;
+
+	region = lt->reginfo.primary;
+	*grantedp = 0;
+
+	LOCKER_INDX(lt, region, locker, ndx);
+	if ((ret = __lock_getlocker(lt, locker, ndx, 0,
+	    (locker > DB_LOCK_MAXID ? GETLOCKER_CREATE : 0) |
+	    GETLOCKER_KEEP_PART, &sh_locker)) != 0 || sh_locker == NULL)
+		return (ret);
+	lpartition = sh_locker->partition;
+
+	if (F_ISSET(sh_locker, DB_LOCKER_DELETED | DB_LOCKER_TRACK))
+		goto out;
+	if (sh_locker->fplocks == NULL &&
+	    __os_calloc(lt->dbenv, DB_LOCK_FP_SLOTS,
+	    sizeof(struct __db_fplock), &sh_locker->fplocks) != 0)
+		goto out;
+
+	bucket = FP_BUCKET(__lock_ohash(obj));
+	freefp = NULL;
+	for (i = 0, fp = sh_locker->fplocks; i < DB_LOCK_FP_SLOTS; ++i, ++fp) {
+		if (fp->state == DB_FPLOCK_FREE) {
+			if (freefp == NULL)
+				freefp = fp;
+		} else if (fp->bucket == bucket &&
+		    memcmp(fp->lock, obj->data, sizeof(fp->lock)) == 0) {
+			/* A moved lock is re-acquired through the table. */
+			if (fp->state == DB_FPLOCK_MOVED)
+				goto out;
+			fp->refcount++;
+			goto granted;
+		}
+	}
+	if ((fp = freefp) == NULL)
+		goto out;
+
+	/*
+	 * Publish the lock before looking for conflicting requests; they bump
+	 * fp_strong before looking at fp_refs, so one of us sees the other.
+	 */
+	if (!__atomic_load_n(&region->fp_used, __ATOMIC_SEQ_CST))
+		__atomic_store_n(&region->fp_used, 1, __ATOMIC_SEQ_CST);
+	refs = FP_REFS(region, lpartition, bucket);
+	__atomic_add_fetch(refs, 1, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&region->fp_strong[bucket], __ATOMIC_SEQ_CST)) {
+		__atomic_sub_fetch(refs, 1, __ATOMIC_SEQ_CST);
+		goto out;
+	}
+
+	memcpy(fp->lock, obj->data, sizeof(fp->lock));
+	fp->bucket = bucket;
+	fp->refcount = 1;
+	fp->state = DB_FPLOCK_FAST;
+	fp->holderp = sh_locker;
+	if (sh_locker->nfastlocks++ == 0)
+		SH_TAILQ_INSERT_HEAD(&region->fp_lockers[lpartition],
+		    sh_locker, fp_links, __db_locker);
+	sh_locker->nfplocks++;
+	sh_locker->nlocks++;
+	sh_locker->npagelocks++;
+
+granted:
+	lock->off = FASTPATH_OFFSET;
+	lock->ilock_latch = fp;
+	lock->gen = fp->gen;
+	lock->ndx = (u_int32_t)(fp - sh_locker->fplocks);
+	lock->mode = DB_LOCK_READ;
+	lock->partition = lpartition;
+	*grantedp = 1;
+
+out:	unlock_locker_partition(region, lpartition);
+	return (0);
+}
+
+/*
+ * __lock_fastpath_move --
+ *	Move a fast-path lock into the object table.  The locker's partition
+ * must be locked.
+ */
+static int
+__lock_fastpath_move(lt, fp)
+	DB_LOCKTAB *lt;
+	struct __db_fplock *fp;
+{
+	struct __db_lock *lp, *wlp;
+	DB_LOCKER *sh_locker;
+	DB_LOCKOBJ *sh_obj;
+	DB_LOCKREGION *region;
+	DBT obj;
+	u_int32_t ndx, partition;
+	int ret;
+
+	region = lt->reginfo.primary;
+	sh_locker = fp->holderp;
+
+	memset(&obj, 0, sizeof(obj));
+	obj.data = fp->lock;
+	obj.size = sizeof(fp->lock);
+	OBJECT_INDX(lt, region, &obj, ndx, partition);
+	lock_obj_partition(region, partition);
+	if ((ret = __lock_getobj(lt, &obj, ndx, partition, 1, &sh_obj)) != 0 ||
+	    (ret = __lock_getfree(lt, partition, &lp)) != 0) {
+		unlock_obj_partition(region, partition);
+		return (ret);
+	}
+	if (++region->stat.st_nlocks > region->stat.st_maxnlocks)
+		region->stat.st_maxnlocks = region->stat.st_nlocks;
+
+	lp->holderp = sh_locker;
+	lp->refcount = fp->refcount;
+	lp->mode = DB_LOCK_READ;
+	lp->lockobj = sh_obj;
+	lp->status = DB_LSTAT_HELD;
+	SH_TAILQ_INSERT_TAIL(&sh_obj->holders, lp, links);
+	/*
+	 * The deadlock detector expects a waiting locker's pending lock at
+	 * the head of heldby, so slide in behind it if there is one.
+	 */
+	if ((wlp = SH_LIST_FIRST(&sh_locker->heldby, __db_lock)) != NULL &&
+	    wlp->status == DB_LSTAT_WAITING)
+		SH_LIST_INSERT_AFTER(wlp, lp, locker_links, __db_lock);
+	else
+		SH_LIST_INSERT_HEAD(&sh_locker->heldby, lp, locker_links,
+		    __db_lock);
+
+	fp->off = R_OFFSET(&lt->reginfo, lp);
+	fp->lgen = lp->gen;
+	fp->ndx = ndx;
+	fp->partition = partition;
+	unlock_obj_partition(region, partition);
+
+	/* The table lock now carries the locker's nlocks/npagelocks. */
+	fp->state = DB_FPLOCK_MOVED;
+	__atomic_sub_fetch(FP_REFS(region, sh_locker->partition, fp->bucket),
+	    1, __ATOMIC_SEQ_CST);
+	if (--sh_locker->nfastlocks == 0)
+		SH_TAILQ_REMOVE(&region->fp_lockers[sh_locker->partition],
+		    sh_locker, fp_links, __db_locker);
+	return (0);
+}
+
+/*
+ * __lock_fastpath_flush --
+ *	Move all of a locker's fast-path locks into the object table.  The
+ * locker's partition must be locked.
+ */
+static int
+__lock_fastpath_flush(lt, sh_locker)
+	DB_LOCKTAB *lt;
+	DB_LOCKER *sh_locker;
+{
+	u_int32_t i;
+	int ret;
+
+	for (i = 0; sh_locker->nfastlocks != 0 && i < DB_LOCK_FP_SLOTS; ++i)
+		if (sh_locker->fplocks[i].state == DB_FPLOCK_FAST &&
+		    (ret = __lock_fastpath_move(lt,
+		    &sh_locker->fplocks[i])) != 0)
+			return (ret);
+	return (0);
+}
+
+/*
+ * __lock_fastpath_strong --
+ *	Called before requesting a page lock in a mode that conflicts with
+ * DB_LOCK_READ.  Counts the request against its bucket, so no new fast-path
+ * locks are granted there, and moves the bucket's existing fast-path locks
+ * into the object table so that the request sees them.  The caller drops
+ * the count with __lock_fastpath_strong_done once the request has its lock
+ * (which keeps its own count) or has failed.
+ */
+static int
+__lock_fastpath_strong(lt, obj, lock, lock_mode, bucketp)
+	DB_LOCKTAB *lt;
+	const DBT *obj;
+	DB_LOCK *lock;
+	db_lockmode_t lock_mode;
+	int *bucketp;
+{
+	struct __db_lock *lp;
+	DB_LOCKER *sh_locker, *next_locker;
+	DB_LOCKREGION *region;
+	u_int32_t bucket, hash, i, p;
+	int ret;
+
+	region = lt->reginfo.primary;
+	*bucketp = -1;
+
+	if ((u_int32_t)lock_mode >= region->stat.st_nmodes ||
+	    !CONFLICTS(lt, region, lock_mode, DB_LOCK_READ))
+		return (0);
+	if (obj != NULL) {
+		if (obj->size != sizeof(DB_LOCK_ILOCK) ||
+		    ((DB_LOCK_ILOCK *)obj->data)->type != DB_PAGE_LOCK)
+			return (0);
+		hash = __lock_ohash(obj);
+	} else {
+		/* Upgrading a lock we already hold. */
+		lp = (struct __db_lock *)R_ADDR(&lt->reginfo, lock->off);
+		if (!is_pagelock(lp->lockobj))
+			return (0);
+		hash = __lock_lhash(lp->lockobj);
+	}
+
+	bucket = FP_BUCKET(hash);
+	*bucketp = (int)bucket;
+	__atomic_add_fetch(&region->fp_strong[bucket], 1, __ATOMIC_SEQ_CST);
+	if (!__atomic_load_n(&region->fp_used, __ATOMIC_SEQ_CST))
+		return (0);
+
+	for (p = 0; p < gbl_lkr_parts; ++p) {
+		if (!__atomic_load_n(FP_REFS(region, p, bucket),
+		    __ATOMIC_SEQ_CST))
+			continue;
+		lock_locker_partition(region, p);
+		for (sh_locker = SH_TAILQ_FIRST(&region->fp_lockers[p],
+		    __db_locker); sh_locker != NULL; sh_locker = next_locker) {
+			next_locker =
+			    SH_TAILQ_NEXT(sh_locker, fp_links, __db_locker);
+			for (i = 0; i < DB_LOCK_FP_SLOTS; ++i) {
+				if (sh_locker->fplocks[i].state !=
+				    DB_FPLOCK_FAST ||
+				    sh_locker->fplocks[i].bucket != bucket)
+					continue;
+				if ((ret = __lock_fastpath_move(lt,
+				    &sh_locker->fplocks[i])) != 0) {
+					unlock_locker_partition(region, p);
+					return (ret);
+				}
+			}
+		}
+		unlock_locker_partition(region, p);
+	}
+	return (0);
+}
+
+static inline void
+__lock_fastpath_strong_done(lt, bucket)
+	DB_LOCKTAB *lt;
+	int bucket;
+{
+	DB_LOCKREGION *region = lt->reginfo.primary;
+
+	__atomic_sub_fetch(&region->fp_strong[bucket], 1, __ATOMIC_SEQ_CST);
+}
+
+/*
+ * __lock_fastpath_drop --
+ *	Release a fast-path slot.  A moved slot only goes away; its table
+ * lock is released separately.  The locker's partition must be locked.
+ */
+static void
+__lock_fastpath_drop(region, fp)
+	DB_LOCKREGION *region;
+	struct __db_fplock *fp;
+{
+	DB_LOCKER *sh_locker = fp->holderp;
+
+	if (fp->state == DB_FPLOCK_FAST) {
+		__atomic_sub_fetch(FP_REFS(region, sh_locker->partition,
+		    fp->bucket), 1, __ATOMIC_SEQ_CST);
+		sh_locker->nlocks--;
+		sh_locker->npagelocks--;
+		if (--sh_locker->nfastlocks == 0)
+			SH_TAILQ_REMOVE(&region->fp_lockers[
+			    sh_locker->partition], sh_locker, fp_links,
+			    __db_locker);
+	}
+	fp->state = DB_FPLOCK_FREE;
+	fp->gen++;
+	sh_locker->nfplocks--;
+}
+
+/*
+ * __lock_fastpath_putall --
+ *	Release all of a locker's fast-path slots.  The locker's partition
+ * must be locked.
+ */
+static void
+__lock_fastpath_putall(region, sh_locker)
+	DB_LOCKREGION *region;
+	DB_LOCKER *sh_locker;
+{
+	u_int32_t i;
+
+	for (i = 0; sh_locker->nfplocks != 0 && i < DB_LOCK_FP_SLOTS; ++i)
+		if (sh_locker->fplocks[i].state != DB_FPLOCK_FREE)
+			__lock_fastpath_drop(region, &sh_locker->fplocks[i]);
+}
+
+/*
+ * __lock_fastpath_unfast --
+ *	Turn a fast-path lock handle into a handle on an object table lock,
+ * moving the lock into the table if it is still on the fast path.  Used
+ * before operations that only understand table locks.
+ */
+static int
+__lock_fastpath_unfast(lt, lock)
+	DB_LOCKTAB *lt;
+	DB_LOCK *lock;
+{
+	struct __db_fplock *fp;
+	DB_LOCKREGION *region;
+	u_int32_t lpartition;
+	int ret;
+
+	region = lt->reginfo.primary;
+	fp = lock->ilock_latch;
+	lpartition = lock->partition;
+
+	lock_locker_partition(region, lpartition);
+	if (fp->gen != lock->gen || fp->state == DB_FPLOCK_FREE) {
+		unlock_locker_partition(region, lpartition);
+		__db_err(lt->dbenv, __db_lock_invalid, "DB_LOCK");
+		return (EINVAL);
+	}
+	if (fp->state == DB_FPLOCK_FAST &&
+	    (ret = __lock_fastpath_move(lt, fp)) != 0) {
+		unlock_locker_partition(region, lpartition);
+		return (ret);
+	}
+	lock->off = fp->off;
+	lock->gen = fp->lgen;
+	lock->ndx = fp->ndx;
+	lock->partition = fp->partition;
+	lock->ilock_latch = NULL;
+	/* This handle's reference now belongs to the table lock. */
+	if (--fp->refcount == 0)
+		__lock_fastpath_drop(region, fp);
+	unlock_locker_partition(region, lpartition);
+	return (0);
+}
+
 static inline int
 __lock_get_internal(lt, locker, sh_locker, flags, obj, lock_mode, timeout, lock)
 	DB_LOCKTAB *lt;
@@ -2921,7 +3274,7 @@ __lock_get_internal(lt, locker, sh_locker, flags, obj, lock_mode, timeout, lock)
 	db_timeout_t timeout;
 	DB_LOCK *lock;
 {
-	int rc, use_latch = 0;
+	int fpbucket, granted, rc, use_latch = 0;
 
 	if (use_page_latches(lt->dbenv)) {
 		if (obj) {
@@ -2940,8 +3293,29 @@ __lock_get_internal(lt, locker, sh_locker, flags, obj, lock_mode, timeout, lock)
 	if (use_latch) {
 		rc = __get_page_latch(lt, locker, flags, obj, lock_mode, lock);
 	} else {
-		rc = __lock_get_internal_int(lt, locker, &sh_locker, flags, obj,
-		    lock_mode, timeout, lock);
+		if (obj == NULL && LOCK_ISFASTPATH(*lock) &&
+		    (rc = __lock_fastpath_unfast(lt, lock)) != 0)
+			return (rc);
+
+		if (gbl_lock_fastpath && lock_mode == DB_LOCK_READ &&
+		    obj != NULL && sh_locker == NULL &&
+		    (flags & ~DB_LOCK_NOWAIT) == 0 &&
+		    obj->size == sizeof(DB_LOCK_ILOCK) &&
+		    ((DB_LOCK_ILOCK *)obj->data)->type == DB_PAGE_LOCK &&
+		    !gbl_berkdb_track_locks && !gbl_ddlk &&
+		    !F_ISSET(lt->dbenv, DB_ENV_NOLOCKING)) {
+			rc = __lock_get_fastpath(lt, locker, obj, lock,
+			    &granted);
+			if (rc != 0 || granted)
+				return (rc);
+		}
+
+		if ((rc = __lock_fastpath_strong(lt, obj, lock, lock_mode,
+		    &fpbucket)) == 0)
+			rc = __lock_get_internal_int(lt, locker, &sh_locker,
+			    flags, obj, lock_mode, timeout, lock);
+		if (fpbucket >= 0)
+			__lock_fastpath_strong_done(lt, fpbucket);
 	}
 
 	if (sh_locker && F_ISSET(sh_locker, DB_LOCKER_TRACK)) {
@@ -3050,6 +3424,9 @@ __lock_put_nolock(dbenv, lock, runp, flags)
 	lt = dbenv->lk_handle;
 	region = lt->reginfo.primary;
 
+	if (LOCK_ISFASTPATH(*lock))
+		return (__lock_put_fastpath(dbenv, lock, runp, flags));
+
 	lockp = (struct __db_lock *)R_ADDR(&lt->reginfo, lock->off);
 	sh_locker = lockp->holderp;
 
@@ -3078,6 +3455,51 @@ out:	unlock_obj_partition(region, partition);
 	return (ret);
 }
 
+static int
+__lock_put_fastpath(dbenv, lock, runp, flags)
+	DB_ENV *dbenv;
+	DB_LOCK *lock;
+	u_int32_t *runp;
+	u_int32_t flags;
+{
+	struct __db_fplock *fp;
+	DB_LOCK moved;
+	DB_LOCKREGION *region;
+	DB_LOCKTAB *lt;
+	u_int32_t lpartition;
+
+	lt = dbenv->lk_handle;
+	region = lt->reginfo.primary;
+	fp = lock->ilock_latch;
+	lpartition = lock->partition;
+
+	lock_locker_partition(region, lpartition);
+	if (fp->gen != lock->gen || fp->state == DB_FPLOCK_FREE) {
+		__db_err(dbenv, __db_lock_invalid, "DB_LOCK->lock_put");
+		abort();
+	}
+	LOCK_INIT(*lock);
+
+	if (fp->state == DB_FPLOCK_FAST) {
+		if (--fp->refcount == 0)
+			__lock_fastpath_drop(region, fp);
+		unlock_locker_partition(region, lpartition);
+		return (0);
+	}
+
+	/* Moved into the table by a conflicting request: release it there. */
+	memset(&moved, 0, sizeof(moved));
+	moved.off = fp->off;
+	moved.gen = fp->lgen;
+	moved.ndx = fp->ndx;
+	moved.partition = fp->partition;
+	moved.mode = DB_LOCK_READ;
+	if (--fp->refcount == 0)
+		__lock_fastpath_drop(region, fp);
+	unlock_locker_partition(region, lpartition);
+	return (__lock_put_nolock(dbenv, &moved, runp, flags));
+}
+
 /*
  * __lock_downgrade --
  *
@@ -3117,6 +3539,13 @@ __lock_downgrade(dbenv, lock, new_mode, flags)
 
 	lt = dbenv->lk_handle;
 	region = lt->reginfo.primary;
+
+	if (LOCK_ISFASTPATH(*lock)) {
+		if (new_mode == DB_LOCK_READ)
+			return (0);
+		if ((ret = __lock_fastpath_unfast(lt, lock)) != 0)
+			return (ret);
+	}
 	partition = lock->partition;
 
 	LOCKREGION(dbenv, lt);
@@ -3371,6 +3800,11 @@ __lock_freelock(lt, lockp, sh_locker, flags)
 		lockp->nlsns = 0;
 		SH_LIST_INIT(&lockp->lsns);
 		pthread_mutex_unlock(&lockp->lsns_mtx);
+		if (lockp->fpbucket >= 0) {
+			__atomic_sub_fetch(&region->fp_strong[lockp->fpbucket],
+			    1, __ATOMIC_RELAXED);
+			lockp->fpbucket = -1;
+		}
 		SH_TAILQ_INSERT_HEAD(&region->free_locks[lockp->lpartition],
 		    lockp, links, __db_lock);
 		region->stat.st_nlocks--;
@@ -3626,7 +4060,8 @@ __lock_freefamilylocker(lt, locker)
 
 	partition = sh_locker->partition;
 
-	if (SH_LIST_FIRST(&sh_locker->heldby, __db_lock) != NULL) {
+	if (SH_LIST_FIRST(&sh_locker->heldby, __db_lock) != NULL ||
+	    sh_locker->nfastlocks != 0) {
 		logmsg(LOGMSG_USER, "Dumping locks held by locker %u\n", locker);
 		__lock_dump_locker_int(dbenv->lk_handle, sh_locker, stderr, 1);
 		fflush(stderr);
@@ -3665,6 +4100,18 @@ __lock_freelocker(lt, region, sh_locker, indx)
 	if (F_ISSET(sh_locker, DB_LOCKER_TRACK))
 		logmsg(LOGMSG_USER, "LOCKID %u FREED\n", sh_locker->id);
 
+	if (sh_locker->wstatus == 1) {
+		lock_detector(region);
+		SH_TAILQ_REMOVE(&region->dd_lockers, sh_locker, dd_links,
+		    __db_locker);
+		region->ndd_lockers--;
+		unlock_detector(region);
+	}
+	sh_locker->wstatus = 0;
+
+	if (sh_locker->nfplocks != 0)
+		__lock_fastpath_putall(region, sh_locker);
+
 	sh_locker->has_pglk_lsn = 0;
 	sh_locker->ntrackedlocks = 0;
 	sh_locker->maxtrackedlocks = 0;
@@ -3680,6 +4127,45 @@ __lock_freelocker(lt, region, sh_locker, indx)
 	region->stat.st_nlockers--;
 }
 
+/*
+ * __lock_set_wstatus
+ *	Set or clear the waiting status of sh_locker's master locker.  Waiting
+ * masters are kept on dd_lockers so that the deadlock detector only visits
+ * lockers that can be part of a cycle.
+ */
+static void
+__lock_set_wstatus(lt, region, sh_locker, wstatus)
+	DB_LOCKTAB *lt;
+	DB_LOCKREGION *region;
+	DB_LOCKER *sh_locker;
+	int wstatus;
+{
+	DB_LOCKER *master;
+
+	if (sh_locker->master_locker == INVALID_ROFF)
+		master = sh_locker;
+	else
+		master = (DB_LOCKER *)R_ADDR(&lt->reginfo,
+		    sh_locker->master_locker);
+
+	/* Every granted lock comes through here; skip the mutex if we can. */
+	if ((master->wstatus == 1) == (wstatus != 0))
+		return;
+
+	lock_detector(region);
+	if (wstatus && master->wstatus != 1) {
+		master->wstatus = 1;
+		SH_TAILQ_INSERT_TAIL(&region->dd_lockers, master, dd_links);
+		region->ndd_lockers++;
+	} else if (!wstatus && master->wstatus == 1) {
+		master->wstatus = 0;
+		SH_TAILQ_REMOVE(&region->dd_lockers, master, dd_links,
+		    __db_locker);
+		region->ndd_lockers--;
+	}
+	unlock_detector(region);
+}
+
 /*
  * __lock_set_timeout
  *		-- set timeout values in shared memory.
@@ -3883,10 +4369,12 @@ __lock_getlocker_int(lt, locker, indx, partition, create, retries, retp,
 			sh_locker->ntrackedlocks = 0;
 			sh_locker->maxtrackedlocks = 0;
 			sh_locker->tracked_locklist = NULL;
-			for (i = 0; i < num; ++i, ++sh_locker)
+			for (i = 0; i < num; ++i, ++sh_locker) {
+				sh_locker->fplocks = NULL;
 				SH_TAILQ_INSERT_HEAD(&region->
 				    free_lockers[partition], sh_locker, links,
 				    __db_locker);
+			}
 			sh_locker =
 			    SH_TAILQ_FIRST(&region->free_lockers[partition],
 			    __db_locker);
@@ -3894,7 +4382,8 @@ __lock_getlocker_int(lt, locker, indx, partition, create, retries, retp,
 		SH_TAILQ_REMOVE(&region->free_lockers[partition],
 		    sh_locker, links, __db_locker);
 		sh_locker->id = locker;
-		sh_locker->dd_id = 0;
+		sh_locker->dd_id = DD_INVALID_ID;
+		sh_locker->wstatus = 0;
 		sh_locker->master_locker = INVALID_ROFF;
 		sh_locker->parent_locker = INVALID_ROFF;
 		SH_LIST_INIT(&sh_locker->child_locker);
@@ -3903,6 +4392,8 @@ __lock_getlocker_int(lt, locker, indx, partition, create, retries, retp,
 		sh_locker->nlocks = 0;
 		sh_locker->npagelocks = 0;
 		sh_locker->nwrites = 0;
+		sh_locker->nfplocks = 0;
+		sh_locker->nfastlocks = 0;
 #if TEST_DEADLOCKS
 		printf("%d %s:%d lockerid %x setting priority to %d\n",
 		    pthread_self(), __FILE__, __LINE__, sh_locker->id, retries);
@@ -3996,6 +4487,49 @@ __lock_getlocker(lt, locker, indx, retries, flags, retp)
 }
 
 
+/*
+ * __lock_getfree --
+ *	Take a lock off an object partition's free list, growing the list if
+ * it is empty.
+ *
+ * This must be called with the object partition locked.
+ */
+static int
+__lock_getfree(lt, partition, newlp)
+	DB_LOCKTAB *lt;
+	u_int32_t partition;
+	struct __db_lock **newlp;
+{
+	DB_ENV *dbenv;
+	DB_LOCKREGION *region;
+	struct __db_lock *newl;
+	unsigned num;
+	int ret;
+
+	dbenv = lt->dbenv;
+	region = lt->reginfo.primary;
+
+	if ((newl = SH_TAILQ_FIRST(&region->free_locks[partition],
+	    __db_lock)) == NULL) {
+		++region->nwlk_scale[partition];
+		num = region->object_p_size * region->nwlk_scale[partition];
+		PRINTF(nwlk_scale, "add  lk:%d part:%d sc:%d\n",
+		    num, partition, region->nwlk_scale[partition]);
+		if ((ret = __os_malloc(dbenv,
+		    sizeof(struct __db_lock) * num, &newl)) != 0) {
+			__db_err(dbenv, __db_lock_err, "locks");
+			return (ENOMEM);
+		}
+		if ((ret = add_to_lock_partition(dbenv, lt, partition, num,
+		    newl)) != 0)
+			return (ret);
+		newl = SH_TAILQ_FIRST(&region->free_locks[partition], __db_lock);
+	}
+	SH_TAILQ_REMOVE(&region->free_locks[partition], newl, links, __db_lock);
+	*newlp = newl;
+	return (0);
+}
+
 /*
  * __lock_getobj --
  *	Get an object in the object hash table.  The create parameter
@@ -4218,6 +4752,12 @@ __lock_inherit_locks(lt, locker, flags)
 		goto err;
 	}
 	sh_parent = (DB_LOCKER *)R_ADDR(&lt->reginfo, sh_locker->parent_locker);
+
+	/* Fast-path locks are inherited through the table like the rest. */
+	if ((ret = __lock_fastpath_flush(lt, sh_locker)) != 0) {
+		unlock_locker_partition(region, sh_locker->partition);
+		goto err;
+	}
 	F_SET(sh_locker, DB_LOCKER_DELETED);
 	unlock_locker_partition(region, sh_locker->partition);
 
@@ -4577,6 +5117,10 @@ __lock_trade(dbenv, lock, new_locker, create)
 		return __latch_trade(dbenv, lnode->latch, new_locker);
 	}
 
+	if (LOCK_ISFASTPATH(*lock) &&
+	    (ret = __lock_fastpath_unfast(lt, lock)) != 0)
+		return (ret);
+
 
 	/* Make sure that we can get new locker and add this lock to it. */
 	LOCKER_INDX(lt, region, new_locker, locker_ndx);
@@ -5835,6 +6379,66 @@ lock_list_parse_pglogs(dbenv, list, maxlsn, pglogs, keycnt)
 	    list, maxlsn, pglogs, keycnt, 0, NULL, NULL);
 }
 
+/*
+ * __lock_list_foreach --
+ *	Walk a logged lock list without acquiring anything, calling fn once
+ *	for every (object, page) pair it names.  *haskeys is set if the list
+ *	carries page-lsn keys (the newsi logging format).
+ *
+ * PUBLIC: int __lock_list_foreach __P((DB_ENV *, DBT *,
+ * PUBLIC:     int (*)(void *, DB_LOCK_ILOCK *, u_int32_t, db_pgno_t),
+ * PUBLIC:     void *, int *));
+ */
+int
+__lock_list_foreach(dbenv, list, fn, arg, haskeys)
+	DB_ENV *dbenv;
+	DBT *list;
+	int (*fn) __P((void *, DB_LOCK_ILOCK *, u_int32_t, db_pgno_t));
+	void *arg;
+	int *haskeys;
+{
+	DB_LOCK_ILOCK *lock;
+	DB_LSN llsn;
+	db_pgno_t pgno;
+	u_int16_t npgno, size;
+	u_int32_t i, j, nkeys = 0, nlocks, nlsns;
+	void *dp;
+	int ret;
+
+	*haskeys = 0;
+	if (list->size == 0 || list->size == sizeof(unsigned long long))
+		return (0);
+
+	dp = list->data;
+	GET_COUNT(dp, nlocks);
+	if (nlocks == MAX_LOCK_COUNT) {
+		GET_NKEYS(dp, nkeys);
+		GET_COUNT(dp, nlocks);
+	}
+	*haskeys = (nkeys != 0);
+
+	for (i = 0; i < nlocks; i++) {
+		GET_PCOUNT(dp, npgno);
+		GET_SIZE(dp, size);
+		lock = (DB_LOCK_ILOCK *)dp;
+		pgno = lock->pgno;
+		dp = ((u_int8_t *)dp) + ALIGN(size, sizeof(u_int32_t));
+		do {
+			if (nkeys != 0) {
+				GET_LSNCOUNT(dp, nlsns);
+				for (j = 0; j < nlsns; j++)
+					GET_LSN(dp, &llsn);
+			}
+			if ((ret = fn(arg, lock, size, pgno)) != 0)
+				return (ret);
+			if (npgno != 0)
+				GET_PGNO(dp, pgno);
+		} while (npgno-- != 0);
+	}
+
+	return (0);
+}
+
 
 /*
  * PUBLIC: int __lock_get_list __P((DB_ENV *, u_int32_t, u_int32_t,
@@ -5978,6 +6582,10 @@ __lock_to_dbt_unlocked(dbenv, lock, dbt)
 	int rc = 0;
 	void **ptr;
 
+	if (LOCK_ISFASTPATH(*lock) &&
+	    (rc = __lock_fastpath_unfast(lt, lock)) != 0)
+		goto done;
+
 	lockp = (struct __db_lock *)R_ADDR(&lt->reginfo, lock->off);
 	if (lock->gen != lockp->gen) {
 		__db_err(dbenv, __db_lock_invalid, "DB_LOCK->lock_put");
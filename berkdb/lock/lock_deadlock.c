@@ -89,6 +89,9 @@ static int __dd_abort __P((DB_ENV *, locker_info *));
 static int __dd_build __P((DB_ENV *,
 	u_int32_t, u_int32_t **, sparse_map_t **, u_int32_t *, u_int32_t *,
 	locker_info **, int));
+static int __dd_build_int __P((DB_ENV *,
+	u_int32_t, u_int32_t **, sparse_map_t **, u_int32_t *, u_int32_t *,
+	locker_info **, int));
 static int __dd_find __P((DB_ENV *, u_int32_t *, sparse_map_t *, locker_info *,
 	u_int32_t, u_int32_t, u_int32_t ***, u_int32_t **, int *));
 static int __dd_isolder __P((u_int32_t, u_int32_t, u_int32_t, u_int32_t));
@@ -498,10 +501,17 @@ __lock_detect(dbenv, atype, abortp)
 		pthread_mutex_lock(&qlock);
 		q = 0;
 		pthread_mutex_unlock(&qlock);
+		DB_LOCKREGION *region = ((DB_LOCKTAB *)dbenv->lk_handle)->reginfo.primary;
+		uint64_t start = bb_berkdb_fasttime(), usecs;
 		int retry = 0;
 		ret = __lock_detect_int(dbenv, atype, abortp, &retry);
 		if (retry)
 			ret = __lock_detect_int(dbenv, atype, abortp, NULL);
+		usecs = bb_berkdb_fasttime() - start;
+		region->stat.st_ndetects++;
+		region->stat.st_detect_usecs += usecs;
+		if (usecs > region->stat.st_detect_max_usecs)
+			region->stat.st_detect_max_usecs = usecs;
 	}
 	pthread_mutex_unlock(&dlock);
 	return ret;
@@ -594,6 +604,11 @@ __lock_detect_int(dbenv, atype, abortp, can_retry)
 	ret = __dd_build(dbenv, atype, &bitmap, &sparse_map, &nlockers, &nalloc,
 	    &idmap, is_client);
 	lock_max = region->stat.st_cur_maxid;
+	if (ret == 0) {
+		region->stat.st_detect_waiters = nlockers;
+		if (nlockers > region->stat.st_detect_max_waiters)
+			region->stat.st_detect_max_waiters = nlockers;
+	}
 	unlock_lockers(region);
 
 	UNLOCKREGION(dbenv, lt);
@@ -914,8 +929,6 @@ err:
  * Utilities
  */
 
-#define DD_INVALID_ID	((u_int32_t) -1)
-
 inline static void
 __init_lockerid_priority(dbenv, atype, lip, ptr_idarr)
 	DB_ENV *dbenv;
@@ -1049,6 +1062,8 @@ static inline int __resize_object(DB_ENV *dbenv, void **obj, size_t *obj_size,
 		return 0;
 	new_size = new_size + new_size/2;
 	__os_free(dbenv, *obj);
+	*obj = NULL;
+	*obj_size = 0;
 	int ret = __os_malloc (dbenv, new_size, obj);
 	if (ret)
 		return ret;
@@ -1057,6 +1072,37 @@ static inline int __resize_object(DB_ENV *dbenv, void **obj, size_t *obj_size,
 }
 
 
+/*
+ * Lockers which were given a dd_id by the current pass.  Every other locker
+ * keeps dd_id == DD_INVALID_ID, so this is what has to be reset afterwards.
+ */
+static DB_LOCKER **dd_touched = NULL;
+static size_t dd_touched_size = 0;
+static u_int32_t dd_ntouched = 0;
+
+static int
+__dd_touch(dbenv, lip)
+	DB_ENV *dbenv;
+	DB_LOCKER *lip;
+{
+	size_t sz;
+	int ret;
+
+	if ((dd_ntouched + 1) * sizeof(DB_LOCKER *) > dd_touched_size) {
+		sz = dd_touched_size * 2 + 64 * sizeof(DB_LOCKER *);
+		if ((ret = __os_realloc(dbenv, sz, &dd_touched)) != 0)
+			return (ret);
+		dd_touched_size = sz;
+	}
+	dd_touched[dd_ntouched++] = lip;
+	return (0);
+}
+
+/*
+ * __dd_build --
+ *	Build the waits-for matrix.  This has to be called with the lockers
+ * mutex held, which keeps every locker we touch from being freed.
+ */
 static int
 __dd_build(dbenv, atype, bmp, smap, nlockers, allocp, idmap, is_replicant)
 	DB_ENV *dbenv;
@@ -1064,6 +1110,27 @@ __dd_build(dbenv, atype, bmp, smap, nlockers, allocp, idmap, is_replicant)
 	sparse_map_t **smap;
 	locker_info **idmap;
 	int is_replicant;
+{
+	u_int32_t i;
+	int ret;
+
+	ret = __dd_build_int(dbenv, atype, bmp, smap, nlockers, allocp, idmap,
+	    is_replicant);
+
+	for (i = 0; i < dd_ntouched; i++)
+		dd_touched[i]->dd_id = DD_INVALID_ID;
+	dd_ntouched = 0;
+
+	return (ret);
+}
+
+static int
+__dd_build_int(dbenv, atype, bmp, smap, nlockers, allocp, idmap, is_replicant)
+	DB_ENV *dbenv;
+	u_int32_t atype, **bmp, *nlockers, *allocp;
+	sparse_map_t **smap;
+	locker_info **idmap;
+	int is_replicant;
 {
 	struct __db_lock *lp;
 	DB_LOCKER *lockerp, *child;
@@ -1108,82 +1175,67 @@ __dd_build(dbenv, atype, bmp, smap, nlockers, allocp, idmap, is_replicant)
 	}
 
 	/*
-	 * We'll check how many lockers there are, add a few more in for
-	 * good measure and then allocate all the structures.  Then we'll
-	 * verify that we have enough room when we go back in and get the
-	 * mutex the second time.
+	 * Assign a deadlock detector id to each master locker in waiting
+	 * status.  Only those can be part of a cycle, and lock.c keeps them on
+	 * dd_lockers, so this is proportional to the number of waiters rather
+	 * than to the number of lockers.
 	 */
-retry:	count = region->stat.st_nlockers;
+	lock_detector(region);
+	count = region->ndd_lockers;
 
 	if (count == 0) {
+		unlock_detector(region);
 		*nlockers = 0;
 		return (0);
 	}
 
 	if (FLD_ISSET(dbenv->verbose, DB_VERB_DEADLOCK))
-		 __db_err(dbenv, "%lu lockers", (u_long)count);
+		 __db_err(dbenv, "%lu waiting lockers", (u_long)count);
 
-	count +=20;
 	allocSz = (size_t)count * sizeof(locker_info);
-
-	ret = __resize_object(dbenv, (void**) &dd_id_array, 
+	ret = __resize_object(dbenv, (void**) &dd_id_array,
 		&dd_id_array_size, allocSz);
-	if(ret) {
-		if (sparse_map) 
-			free_sparse_map(dbenv, sparse_map);
+	if (ret == 0)
+		ret = __resize_object(dbenv, (void**) &dd_touched,
+			&dd_touched_size, (size_t)count * sizeof(DB_LOCKER *));
+	if (ret) {
+		unlock_detector(region);
 		return ret;
 	}
 	memset(dd_id_array, 0, allocSz);
+	dd_ntouched = 0;
 
-
-	/*
-	 * Now go back in and actually fill in the matrix.
-	 */
-	if (region->stat.st_nlockers > count) {
-		if (sparse_map) {
-			free_sparse_map(dbenv, sparse_map);
-		}
-		goto retry;
-	}
-
-	/*
-	 * First we go through and assign a deadlock detector id
-	 * to each master locker which is in waiting status 
-	 */
 	id = 0;
 
-	for (DB_LOCKER *lip = SH_TAILQ_FIRST(&region->lockers, __db_locker);
-		lip != NULL; lip = SH_TAILQ_NEXT(lip, ulinks, __db_locker)) {
-		if (lip->wstatus == 1) {	/*only master lockers can be in waiting status */
-			lip->dd_id = id ++;
-			locker_info *ptr_idarr = &dd_id_array[lip->dd_id];
-			ptr_idarr->id = lip->id;
-
-			ptr_idarr->tid = lip->tid;
-			ptr_idarr->killme = F_ISSET(lip, DB_LOCKER_KILLME);
-			ptr_idarr->readonly = F_ISSET(lip, DB_LOCKER_READONLY);
-			ptr_idarr->saveme =
-				F_ISSET(lip, (DB_LOCKER_LOGICAL | DB_LOCKER_IN_LOGICAL_ABORT));
-			ptr_idarr->in_abort =
-				(F_ISSET(lip, DB_LOCKER_INABORT) != 0);
-			ptr_idarr->tracked =
-				(F_ISSET(lip, DB_LOCKER_TRACK) != 0);
+	for (DB_LOCKER *lip = SH_TAILQ_FIRST(&region->dd_lockers, __db_locker);
+		lip != NULL; lip = SH_TAILQ_NEXT(lip, dd_links, __db_locker)) {
+		lip->dd_id = id ++;
+		dd_touched[dd_ntouched++] = lip;
+		locker_info *ptr_idarr = &dd_id_array[lip->dd_id];
+		ptr_idarr->id = lip->id;
+
+		ptr_idarr->tid = lip->tid;
+		ptr_idarr->killme = F_ISSET(lip, DB_LOCKER_KILLME);
+		ptr_idarr->readonly = F_ISSET(lip, DB_LOCKER_READONLY);
+		ptr_idarr->saveme =
+			F_ISSET(lip, (DB_LOCKER_LOGICAL | DB_LOCKER_IN_LOGICAL_ABORT));
+		ptr_idarr->in_abort =
+			(F_ISSET(lip, DB_LOCKER_INABORT) != 0);
+		ptr_idarr->tracked =
+			(F_ISSET(lip, DB_LOCKER_TRACK) != 0);
 
 #if TEST_DEADLOCKS
-			__adjust_lockerid_priority_td(dbenv, atype, lip,
-				lip->dd_id, dd_id_array, 0);
+		__adjust_lockerid_priority_td(dbenv, atype, lip,
+			lip->dd_id, dd_id_array, 0);
 #else
-			__init_lockerid_priority(dbenv, atype, lip, ptr_idarr);
+		__init_lockerid_priority(dbenv, atype, lip, ptr_idarr);
 #endif
 
-			if (verbose_deadlocks &&lip->id >DB_LOCK_MAXID)
-				logmsg(LOGMSG_USER, "Added lip %p id=%x dd_id=%x count=%u\n",
-					lip, lip->id, lip->dd_id, ptr_idarr->count);
-
-		} else {
-			lip->dd_id = DD_INVALID_ID;
-		}
+		if (verbose_deadlocks &&lip->id >DB_LOCK_MAXID)
+			logmsg(LOGMSG_USER, "Added lip %p id=%x dd_id=%x count=%u\n",
+				lip, lip->id, lip->dd_id, ptr_idarr->count);
 	}
+	unlock_detector(region);
 
 	count = id;
 	nentries = ALIGN(count, 32) / 32;
@@ -1268,6 +1320,12 @@ obj_loop:
 					lockerp->master_locker))->dd_id;
 				if (dd == DD_INVALID_ID)	//locker is not in waiting status 
 					continue;
+				if ((ret = __dd_touch(dbenv, lockerp)) != 0) {
+					if (sparse_map)
+						free_sparse_map(dbenv, sparse_map);
+					unlock_obj_partition(region, partition);
+					return (ret);
+				}
 				lockerp->dd_id = dd;
 #if TEST_DEADLOCKS
 				__adjust_lockerid_priority_td(dbenv, atype,
@@ -1339,6 +1397,12 @@ look_waiters:
 					lockerp->master_locker))->dd_id;
 				if (dd == DD_INVALID_ID)	//locker is not in waiting status 
 					continue;
+				if ((ret = __dd_touch(dbenv, lockerp)) != 0) {
+					if (sparse_map)
+						free_sparse_map(dbenv, sparse_map);
+					unlock_obj_partition(region, partition);
+					return (ret);
+				}
 				lockerp->dd_id = dd;
 #if TEST_DEADLOCKS
 				__adjust_lockerid_priority_td(dbenv, atype,
@@ -166,6 +166,7 @@ add_to_lock_partition(DB_ENV *dbenv, DB_LOCKTAB *lt,
 		lp[i].status = DB_LSTAT_FREE;
 		lp[i].lpartition = partition;
 		lp[i].gen = 0;
+		lp[i].fpbucket = -1;
 		if ((ret = __db_mutex_setup(dbenv, &lt->reginfo, &lp[i].mutex,
 		    MUTEX_LOGICAL_LOCK | MUTEX_NO_RLOCK |
 		    MUTEX_SELF_BLOCK)) != 0)
@@ -327,6 +328,25 @@ __lock_init(dbenv, lt)
 	    &region->nwlkr_scale)) != 0) {
 		goto mem_err;
 	}
+	if ((ret = __db_shalloc(lt->reginfo.addr,
+	    sizeof(region->fp_lockers[0]) * gbl_lkr_parts, 0,
+	    &region->fp_lockers)) != 0) {
+		goto mem_err;
+	}
+	if ((ret = __db_shalloc(lt->reginfo.addr,
+	    sizeof(region->fp_refs[0]) * DB_LOCK_FP_BUCKETS * gbl_lkr_parts, 0,
+	    &region->fp_refs)) != 0) {
+		goto mem_err;
+	}
+	if ((ret = __db_shalloc(lt->reginfo.addr,
+	    sizeof(region->fp_strong[0]) * DB_LOCK_FP_BUCKETS, 0,
+	    &region->fp_strong)) != 0) {
+		goto mem_err;
+	}
+	memset(region->fp_refs, 0,
+	    sizeof(region->fp_refs[0]) * DB_LOCK_FP_BUCKETS * gbl_lkr_parts);
+	memset(region->fp_strong, 0,
+	    sizeof(region->fp_strong[0]) * DB_LOCK_FP_BUCKETS);
 
 	for (i = 0; i < gbl_lk_parts; ++i) {
 		region->nwlk_scale[i] = 0;
@@ -379,15 +399,18 @@ __lock_init(dbenv, lt)
 
 		/* Initialize lockers onto a free list.  */
 		SH_TAILQ_INIT(&region->free_lockers[i]);
+		SH_TAILQ_INIT(&region->fp_lockers[i]);
 		if ((ret = __db_shalloc(lt->reginfo.addr,
 		    sizeof(DB_LOCKER) * locker_p_size, 0, &lidp)) != 0) {
 mem_err:		__db_err(dbenv,
 			    "Unable to allocate memory for the lock table");
 			return (ret);
 		}
-		for (j = 0; j < locker_p_size; ++j, ++lidp)
+		for (j = 0; j < locker_p_size; ++j, ++lidp) {
+			lidp->fplocks = NULL;
 			SH_TAILQ_INSERT_HEAD(
 			    &region->free_lockers[i], lidp, links, __db_locker);
+		}
 	}
 
 #ifdef	HAVE_MUTEX_SYSTEM_RESOURCES
@@ -401,6 +424,8 @@ mem_err:		__db_err(dbenv,
 #endif
 
 	SH_TAILQ_INIT(&region->dd_objs);
+	SH_TAILQ_INIT(&region->dd_lockers);
+	region->ndd_lockers = 0;
 	SH_TAILQ_INIT(&region->lockers);
 
 	pthread_mutex_init(&region->dd_mtx.mtx, NULL);
@@ -506,6 +531,10 @@ __lock_region_size(dbenv)
 	retval += sizeof(region->obj_tab[0]) * gbl_lk_parts;
 	retval += sizeof(region->obj_tab_mtx[0]) * gbl_lk_parts;
 
+	retval += sizeof(region->fp_lockers[0]) * gbl_lkr_parts;
+	retval += sizeof(region->fp_refs[0]) * DB_LOCK_FP_BUCKETS * gbl_lkr_parts;
+	retval += sizeof(region->fp_strong[0]) * DB_LOCK_FP_BUCKETS;
+
 	/* And we keep getting this wrong, let's be generous. */
 	retval += retval / 5;
 
@@ -1028,6 +1028,9 @@ __log_region_destroy(dbenv, infop)
 	COMPQUIET(infop, NULL);
 }
 
+/* Number of times the log has been truncated. */
+unsigned int gbl_log_truncates;
+
 /*
  * __log_vtruncate
  *	This is a virtual truncate.  We set up the log indicators to
@@ -1116,6 +1119,9 @@ __log_vtruncate(dbenv, lsn, ckplsn, trunclsn)
 	if (trunclsn != NULL)
 		*trunclsn = lp->lsn;
 
+	/* Lsns past this point will be reused for different records. */
+	gbl_log_truncates++;
+
 	/* Truncate the log to the new point. */
 	if ((ret = __log_zero(dbenv, &lp->lsn, &end_lsn)) != 0)
 		goto err;
@@ -46,6 +46,9 @@ static const char revid[] = "$Id: log_put.c,v 11.145 2003/09/13 19:20:39 bostic
 #include "logmsg.h"
 
 extern unsigned long long get_commit_context(const void *, uint32_t generation);
+struct quantize;
+extern void quantize(struct quantize *q, int val);
+extern struct quantize *q_log_group_commit;
 extern int bdb_update_startlwm_berk(void *statearg, unsigned long long ltranid,
     DB_LSN *firstlsn);
 
@@ -62,6 +65,58 @@ static int __log_put_next __P((DB_ENV *,
 	u_int8_t *key, u_int32_t));
 static int __log_putr __P((DB_LOG *, DB_LSN *, const DBT *, u_int32_t, HDR *));
 static int __log_write __P((DB_LOG *, void *, u_int32_t));
+
+/*
+ * Adaptive group commit.  A thread about to lead a commit flush may hold
+ * off for a short window so that committers arriving meanwhile queue
+ * behind it and share its fsync.  The window is half the observed fsync
+ * latency, capped at log_group_commit_max_us, and is only taken when
+ * commits are arriving faster than that.
+ */
+int gbl_log_group_commit = 0;
+int gbl_log_group_commit_max_us = 1000;
+int gbl_log_group_fsync_us = 0;
+int gbl_log_group_arrival_us = 0;
+int gbl_log_group_window_us = 0;
+int64_t gbl_log_group_waits = 0;
+static u_int64_t log_group_last_arrival;
+
+static inline u_int64_t
+__log_group_now_us(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (u_int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/* Exponentially weighted average, 1/8 weight for the new sample. */
+static inline void
+__log_group_ewma(int *avg, u_int64_t sample)
+{
+	if (sample > 1000000)
+		sample = 1000000;
+	*avg = *avg ? (int)((7 * (u_int64_t)*avg + sample) / 8) : (int)sample;
+}
+
+/* Called with the region lock held. */
+static int
+__log_group_commit_window(void)
+{
+	int window;
+
+	if (!gbl_log_group_commit || gbl_log_group_fsync_us == 0 ||
+	    gbl_log_group_arrival_us == 0)
+		return (0);
+
+	window = gbl_log_group_fsync_us / 2;
+	if (window > gbl_log_group_commit_max_us)
+		window = gbl_log_group_commit_max_us;
+	if (gbl_log_group_arrival_us >= window)
+		window = 0;
+	gbl_log_group_window_us = window;
+	return (window);
+}
 void hexdump(unsigned char *key, int keylen);
 
 pthread_mutex_t log_write_lk = PTHREAD_MUTEX_INITIALIZER;
@@ -1261,7 +1316,8 @@ __log_flush_int(dblp, lsnp, release)
 	LOG *lp;
 	size_t b_off;
 	u_int32_t ncommit, w_off, listcnt;
-	int do_flush, first, ret, wrote_inmem;
+	u_int64_t fsync_start, fsync_us;
+	int do_flush, first, ret, wrote_inmem, window;
 
 	dbenv = dblp->dbenv;
 	lp = dblp->reginfo.primary;
@@ -1307,6 +1363,15 @@ __log_flush_int(dblp, lsnp, release)
 			return (0);
 
 		flush_lsn = *lsnp;
+
+		if (release) {
+			u_int64_t now = __log_group_now_us();
+
+			if (log_group_last_arrival)
+				__log_group_ewma(&gbl_log_group_arrival_us,
+				    now - log_group_last_arrival);
+			log_group_last_arrival = now;
+		}
 	}
 
 	/*
@@ -1397,6 +1462,23 @@ __log_flush_int(dblp, lsnp, release)
 			return (0);
 	}
 
+	/*
+	 * We're leading this flush.  Look busy for the group commit window
+	 * so that committers arriving meanwhile queue on lp->commits above,
+	 * then flush far enough to cover all of them.
+	 */
+	if (release && lsnp != NULL &&
+	    (window = __log_group_commit_window()) > 0) {
+		lp->in_flush++;
+		R_UNLOCK(dbenv, &dblp->reginfo);
+		__os_sleep(dbenv, 0, window);
+		R_LOCK(dbenv, &dblp->reginfo);
+		lp->in_flush--;
+		if (log_compare(&flush_lsn, &lp->t_lsn) < 0)
+			flush_lsn = lp->t_lsn;
+		gbl_log_group_waits++;
+	}
+
 	/*
 	 * Protect flushing with its own mutex so we can release
 	 * the region lock except during file switches.
@@ -1488,6 +1570,7 @@ flush:	MUTEX_LOCK(dbenv, flush_mutexp);
 		R_UNLOCK(dbenv, &dblp->reginfo);
 
 	/* Sync all writes to disk. */
+	fsync_start = __log_group_now_us();
 	if ((ret = __os_fsync(dbenv, dblp->lfhp)) != 0) {
 		MUTEX_UNLOCK(dbenv, flush_mutexp);
 		if (release)
@@ -1495,6 +1578,7 @@ flush:	MUTEX_LOCK(dbenv, flush_mutexp);
 		ret = __db_panic(dbenv, ret);
 		return (ret);
 	}
+	fsync_us = __log_group_now_us() - fsync_start;
 
 	/*
 	 * Set the last-synced LSN.
@@ -1520,6 +1604,7 @@ flush:	MUTEX_LOCK(dbenv, flush_mutexp);
 
 	lp->in_flush--;
 	++lp->stat.st_scount;
+	__log_group_ewma(&gbl_log_group_fsync_us, fsync_us);
 
 	/*
 	 * How many flush calls (usually commits) did this call actually sync?
@@ -1605,6 +1690,8 @@ done:	listcnt = 0;
 	if (lp->stat.st_mincommitperflush > ncommit ||
 	    lp->stat.st_mincommitperflush == 0)
 		lp->stat.st_mincommitperflush = ncommit;
+	if (ncommit && q_log_group_commit)
+		quantize(q_log_group_commit, ncommit);
 
 	return (ret);
 }
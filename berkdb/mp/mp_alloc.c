@@ -62,6 +62,22 @@ __memp_dump_bufferpool_info(dbenv, f)
 
 	bufcnt = 0;
 
+	/* Per-region summary first; the buffer listing can be very long. */
+	logmsgf(LOGMSG_USER, f, "%-6s %-5s %10s %10s %12s %12s %12s %10s %10s %10s\n",
+	    "CACHE", "NODE", "PAGES", "DIRTY", "HIT", "MISS", "ALLOC",
+	    "RO_EVICT", "RW_EVICT", "HASH_WAIT");
+	for (n_cache = 0; n_cache < mp->nreg; n_cache++) {
+		c_mp = dbmp->reginfo[n_cache].primary;
+		logmsgf(LOGMSG_USER, f,
+		    "%-6d %-5d %10u %10d %12u %12u %12u %10u %10u %10u\n",
+		    n_cache, c_mp->numa_node, c_mp->stat.st_pages,
+		    c_mp->stat.st_page_dirty.value, c_mp->stat.st_cache_hit,
+		    c_mp->stat.st_cache_miss, c_mp->stat.st_alloc,
+		    c_mp->stat.st_ro_evict, c_mp->stat.st_rw_evict,
+		    c_mp->stat.st_hash_wait);
+	}
+	logmsgf(LOGMSG_USER, f, "\n");
+
 	/* Print format of buffers. */
 	logmsgf(LOGMSG_USER, f, "FORMAT = ( MPOOLOFFSET : PAGENUMBER : PRIORITY )\n");
 
@@ -21,8 +21,20 @@ static const char revid[] = "$Id: mp_region.c,v 11.55 2003/06/30 17:20:19 bostic
 #include "db_int.h"
 #include "dbinc/db_shash.h"
 #include "dbinc/mp.h"
+#include "logmsg.h"
 
 static int __mpool_init __P((DB_ENV *, DB_MPOOL *, int, int));
+static int __mpool_numa_place __P((DB_ENV *, DB_MPOOL *, int, int *, int));
+
+/*
+ * When set, the cache regions are spread round-robin across the NUMA nodes
+ * and each region's memory is placed on its node.
+ */
+int gbl_mpool_numa_bind = 0;
+
+/* __os_r_numa_bind takes a 256 bit node mask. */
+#define	MPOOL_NUMA_MAXNODES	256
+
 #ifdef HAVE_MUTEX_SYSTEM_RESOURCES
 static size_t __mpool_region_maint __P((REGINFO *));
 #endif
@@ -43,9 +55,22 @@ __memp_open(dbenv)
 	size_t reg_size;
 	u_int32_t *regids;
 	u_int32_t i;
-	int htab_buckets, ret;
+	int htab_buckets, nnodes, node, ret;
+	int nodes[MPOOL_NUMA_MAXNODES];
 	double x;
 
+	/* Give every NUMA node the same number of cache regions. */
+	nnodes = gbl_mpool_numa_bind ?
+	    __os_numa_nodes(nodes, MPOOL_NUMA_MAXNODES) : 0;
+	if (nnodes > 1 && dbenv->mp_ncache % nnodes != 0) {
+		u_int32_t ncache;
+
+		ncache = (dbenv->mp_ncache + nnodes - 1) / nnodes * nnodes;
+		logmsg(LOGMSG_INFO, "mpool: %u cache regions rounded up to %u "
+		    "for %d NUMA nodes\n", dbenv->mp_ncache, ncache, nnodes);
+		dbenv->mp_ncache = ncache;
+	}
+
 	/* Figure out how big each cache region is. */
 	x = ((double)dbenv->mp_gbytes) * GIGABYTE;
 	x += dbenv->mp_bytes;
@@ -106,8 +131,10 @@ __memp_open(dbenv)
 		dbmp->reginfo[0] = reginfo;
 
 		/* Initialize the first region. */
+		node = __mpool_numa_place(dbenv, dbmp, 0, nodes, nnodes);
 		if ((ret = __mpool_init(dbenv, dbmp, 0, htab_buckets)) != 0)
 			goto err;
+		((MPOOL *)dbmp->reginfo[0].primary)->numa_node = node;
 
 		/*
 		 * Create/initialize remaining regions and copy their IDs into
@@ -123,9 +150,11 @@ __memp_open(dbenv)
 			if ((ret = __db_r_attach(
 			    dbenv, &dbmp->reginfo[i], reg_size)) != 0)
 				goto err;
+			node = __mpool_numa_place(dbenv, dbmp, i, nodes, nnodes);
 			if ((ret =
 			    __mpool_init(dbenv, dbmp, i, htab_buckets)) != 0)
 				goto err;
+			((MPOOL *)dbmp->reginfo[i].primary)->numa_node = node;
 			R_UNLOCK(dbenv, &dbmp->reginfo[i]);
 
 			regids[i] = dbmp->reginfo[i].id;
@@ -207,6 +236,32 @@ err:	if (dbmp->reginfo != NULL && dbmp->reginfo[0].addr != NULL) {
 	return (ret);
 }
 
+/*
+ * __mpool_numa_place --
+ *	Place a freshly attached cache region on its NUMA node.  This happens
+ *	before __mpool_init touches the region, so the hash table and buffer
+ *	headers are faulted in locally.  Regions go round robin over the
+ *	online node ids.  Returns the node, or -1.
+ */
+static int
+__mpool_numa_place(dbenv, dbmp, reginfo_off, nodes, nnodes)
+	DB_ENV *dbenv;
+	DB_MPOOL *dbmp;
+	int reginfo_off;
+	int *nodes;
+	int nnodes;
+{
+	int node;
+
+	if (nnodes <= 1)
+		return (-1);
+
+	node = nodes[reginfo_off % nnodes];
+	if (__os_r_numa_bind(dbenv, &dbmp->reginfo[reginfo_off], node) != 0)
+		return (-1);
+	return (node);
+}
+
 /*
  * __mpool_init --
  *	Initialize a MPOOL structure in shared memory.
@@ -235,6 +290,7 @@ __mpool_init(dbenv, dbmp, reginfo_off, htab_buckets)
 	reginfo->rp->primary = R_OFFSET(reginfo, reginfo->primary);
 	mp = reginfo->primary;
 	memset(mp, 0, sizeof(*mp));
+	mp->numa_node = -1;
 
 #ifdef	HAVE_MUTEX_SYSTEM_RESOURCES
 	maint_size = __mpool_region_maint(reginfo);
@@ -21,6 +21,10 @@ static const char revid[] = "$Id: os_region.c,v 11.17 2003/07/13 17:45:23 bostic
 #include <sys/types.h>
 #endif
 
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
 #include "db_int.h"
 #include <cdb2_constants.h>
 #include "logmsg.h"
@@ -189,3 +193,87 @@ __os_r_detach(dbenv, infop, destroy)
 	return (0);
 
 }
+
+/*
+ * __os_numa_nodes --
+ *	Fill in the ids of the online NUMA nodes, which need not be
+ *	contiguous, and return how many there are, or 0 if we can't tell.
+ *
+ * PUBLIC: int __os_numa_nodes __P((int *, int));
+ */
+int
+__os_numa_nodes(nodes, max)
+	int *nodes;
+	int max;
+{
+	FILE *f;
+	char buf[256], *p;
+	int lo, hi, n;
+
+	if ((f = fopen("/sys/devices/system/node/online", "r")) == NULL)
+		return (0);
+	p = fgets(buf, sizeof(buf), f);
+	fclose(f);
+	if (p == NULL)
+		return (0);
+
+	/* A list of ranges, eg. "0-1" or "0,2-3". */
+	for (n = 0; *p != '\0' && *p != '\n';) {
+		lo = hi = (int)strtol(p, &p, 10);
+		if (*p == '-')
+			hi = (int)strtol(p + 1, &p, 10);
+		for (; lo <= hi && n < max; ++lo)
+			nodes[n++] = lo;
+		if (*p == ',')
+			++p;
+		else
+			break;
+	}
+	return (n);
+}
+
+/*
+ * __os_r_numa_bind --
+ *	Prefer allocating a region's memory from the given NUMA node, and move
+ *	whatever has already been faulted in.
+ *
+ * PUBLIC: int __os_r_numa_bind __P((DB_ENV *, REGINFO *, int));
+ */
+int
+__os_r_numa_bind(dbenv, infop, node)
+	DB_ENV *dbenv;
+	REGINFO *infop;
+	int node;
+{
+#if defined(__linux__) && defined(SYS_mbind)
+#define	OS_MPOL_PREFERRED	1
+#define	OS_MPOL_MF_MOVE		(1 << 1)
+	unsigned long mask[4];
+	uintptr_t start, end, pgsz;
+
+	if (infop->addr == NULL || infop->rp == NULL ||
+	    node < 0 || node >= (int)(sizeof(mask) * 8))
+		return (EINVAL);
+
+	pgsz = (uintptr_t)sysconf(_SC_PAGESIZE);
+	start = ((uintptr_t)infop->addr + pgsz - 1) & ~(pgsz - 1);
+	end = ((uintptr_t)infop->addr + infop->rp->size) & ~(pgsz - 1);
+	if (end <= start)
+		return (0);
+
+	memset(mask, 0, sizeof(mask));
+	mask[node / (sizeof(unsigned long) * 8)] |=
+	    1UL << (node % (sizeof(unsigned long) * 8));
+	if (syscall(SYS_mbind, (void *)start, end - start, OS_MPOL_PREFERRED,
+		mask, sizeof(mask) * 8, OS_MPOL_MF_MOVE) != 0) {
+		__db_err(dbenv, "mbind region to node %d: %s", node,
+		    strerror(errno));
+		return (errno);
+	}
+	return (0);
+#else
+	COMPQUIET(infop, NULL);
+	COMPQUIET(node, 0);
+	return (DB_OPNOTSUP);
+#endif
+}
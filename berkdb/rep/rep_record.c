@@ -39,6 +39,7 @@ static const char revid[] =
 #include "dbinc/hmac.h"
 #include <ctrace.h>
 #include <sys/poll.h>
+#include <sys/time.h>
 
 #include "dbinc_auto/fileops_auto.h"
 #include "dbinc_auto/qam_auto.h"
@@ -74,6 +75,8 @@ int gbl_rep_badgen_trace;
 void hexdump(unsigned char *key, int keylen);
 extern void fsnapf(FILE *, void *, int);
 static int reset_recovery_processor(struct __recovery_processor *rp);
+static void rep_deps_applied(DB_ENV *dbenv, struct __recovery_processor *rp);
+static int rep_deps_hold_ack(DB_LSN *lsn, u_int32_t generation);
 
 #define BDB_WRITELOCK(idstr)    bdb_get_writelock(bdb_state, (idstr), __func__, __LINE__)
 #define BDB_RELLOCK()           bdb_rellock(bdb_state, __func__, __LINE__)
@@ -102,6 +105,13 @@ int64_t gbl_rep_trans_parallel = 0, gbl_rep_trans_serial =
     0, gbl_rep_trans_deadlocked = 0, gbl_rep_trans_inline =
     0, gbl_rep_rowlocks_multifile = 0;
 
+/* Apply non-conflicting replicated transactions concurrently, ordering only
+ * transactions that touch the same pages and releasing in commit order. */
+int gbl_rep_apply_page_deps = 0;
+int64_t gbl_rep_trans_deps_parked = 0, gbl_rep_trans_deps_waits =
+    0, gbl_rep_trans_deps_inflight_max = 0, gbl_rep_trans_deps_retired =
+    0, gbl_rep_trans_deps_lag_us = 0, gbl_rep_trans_deps_lag_max_us = 0;
+
 static inline int wait_for_running_transactions(DB_ENV *dbenv);
 
 #define	IS_SIMPLE(R)	((R) != DB___txn_regop && (R) != DB___txn_xa_regop && \
@@ -2718,7 +2728,12 @@ err:	if (dbc != NULL && (t_ret = __db_c_close(dbc)) != 0 && ret == 0) {
 	if (ret == 0 && gap) {
 		if (ret_lsnp != NULL)
 			*ret_lsnp = max_lsn;
-		ret = DB_REP_ISPERM;
+		/* Acking max_lsn would tell the master that a parked transaction
+		 * is visible here before it has its page locks.  The ack is sent
+		 * when the last parked transaction gets them. */
+		if (max_lsn.file == 0 || !rep_deps_hold_ack(&max_lsn,
+			commit_gen ? *commit_gen : rep->committed_gen))
+			ret = DB_REP_ISPERM;
 	}
 	/* here we have received an inline non simple record; we still 
 	 * have to report it to the bdb caller so that lsn is updated
@@ -2916,9 +2931,9 @@ logical_record_file_affinity(int rectype)
 #include <stdlib.h>
 
 static void
-processor_thd(struct thdpool *pool, void *work, void *thddata, int op)
-{
+processor_apply(rp)
 	struct __recovery_processor *rp;
+{
 	struct __recovery_queue *rq;
 	struct __recovery_record *rr;
 	DBT data_dbt, lock_prev_lsn_dbt;
@@ -2936,7 +2951,6 @@ processor_thd(struct thdpool *pool, void *work, void *thddata, int op)
 	DB_REP *db_rep;
 	REP *rep;
 
-	rp = (struct __recovery_processor *)work;
 	listc_init(&queues, offsetof(struct __recovery_queue, lnk));
 	dbenv = rp->dbenv;
 	db_rep = dbenv->rep_handle;
@@ -3238,8 +3252,26 @@ err:
 		unlock_schema_lk();
 		rp->has_schema_lock = 0;
 	}
+}
+
+static void
+processor_thd(struct thdpool *pool, void *work, void *thddata, int op)
+{
+	struct __recovery_processor *rp;
+	DB_ENV *dbenv;
+
+	rp = (struct __recovery_processor *)work;
+	dbenv = rp->dbenv;
 
-	ret = reset_recovery_processor(rp);
+	processor_apply(rp);
+
+	/* Scheduled by page ownership: retire in commit order. */
+	if (rp->deps_mode) {
+		rep_deps_applied(dbenv, rp);
+		return;
+	}
+
+	reset_recovery_processor(rp);
 
 	/* TODO: How do I signal error?  What errors can there be? */
 	pthread_mutex_lock(&dbenv->recover_lk);
@@ -3250,6 +3282,10 @@ err:
 	if (!dbenv->lsn_chain) {
 		pthread_rwlock_unlock(&dbenv->ser_lk);
 	}
+
+	/* We may have been the only thing holding back scheduled transactions
+	 * that finished after us. */
+	rep_deps_applied(dbenv, NULL);
 }
 
 static void
@@ -3896,6 +3932,463 @@ reset_recovery_processor(rp)
 	return ret;
 }
 
+/*
+ * Page-ownership apply scheduling.
+ *
+ * Every transaction handed to the processors registers the pages named in
+ * its commit record's lock list.  The table below remembers the most recent
+ * unretired transaction to touch each page; a new transaction depends on
+ * every distinct owner it displaces.  A transaction with no dependencies is
+ * dispatched immediately.  One with dependencies is parked, and is run by
+ * whichever thread retires its last dependency.  Transactions are retired
+ * (page locks released, so their changes become visible) strictly in commit
+ * LSN order.
+ */
+#define REP_DEPS_HASH_SZ 4096
+
+struct rep_page_owner {
+	u_int64_t key;
+	struct __recovery_processor *owner;
+	struct rep_page_owner *next;
+};
+
+static pthread_mutex_t rep_deps_lk = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t rep_deps_cd = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t rep_retire_lk = PTHREAD_MUTEX_INITIALIZER;
+static struct rep_page_owner *rep_page_owners[REP_DEPS_HASH_SZ];
+static struct rep_page_owner *rep_page_owner_free;
+static int rep_deps_active;
+static int rep_deps_nparked;
+static DB_LSN rep_deps_ack_lsn;		/* ack held back while parked */
+static u_int32_t rep_deps_ack_gen;
+
+static inline u_int64_t
+rep_deps_now_us(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (u_int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static int
+rep_deps_u64_cmp(const void *a, const void *b)
+{
+	u_int64_t x = *(const u_int64_t *)a, y = *(const u_int64_t *)b;
+
+	return (x < y) ? -1 : (x > y);
+}
+
+/* Hash a lock object the way the lock manager will see it for pgno. */
+static int
+rep_deps_collect_page(void *arg, DB_LOCK_ILOCK *lock, u_int32_t size,
+    db_pgno_t pgno)
+{
+	struct __recovery_processor *rp = arg;
+	const u_int8_t *p = (const u_int8_t *)lock;
+	const u_int8_t *pg = (const u_int8_t *)&pgno;
+	u_int64_t h = 14695981039346656037ULL;
+	u_int32_t i;
+
+	for (i = 0; i < size; i++) {
+		h ^= (i < sizeof(db_pgno_t)) ? pg[i] : p[i];
+		h *= 1099511628211ULL;
+	}
+
+	if (rp->npgkeys == rp->maxpgkeys) {
+		int newmax = rp->maxpgkeys ? rp->maxpgkeys * 2 : 64;
+		u_int64_t *keys;
+
+		keys = realloc(rp->pgkeys, newmax * sizeof(u_int64_t));
+		if (keys == NULL)
+			return (ENOMEM);
+		rp->pgkeys = keys;
+		rp->maxpgkeys = newmax;
+	}
+	rp->pgkeys[rp->npgkeys++] = h;
+	return (0);
+}
+
+static void
+rep_deps_add_dependent(owner, rp)
+	struct __recovery_processor *owner;
+	struct __recovery_processor *rp;
+{
+	/* rp is the only transaction registering, so a duplicate is always
+	 * the last entry. */
+	if (owner->ndependents &&
+	    owner->dependents[owner->ndependents - 1] == rp)
+		return;
+
+	if (owner->ndependents == owner->maxdependents) {
+		owner->maxdependents =
+		    owner->maxdependents ? owner->maxdependents * 2 : 8;
+		owner->dependents = realloc(owner->dependents,
+		    owner->maxdependents * sizeof(struct __recovery_processor *));
+		if (owner->dependents == NULL) {
+			logmsg(LOGMSG_FATAL, "%s: out of memory\n", __func__);
+			abort();
+		}
+	}
+	owner->dependents[owner->ndependents++] = rp;
+	rp->ndeps++;
+}
+
+/*
+ * Record rp as the owner of every page in its lock list.  If rp depends on
+ * an earlier transaction and can_park is set (and the lock list has no
+ * page-lsn keys), rp is parked and held; the caller finishes setting it up
+ * and calls rep_deps_unhold.  Otherwise the caller waits for *ndeps to drain
+ * with rep_deps_wait.
+ */
+static int
+rep_deps_register(dbenv, rp, lock_dbt, can_park, parked)
+	DB_ENV *dbenv;
+	struct __recovery_processor *rp;
+	DBT *lock_dbt;
+	int can_park;
+	int *parked;
+{
+	struct rep_page_owner *po;
+	int haskeys, i, j, ret;
+
+	*parked = 0;
+	rp->npgkeys = 0;
+	rp->ndeps = 0;
+	rp->ndependents = 0;
+	rp->deps_applied = 0;
+	rp->deps_parked = 0;
+	rp->deps_hold = 0;
+
+	if ((ret = __lock_list_foreach(dbenv, lock_dbt, rep_deps_collect_page,
+		    rp, &haskeys)) != 0)
+		return (ret);
+
+	if (rp->npgkeys > 1) {
+		qsort(rp->pgkeys, rp->npgkeys, sizeof(u_int64_t),
+		    rep_deps_u64_cmp);
+		for (i = 1, j = 1; i < rp->npgkeys; i++) {
+			if (rp->pgkeys[i] != rp->pgkeys[j - 1])
+				rp->pgkeys[j++] = rp->pgkeys[i];
+		}
+		rp->npgkeys = j;
+	}
+
+	pthread_mutex_lock(&rep_deps_lk);
+	for (i = 0; i < rp->npgkeys; i++) {
+		u_int64_t key = rp->pgkeys[i];
+
+		for (po = rep_page_owners[key % REP_DEPS_HASH_SZ]; po;
+		    po = po->next) {
+			if (po->key == key)
+				break;
+		}
+		if (po) {
+			rep_deps_add_dependent(po->owner, rp);
+			po->owner = rp;
+			continue;
+		}
+		if ((po = rep_page_owner_free) != NULL)
+			rep_page_owner_free = po->next;
+		else if ((po = malloc(sizeof(*po))) == NULL) {
+			logmsg(LOGMSG_FATAL, "%s: out of memory\n", __func__);
+			abort();
+		}
+		po->key = key;
+		po->owner = rp;
+		po->next = rep_page_owners[key % REP_DEPS_HASH_SZ];
+		rep_page_owners[key % REP_DEPS_HASH_SZ] = po;
+	}
+	rp->deps_mode = 1;
+	rep_deps_active++;
+	if (rp->ndeps && can_park && !haskeys) {
+		rp->deps_parked = rp->deps_hold = 1;
+		rep_deps_nparked++;
+		*parked = 1;
+	}
+	pthread_mutex_unlock(&rep_deps_lk);
+
+	return (0);
+}
+
+/* Drop rp's page ownership and collect parked dependents that are now
+ * runnable onto ready. */
+static void
+rep_deps_release(rp, ready)
+	struct __recovery_processor *rp;
+	void *ready;
+{
+	LISTC_T(struct __recovery_processor) *readyl = ready;
+	struct rep_page_owner *po, **ppo;
+	int i;
+
+	pthread_mutex_lock(&rep_deps_lk);
+	for (i = 0; i < rp->npgkeys; i++) {
+		u_int64_t key = rp->pgkeys[i];
+
+		for (ppo = &rep_page_owners[key % REP_DEPS_HASH_SZ];
+		    (po = *ppo) != NULL; ppo = &po->next) {
+			if (po->key == key)
+				break;
+		}
+		if (po && po->owner == rp) {
+			*ppo = po->next;
+			po->next = rep_page_owner_free;
+			rep_page_owner_free = po;
+		}
+	}
+	for (i = 0; i < rp->ndependents; i++) {
+		struct __recovery_processor *d = rp->dependents[i];
+
+		if (--d->ndeps == 0 && d->deps_parked && !d->deps_hold) {
+			d->deps_parked = 0;
+			listc_abl(readyl, d);
+		}
+	}
+	rp->npgkeys = 0;
+	rp->ndependents = 0;
+	rp->deps_mode = 0;
+	rep_deps_active--;
+	pthread_cond_broadcast(&rep_deps_cd);
+	pthread_mutex_unlock(&rep_deps_lk);
+}
+
+/* Forget a registered transaction that was applied inline or failed.  It
+ * was the newest registration and has no dependencies left, so nothing can
+ * be waiting on it. */
+static void
+rep_deps_forget(rp)
+	struct __recovery_processor *rp;
+{
+	LISTC_T(struct __recovery_processor) ready;
+
+	listc_init(&ready, offsetof(struct __recovery_processor, deps_lnk));
+	rep_deps_release(rp, &ready);
+	assert(listc_size(&ready) == 0);
+}
+
+static void
+rep_deps_wait(rp)
+	struct __recovery_processor *rp;
+{
+	pthread_mutex_lock(&rep_deps_lk);
+	if (rp->ndeps)
+		gbl_rep_trans_deps_waits++;
+	while (rp->ndeps)
+		pthread_cond_wait(&rep_deps_cd, &rep_deps_lk);
+	pthread_mutex_unlock(&rep_deps_lk);
+}
+
+/*
+ * Hold back an ack for lsn if any transaction is parked without its page
+ * locks: the ack covers every earlier commit, and a reader on this node
+ * could otherwise see the old page.  Returns 1 if the ack was held.
+ */
+static int
+rep_deps_hold_ack(lsn, generation)
+	DB_LSN *lsn;
+	u_int32_t generation;
+{
+	int held = 0;
+
+	pthread_mutex_lock(&rep_deps_lk);
+	if (rep_deps_nparked > 0) {
+		if (log_compare(lsn, &rep_deps_ack_lsn) > 0) {
+			rep_deps_ack_lsn = *lsn;
+			rep_deps_ack_gen = generation;
+		}
+		held = 1;
+	}
+	pthread_mutex_unlock(&rep_deps_lk);
+	return (held);
+}
+
+/* A parked transaction has its locks (or was handed back to the
+ * dispatcher).  Send the held ack once none are left parked. */
+static void
+rep_deps_unparked(dbenv)
+	DB_ENV *dbenv;
+{
+	DB_LSN lsn;
+	u_int32_t gen = 0;
+
+	ZERO_LSN(lsn);
+	pthread_mutex_lock(&rep_deps_lk);
+	if (--rep_deps_nparked == 0 && !IS_ZERO_LSN(rep_deps_ack_lsn)) {
+		lsn = rep_deps_ack_lsn;
+		gen = rep_deps_ack_gen;
+		ZERO_LSN(rep_deps_ack_lsn);
+	}
+	pthread_mutex_unlock(&rep_deps_lk);
+
+	if (!IS_ZERO_LSN(lsn))
+		comdb2_early_ack(dbenv, lsn, gen);
+}
+
+/* Turn a held, parked transaction back into one the dispatcher waits on. */
+static void
+rep_deps_unpark(dbenv, rp)
+	DB_ENV *dbenv;
+	struct __recovery_processor *rp;
+{
+	pthread_mutex_lock(&rep_deps_lk);
+	rp->deps_parked = rp->deps_hold = 0;
+	pthread_mutex_unlock(&rep_deps_lk);
+	rep_deps_unparked(dbenv);
+	rep_deps_wait(rp);
+}
+
+/* Acquire a parked transaction's page locks and apply it. */
+static void
+rep_deps_run_parked(dbenv, rp)
+	DB_ENV *dbenv;
+	struct __recovery_processor *rp;
+{
+	DB_LOCKREQ req;
+	void *pglogs = NULL;
+	u_int32_t keycnt = 0, flags;
+	int ret;
+
+	flags = LOCK_GET_LIST_GETLOCK |
+	    (gbl_rep_printlock ? LOCK_GET_LIST_PRINTLOCK : 0);
+
+	/* Only readers can hold these pages now; retry if we're picked as a
+	 * deadlock victim against one of them. */
+	while ((ret = __lock_get_list(dbenv, rp->lockid, flags, DB_LOCK_WRITE,
+		    &rp->deps_locks, &rp->commit_lsn, &pglogs, &keycnt,
+		    stdout)) == DB_LOCK_DEADLOCK) {
+		gbl_rep_trans_deadlocked++;
+		memset(&req, 0, sizeof(req));
+		req.op = DB_LOCK_PUT_ALL;
+		__lock_vec(dbenv, rp->lockid, 0, &req, 1, NULL);
+		poll(0, 0, 1);
+	}
+	if (ret != 0) {
+		logmsg(LOGMSG_FATAL,
+		    "%s: can't get locks for %u:%u, ret=%d\n", __func__,
+		    rp->commit_lsn.file, rp->commit_lsn.offset, ret);
+		abort();
+	}
+
+	rep_deps_unparked(dbenv);
+
+	processor_apply(rp);
+}
+
+/* Retire applied transactions from the head of the in-flight list. */
+static void
+rep_deps_retire(dbenv, ready)
+	DB_ENV *dbenv;
+	void *ready;
+{
+	struct __recovery_processor *rp;
+	u_int64_t lag;
+
+	pthread_mutex_lock(&rep_retire_lk);
+	for (;;) {
+		pthread_mutex_lock(&dbenv->recover_lk);
+		rp = LISTC_TOP(&dbenv->inflight_transactions);
+		if (rp == NULL || !rp->deps_mode || !rp->deps_applied) {
+			pthread_mutex_unlock(&dbenv->recover_lk);
+			break;
+		}
+		listc_rtl(&dbenv->inflight_transactions);
+		pthread_mutex_unlock(&dbenv->recover_lk);
+
+		/* Releasing the page locks is what makes the commit visible. */
+		reset_recovery_processor(rp);
+		rep_deps_release(rp, ready);
+
+		lag = rep_deps_now_us() - rp->dispatch_us;
+		gbl_rep_trans_deps_retired++;
+		gbl_rep_trans_deps_lag_us += lag;
+		if (lag > gbl_rep_trans_deps_lag_max_us)
+			gbl_rep_trans_deps_lag_max_us = lag;
+
+		pthread_mutex_lock(&dbenv->recover_lk);
+		listc_abl(&dbenv->inactive_transactions, rp);
+		pthread_mutex_unlock(&dbenv->recover_lk);
+
+		pthread_rwlock_unlock(&dbenv->ser_lk);
+	}
+	pthread_mutex_unlock(&rep_retire_lk);
+}
+
+/*
+ * Called when rp (if any) has been applied.  Retires whatever is now at the
+ * head of the commit order, then runs the parked transactions that unblocks
+ * on this thread rather than queueing them: a processor thread that blocked
+ * waiting for a free processor could deadlock the pool.
+ */
+static void
+rep_deps_applied(dbenv, rp)
+	DB_ENV *dbenv;
+	struct __recovery_processor *rp;
+{
+	LISTC_T(struct __recovery_processor) ready;
+
+	if (rp == NULL && !rep_deps_active)
+		return;
+
+	listc_init(&ready, offsetof(struct __recovery_processor, deps_lnk));
+	for (;;) {
+		if (rp) {
+			pthread_mutex_lock(&dbenv->recover_lk);
+			rp->deps_applied = 1;
+			pthread_mutex_unlock(&dbenv->recover_lk);
+		}
+		rep_deps_retire(dbenv, &ready);
+		if ((rp = listc_rtl(&ready)) == NULL)
+			break;
+		rep_deps_run_parked(dbenv, rp);
+	}
+}
+
+static void
+rep_deps_parked_thd(struct thdpool *pool, void *work, void *thddata, int op)
+{
+	struct __recovery_processor *rp = work;
+
+	rep_deps_run_parked(rp->dbenv, rp);
+	rep_deps_applied(rp->dbenv, rp);
+}
+
+/* The dispatcher has finished setting up a parked transaction.  If its
+ * dependencies retired in the meantime, nobody else will run it. */
+static void
+rep_deps_unhold(dbenv, rp)
+	DB_ENV *dbenv;
+	struct __recovery_processor *rp;
+{
+	int run;
+
+	pthread_mutex_lock(&rep_deps_lk);
+	rp->deps_hold = 0;
+	if ((run = (rp->ndeps == 0)) != 0)
+		rp->deps_parked = 0;
+	pthread_mutex_unlock(&rep_deps_lk);
+
+	if (run)
+		thdpool_enqueue(dbenv->recovery_processors,
+		    rep_deps_parked_thd, rp, 0, NULL);
+}
+
+static void
+rep_deps_note_inflight(dbenv, rp)
+	DB_ENV *dbenv;
+	struct __recovery_processor *rp;
+{
+	int n;
+
+	rp->dispatch_us = rep_deps_now_us();
+	pthread_mutex_lock(&dbenv->recover_lk);
+	listc_abl(&dbenv->inflight_transactions, rp);
+	n = listc_size(&dbenv->inflight_transactions);
+	pthread_mutex_unlock(&dbenv->recover_lk);
+	if (n > gbl_rep_trans_deps_inflight_max)
+		gbl_rep_trans_deps_inflight_max = n;
+}
+
 static inline int
 __rep_process_txn_concurrent_int(dbenv, rctl, rec, ltrans, ctrllsn, maxlsn,
     commit_gen, prev_commit_lsn)
@@ -3933,6 +4426,7 @@ __rep_process_txn_concurrent_int(dbenv, rctl, rec, ltrans, ctrllsn, maxlsn,
 	int had_serializable_records = 0;
 	void *pglogs = NULL;
 	u_int32_t keycnt = 0;
+	int deps = 0, collected = 0, parked = 0;
 
 	pthread_mutex_lock(&dbenv->recover_lk);
 	rp = listc_rtl(&dbenv->inactive_transactions);
@@ -4153,6 +4647,86 @@ bad_resize:	;
 		lock_dbt = &prep_args->locks;
 	}
 
+	/* Keep registering while anything registered is still in flight, even
+	 * if the tunable was just turned off: an unregistered transaction
+	 * could otherwise overtake a parked one on the same page. */
+	if ((gbl_rep_apply_page_deps || rep_deps_active) && !dbenv->lsn_chain) {
+		int can_park = 0;
+
+		deps = 1;
+
+		/* A parked transaction is started by whichever thread retires
+		 * its last dependency, so it must not need the dispatcher: its
+		 * context is known and it has no records that force it to run
+		 * serially. */
+		if (rectype == DB___txn_regop_gen && rp->context &&
+		    !throwdeadlock) {
+			if ((ret = __rep_collect_txn_txnid(dbenv, &prev_lsn,
+				    &rp->lc, &had_serializable_records, rp,
+				    txnid)) != 0)
+				goto err;
+			collected = 1;
+			can_park = !had_serializable_records;
+		}
+
+		if ((ret = rep_deps_register(dbenv, rp, lock_dbt, can_park,
+			    &parked)) != 0)
+			goto err;
+
+		if (parked) {
+			set_commit_context(rp->context, commit_gen,
+			    &(rctl->lsn), args, rectype);
+			ret = bdb_transfer_pglogs_to_queues(dbenv->app_private,
+			    NULL, 0, 1, 0, rctl->lsn, txn_gen_args->timestamp,
+			    rp->context);
+			if (ret == 0)
+				ret = __db_txnlist_init(dbenv, 0, 0, NULL,
+				    &txninfo);
+			if (ret == 0 && rp->deps_locks.ulen < lock_dbt->size) {
+				void *p = realloc(rp->deps_locks.data,
+				    lock_dbt->size);
+				if (p == NULL)
+					ret = ENOMEM;
+				else {
+					rp->deps_locks.data = p;
+					rp->deps_locks.ulen = lock_dbt->size;
+				}
+			}
+			if (ret) {
+				rep_deps_unpark(dbenv, rp);
+				goto err;
+			}
+			memcpy(rp->deps_locks.data, lock_dbt->data,
+			    lock_dbt->size);
+			rp->deps_locks.size = lock_dbt->size;
+
+			qsort(rp->lc.array, rp->lc.nlsns,
+			    sizeof(struct logrecord), __rep_lsn_cmp);
+
+			rp->lockid = lockid;
+			rp->txninfo = txninfo;
+			rp->commit_lsn = ctrllsn;
+			rp->has_logical_commit = 0;
+			rp->has_schema_lock = 0;
+			if (data_dbt.data) {
+				free(data_dbt.data);
+				data_dbt.data = NULL;
+			}
+			__os_free(dbenv, txn_gen_args);
+
+			gbl_rep_trans_parallel++;
+			gbl_rep_trans_deps_parked++;
+
+			pthread_rwlock_rdlock(&dbenv->ser_lk);
+			rep_deps_note_inflight(dbenv, rp);
+			rep_deps_unhold(dbenv, rp);
+			return 0;
+		}
+
+		/* Wait for the earlier transactions touching our pages. */
+		rep_deps_wait(rp);
+	}
+
 	/* XXX new logic: collect the locks & commit context, and then send the ack */
 
 	if (!rp->context) {
@@ -4200,8 +4774,10 @@ bad_resize:	;
 		    !(txn_rl_args->lflags & DB_TXN_SCHEMA_LOCK)) ||
 		F_ISSET(rctl, DB_LOG_REP_ACK))
 	    ) {
-		/* got all the locks.  ack back early */
-		comdb2_early_ack(dbenv, maxlsn, *commit_gen);
+		/* got all the locks.  ack back early, unless a parked
+		 * transaction still hasn't got its own */
+		if (!deps || !rep_deps_hold_ack(&maxlsn, *commit_gen))
+			comdb2_early_ack(dbenv, maxlsn, *commit_gen);
 	}
 
 	if (txn_rl_args)
@@ -4225,9 +4801,8 @@ bad_resize:	;
 	/* Phase 1.  Get a list of the LSNs in this transaction, and sort it. */
 	/* Had serializable records means the transaction has a record type that requires
 	 * this transaction to be processed serially. */
-	had_serializable_records = 0;
-	if ((ret = __rep_collect_txn_txnid(dbenv, &prev_lsn, &rp->lc,
-		    &had_serializable_records, rp, txnid)) != 0) {
+	if (!collected && (ret = __rep_collect_txn_txnid(dbenv, &prev_lsn,
+		    &rp->lc, &had_serializable_records, rp, txnid)) != 0) {
 #if defined ABORT_ON_CONCURRENT_ERROR
 		abort();
 #else
@@ -4277,6 +4852,8 @@ bad_resize:	;
 		    commit_gen, lockid, rp, &rp->lc);
 
 		reset_recovery_processor(rp);
+		if (rp->deps_mode)
+			rep_deps_forget(rp);
 		pthread_mutex_lock(&dbenv->recover_lk);
 		listc_abl(&dbenv->inactive_transactions, rp);
 		pthread_mutex_unlock(&dbenv->recover_lk);
@@ -4346,9 +4923,13 @@ bad_resize:	;
 			rp->has_schema_lock = 1;
 	}
 
-	pthread_mutex_lock(&dbenv->recover_lk);
-	listc_abl(&dbenv->inflight_transactions, rp);
-	pthread_mutex_unlock(&dbenv->recover_lk);
+	if (deps)
+		rep_deps_note_inflight(dbenv, rp);
+	else {
+		pthread_mutex_lock(&dbenv->recover_lk);
+		listc_abl(&dbenv->inflight_transactions, rp);
+		pthread_mutex_unlock(&dbenv->recover_lk);
+	}
 
 	thdpool_enqueue(dbenv->recovery_processors, processor_thd, rp, 0, NULL);
 
@@ -4388,6 +4969,8 @@ err:
 	}
 
 	reset_recovery_processor(rp);
+	if (rp->deps_mode)
+		rep_deps_forget(rp);
 
 	pthread_mutex_lock(&dbenv->recover_lk);
 	listc_abl(&dbenv->inactive_transactions, rp);
@@ -656,6 +656,7 @@ struct cdb2_hndl {
     int first_record_read;
     char **commands;
     int ack;
+    int n_pipelined; /* submitted with cdb2_submit, not yet received */
     int is_hasql;
     int clear_snap_line;
     int debug_trace;
@@ -1567,7 +1568,8 @@ static int newsql_disconnect(cdb2_hndl_tp *hndl, SBUF2 *sb, int line)
     if ((hndl->firstresponse &&
          (!hndl->lastresponse ||
           (hndl->lastresponse->response_type != RESPONSE_TYPE__LAST_ROW))) ||
-        (!hndl->firstresponse) || hndl->in_trans) {
+        (!hndl->firstresponse) || hndl->in_trans || hndl->n_pipelined) {
+        /* results still on the wire; don't hand this socket to the pool */
         sbuf2close(sb);
     } else {
         sbuf2free(sb);
@@ -1576,6 +1578,7 @@ static int newsql_disconnect(cdb2_hndl_tp *hndl, SBUF2 *sb, int line)
     }
     hndl->use_hint = 0;
     hndl->sb = NULL;
+    hndl->n_pipelined = 0;
     return 0;
 }
 
@@ -3788,6 +3791,170 @@ static char *cdb2_type_str(int type)
     }
 }
 
+/* Pipelining: cdb2_submit() sends a statement and returns without waiting
+   for the server.  The server runs statements on a connection one after the
+   other, so results come back in submission order; cdb2_receive() moves the
+   handle onto the next one, after which the usual cdb2_next_record() and
+   cdb2_column_* calls apply.  Pipelined statements are never retried: if the
+   connection is lost every outstanding statement fails and the caller has to
+   resubmit.  Outside a transaction the server hangs up after a statement
+   fails, so an error also ends the pipeline.  Transactions and 'set' commands change handle state, so they
+   still go through cdb2_run_statement(). */
+int cdb2_submit(cdb2_hndl_tp *hndl, const char *sql)
+{
+    int rc;
+
+    pthread_once(&init_once, do_init_once);
+
+    while (sql && isspace(*sql))
+        sql++;
+
+    if (sql == NULL || *sql == '\0') {
+        sprintf(hndl->errstr, "%s: Empty statement", __func__);
+        PRINT_RETURN(CDB2ERR_BADSTATE);
+    }
+
+    if (hndl->in_trans || hndl->is_hasql || strncasecmp(sql, "set", 3) == 0 ||
+        strncasecmp(sql, "begin", 5) == 0 ||
+        strncasecmp(sql, "commit", 6) == 0 ||
+        strncasecmp(sql, "rollback", 8) == 0) {
+        sprintf(hndl->errstr, "%s: Statement can't be pipelined", __func__);
+        PRINT_RETURN(CDB2ERR_BADSTATE);
+    }
+
+#if WITH_SSL
+    if (hndl->sslerr != 0)
+        PRINT_RETURN(CDB2ERR_CONNECT_ERROR);
+#endif
+
+    /* Nothing can be in flight without a connection, so a fresh one loses
+       nothing. */
+    if (hndl->sb == NULL && cdb2_connect_sqlhost(hndl) != 0) {
+        sprintf(hndl->errstr, "%s: Cannot connect to db", __func__);
+        PRINT_RETURN(CDB2ERR_CONNECT_ERROR);
+    }
+
+    clear_snapshot_info(hndl, __LINE__);
+    hndl->is_retry = 0;
+    make_random_str(hndl->cnonce, &hndl->cnonce_len);
+
+    rc = cdb2_send_query(hndl, hndl->sb, hndl->dbname, (char *)sql,
+                         hndl->num_set_commands, hndl->num_set_commands_sent,
+                         hndl->commands, hndl->n_bindvars, hndl->bindvars, 0,
+                         NULL, 0, 0, 0, 0, __LINE__);
+    if (rc != 0) {
+        int lost = hndl->n_pipelined;
+        newsql_disconnect(hndl, hndl->sb, __LINE__);
+        snprintf(hndl->errstr, sizeof(hndl->errstr),
+                 "%s: Can't send query to the db, %d pipelined statement(s) "
+                 "lost",
+                 __func__, lost);
+        PRINT_RETURN(CDB2ERR_TRAN_IO_ERROR);
+    }
+
+    /* The server keeps set commands for the life of the connection. */
+    hndl->num_set_commands_sent = hndl->num_set_commands;
+    hndl->n_pipelined++;
+
+    if (log_calls)
+        fprintf(stderr, "%p> cdb2_submit(%p, \"%s\") = 0 pending %d\n",
+                (void *)pthread_self(), hndl, sql, hndl->n_pipelined);
+    return 0;
+}
+
+int cdb2_receive(cdb2_hndl_tp *hndl)
+{
+    int rc;
+    int len;
+    int type = 0;
+
+    pthread_once(&init_once, do_init_once);
+
+    /* Whatever is left of the current result set is ahead of ours. */
+    while (cdb2_next_record_int(hndl, 0) == CDB2_OK)
+        ;
+
+    clear_responses(hndl);
+    hndl->rows_read = 0;
+    hndl->first_record_read = 0;
+
+    if (hndl->n_pipelined == 0 || hndl->sb == NULL) {
+        hndl->n_pipelined = 0;
+        sprintf(hndl->errstr, "%s: No statement pending", __func__);
+        PRINT_RETURN(CDB2ERR_BADSTATE);
+    }
+
+    rc = cdb2_read_record(hndl, &hndl->first_buf, &len, &type);
+
+    /* A redirect or an ssl upgrade would mean reconnecting, and everything
+       queued behind this statement went to the old connection. */
+    if (rc == 0 && hndl->first_buf != NULL &&
+        type != RESPONSE_HEADER__DBINFO_RESPONSE &&
+        type != RESPONSE_HEADER__SQL_RESPONSE_SSL) {
+        hndl->firstresponse =
+            cdb2__sqlresponse__unpack(NULL, len, hndl->first_buf);
+    }
+    if (hndl->firstresponse == NULL) {
+        int lost = hndl->n_pipelined;
+        newsql_disconnect(hndl, hndl->sb, __LINE__);
+        snprintf(hndl->errstr, sizeof(hndl->errstr),
+                 "%s: Can't read response from the db, %d pipelined "
+                 "statement(s) lost",
+                 __func__, lost);
+        PRINT_RETURN(CDB2ERR_TRAN_IO_ERROR);
+    }
+
+    hndl->n_pipelined--;
+
+    if (hndl->firstresponse->response_type != RESPONSE_TYPE__COLUMN_NAMES) {
+        sprintf(hndl->errstr, "%s: Unknown response type %d", __func__,
+                hndl->firstresponse->response_type);
+        newsql_disconnect(hndl, hndl->sb, __LINE__);
+        PRINT_RETURN(-1);
+    }
+
+    if (hndl->firstresponse->error_code)
+        PRINT_RETURN(cdb2_convert_error_code(hndl->firstresponse->error_code));
+
+    /* Same as cdb2_run_statement: read ahead the first row. */
+    rc = cdb2_next_record_int(hndl, 0);
+    if (rc == CDB2_OK || rc == CDB2_OK_DONE)
+        rc = 0;
+    else
+        rc = cdb2_convert_error_code(rc);
+
+    if (log_calls)
+        fprintf(stderr, "%p> cdb2_receive(%p) = %d pending %d\n",
+                (void *)pthread_self(), hndl, rc, hndl->n_pipelined);
+    return rc;
+}
+
+int cdb2_pending(cdb2_hndl_tp *hndl)
+{
+    return hndl->n_pipelined;
+}
+
+int cdb2_socket(cdb2_hndl_tp *hndl)
+{
+    return hndl->sb ? sbuf2fileno(hndl->sb) : -1;
+}
+
+/* Buffered bytes never wake up poll(), so check here before sleeping on
+   cdb2_socket(). */
+int cdb2_ready(cdb2_hndl_tp *hndl)
+{
+    struct pollfd pfd;
+
+    if (hndl->sb == NULL)
+        return 0;
+    if (sbuf2pending(hndl->sb) > 0)
+        return 1;
+    pfd.fd = sbuf2fileno(hndl->sb);
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    return poll(&pfd, 1, 0) > 0;
+}
+
 int cdb2_run_statement_typed(cdb2_hndl_tp *hndl, const char *sql, int ntypes,
                              int *types)
 {
@@ -3795,6 +3962,10 @@ int cdb2_run_statement_typed(cdb2_hndl_tp *hndl, const char *sql, int ntypes,
 
     pthread_once(&init_once, do_init_once);
 
+    /* Results of pipelined statements are ahead of ours; discard them. */
+    while (hndl->n_pipelined > 0)
+        cdb2_receive(hndl);
+
     if (hndl->temp_trans && hndl->in_trans) {
         cdb2_run_statement_typed_int(hndl, "rollback", 0, NULL, __LINE__);
     }
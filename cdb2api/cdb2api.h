@@ -203,6 +203,13 @@ int cdb2_run_statement(cdb2_hndl_tp *hndl, const char *sql);
 int cdb2_run_statement_typed(cdb2_hndl_tp *hndl, const char *sql, int ntypes,
                              int *types);
 
+/* Pipelined statements; results are received in submission order. */
+int cdb2_submit(cdb2_hndl_tp *hndl, const char *sql);
+int cdb2_receive(cdb2_hndl_tp *hndl);
+int cdb2_pending(cdb2_hndl_tp *hndl);
+int cdb2_socket(cdb2_hndl_tp *hndl);
+int cdb2_ready(cdb2_hndl_tp *hndl);
+
 int cdb2_numcolumns(cdb2_hndl_tp *hndl);
 const char *cdb2_column_name(cdb2_hndl_tp *hndl, int col);
 int cdb2_column_type(cdb2_hndl_tp *hndl, int col);
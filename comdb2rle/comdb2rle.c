@@ -234,6 +234,88 @@ static uint32_t space_reqd(uint32_t r, uint32_t s)
            (s > 1 ? (varint_need(s) + s) : s);
 }
 
+/* Length of the common prefix of a and b.  When looking for runs b is a
+ * shifted by the pattern size, so the two overlap and the comparison has to
+ * go front to back. */
+static size_t match_len_scalar(const uint8_t *a, const uint8_t *b, size_t n)
+{
+    size_t i = 0;
+#ifndef _SUN_SOURCE
+    for (; i + sizeof(uint64_t) <= n; i += sizeof(uint64_t)) {
+        uint64_t x, y;
+        memcpy(&x, a + i, sizeof(x));
+        memcpy(&y, b + i, sizeof(y));
+        if (x != y)
+            break;
+    }
+#endif
+    while (i < n && a[i] == b[i])
+        ++i;
+    return i;
+}
+
+#if defined(__x86_64__) && !defined(_SUN_SOURCE)
+#define CRLE_SIMD
+#include <immintrin.h>
+
+static size_t match_len_sse2(const uint8_t *a, const uint8_t *b, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+        __m128i y = _mm_loadu_si128((const __m128i *)(b + i));
+        unsigned ne = _mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) ^ 0xffff;
+        if (ne)
+            return i + __builtin_ctz(ne);
+    }
+    return i + match_len_scalar(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static size_t match_len_avx2(const uint8_t *a, const uint8_t *b, size_t n)
+{
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i *)(b + i));
+        unsigned ne = ~(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y));
+        if (ne)
+            return i + __builtin_ctz(ne);
+    }
+    return i + match_len_sse2(a + i, b + i, n - i);
+}
+#endif
+
+typedef size_t (*match_len_t)(const uint8_t *, const uint8_t *, size_t);
+static size_t match_len_first(const uint8_t *, const uint8_t *, size_t);
+static match_len_t match_len = match_len_first;
+
+void comdb2rle_init(int v)
+{
+    match_len_t fn = match_len_scalar;
+    const char *name = "scalar";
+#ifdef CRLE_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        fn = match_len_avx2;
+        name = "avx2";
+    } else {
+        fn = match_len_sse2;
+        name = "sse2";
+    }
+#endif
+    match_len = fn;
+    if (v)
+        fprintf(stderr, "comdb2rle run scanner = %s\n", name);
+}
+
+/* Callers that never ran comdb2rle_init() land here once */
+static size_t match_len_first(const uint8_t *a, const uint8_t *b, size_t n)
+{
+    comdb2rle_init(0);
+    return match_len(a, b, n);
+}
+
 /* Check if 'sz' bytes repeat */
 static uint32_t repeats(Data in, uint32_t sz, uint32_t *r_)
 {
@@ -241,56 +323,10 @@ static uint32_t repeats(Data in, uint32_t sz, uint32_t *r_)
     r = *r_ = 0;
     if (in.sz < (sz * 2))
         return 0;
-    uint8_t *bp, *bx, bt;
-    uint16_t *wp, word;
-    switch (sz) {
-    case 1:
-        bt = *in.dt;        // 1st byte
-        bp = in.dt + sz;    // byte ptr
-        bx = in.dt + in.sz; // byte ptr max
-#ifndef _SUN_SOURCE
-        if (in.sz > 16) {
-            size_t qz = in.sz - in.sz % 8; // # of quads
-            uint64_t qw;
-            memset(&qw, bt, sizeof(qw));             // 1st quad
-            uint64_t *qp = (uint64_t *)in.dt;        // quad ptr
-            uint64_t *qx = (uint64_t *)(in.dt + qz); // quad ptr max
-            while (qp < qx && *qp == qw)
-                ++qp;
-            if ((uint8_t *)qp != in.dt) {
-                if (qp < qx) // last quad != 1st
-                    --qp;
-                bp = (uint8_t *)qp;
-            }
-        }
-#endif
-        // check remainder byte at a time
-        while (bp < bx && *bp == bt)
-            ++bp;
-        r = bp - in.dt - 1;
-        break;
-#ifndef _SUN_SOURCE
-    case 2:
-        word = *(uint16_t *)in.dt;
-        wp = (uint16_t *)(in.dt + sz);
-        in.sz -= (in.sz % sz);
-        while ((in.sz -= sz) != 0 && word == *wp) {
-            ++wp;
-            ++r;
-        }
-        break;
-#endif
-    default:
-        bp = in.dt + sz;
-        in.sz -= (in.sz % sz);
-        while ((in.sz -= sz) != 0) {
-            if (memcmp(in.dt, bp, sz))
-                break;
-            bp += sz;
-            ++r;
-        }
-        break;
-    }
+    /* The pattern repeats k times iff each of the first k * sz bytes matches
+     * the byte sz after it.  Only whole copies count. */
+    size_t n = in.sz - (in.sz % sz) - sz;
+    r = match_len(in.dt, in.dt + sz, n) / sz;
     *r_ = r;
     return r;
 }
@@ -299,6 +335,14 @@ static uint32_t repeats(Data in, uint32_t sz, uint32_t *r_)
 static int well_known(uint8_t *d, uint32_t s, uint32_t *w)
 {
     *w = MAXPAT;
+    /* Lead bytes of patterns[] (they are part of the on-disk format and
+     * never change).  Skips the table walk for most ordinary data. */
+    switch (*d) {
+    case 0x00: case 0x02: case 0x08: case 0x30:
+        break;
+    default:
+        return 0;
+    }
     for (uint32_t i = 0; i < MAXPAT; ++i) {
         if (s == psizes[i])
             if (memcmp(d, patterns[i], psizes[i]) == 0) {
@@ -536,6 +580,17 @@ int decompressComdb2RLE(Comdb2RLE *d)
             memset(output.dt, *p, r);
             output.dt += r;
             output.sz -= r;
+        } else if (r > 3) {
+            /* lay down one copy and keep doubling it */
+            uint32_t have = s;
+            memcpy(output.dt, p, s);
+            while (have < reqd) {
+                uint32_t n = reqd - have < have ? reqd - have : have;
+                memcpy(output.dt + have, output.dt, n);
+                have += n;
+            }
+            output.dt += reqd;
+            output.sz -= reqd;
         } else
             for (uint32_t i = 0; i <= r; ++i) {
                 switch (s) {
@@ -571,13 +626,25 @@ int decompressComdb2RLE(Comdb2RLE *d)
  * r: output param */
 static int repeats_rev(const Data *input, uint32_t sz, uint32_t *r)
 {
-    uint8_t *first = input->dt - 1; //sentinal -- one before first
-    uint8_t *last = first + sz;
-    uint8_t b = *last--;
-    uint32_t dups = 0;
-    while (last != first && b == *last--) {
-        ++dups;
+    const uint8_t *dt = input->dt;
+    uint8_t b = dt[sz - 1];
+    uint32_t n = sz - 1; // bytes before the last one
+#ifdef CRLE_SIMD
+    __m128i bb = _mm_set1_epi8(b);
+    while (n >= 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(dt + n - 16));
+        unsigned ne = _mm_movemask_epi8(_mm_cmpeq_epi8(x, bb)) ^ 0xffff;
+        if (ne) {
+            // keep everything after the last mismatch
+            n = n - 16 + (32 - __builtin_clz(ne));
+            break;
+        }
+        n -= 16;
     }
+#endif
+    while (n && dt[n - 1] == b)
+        --n;
+    uint32_t dups = sz - 1 - n;
     *r = dups;
     return dups;
 }
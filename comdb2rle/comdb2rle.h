@@ -33,4 +33,8 @@ int compressComdb2RLE(Comdb2RLE *);
 int compressComdb2RLE_hints(Comdb2RLE *, uint16_t *);
 int decompressComdb2RLE(Comdb2RLE *);
 
+/* Pick the fastest run scanner this cpu supports.  Optional: the first
+** compress does it otherwise. */
+void comdb2rle_init(int v);
+
 #endif
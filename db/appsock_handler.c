@@ -39,6 +39,8 @@
 #include <strings.h>
 #include <pthread.h>
 #include <time.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
 
 #include <segstr.h>
 #include <machpthread.h>
@@ -49,6 +51,7 @@
 #include <memory_sync.h>
 
 #include <sbuf2.h>
+#include <ssl_io.h>
 #include <bdb_api.h>
 
 #include "util.h"
@@ -192,10 +195,264 @@ int appsock_init(void)
     return 0;
 }
 
+/* Idle newsql connections.  Between queries a connection that is not in a
+ * transaction is handed to a single epoll thread instead of keeping an
+ * appsock thread blocked in sbuf2read.  The epoll thread peeks at the socket
+ * and only queues the connection back to the appsock pool once a whole
+ * CDB2_QUERY frame has arrived (or the peer hung up, or it went idle for
+ * longer than max_sql_idle_time). */
+int gbl_newsql_park_idle = 0;
+
+/* frames bigger than this are dispatched as soon as the header is in */
+#define PARK_MAX_FRAME (64 * 1024)
+/* idle timeouts handed back per sweep */
+#define NPARKEXP 64
+
+struct appsock_parked {
+    SBUF2 *sb;
+    struct sqlclntstate *clnt;
+    int fd;
+    int ssl;
+    int action;
+    int parked_at;
+    uint64_t ready_us;
+    LINKC_T(struct appsock_parked) lnk;
+};
+
+static pthread_once_t park_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t park_lk = PTHREAD_MUTEX_INITIALIZER;
+static LISTC_T(struct appsock_parked) parked;
+static int park_epfd = -1;
+static unsigned long long park_resumes = 0;
+static unsigned long long park_timeouts = 0;
+static unsigned long long park_dispatch_us = 0;
+static unsigned long long park_dispatch_max_us = 0;
+
+static uint64_t park_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void appsock_resume_pp(struct thdpool *pool, void *work, void *thddata,
+                              int op)
+{
+    struct appsock_parked *p = work;
+    struct appsock_thd_state *state = thddata;
+    uint64_t lat;
+
+    switch (op) {
+    case THD_RUN:
+        lat = park_now_us() - p->ready_us;
+        LOCK(&park_lk)
+        {
+            if (p->action == NEWSQL_RESUME) {
+                park_resumes++;
+                park_dispatch_us += lat;
+                if (lat > park_dispatch_max_us)
+                    park_dispatch_max_us = lat;
+            }
+        }
+        UNLOCK(&park_lk);
+
+        thrman_change_type(state->thr_self, THRTYPE_APPSOCK_SQL);
+        thrman_setfd(state->thr_self, p->fd);
+        newsql_resume(state->thr_self, p->clnt, p->action);
+        thrman_setfd(state->thr_self, -1);
+        thrman_where(state->thr_self, NULL);
+        thrman_change_type(state->thr_self, THRTYPE_APPSOCK_POOL);
+        break;
+
+    case THD_FREE:
+        newsql_resume(NULL, p->clnt, NEWSQL_DROP);
+        break;
+
+    default:
+        abort();
+    }
+    free(p);
+}
+
+static void appsock_park_dispatch(struct appsock_parked *p, int action,
+                                  uint64_t now_us)
+{
+    epoll_ctl(park_epfd, EPOLL_CTL_DEL, p->fd, NULL);
+    LOCK(&park_lk)
+    {
+        listc_rfl(&parked, p);
+        if (action == NEWSQL_IDLE_TIMEOUT)
+            park_timeouts++;
+    }
+    UNLOCK(&park_lk);
+
+    p->action = action;
+    p->ready_us = now_us;
+    if (thdpool_enqueue(gbl_appsock_thdpool, appsock_resume_pp, p, 0, NULL) !=
+        0) {
+        logmsg(LOGMSG_ERROR, "%s: thdpool_enqueue error, dropping fd %d\n",
+               __func__, p->fd);
+        newsql_resume(NULL, p->clnt, NEWSQL_DROP);
+        free(p);
+    }
+}
+
+/* Is a whole request waiting in the socket?  A sockpool reset may precede
+   the query it is sent with. */
+static int appsock_park_ready(struct appsock_parked *p, uint32_t events)
+{
+    struct newsqlheader hdr[2];
+    int avail, npeek, off = 0;
+
+    if (events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP))
+        return 1;
+    /* can't see through ssl; go on any input */
+    if (p->ssl)
+        return 1;
+    if (ioctl(p->fd, FIONREAD, &avail) != 0)
+        return 1;
+    if (avail < sizeof(struct newsqlheader))
+        return 0;
+
+    npeek = avail < sizeof(hdr) ? avail : sizeof(hdr);
+    if (recv(p->fd, hdr, npeek, MSG_PEEK | MSG_DONTWAIT) != npeek)
+        return 1;
+
+    if (ntohl(hdr[0].type) == FSQL_RESET) {
+        if (npeek < sizeof(hdr))
+            return 0;
+        off = 1;
+    }
+    /* anything but a query is read_newsql_query's business */
+    int type = ntohl(hdr[off].type);
+    if (type <= 0 || type > 2)
+        return 1;
+    int len = ntohl(hdr[off].length);
+    if (len <= 0 || len > PARK_MAX_FRAME)
+        return 1;
+    return avail >= (off + 1) * (int)sizeof(struct newsqlheader) + len;
+}
+
+static void *appsock_park_thd(void *arg)
+{
+    struct epoll_event ev[64];
+    struct appsock_parked *p, *expired[NPARKEXP];
+    int n, nexp, now, idle, last_sweep = 0;
+
+    thrman_register(THRTYPE_APPSOCK);
+    thread_started("appsock park");
+
+    while (!gbl_exit) {
+        n = epoll_wait(park_epfd, ev, sizeof(ev) / sizeof(ev[0]), 1000);
+        if (n < 0 && errno != EINTR) {
+            logmsg(LOGMSG_ERROR, "%s: epoll_wait errno %d\n", __func__, errno);
+            sleep(1);
+            continue;
+        }
+        uint64_t now_us = park_now_us();
+        for (int i = 0; i < n; i++) {
+            p = ev[i].data.ptr;
+            if (appsock_park_ready(p, ev[i].events)) {
+                appsock_park_dispatch(p, NEWSQL_RESUME, now_us);
+            } else {
+                /* partial frame; wait for the rest */
+                ev[i].events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+                if (epoll_ctl(park_epfd, EPOLL_CTL_MOD, p->fd, &ev[i]))
+                    appsock_park_dispatch(p, NEWSQL_RESUME, now_us);
+            }
+        }
+
+        now = time_epoch();
+        if (now == last_sweep)
+            continue;
+        last_sweep = now;
+        idle = bdb_attr_get(thedb->bdb_attr, BDB_ATTR_MAX_SQL_IDLE_TIME);
+        if (idle <= 0)
+            continue;
+        /* oldest first; anything past the batch goes on the next sweep */
+        nexp = 0;
+        LOCK(&park_lk)
+        {
+            LISTC_FOR_EACH(&parked, p, lnk)
+            {
+                if (now - p->parked_at <= idle || nexp == NPARKEXP)
+                    break;
+                expired[nexp++] = p;
+            }
+        }
+        UNLOCK(&park_lk);
+        for (int i = 0; i < nexp; i++)
+            appsock_park_dispatch(expired[i], NEWSQL_IDLE_TIMEOUT, now_us);
+    }
+
+    thrman_unregister();
+    return NULL;
+}
+
+static void appsock_park_init(void)
+{
+    pthread_t tid;
+
+    listc_init(&parked, offsetof(struct appsock_parked, lnk));
+    park_epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (park_epfd < 0) {
+        logmsg(LOGMSG_ERROR, "%s: epoll_create1 errno %d\n", __func__, errno);
+        return;
+    }
+    if (pthread_create(&tid, &gbl_pthread_attr_detached, appsock_park_thd,
+                       NULL) != 0) {
+        logmsg(LOGMSG_ERROR, "%s: pthread_create failed\n", __func__);
+        close(park_epfd);
+        park_epfd = -1;
+    }
+}
+
+/* Returns 0 if the connection now belongs to the epoll thread. */
+int appsock_park_newsql(SBUF2 *sb, struct sqlclntstate *clnt)
+{
+    struct appsock_parked *p;
+    struct epoll_event ev;
+
+    pthread_once(&park_once, appsock_park_init);
+    if (park_epfd < 0 || gbl_exit)
+        return -1;
+
+    p = malloc(sizeof(struct appsock_parked));
+    if (p == NULL)
+        return -1;
+    p->sb = sb;
+    p->clnt = clnt;
+    p->fd = sbuf2fileno(sb);
+    p->ssl = sslio_has_ssl(sb);
+    p->parked_at = time_epoch();
+
+    /* on the list before the fd is armed: the epoll thread owns it after */
+    LOCK(&park_lk) { listc_abl(&parked, p); }
+    UNLOCK(&park_lk);
+
+    ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+    ev.data.ptr = p;
+    if (epoll_ctl(park_epfd, EPOLL_CTL_ADD, p->fd, &ev) != 0) {
+        LOCK(&park_lk) { listc_rfl(&parked, p); }
+        UNLOCK(&park_lk);
+        free(p);
+        return -1;
+    }
+    return 0;
+}
+
 void appsock_quick_stat(void)
 {
     logmsg(LOGMSG_USER, "num appsock connections %llu\n", total_appsock_conns);
     logmsg(LOGMSG_USER, "num active appsock connections %d\n", active_appsock_conns);
+    if (park_epfd >= 0) {
+        int nparked;
+        LOCK(&park_lk) { nparked = listc_size(&parked); }
+        UNLOCK(&park_lk);
+        logmsg(LOGMSG_USER, "  idle (parked) newsql connections %d\n", nparked);
+        logmsg(LOGMSG_USER, "  busy appsock connections %d\n",
+               active_appsock_conns - nparked);
+    }
     logmsg(LOGMSG_USER, "num appsock commands    %llu\n", total_toks);
 }
 
@@ -205,6 +462,21 @@ void appsock_stat(void)
     appsock_quick_stat();
     logmsg(LOGMSG_USER, "bad appsock commands    %llu\n", num_bad_toks);
     logmsg(LOGMSG_USER, "rejected appsock conns  %llu\n", total_appsock_rejections);
+    if (park_epfd >= 0) {
+        unsigned long long resumes, timeouts, lat, maxlat;
+        LOCK(&park_lk)
+        {
+            resumes = park_resumes;
+            timeouts = park_timeouts;
+            lat = park_dispatch_us;
+            maxlat = park_dispatch_max_us;
+        }
+        UNLOCK(&park_lk);
+        logmsg(LOGMSG_USER, "parked newsql resumes   %llu\n", resumes);
+        logmsg(LOGMSG_USER, "parked idle timeouts    %llu\n", timeouts);
+        logmsg(LOGMSG_USER, "dispatch latency        avg %llu us max %llu us\n",
+               resumes ? lat / resumes : 0, maxlat);
+    }
     for (ii = 0; ii < num_commands; ii++) {
         if (commands[ii].num_uses) {
             logmsg(LOGMSG_USER, "  num %-16s  %llu\n", commands[ii].cmd,
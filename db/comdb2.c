@@ -107,6 +107,7 @@ void berk_memp_sync_alarm_ms(int);
 #include <cdb2_constants.h>
 
 #include <crc32c.h>
+#include <comdb2rle.h>
 
 #include "fdb_fend.h"
 #include "fdb_bend.h"
@@ -551,6 +552,8 @@ struct quantize *q_sql_steps_min;
 struct quantize *q_sql_steps_hour;
 struct quantize *q_sql_steps_all;
 
+struct quantize *q_log_group_commit;
+
 extern int gbl_net_lmt_upd_incoherent_nodes;
 extern int gbl_allow_user_schema;
 extern int gbl_skip_cget_in_db_put;
@@ -578,6 +581,7 @@ void set_tzdir(char *dir);
 void free_tzdir();
 
 extern void init_sql_hint_table();
+extern void init_shared_stmts(void);
 extern int bdb_osql_log_repo_init(int *bdberr);
 
 int gbl_use_plan = 1;
@@ -975,6 +979,8 @@ static void init_q_vars()
     q_sql_steps_min = quantize_new(100, 100000, "steps");
     q_sql_steps_hour = quantize_new(100, 100000, "steps");
     q_sql_steps_all = quantize_new(100, 100000, "steps");
+
+    q_log_group_commit = quantize_new(1, 64, "commits");
 }
 
 static void cleanup_q_vars()
@@ -990,6 +996,8 @@ static void cleanup_q_vars()
     quantize_free(q_sql_steps_min);
     quantize_free(q_sql_steps_hour);
     quantize_free(q_sql_steps_all);
+
+    quantize_free(q_log_group_commit);
 }
 
 /* Send an alert about the fact that I'm incoherent */
@@ -2419,6 +2427,7 @@ static struct dbenv *newdbenv(char *dbname, char *lrlname)
 
     tz_hash_init();
     init_sql_hint_table();
+    init_shared_stmts();
 
     dbenv->long_trn_table = hash_init(sizeof(unsigned long long));
 
@@ -5221,6 +5230,7 @@ int main(int argc, char **argv)
     setvbuf(stdout, 0, _IOLBF, 0);
 
     crc32c_init(0);
+    comdb2rle_init(0);
 
     adjust_ulimits();
     sqlite3_tunables_init();
@@ -2475,6 +2475,12 @@ int dbq_consume_genid(struct ireq *, void *trans, int consumer, const genid_t);
 int dbq_get(struct ireq *iq, int consumer, const struct dbq_cursor *prevcursor,
             void **fnddta, size_t *fnddtalen, size_t *fnddtaoff,
             struct dbq_cursor *fndcursor, unsigned int *epoch);
+int dbq_get_batch(struct ireq *iq, int consumer,
+                  const struct dbq_cursor *prevcursor,
+                  unsigned long long maxgenid, int maxitems, void **fnddta,
+                  size_t *fnddtalen, int *nfound);
+int dbq_consume_batch(struct ireq *iq, void *trans, int consumer,
+                      void *const *fnds, int nfnds);
 void dbq_get_item_info(const void *fnd, size_t *dtaoff, size_t *dtalen);
 unsigned long long dbq_item_genid(const void *dta);
 typedef int (*dbq_walk_callback_t)(int consumern, size_t item_length,
@@ -3265,6 +3271,8 @@ struct quantize *q_sql_all;
 struct quantize *q_sql_steps_min;
 struct quantize *q_sql_steps_hour;
 struct quantize *q_sql_steps_all;
+/* commits made durable per log flush */
+extern struct quantize *q_log_group_commit;
 
 extern int gbl_stop_thds_time;
 extern int gbl_stop_thds_time_threshold;
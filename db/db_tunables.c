@@ -58,6 +58,22 @@ extern int gbl_partial_indexes;
 extern int gbl_enable_position_apis;
 extern int gbl_enable_sock_fstsnd;
 extern int gbl_sparse_lockerid_map;
+extern int gbl_sql_decode_plan;
+extern int gbl_tag_convert_plan;
+extern int gbl_osql_prefault_window;
+extern int gbl_osql_bplog_arena;
+extern int gbl_thdpool_lockfree_queue;
+extern int gbl_net_writev;
+extern int gbl_osql_send_batch;
+extern int gbl_osql_send_batch_bytes;
+extern int gbl_rep_apply_page_deps;
+extern int gbl_log_group_commit;
+extern int gbl_log_group_commit_max_us;
+extern int gbl_mpool_numa_bind;
+extern int gbl_newsql_park_idle;
+extern int gbl_fdb_push_projection;
+extern int gbl_fdb_stream_batch_bytes;
+extern int gbl_fdb_stream_flush_ms;
 extern int gbl_spstrictassignments;
 extern int gbl_early;
 extern int gbl_enque_flush_interval_signal;
@@ -81,6 +97,7 @@ extern int gbl_master_swing_osql_verbose;
 extern int gbl_master_swing_sock_restart_sleep;
 extern int gbl_max_lua_instructions;
 extern int gbl_max_sqlcache;
+extern int gbl_max_shared_sqlcache;
 extern int __gbl_max_mpalloc_sleeptime;
 extern int gbl_mem_nice;
 extern int gbl_netbufsz;
@@ -111,6 +128,7 @@ extern int gbl_survive_n_master_swings;
 extern int gbl_test_blob_race;
 extern int gbl_test_scindex_deadlock;
 extern int gbl_berkdb_track_locks;
+extern int gbl_lock_fastpath;
 extern int gbl_udp;
 extern int gbl_update_delete_limit;
 extern int gbl_updategenids;
@@ -124,6 +142,9 @@ extern int gbl_osql_max_throttle_sec;
 extern int diffstat_thresh;
 extern int reqltruncate;
 extern int analyze_max_comp_threads;
+extern int gbl_analyze_comp_ranges;
+extern int gbl_analyze_comp_max_kbps;
+extern int gbl_analyze_sketches;
 extern int analyze_max_table_threads;
 extern int gbl_block_set_commit_genid_trace;
 extern int gbl_debug_high_availability_flag;
@@ -176,6 +197,10 @@ extern int gbl_namemangle_loglevel;
 /* berkdb/rep/rep_record.c */
 extern int max_replication_trans_retries;
 
+/* lua/sp.c */
+extern int gbl_trigger_batch;
+extern int gbl_lua_vm_pool_size;
+
 /* net/net.c */
 extern int explicit_flush_trace;
 
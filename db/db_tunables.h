@@ -42,6 +42,16 @@ REGISTER_TUNABLE("allow_user_schema",
                  "Enable to allow per-user schemas. (Default: off)",
                  TUNABLE_BOOLEAN, &gbl_allow_user_schema, READONLY | NOARG,
                  NULL, NULL, NULL, NULL);
+REGISTER_TUNABLE("analyze_comp_max_kbps",
+                 "Read budget in KB/s shared by all threads sampling index "
+                 "files for analyze; 0 for unlimited. (Default: 0)",
+                 TUNABLE_INTEGER, &gbl_analyze_comp_max_kbps, 0, NULL, NULL,
+                 NULL, NULL);
+REGISTER_TUNABLE("analyze_comp_ranges",
+                 "Number of threads scanning disjoint page ranges of each "
+                 "index file being sampled. (Default: 4)",
+                 TUNABLE_INTEGER, &gbl_analyze_comp_ranges, 0, NULL, NULL,
+                 NULL, NULL);
 REGISTER_TUNABLE("analyze_comp_threads",
                  "Number of thread to use when generating samples for "
                  "computing index statistics. (Default: 10)",
@@ -52,6 +62,12 @@ REGISTER_TUNABLE("analyze_comp_threshold",
                  "scan the entire index. (Default: 104857600)",
                  TUNABLE_INTEGER, &sampling_threshold, READONLY, NULL, NULL,
                  analyze_set_sampling_threshold, NULL);
+REGISTER_TUNABLE("analyze_sketches",
+                 "Build the index statistics of tables over "
+                 "analyze_comp_threshold from streaming sketches of every key "
+                 "rather than from a sample. (Default: off)",
+                 TUNABLE_BOOLEAN, &gbl_analyze_sketches, NOARG, NULL, NULL,
+                 NULL, NULL);
 REGISTER_TUNABLE("analyze_tbl_threads",
                  "Number of threads to go through generated samples when "
                  "generating index statistics. (Default: 5)",
@@ -471,6 +487,22 @@ REGISTER_TUNABLE("exitalarmsec", NULL, TUNABLE_INTEGER, &gbl_exit_alarm_sec,
 REGISTER_TUNABLE("exit_on_internal_failure", NULL, TUNABLE_BOOLEAN,
                  &gbl_exit_on_internal_error, READONLY | NOARG, NULL, NULL,
                  NULL, NULL);
+REGISTER_TUNABLE("fdb_push_projection",
+                 "Ask remote databases only for the columns a table scan "
+                 "reads. (Default: on)",
+                 TUNABLE_BOOLEAN, &gbl_fdb_push_projection, NOARG, NULL, NULL,
+                 NULL, NULL);
+REGISTER_TUNABLE("fdb_stream_batch_bytes",
+                 "Socket buffer size for remote cursors; rows are streamed "
+                 "back in batches of this size. 0 sends one row per "
+                 "write. (Default: 65536)",
+                 TUNABLE_INTEGER, &gbl_fdb_stream_batch_bytes, 0, NULL, NULL,
+                 NULL, NULL);
+REGISTER_TUNABLE("fdb_stream_flush_ms",
+                 "Longest a partial batch of streamed remote rows waits "
+                 "before it is sent. (Default: 10)",
+                 TUNABLE_INTEGER, &gbl_fdb_stream_flush_ms, 0, NULL, NULL,
+                 NULL, NULL);
 REGISTER_TUNABLE("fdbdebg", NULL, TUNABLE_INTEGER, &gbl_fdb_track, READONLY,
                  NULL, NULL, NULL, NULL);
 REGISTER_TUNABLE("fdbtrackhints", NULL, TUNABLE_INTEGER, &gbl_fdb_track_hints,
@@ -592,6 +624,11 @@ REGISTER_TUNABLE("lock_conflict_trace",
                  "Dump count of lock conflicts every second. (Default: off)",
                  TUNABLE_BOOLEAN, &gbl_lock_conflict_trace, NOARG, NULL, NULL,
                  NULL, NULL);
+REGISTER_TUNABLE("lock_fastpath",
+                 "Grant uncontended read page locks from a per-locker cache "
+                 "instead of the lock table. (Default: off)",
+                 TUNABLE_BOOLEAN, &gbl_lock_fastpath, NOARG, NULL, NULL, NULL,
+                 NULL);
 /* TODO(Nirbhay): Merge the following 3 into a single (enum?) tunable. */
 REGISTER_TUNABLE("log_delete_after_backup",
                  "Set log deletion policy to disable log deletion (can be set "
@@ -608,6 +645,17 @@ REGISTER_TUNABLE(
     "Set log deletion policy to delete logs as soon as possible. (Default: 0)",
     TUNABLE_INTEGER, &db->log_delete_age, READONLY | NOARG | INVERSE_VALUE,
     NULL, NULL, NULL, NULL);
+REGISTER_TUNABLE("log_group_commit",
+                 "Let the thread leading a commit flush wait briefly for other "
+                 "committers to share its fsync. The wait adapts to fsync "
+                 "latency and commit rate. (Default: off)",
+                 TUNABLE_BOOLEAN, &gbl_log_group_commit, NOARG, NULL, NULL,
+                 NULL, NULL);
+REGISTER_TUNABLE("log_group_commit_max_us",
+                 "Longest a commit flush will wait for other committers. "
+                 "(Default: 1000)",
+                 TUNABLE_INTEGER, &gbl_log_group_commit_max_us, 0, NULL, NULL,
+                 NULL, NULL);
 REGISTER_TUNABLE("loghist", NULL, TUNABLE_INTEGER, &gbl_loghist,
                  READONLY | NOARG, NULL, NULL, loghist_update, NULL);
 REGISTER_TUNABLE("loghist_verbose", NULL, TUNABLE_BOOLEAN, &gbl_loghist_verbose,
@@ -663,6 +711,11 @@ REGISTER_TUNABLE("max_lua_instructions",
                  "procedure is looping and kill it. (Default: 10000)",
                  TUNABLE_INTEGER, &gbl_max_lua_instructions, READONLY, NULL,
                  NULL, NULL, NULL);
+REGISTER_TUNABLE("lua_vm_pool_size",
+                 "Idle Lua machines kept from closed connections for the next "
+                 "call of the same stored procedure. (Default: 32)",
+                 TUNABLE_INTEGER, &gbl_lua_vm_pool_size, 0, NULL, NULL, NULL,
+                 NULL);
 REGISTER_TUNABLE("max_num_compact_pages_per_txn", NULL, TUNABLE_INTEGER,
                  &gbl_max_num_compact_pages_per_txn, 0, NULL, NULL, NULL, NULL);
 REGISTER_TUNABLE("maxq",
@@ -683,6 +736,11 @@ REGISTER_TUNABLE("max_sqlcache_per_thread",
                  "cache is per-thread). (Default: 10)",
                  TUNABLE_INTEGER, &gbl_max_sqlcache, READONLY, NULL, NULL, NULL,
                  NULL);
+REGISTER_TUNABLE("max_shared_sqlcache",
+                 "Maximum number of compiled statements shared by all sql "
+                 "threads (0 disables). (Default: 0)",
+                 TUNABLE_INTEGER, &gbl_max_shared_sqlcache, READONLY, NULL,
+                 NULL, NULL, NULL);
 REGISTER_TUNABLE("maxt", NULL, TUNABLE_INTEGER, &gbl_maxthreads,
                  READONLY | NOZERO, NULL, NULL, maxt_update, NULL);
 REGISTER_TUNABLE(
@@ -703,6 +761,11 @@ REGISTER_TUNABLE("morecolumns", NULL, TUNABLE_BOOLEAN, &gbl_morecolumns,
                  READONLY | NOARG | READEARLY, NULL, NULL, NULL, NULL);
 REGISTER_TUNABLE("move_deadlock_max_attempt", NULL, TUNABLE_INTEGER,
                  &gbl_move_deadlk_max_attempt, 0, NULL, NULL, NULL, NULL);
+REGISTER_TUNABLE("mpool_numa_bind",
+                 "Spread the buffer pool's cache regions across NUMA nodes and "
+                 "place each region's memory on its node. (Default: off)",
+                 TUNABLE_BOOLEAN, &gbl_mpool_numa_bind, READONLY | NOARG, NULL,
+                 NULL, NULL, NULL);
 REGISTER_TUNABLE("name", NULL, TUNABLE_STRING, &name, DEPRECATED | READONLY,
                  NULL, NULL, NULL, NULL);
 REGISTER_TUNABLE("natural_types", "Same as 'nosurprise'", TUNABLE_BOOLEAN,
@@ -753,6 +816,16 @@ REGISTER_TUNABLE("net_portmux_register_interval",
 REGISTER_TUNABLE("net_throttle_percent", NULL, TUNABLE_INTEGER,
                  &gbl_net_throttle_percent, READONLY, NULL, percent_verify,
                  NULL, NULL);
+REGISTER_TUNABLE("net_writev",
+                 "Send queued network messages with writev rather than "
+                 "copying them through the socket buffer. (Default: on)",
+                 TUNABLE_BOOLEAN, &gbl_net_writev, NOARG, NULL, NULL, NULL,
+                 NULL);
+REGISTER_TUNABLE("newsql_park_idle",
+                 "Hand idle newsql connections to an epoll thread between "
+                 "queries instead of holding an appsock thread. (Default: off)",
+                 TUNABLE_BOOLEAN, &gbl_newsql_park_idle, NOARG, NULL, NULL,
+                 NULL, NULL);
 REGISTER_TUNABLE("nice", "If set, nice() will be called with this "
                          "value to set the database nice level.",
                  TUNABLE_INTEGER, &gbl_nice, READONLY, NULL, NULL, NULL, NULL);
@@ -876,6 +949,12 @@ REGISTER_TUNABLE("osql_bkoff_netsend_lmt", NULL, TUNABLE_INTEGER,
 REGISTER_TUNABLE("osql_blockproc_timeout_sec", NULL, TUNABLE_INTEGER,
                  &gbl_osql_blockproc_timeout_sec, READONLY, NULL, NULL, NULL,
                  NULL);
+REGISTER_TUNABLE("osql_bplog_arena",
+                 "Allocate the memory of osql transaction logs and routed "
+                 "replies on the master from pooled per-thread arenas. "
+                 "(Default: on)",
+                 TUNABLE_BOOLEAN, &gbl_osql_bplog_arena, NOARG, NULL, NULL,
+                 NULL, NULL);
 REGISTER_TUNABLE("osql_heartbeat_alert_time", NULL, TUNABLE_INTEGER,
                  &gbl_osql_heartbeat_alert, READONLY | NOZERO, NULL,
                  osql_heartbeat_alert_time_verify, NULL, NULL);
@@ -893,6 +972,23 @@ REGISTER_TUNABLE("osql_net_poll",
 REGISTER_TUNABLE("osql_net_portmux_register_interval", NULL, TUNABLE_INTEGER,
                  &gbl_osql_net_portmux_register_interval, READONLY, NULL, NULL,
                  NULL, NULL);
+REGISTER_TUNABLE("osql_prefault_window",
+                 "If osqlprefaultthreads is set, prefault the pages for this "
+                 "many ops ahead of the one being applied on the master, "
+                 "instead of as ops arrive. (Default: 0)",
+                 TUNABLE_INTEGER, &gbl_osql_prefault_window, 0, NULL, NULL,
+                 NULL, NULL);
+REGISTER_TUNABLE("osql_send_batch",
+                 "Replicants pack the ops of a transaction into frames of many "
+                 "ops instead of sending one net message per op; the master "
+                 "must understand them. (Default: off)",
+                 TUNABLE_BOOLEAN, &gbl_osql_send_batch, NOARG, NULL, NULL, NULL,
+                 NULL);
+REGISTER_TUNABLE("osql_send_batch_bytes",
+                 "Largest osql op frame sent with osql_send_batch. "
+                 "(Default: 65536)",
+                 TUNABLE_INTEGER, &gbl_osql_send_batch_bytes, 0, NULL, NULL,
+                 NULL, NULL);
 REGISTER_TUNABLE("osqlprefaultthreads",
                  "If set, send prefaulting hints to nodes. (Default: 0)",
                  TUNABLE_INTEGER, &gbl_osqlpfault_threads, READONLY, NULL, NULL,
@@ -990,6 +1086,12 @@ REGISTER_TUNABLE("repchecksum",
                  "checksums. (Default: off)",
                  TUNABLE_BOOLEAN, &gbl_repchecksum, READONLY | NOARG, NULL,
                  NULL, NULL, NULL);
+REGISTER_TUNABLE("rep_apply_page_deps",
+                 "Apply replicated transactions that touch disjoint pages "
+                 "concurrently, ordering only conflicting ones and releasing "
+                 "in commit order. (Default: off)",
+                 TUNABLE_BOOLEAN, &gbl_rep_apply_page_deps, NOARG, NULL, NULL,
+                 NULL, NULL);
 REGISTER_TUNABLE("rep_collect_trace", NULL, TUNABLE_BOOLEAN,
                  &gbl_rep_collect_txn_time, READONLY | NOARG, NULL, NULL, NULL,
                  NULL);
@@ -1099,6 +1201,11 @@ REGISTER_TUNABLE("sqlsortermem", "Maximum amount of memory to be "
                  NULL, NULL);
 REGISTER_TUNABLE("sqlsortermult", NULL, TUNABLE_INTEGER, &gbl_sqlite_sortermult,
                  READONLY, NULL, NULL, NULL, NULL);
+REGISTER_TUNABLE("sql_decode_plan",
+                 "Decode raw table and index columns through a precompiled "
+                 "per-schema plan. (Default: on)",
+                 TUNABLE_BOOLEAN, &gbl_sql_decode_plan, NOARG, NULL, NULL, NULL,
+                 NULL);
 REGISTER_TUNABLE("sql_time_threshold",
                  "Sets the threshold time in ms after which queries are "
                  "reported as running a long time. (Default: 5000 ms)",
@@ -1128,6 +1235,11 @@ REGISTER_TUNABLE("survive_n_master_swings",
                  "master this many times before giving up. (Default: 600)",
                  TUNABLE_INTEGER, &gbl_survive_n_master_swings, READONLY, NULL,
                  NULL, NULL, NULL);
+REGISTER_TUNABLE("tag_convert_plan",
+                 "Convert between server tags through a cached per-schema "
+                 "conversion program. (Default: on)",
+                 TUNABLE_BOOLEAN, &gbl_tag_convert_plan, NOARG, NULL, NULL,
+                 NULL, NULL);
 REGISTER_TUNABLE("temptable_limit",
                  "Set the maximum number of temporary tables the database can "
                  "create. (Default: 8192)",
@@ -1139,6 +1251,11 @@ REGISTER_TUNABLE("test_scindex_deadlock",
                  "Test index on expressions schema change deadlock",
                  TUNABLE_BOOLEAN, &gbl_test_scindex_deadlock, READONLY, NULL,
                  NULL, NULL, NULL);
+REGISTER_TUNABLE("thdpool_lockfree_queue",
+                 "Thread pools queue work on a lock-free ring when all "
+                 "their threads are busy. (Default: off)",
+                 TUNABLE_BOOLEAN, &gbl_thdpool_lockfree_queue,
+                 READONLY | NOARG, NULL, NULL, NULL, NULL);
 REGISTER_TUNABLE("throttlesqloverlog",
                  "On a full queue of SQL requests, dump the current thread "
                  "pool this often (in secs). (Default: 5sec)",
@@ -1151,6 +1268,11 @@ REGISTER_TUNABLE("toblock_net_throttle",
 REGISTER_TUNABLE("track_berk_locks", NULL, TUNABLE_INTEGER,
                  &gbl_berkdb_track_locks, READONLY | NOARG, NULL, NULL, NULL,
                  NULL);
+REGISTER_TUNABLE("trigger_batch",
+                 "Queue events a trigger stored procedure handles per "
+                 "transaction. (Default: 1)",
+                 TUNABLE_INTEGER, &gbl_trigger_batch, NOZERO, NULL, NULL, NULL,
+                 NULL);
 REGISTER_TUNABLE("udp", NULL, TUNABLE_BOOLEAN, &gbl_udp, READONLY | NOARG, NULL,
                  NULL, NULL, NULL);
 REGISTER_TUNABLE("unnatural_types", "Same as 'surprise'", TUNABLE_BOOLEAN,
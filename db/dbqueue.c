@@ -151,6 +151,8 @@ extern int getlclbfpoolwidthbigsnd(void);
 static void *dbqueue_consume_thread(void *arg);
 int consume(struct ireq *iq, const void *fnd, struct consumer *consumer,
             int consumern);
+int consume_batch(struct ireq *iq, void *const *fnds, int nfnds,
+                  struct consumer *consumer, int consumern);
 static int dispatch_item(struct ireq *iq, struct consumer *consumer,
                          const struct dbq_cursor *cursor, void *item);
 static int dispatch_flush(struct ireq *iq, struct consumer *consumer);
@@ -1203,30 +1205,33 @@ static void dbqueue_flush(struct dbtable *db, int consumern)
     }
 
     while (1) {
-        void *item;
-        int rc;
+        void *items[100];
+        size_t lens[100];
+        int nitems, rc;
 
         if (!flush_thread_active) {
             logmsg(LOGMSG_WARN, "Terminating flush operation prematurely\n");
             return;
         }
 
-        rc = dbq_get(&iq, consumern, NULL, (void **)&item, NULL, NULL, NULL,
-                     NULL);
+        rc = dbq_get_batch(&iq, consumern, NULL, 0, 100, items, lens, &nitems);
 
         if (rc != 0) {
             if (rc != IX_NOTFND)
-                logmsg(LOGMSG_ERROR, "Terminating with dbq_get rcode %d\n", rc);
+                logmsg(LOGMSG_ERROR, "Terminating with dbq_get_batch rcode %d\n",
+                       rc);
             break;
         }
 
-        rc = consume(&iq, item, NULL, consumern);
-        free(item);
+        rc = consume_batch(&iq, items, nitems, NULL, consumern);
+        for (int ii = 0; ii < nitems; ii++)
+            free(items[ii]);
         if (rc != 0) {
             logmsg(LOGMSG_ERROR, "Terminating after consume rcode %d\n", rc);
             break;
         }
-        if (++nflush % 100 == 0) {
+        nflush += nitems;
+        if (nflush / 100 != (nflush - nitems) / 100) {
             logmsg(LOGMSG_INFO, "... flushed %d items\n", nflush);
         }
     }
@@ -1654,6 +1659,15 @@ static void *dbqueue_consume_thread(void *arg)
 
 int consume(struct ireq *iq, const void *fnd, struct consumer *consumer,
             int consumern)
+{
+    void *item = (void *)fnd;
+    return consume_batch(iq, &item, 1, consumer, consumern);
+}
+
+/* Consume a batch of items in one transaction.  Items that are already gone
+ * are skipped. */
+int consume_batch(struct ireq *iq, void *const *fnds, int nfnds,
+                  struct consumer *consumer, int consumern)
 {
     const int sleeptime = 1;
     int gotlk = 0;
@@ -1688,17 +1702,16 @@ int consume(struct ireq *iq, const void *fnd, struct consumer *consumer,
                 return -1;
             }
 
-            rc = dbq_consume(iq, trans, consumern, fnd);
+            rc = dbq_consume_batch(iq, trans, consumern, fnds, nfnds);
             if (consumer && consumer->debug)
-                condbgf(consumer, "dbq_consume rc=%d\n", rc);
+                condbgf(consumer, "dbq_consume_batch %d items rc=%d\n", nfnds,
+                        rc);
             if (rc != 0) {
                 trans_abort(iq, trans);
                 if (gotlk)
                     pthread_rwlock_unlock(&gbl_block_qconsume_lock);
                 if (rc == RC_INTERNAL_RETRY)
                     continue;
-                else if (rc == IX_NOTFND)
-                    return 0;
                 else
                     break;
             }
@@ -1719,8 +1732,8 @@ int consume(struct ireq *iq, const void *fnd, struct consumer *consumer,
         }
 
         logmsg(LOGMSG_WARN,
-               "difficulty consuming key from queue '%s' consumer %d\n",
-               iq->usedb->tablename, consumern);
+               "difficulty consuming %d key%s from queue '%s' consumer %d\n",
+               nfnds, nfnds == 1 ? "" : "s", iq->usedb->tablename, consumern);
         if (!consumer)
             sleep(sleeptime);
         else {
@@ -2081,15 +2094,13 @@ static int flush_fstsnd(struct ireq *iq, struct consumer *consumer)
         if (consumer->debug)
             condbgf(consumer, "flush_fstsnd: %d items to consume\n",
                     consumer->numitems);
-        for (ii = 0; ii < consumer->numitems; ii++) {
-            rc =
-                consume(iq, consumer->items[ii], consumer, consumer->consumern);
-            if (rc != 0) {
-                rc = XMIT_NOCONSUME;
-                goto flushed_buffer;
-            }
-            consumer->n_consumed++;
+        rc = consume_batch(iq, consumer->items, consumer->numitems, consumer,
+                           consumer->consumern);
+        if (rc != 0) {
+            rc = XMIT_NOCONSUME;
+            goto flushed_buffer;
         }
+        consumer->n_consumed += consumer->numitems;
     }
 
 flushed_buffer:
@@ -453,6 +453,14 @@ static void eventlog_add_int(cson_object *obj, const struct reqlogger *logger)
     cson_object_set(obj, "host",
                     cson_value_new_string(gbl_mynode, strlen(gbl_mynode)));
 
+    if (logger->origin[0])
+        cson_object_set(obj, "origin", cson_value_new_string(
+                                           logger->origin, strlen(logger->origin)));
+    if (logger->have_client_info) {
+        cson_object_set(obj, "pid", cson_new_int(logger->client_pid));
+        cson_object_set(obj, "tid", cson_new_int(logger->client_tid));
+    }
+
     if (logger->have_fingerprint) {
         char expanded_fp[2 * FINGERPRINTSZ + 1];
         util_tohex(expanded_fp, logger->fingerprint, FINGERPRINTSZ);
@@ -113,7 +113,7 @@ int fdb_svc_cursor_open_sql(char *tid, char *cid, int code_release, int version,
  *
  */
 int fdb_svc_sql_row(SBUF2 *sb, char *cid, char *row, int rowlen, int ret,
-                    int isuuid)
+                    int isuuid, int flush)
 {
     /* NOTE: we assume everything required is embedded in the sqlite row
        including genid and datacopy fields - as generated by select
@@ -127,8 +127,12 @@ int fdb_svc_sql_row(SBUF2 *sb, char *cid, char *row, int rowlen, int ret,
         genid = flibc_htonll(genid);
     }
 
+    /* only a FNDMORE row has another one behind it */
+    if (ret != IX_FNDMORE)
+        flush = 1;
+
     rc = fdb_remcur_send_row(sb, NULL, cid, genid, row, rowlen, NULL, 0, ret,
-                             isuuid);
+                             isuuid, flush);
 
     return rc;
 }
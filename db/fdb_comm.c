@@ -27,6 +27,7 @@
 
 extern int gbl_fdb_track;
 extern int gbl_fdb_track_times;
+extern int gbl_fdb_stream_batch_bytes;
 extern int gbl_time_fdb;
 extern int gbl_notimeouts;
 
@@ -591,7 +592,7 @@ static int _check_code_release(SBUF2 *sb, char *cid, int code_release,
 
         /* we need to send back a rc code */
         rc = fdb_svc_sql_row(sb, cid, errstr, strlen(errstr) + 1, errval,
-                             isuuid);
+                             isuuid, 1);
         if (rc) {
             logmsg(LOGMSG_ERROR, "%s: fdb_send_rc failed rc=%d\n", __func__, rc);
         }
@@ -2967,7 +2968,8 @@ static enum svc_move_types move_type(int type)
 
 int fdb_remcur_send_row(SBUF2 *sb, fdb_msg_t *msg, char *cid,
                         unsigned long long genid, char *data, int datalen,
-                        char *datacopy, int datacopylen, int ret, int isuuid)
+                        char *datacopy, int datacopylen, int ret, int isuuid,
+                        int flush)
 {
     int rc;
     fdb_msg_t lcl_msg;
@@ -2992,7 +2994,7 @@ int fdb_remcur_send_row(SBUF2 *sb, fdb_msg_t *msg, char *cid,
     msg->dr.datacopylen = datacopylen;
     msg->dr.datacopy = datacopy;
 
-    rc = fdb_msg_write_message(sb, msg, 1);
+    rc = fdb_msg_write_message(sb, msg, flush);
 
     if (gbl_fdb_track) {
         fdb_msg_print_message(sb, msg, "sending msg");
@@ -3028,7 +3030,7 @@ int fdb_remcur_cursor_move(SBUF2 *sb, fdb_msg_t *msg, svc_callback_arg_t *arg)
     }
 
     rc = fdb_remcur_send_row(sb, msg, NULL, genid, data, datalen, datacopy,
-                             datacopylen, rc, arg->isuuid);
+                             datacopylen, rc, arg->isuuid, 1);
 
     return rc;
 }
@@ -3087,7 +3089,7 @@ int fdb_remcur_cursor_find(SBUF2 *sb, fdb_msg_t *msg, svc_callback_arg_t *arg)
     }
 
     rc = fdb_remcur_send_row(sb, msg, NULL, genid, data, datalen, datacopy,
-                             datacopylen, rc, arg->isuuid);
+                             datacopylen, rc, arg->isuuid, 1);
 
     return rc;
 }
@@ -3111,6 +3113,10 @@ int fdb_remcur_run_sql(SBUF2 *sb, fdb_msg_t *msg, svc_callback_arg_t *arg)
     start_localrpc = osql_log_time();
     /*fprintf(stderr, "=== Calling appsock %llu\n", start_localrpc);*/
 
+    /* room for a batch of streamed rows */
+    if (gbl_fdb_stream_batch_bytes > 0)
+        sbuf2growbuf(sb, gbl_fdb_stream_batch_bytes);
+
     rc = fdb_appsock_work(cid, clnt, version, flags, sql, sqllen, trim_key,
                           trim_keylen, sb);
     if (rc) {
@@ -3135,7 +3141,7 @@ int fdb_remcur_run_sql(SBUF2 *sb, fdb_msg_t *msg, svc_callback_arg_t *arg)
             clnt->fdb_state.remote_sql_sb, cid,
             clnt->fdb_state.err.errstr, /* the actual row is the errstr */
             strlen(clnt->fdb_state.err.errstr) + 1, clnt->fdb_state.err.errval,
-            arg->isuuid);
+            arg->isuuid, 1);
         if (rc) {
             logmsg(LOGMSG_ERROR, "%s: fdb_send_rc failed rc=%d\n", __func__, rc);
         }
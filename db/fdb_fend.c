@@ -57,6 +57,11 @@ extern int gbl_expressions_indexes;
 
 int gbl_fdb_track = 0;
 int gbl_fdb_track_times = 0;
+int gbl_fdb_push_projection = 1;
+/* remote cursor socket buffer; rows are streamed back in batches this big */
+int gbl_fdb_stream_batch_bytes = 65536;
+/* longest a partial batch waits for more rows before it is flushed */
+int gbl_fdb_stream_flush_ms = 10;
 
 struct fdb_tbl;
 struct fdb;
@@ -1997,6 +2002,10 @@ static int _fdb_remote_reconnect(fdb_t *fdb, SBUF2 **psb, char *host)
     /* we don't want timeouts so we can cache sockets on the source side...  */
     sbuf2settimeout(sb, 0, 0);
 
+    /* read streamed rows a batch at a time */
+    if (gbl_fdb_stream_batch_bytes > 0)
+        sbuf2growbuf(sb, gbl_fdb_stream_batch_bytes);
+
     return FDB_NOERR;
 }
 
@@ -2498,6 +2507,19 @@ static char *_build_run_sql_from_hint(BtCursor *pCur, Mem *m, int ncols,
             using_col_filter = 1;
         } else {
             tableName = fdbc->ent->name;
+
+            /* ship only the columns this scan reads; writers need the whole
+               row */
+            if (gbl_fdb_push_projection && pCur->col_mask &&
+                sqlite3_stmt_readonly((sqlite3_stmt *)pCur->vdbe)) {
+                columnsDesc = sqlite3DescribeTableColumns(
+                    sqlitedb, tableName, fdbc->ent->tbl->fdb->dbname,
+                    pCur->col_mask);
+                if (columnsDesc) {
+                    columnsDescLen = strlen(columnsDesc);
+                    using_col_filter = 1;
+                }
+            }
         }
     }
 
@@ -5309,6 +5309,27 @@ int dbq_consume(struct ireq *iq, void *trans, int consumer, const void *fnd)
     return map_unhandled_bdb_wr_rcode("bdb_queue_consume", bdberr);
 }
 
+int dbq_consume_batch(struct ireq *iq, void *trans, int consumer,
+                      void *const *fnds, int nfnds)
+{
+    int bdberr;
+    void *bdb_handle;
+    bdb_handle = get_bdb_handle_ireq(iq, AUXDB_NONE);
+    if (!bdb_handle)
+        return ERR_NO_AUXDB;
+    iq->gluewhere = "bdb_queue_consume_batch";
+    bdb_queue_consume_batch(bdb_handle, trans, consumer, fnds, nfnds, &bdberr);
+    iq->gluewhere = "bdb_queue_consume_batch done";
+
+    if (bdberr == 0)
+        return 0;
+    if (bdberr == BDBERR_DEADLOCK)
+        return RC_INTERNAL_RETRY;
+    if (bdberr == BDBERR_READONLY)
+        return ERR_NOMASTER;
+    return map_unhandled_bdb_wr_rcode("bdb_queue_consume_batch", bdberr);
+}
+
 int dbq_consume_genid(struct ireq *iq, void *trans, int consumer,
                       const genid_t genid)
 {
@@ -5438,6 +5459,46 @@ retry:
     return rc;
 }
 
+int dbq_get_batch(struct ireq *iq, int consumer,
+                  const struct dbq_cursor *prevcursor,
+                  unsigned long long maxgenid, int maxitems, void **fnddta,
+                  size_t *fnddtalen, int *nfound)
+{
+    int bdberr;
+    void *bdb_handle;
+    int retries = 0;
+    int rc;
+    bdb_handle = get_bdb_handle_ireq(iq, AUXDB_NONE);
+    if (!bdb_handle)
+        return ERR_NO_AUXDB;
+
+retry:
+    iq->gluewhere = "bdb_queue_get_batch";
+    rc = bdb_queue_get_batch(bdb_handle, consumer,
+                             (const struct bdb_queue_cursor *)prevcursor,
+                             maxgenid, maxitems, fnddta, fnddtalen, nfound,
+                             &bdberr);
+    iq->gluewhere = "bdb_queue_get_batch done";
+    if (rc != 0) {
+        if (bdberr == BDBERR_DEADLOCK) {
+            iq->retries++;
+            if (++retries < gbl_maxretries) {
+                n_retries++;
+                poll(0, 0, (rand() % 500 + 10));
+                goto retry;
+            }
+            logmsg(LOGMSG_ERROR, "*ERROR* bdb_queue_get_batch too much contention %d count %d\n",
+                   bdberr, retries);
+            return ERR_INTERNAL;
+        } else if (bdberr == BDBERR_FETCH_DTA ||
+                   bdberr == BDBERR_LOCK_DESIRED) {
+            return IX_NOTFND;
+        }
+        return map_unhandled_bdb_rcode("bdb_queue_get_batch", bdberr, 0);
+    }
+    return rc;
+}
+
 unsigned long long dbq_item_genid(const void *dta)
 {
     return bdb_queue_item_genid(dta);
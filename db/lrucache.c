@@ -30,6 +30,187 @@
 #include <mem_override.h>
 #include <logmsg.h>
 
+/* Concurrent caches keep every entry of a shard on one list in insertion
+ * order.  The head of the list is the clock hand: eviction gives entries that
+ * are in use or were hit since the last pass a second chance at the tail, and
+ * frees the first one that is neither. */
+struct lrucache_shard {
+    pthread_mutex_t lk;
+    hash_t *h;
+    listc_t clock;
+    int maxent;
+    int nused; /* entries with ref > 0 */
+} __attribute__((aligned(64)));
+
+#define LRU_LINK(cache, ent)                                                   \
+    ((struct lrucache_link *)((uintptr_t)(ent) + (cache)->offset))
+
+static struct lrucache_shard *shard_for_key(struct lrucache *cache,
+                                            const void *key)
+{
+    unsigned int hash = cache->hashfunc(key, cache->keysz) * 2654435761U;
+    return &cache->shards[((uint64_t)hash * cache->nshards) >> 32];
+}
+
+struct lrucache *lrucache_init_concurrent(hashfunc_t *hashfunc,
+                                          cmpfunc_t *cmpfunc,
+                                          void (*freefunc)(void *), int offset,
+                                          int keyoff, int keysz, int maxent,
+                                          int nshards)
+{
+    struct lrucache *cache;
+
+    if (nshards < 1)
+        nshards = 1;
+    cache = calloc(1, sizeof(struct lrucache));
+    cache->maxent = maxent;
+    cache->freefunc = freefunc;
+    cache->offset = offset;
+    cache->keyoff = keyoff;
+    cache->keysz = keysz;
+    cache->hashfunc = hashfunc;
+    cache->nshards = nshards;
+    cache->shards = calloc(nshards, sizeof(struct lrucache_shard));
+    for (int i = 0; i < nshards; i++) {
+        struct lrucache_shard *sh = &cache->shards[i];
+        pthread_mutex_init(&sh->lk, NULL);
+        sh->h = hash_init_user(hashfunc, cmpfunc, keyoff, keysz);
+        listc_init(&sh->clock, offset + offsetof(struct lrucache_link, lnk));
+        sh->maxent = (maxent + nshards - 1) / nshards;
+        if (sh->maxent < 1)
+            sh->maxent = 1;
+    }
+    return cache;
+}
+
+static void *shard_find(struct lrucache *cache, void *key)
+{
+    struct lrucache_shard *sh = shard_for_key(cache, key);
+    void *ent;
+
+    pthread_mutex_lock(&sh->lk);
+    ent = hash_find_readonly(sh->h, key);
+    if (ent) {
+        struct lrucache_link *lent = LRU_LINK(cache, ent);
+        if (lent->ref++ == 0)
+            sh->nused++;
+        lent->hits++;
+        lent->referenced = 1;
+    }
+    pthread_mutex_unlock(&sh->lk);
+    return ent;
+}
+
+static int shard_hasentry(struct lrucache *cache, void *key)
+{
+    struct lrucache_shard *sh = shard_for_key(cache, key);
+    void *ent;
+
+    pthread_mutex_lock(&sh->lk);
+    ent = hash_find_readonly(sh->h, key);
+    pthread_mutex_unlock(&sh->lk);
+    return ent != NULL;
+}
+
+/* Free unused entries until fewer than keep remain.  Every entry in use is
+ * counted against keep, so this stops once only those are left. */
+static void shard_evict(struct lrucache *cache, struct lrucache_shard *sh,
+                        int keep)
+{
+    while (sh->clock.count - sh->nused > keep) {
+        void *ent = listc_rtl(&sh->clock);
+        struct lrucache_link *lent = LRU_LINK(cache, ent);
+        if (lent->ref > 0 || lent->referenced) {
+            lent->referenced = 0;
+            listc_abl(&sh->clock, ent);
+            continue;
+        }
+        if (hash_del(sh->h, ent) != 0) {
+            logmsg(LOGMSG_ERROR, "NOT DELETED.\n");
+        } else {
+            cache->freefunc(ent);
+        }
+    }
+}
+
+static void shard_add(struct lrucache *cache, void *item)
+{
+    struct lrucache_shard *sh =
+        shard_for_key(cache, (uint8_t *)item + cache->keyoff);
+    struct lrucache_link *lent = LRU_LINK(cache, item);
+
+    lent->ref = 0;
+    lent->hits = 0;
+    lent->referenced = 0;
+
+    pthread_mutex_lock(&sh->lk);
+    shard_evict(cache, sh, sh->maxent - 1);
+    hash_add(sh->h, item);
+    listc_abl(&sh->clock, item);
+    pthread_mutex_unlock(&sh->lk);
+}
+
+static void shard_release(struct lrucache *cache, void *key)
+{
+    struct lrucache_shard *sh = shard_for_key(cache, key);
+    void *ent;
+
+    pthread_mutex_lock(&sh->lk);
+    ent = hash_find_readonly(sh->h, key);
+    if (ent == NULL) {
+        pthread_mutex_unlock(&sh->lk);
+        logmsg(LOGMSG_ERROR, "releasing key, but not found?\n");
+        return;
+    }
+    int ref = --LRU_LINK(cache, ent)->ref;
+    if (ref == 0)
+        sh->nused--;
+    pthread_mutex_unlock(&sh->lk);
+    if (ref < 0)
+        logmsg(LOGMSG_ERROR, "key released more often than found, ref %d\n",
+               ref);
+}
+
+static void shards_destroy(struct lrucache *cache)
+{
+    int used_count = 0;
+
+    for (int i = 0; i < cache->nshards; i++)
+        used_count += cache->shards[i].nused;
+    if (used_count != 0) {
+        logmsg(LOGMSG_WARN,
+               "trying to destroy cache with in-use entries: %d entries in use\n",
+               used_count);
+        return;
+    }
+
+    for (int i = 0; i < cache->nshards; i++) {
+        struct lrucache_shard *sh = &cache->shards[i];
+        shard_evict(cache, sh, 0);
+        hash_free(sh->h);
+        pthread_mutex_destroy(&sh->lk);
+    }
+    free(cache->shards);
+    free(cache);
+}
+
+static void shards_foreach(struct lrucache *cache,
+                           void (*display)(void *, void *), void *usrptr)
+{
+    for (int i = 0; i < cache->nshards; i++) {
+        struct lrucache_shard *sh = &cache->shards[i];
+        pthread_mutex_lock(&sh->lk);
+        logmsg(LOGMSG_USER, "shard %d: %d entries, %d in use\n", i,
+               sh->clock.count, sh->nused);
+        void *ent = sh->clock.top;
+        while (ent) {
+            display(ent, usrptr);
+            ent = LRU_LINK(cache, ent)->lnk.next;
+        }
+        pthread_mutex_unlock(&sh->lk);
+    }
+}
+
 struct lrucache *lrucache_init(hashfunc_t *hashfunc, cmpfunc_t *cmpfunc,
                                void (*freefunc)(void *), int offset, int keyoff,
                                int keysz, int maxent)
@@ -51,6 +232,9 @@ struct lrucache *lrucache_init(hashfunc_t *hashfunc, cmpfunc_t *cmpfunc,
 
 int lrucache_hasentry(struct lrucache *cache, void *key)
 {
+    if (cache->shards)
+        return shard_hasentry(cache, key);
+
     void *ent = hash_find(cache->h, key);
     if (ent) {
         return 1;
@@ -60,6 +244,9 @@ int lrucache_hasentry(struct lrucache *cache, void *key)
 
 void *lrucache_find(struct lrucache *cache, void *key)
 {
+    if (cache->shards)
+        return shard_find(cache, key);
+
     void *ent = hash_find(cache->h, key);
     if (ent) {
         struct lrucache_link *lent;
@@ -79,6 +266,11 @@ void lrucache_add(struct lrucache *cache, void *item)
     void *ent;
     struct lrucache_link *lent;
 
+    if (cache->shards) {
+        shard_add(cache, item);
+        return;
+    }
+
     lent = (struct lrucache_link *)((uintptr_t)item + cache->offset);
     lent->ref = 0;
     lent->hits = 0;
@@ -112,6 +304,11 @@ void lrucache_destroy(struct lrucache *cache)
     void *ent;
     int used_count;
 
+    if (cache->shards) {
+        shards_destroy(cache);
+        return;
+    }
+
     used_count = cache->used.count;
     if (used_count != 0) {
         logmsg(LOGMSG_WARN, 
@@ -132,11 +329,36 @@ void lrucache_destroy(struct lrucache *cache)
     free(cache);
 }
 
+void lrucache_clear(struct lrucache *cache)
+{
+    void *ent;
+
+    if (cache->shards) {
+        for (int i = 0; i < cache->nshards; i++) {
+            struct lrucache_shard *sh = &cache->shards[i];
+            pthread_mutex_lock(&sh->lk);
+            shard_evict(cache, sh, 0);
+            pthread_mutex_unlock(&sh->lk);
+        }
+        return;
+    }
+
+    while ((ent = listc_rtl(&cache->lru)) != NULL) {
+        hash_del(cache->h, ent);
+        cache->freefunc(ent);
+    }
+}
+
 void lrucache_release(struct lrucache *cache, void *key)
 {
     void *ent;
     struct lrucache_link *lent;
 
+    if (cache->shards) {
+        shard_release(cache, key);
+        return;
+    }
+
     ent = hash_find(cache->h, key);
     if (ent == NULL) {
         logmsg(LOGMSG_ERROR, "releasing key, but not found?\n");
@@ -161,6 +383,11 @@ void lrucache_foreach(struct lrucache *cache, void (*display)(void *, void *),
     void *ent;
     linkc_t *l;
 
+    if (cache->shards) {
+        shards_foreach(cache, display, usrptr);
+        return;
+    }
+
     logmsg(LOGMSG_USER, "%d in lru, %d in used\n", cache->lru.count, cache->used.count);
     hash_dump_stats(cache->h, stdout, NULL);
 
@@ -192,3 +419,25 @@ void lrucache_foreach(struct lrucache *cache, void (*display)(void *, void *),
         ent = l->next;
     }
 }
+
+void lrucache_for(struct lrucache *cache, void (*func)(void *, void *),
+                  void *usrptr)
+{
+    void *ent;
+
+    if (cache->shards) {
+        for (int i = 0; i < cache->nshards; i++) {
+            struct lrucache_shard *sh = &cache->shards[i];
+            pthread_mutex_lock(&sh->lk);
+            for (ent = sh->clock.top; ent; ent = LRU_LINK(cache, ent)->lnk.next)
+                func(ent, usrptr);
+            pthread_mutex_unlock(&sh->lk);
+        }
+        return;
+    }
+
+    for (ent = cache->lru.top; ent; ent = LRU_LINK(cache, ent)->lnk.next)
+        func(ent, usrptr);
+    for (ent = cache->used.top; ent; ent = LRU_LINK(cache, ent)->lnk.next)
+        func(ent, usrptr);
+}
@@ -20,6 +20,8 @@
 #include "plhash.h"
 #include "list.h"
 
+struct lrucache_shard;
+
 struct lrucache {
     int maxent;
     void (*freefunc)(void *);
@@ -29,12 +31,17 @@ struct lrucache {
     int keysz;
     listc_t lru;
     listc_t used;
+    /* concurrent caches only; see lrucache_init_concurrent() */
+    hashfunc_t *hashfunc;
+    int nshards;
+    struct lrucache_shard *shards;
 };
 
 struct lrucache_link {
     linkc_t lnk;
     int ref;
     int hits;
+    int referenced; /* concurrent caches: hit since the clock hand last passed */
 };
 
 typedef struct lrucache lrucache;
@@ -43,14 +50,28 @@ typedef struct lrucache_link lrucache_link;
 struct lrucache *lrucache_init(hashfunc_t *hashfunc, cmpfunc_t *cmpfunc,
                                void (*freefunc)(void *), int offset, int keyoff,
                                int keysz, int maxent);
+/* A cache that does its own locking, split into nshards independently locked
+ * shards of maxent/nshards entries each.  Eviction is CLOCK (second chance)
+ * per shard rather than exact LRU, so a hit only sets a flag on the entry
+ * instead of moving it between lists. */
+struct lrucache *lrucache_init_concurrent(hashfunc_t *hashfunc,
+                                          cmpfunc_t *cmpfunc,
+                                          void (*freefunc)(void *), int offset,
+                                          int keyoff, int keysz, int maxent,
+                                          int nshards);
 void *lrucache_find(struct lrucache *cache, void *key);
 
 int lrucache_hasentry(struct lrucache *cache, void *key);
 
 void lrucache_add(struct lrucache *cache, void *item);
 void lrucache_destroy(struct lrucache *cache);
+/* free every entry that isn't currently found (in use) */
+void lrucache_clear(struct lrucache *cache);
 void lrucache_foreach(struct lrucache *cache, void (*display)(void *, void *),
                       void *usrptr);
+/* like lrucache_foreach, but quietly; func must not use the cache */
+void lrucache_for(struct lrucache *cache, void (*func)(void *, void *),
+                  void *usrptr);
 void lrucache_set_maxent(struct lrucache *cache, int maxent);
 void lrucache_release(struct lrucache *cache, void *key);
 
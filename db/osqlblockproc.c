@@ -56,6 +56,8 @@
 #include <assert.h>
 
 #include "comdb2.h"
+#include "comdb2_atomic.h"
+#include "mem.h"
 #include "osqlblockproc.h"
 #include "block_internal.h"
 #include "osqlsession.h"
@@ -69,7 +71,10 @@
 
 
 int g_osql_blocksql_parallel_max = 5;
+int gbl_osql_prefault_window = 0;
+int gbl_osql_bplog_arena = 1;
 extern int gbl_blocksql_grace;
+extern int gbl_osqlpfault_threads;
 
 typedef struct blocksql_info {
     osql_sess_t *sess; /* pointer to the osql session */
@@ -104,8 +109,178 @@ struct blocksql_tran {
     int rows;
 
     struct dbtable *last_db;
+
+    comdb2ma ma; /* arena for allocations that live as long as the bplog */
+    int nallocs;     /* allocations from ma not yet freed */
+    size_t mem_used; /* bytes of them */
+    size_t mem_peak; /* high-water mark of mem_used for this bplog */
 };
 
+/* Bplog arenas are pooled instead of created and destroyed per transaction,
+ * since both of those take the global comdb2ma lock.  Each thread keeps a
+ * few of them; the bplog is usually started by a reader thread and freed by
+ * a block processor, so the surplus of the freeing threads goes to a small
+ * sharded pool that the starting threads draw from.  Each thread also owns
+ * an arena for the transient copies of the replies it routes.
+ */
+#define OSQL_ARENA_THREAD_CACHE 4
+#define OSQL_ARENA_SHARDS 8
+#define OSQL_ARENA_SHARD_CACHE 8
+
+struct osql_arena_cache {
+    comdb2ma rpl; /* arena for reply copies */
+    int shard;    /* home shard in the shared pool */
+    int n;
+    comdb2ma ma[OSQL_ARENA_THREAD_CACHE];
+};
+
+static struct osql_arena_shard {
+    pthread_mutex_t lk;
+    int n;
+    comdb2ma ma[OSQL_ARENA_SHARD_CACHE];
+} osql_arena_pool[OSQL_ARENA_SHARDS];
+
+static pthread_key_t osql_arena_key;
+static pthread_once_t osql_arena_once = PTHREAD_ONCE_INIT;
+static int osql_arena_next_shard;
+
+static void osql_arena_cache_destroy(void *arg)
+{
+    struct osql_arena_cache *cache = arg;
+
+    while (cache->n > 0)
+        comdb2ma_destroy(cache->ma[--cache->n]);
+    if (cache->rpl)
+        comdb2ma_destroy(cache->rpl);
+    free(cache);
+}
+
+static void osql_arena_init_once(void)
+{
+    int i;
+
+    for (i = 0; i < OSQL_ARENA_SHARDS; i++)
+        pthread_mutex_init(&osql_arena_pool[i].lk, NULL);
+    pthread_key_create(&osql_arena_key, osql_arena_cache_destroy);
+}
+
+static struct osql_arena_cache *osql_arena_cache(void)
+{
+    struct osql_arena_cache *cache;
+
+    pthread_once(&osql_arena_once, osql_arena_init_once);
+    cache = pthread_getspecific(osql_arena_key);
+    if (cache == NULL) {
+        cache = calloc(1, sizeof(struct osql_arena_cache));
+        if (cache == NULL)
+            return NULL;
+        cache->shard =
+            ATOMIC_ADD(osql_arena_next_shard, 1) % OSQL_ARENA_SHARDS;
+        pthread_setspecific(osql_arena_key, cache);
+    }
+    return cache;
+}
+
+static comdb2ma osql_arena_get(void)
+{
+    struct osql_arena_cache *cache = osql_arena_cache();
+    struct osql_arena_shard *shard;
+    comdb2ma ma = NULL;
+    int i;
+
+    if (cache && cache->n > 0)
+        return cache->ma[--cache->n];
+
+    for (i = 0; i < OSQL_ARENA_SHARDS && ma == NULL; i++) {
+        shard = &osql_arena_pool[((cache ? cache->shard : 0) + i) %
+                                 OSQL_ARENA_SHARDS];
+        pthread_mutex_lock(&shard->lk);
+        if (shard->n > 0)
+            ma = shard->ma[--shard->n];
+        pthread_mutex_unlock(&shard->lk);
+    }
+
+    if (ma == NULL)
+        ma = comdb2ma_create(0, 0, "osql_bplog", COMDB2MA_MT_SAFE);
+    return ma;
+}
+
+static void osql_arena_put(comdb2ma ma)
+{
+    struct osql_arena_cache *cache = osql_arena_cache();
+    struct osql_arena_shard *shard;
+
+    /* don't let one big transaction pin its footprint in the pool */
+    comdb2_malloc_trim(ma, 0);
+
+    if (cache && cache->n < OSQL_ARENA_THREAD_CACHE) {
+        cache->ma[cache->n++] = ma;
+        return;
+    }
+
+    shard = &osql_arena_pool[cache ? cache->shard : 0];
+    pthread_mutex_lock(&shard->lk);
+    if (shard->n < OSQL_ARENA_SHARD_CACHE) {
+        shard->ma[shard->n++] = ma;
+        ma = NULL;
+    }
+    pthread_mutex_unlock(&shard->lk);
+
+    if (ma)
+        comdb2ma_destroy(ma);
+}
+
+/* the arena is shared across bplogs, so its own statistics don't tell what
+ * this one used; count its allocations here instead */
+static void osql_bplog_alloced(blocksql_tran_t *tran, void *ptr)
+{
+    size_t used;
+
+    if (!ptr)
+        return;
+    ATOMIC_ADD(tran->nallocs, 1);
+    used = ATOMIC_ADD(tran->mem_used, comdb2_malloc_usable_size(ptr));
+    if (used > tran->mem_peak)
+        tran->mem_peak = used;
+}
+
+static void *osql_bplog_calloc(blocksql_tran_t *tran, size_t n, size_t sz)
+{
+    void *ptr;
+
+    if (!tran->ma)
+        return calloc(n, sz);
+    ptr = comdb2_calloc(tran->ma, n, sz);
+    osql_bplog_alloced(tran, ptr);
+    return ptr;
+}
+
+static void osql_bplog_tfree(blocksql_tran_t *tran, void *ptr)
+{
+    if (!ptr)
+        return;
+    /* only what came from this bplog's arena is counted */
+    if (!tran->ma || comdb2_malloc_owner(ptr) != tran->ma) {
+        comdb2_free(ptr);
+        return;
+    }
+    ATOMIC_ADD(tran->mem_used, -comdb2_malloc_usable_size(ptr));
+    ATOMIC_ADD(tran->nallocs, -1);
+    comdb2_free(ptr);
+}
+
+/* an arena goes back to the pool only if everything in it was freed */
+static void osql_bplog_release_arena(blocksql_tran_t *tran)
+{
+    if (!tran->ma)
+        return;
+    if (tran->nallocs == 0)
+        osql_arena_put(tran->ma);
+    else
+        comdb2ma_destroy(tran->ma);
+    tran->ma = NULL;
+}
+
 typedef struct oplog_key {
     unsigned long long rqid;
     uuid_t uuid;
@@ -185,13 +360,6 @@ int osql_bplog_start(struct ireq *iq, osql_sess_t *sess)
        info, we'll need a lock around alloc/dealloc
      */
 
-    info = (blocksql_info_t *)calloc(1, sizeof(blocksql_info_t));
-    if (!info) {
-        logmsg(LOGMSG_ERROR, "%s: error allocating %zu bytes\n", __func__,
-               sizeof(blocksql_info_t));
-        return -1;
-    }
-
     if (iq->blocksql_tran)
         abort();
 
@@ -199,7 +367,19 @@ int osql_bplog_start(struct ireq *iq, osql_sess_t *sess)
     if (!tran) {
         logmsg(LOGMSG_ERROR, "%s: error allocating %zu bytes\n", __func__,
                sizeof(blocksql_tran_t));
-        free(info);
+        return -1;
+    }
+
+    /* if no arena can be had, fall back to malloc */
+    if (gbl_osql_bplog_arena)
+        tran->ma = osql_arena_get();
+
+    info = osql_bplog_calloc(tran, 1, sizeof(blocksql_info_t));
+    if (!info) {
+        logmsg(LOGMSG_ERROR, "%s: error allocating %zu bytes\n", __func__,
+               sizeof(blocksql_info_t));
+        osql_bplog_release_arena(tran);
+        free(tran);
         return -1;
     }
 
@@ -217,8 +397,10 @@ int osql_bplog_start(struct ireq *iq, osql_sess_t *sess)
     if (!tran->db || bdberr) {
         logmsg(LOGMSG_ERROR, "%s: failed to create temp table bdberr=%d\n",
                __func__, bdberr);
+        iq->blocksql_tran = NULL;
+        osql_bplog_tfree(tran, info);
+        osql_bplog_release_arena(tran);
         free(tran);
-        free(info);
         return -1;
     }
 
@@ -404,6 +586,82 @@ char *osql_sorese_type_to_str(int stype)
     return rtn;
 }
 
+/**
+ * Allocate memory that is needed no longer than the bplog of this request;
+ * it comes from the bplog arena when there is one
+ *
+ */
+void *osql_bplog_malloc(struct ireq *iq, size_t sz)
+{
+    blocksql_tran_t *tran = (blocksql_tran_t *)iq->blocksql_tran;
+    void *ptr;
+
+    if (!tran || !tran->ma)
+        return malloc(sz);
+    ptr = comdb2_malloc(tran->ma, sz);
+    osql_bplog_alloced(tran, ptr);
+    return ptr;
+}
+
+/**
+ * Free memory returned by osql_bplog_malloc for the same request
+ *
+ */
+void osql_bplog_mfree(struct ireq *iq, void *ptr)
+{
+    blocksql_tran_t *tran = (blocksql_tran_t *)iq->blocksql_tran;
+
+    if (tran)
+        osql_bplog_tfree(tran, ptr);
+    else
+        comdb2_free(ptr);
+}
+
+/**
+ * Allocate a transient copy of a reply that is routed locally; it comes from
+ * the arena of the calling thread, and must be freed by the same thread
+ * with osql_bplog_rpl_free
+ *
+ */
+void *osql_bplog_rpl_malloc(size_t sz)
+{
+    struct osql_arena_cache *cache;
+
+    if (!gbl_osql_bplog_arena || (cache = osql_arena_cache()) == NULL)
+        return malloc(sz);
+    if (cache->rpl == NULL)
+        cache->rpl = comdb2ma_create(0, 0, "osql_rpl", COMDB2MA_MT_SAFE);
+    if (cache->rpl == NULL)
+        return malloc(sz);
+    return comdb2_malloc(cache->rpl, sz);
+}
+
+void osql_bplog_rpl_free(void *ptr)
+{
+    struct osql_arena_cache *cache;
+
+    pthread_once(&osql_arena_once, osql_arena_init_once);
+    cache = pthread_getspecific(osql_arena_key);
+    if (cache && cache->rpl)
+        comdb2_free(ptr);
+    else
+        free(ptr);
+}
+
+/**
+ * Returns the peak memory this bplog had allocated from its arena, 0 if
+ * there is none
+ *
+ */
+size_t osql_bplog_peak_mem(struct ireq *iq)
+{
+    blocksql_tran_t *tran = (blocksql_tran_t *)iq->blocksql_tran;
+
+    if (!tran || !tran->ma)
+        return 0;
+    return tran->mem_peak;
+}
+
 /**
  * Prints summary for the current osql bp transaction
  *
@@ -422,7 +680,7 @@ char *osql_get_tran_summary(struct ireq *iq)
         blocksql_tran_t *tran = (blocksql_tran_t *)iq->blocksql_tran;
         blocksql_info_t *info = NULL;
 
-        int sz = 128;
+        int sz = 160;
         int min_rtt = INT_MAX;
         int max_rtt = 0;
         int min_tottm = INT_MAX;
@@ -454,9 +712,16 @@ char *osql_get_tran_summary(struct ireq *iq)
 
         nametype = osql_sorese_type_to_str(iq->sorese.type);
 
-        snprintf(ret, sz, "%s num=%u tot=[%u %u] rtt=[%u %u] rtrs=[%u %u]",
-                 nametype, tran->num, min_tottm, max_tottm, min_rtt, max_rtt,
-                 min_rtrs, max_rtrs);
+        if (tran->ma) {
+            snprintf(ret, sz, "%s num=%u tot=[%u %u] rtt=[%u %u] rtrs=[%u %u] "
+                              "mem=%zu",
+                     nametype, tran->num, min_tottm, max_tottm, min_rtt,
+                     max_rtt, min_rtrs, max_rtrs, osql_bplog_peak_mem(iq));
+        } else {
+            snprintf(ret, sz, "%s num=%u tot=[%u %u] rtt=[%u %u] rtrs=[%u %u]",
+                     nametype, tran->num, min_tottm, max_tottm, min_rtt,
+                     max_rtt, min_rtrs, max_rtrs);
+        }
         ret[sz - 1] = '\0';
     }
 
@@ -500,7 +765,7 @@ int osql_bplog_free(struct ireq *iq, int are_sessions_linked, const char *func,
         LISTC_FOR_EACH_SAFE(&tran->pending, info, tmp, p_reqs)
         {
             listc_rfl(&tran->pending, info);
-            free(info);
+            osql_bplog_tfree(tran, info);
         }
 
         LISTC_FOR_EACH_SAFE(&tran->complete, info, tmp, c_reqs)
@@ -511,7 +776,7 @@ int osql_bplog_free(struct ireq *iq, int are_sessions_linked, const char *func,
         LISTC_FOR_EACH_SAFE(&tran->complete, info, tmp, c_reqs)
         {
             listc_rfl(&tran->complete, info);
-            free(info);
+            osql_bplog_tfree(tran, info);
         }
 
 
@@ -528,6 +793,8 @@ int osql_bplog_free(struct ireq *iq, int are_sessions_linked, const char *func,
             tran->db = NULL;
         }
 
+        osql_bplog_release_arena(tran);
+
         free(tran);
 
         /* free the space for sql strings */
@@ -678,7 +945,7 @@ int osql_bplog_saveop(osql_sess_t *sess, char *rpl, int rplen,
         logmsg(LOGMSG_ERROR, 
             "%s: fail to put oplog rqid=%llx (%lld) seq=%llu rc=%d bdberr=%d\n",
             __func__, key.rqid, key.rqid, key.seq, rc, bdberr);
-    } else if (gbl_osqlpfault_threads) {
+    } else if (gbl_osqlpfault_threads && !gbl_osql_prefault_window) {
         osql_page_prefault(rpl, rplen, &(tran->last_db),
                            &(osql_session_get_ireq(sess)->osql_step_ix), rqid,
                            uuid, seq);
@@ -1034,6 +1301,75 @@ void osql_bplog_setlimit(int limit) { g_osql_blocksql_parallel_max = limit; }
 /************************* INTERNALS
  * ***************************************************/
 
+/* Apply-time prefault: a second cursor walks the session's ops up to
+ * gbl_osql_prefault_window ahead of the op being applied and hands them to the
+ * osql prefault threads, so the pages of the next ops are read while the
+ * current one is applied.  Ops the apply has already passed are dropped by
+ * the prefault threads (see gbl_osqlpf_step). */
+typedef struct oplog_prefault {
+    struct temp_cursor *dbc;
+    struct dbtable *last_db;
+    unsigned long long seq; /* next op to prefault */
+    int done;
+} oplog_prefault_t;
+
+static void oplog_prefault_start(oplog_prefault_t *pf, struct ireq *iq,
+                                 blocksql_tran_t *tran, oplog_key_t *key)
+{
+    int bdberr = 0;
+    int rc;
+
+    bzero(pf, sizeof(*pf));
+    pf->done = 1;
+    if (!gbl_osql_prefault_window || !gbl_osqlpfault_threads)
+        return;
+
+    pf->dbc = bdb_temp_table_cursor(thedb->bdb_env, tran->db, NULL, &bdberr);
+    if (!pf->dbc || bdberr) {
+        pf->dbc = NULL;
+        return;
+    }
+    rc = bdb_temp_table_find_exact(thedb->bdb_env, pf->dbc, key, sizeof(*key),
+                                   &bdberr);
+    if (rc)
+        return;
+    pf->last_db = iq->usedb;
+    pf->done = 0;
+}
+
+static void oplog_prefault_advance(oplog_prefault_t *pf, struct ireq *iq,
+                                   oplog_key_t *key,
+                                   unsigned long long applied)
+{
+    int bdberr = 0;
+
+    while (!pf->done && pf->seq <= applied + gbl_osql_prefault_window) {
+        oplog_key_t *pfkey = (oplog_key_t *)bdb_temp_table_key(pf->dbc);
+
+        if (pfkey->rqid != key->rqid ||
+            (key->rqid == OSQL_RQID_USE_UUID &&
+             comdb2uuidcmp(pfkey->uuid, key->uuid))) {
+            pf->done = 1;
+            break;
+        }
+        osql_page_prefault(bdb_temp_table_data(pf->dbc),
+                           bdb_temp_table_datasize(pf->dbc), &pf->last_db,
+                           &iq->osql_step_ix, key->rqid, key->uuid, pfkey->seq);
+        pf->seq = pfkey->seq + 1;
+        if (bdb_temp_table_next(thedb->bdb_env, pf->dbc, &bdberr))
+            pf->done = 1;
+    }
+}
+
+static void oplog_prefault_stop(oplog_prefault_t *pf)
+{
+    int bdberr = 0;
+
+    if (pf->dbc)
+        bdb_temp_table_close_cursor(thedb->bdb_env, pf->dbc, &bdberr);
+    pf->dbc = NULL;
+}
+
 static int process_this_session(
     struct ireq *iq, void *iq_tran, osql_sess_t *sess, int *bdberr, int *nops,
     struct block_err *err, SBUF2 *logsb, struct temp_cursor *dbc,
@@ -1060,10 +1396,11 @@ static int process_this_session(
     int flags = 0;
     uuid_t uuid;
     uuidstr_t us;
+    oplog_prefault_t pf;
 
     iq->queryid = osql_sess_queryid(sess);
 
-    key = (oplog_key_t *)malloc(sizeof(oplog_key_t));
+    key = (oplog_key_t *)osql_bplog_malloc(iq, sizeof(oplog_key_t));
     if (!key) {
         logmsg(LOGMSG_ERROR, "%s: unable to allocated %zu bytes\n", __func__,
                sizeof(oplog_key_t));
@@ -1088,6 +1425,7 @@ static int process_this_session(
     if (rc && rc != IX_EMPTY && rc != IX_NOTFND) {
         logmsg(LOGMSG_ERROR, "%s: bdb_temp_table_first failed rc=%d bdberr=%d\n",
                 __func__, rc, *bdberr);
+        osql_bplog_mfree(iq, key);
         return rc;
     }
 
@@ -1097,6 +1435,8 @@ static int process_this_session(
                 rqid, us);
     }
 
+    oplog_prefault_start(&pf, iq, tran, key);
+
     while (!rc && !rc_out) {
 
         data = bdb_temp_table_data(dbc);
@@ -1108,9 +1448,13 @@ static int process_this_session(
             err->blockop_num = 0;
             err->errcode = ERR_NOMASTER;
             err->ixnum = 0;
+            oplog_prefault_stop(&pf);
+            osql_bplog_mfree(iq, key);
             return ERR_NOMASTER /*OSQL_FAILDISPATCH*/;
         }
 
+        oplog_prefault_advance(&pf, iq, key, key_next.seq);
+
         if (iq->osql_step_ix)
             gbl_osqlpf_step[*(iq->osql_step_ix)].step = key_next.seq << 7;
 
@@ -1165,12 +1509,15 @@ static int process_this_session(
         step++;
     }
 
+    oplog_prefault_stop(&pf);
+
     /* if for some reason the session has not completed correctly,
        this will free the eventually allocated buffers */
     free_blob_buffers(blobs, MAXBLOBS);
 
     if (updCols)
-        free(updCols);
+        osql_bplog_mfree(iq, updCols);
+    osql_bplog_mfree(iq, key);
 
     if (rc == 0 || rc == IX_PASTEOF || rc == IX_EMPTY) {
         rc = 0;
@@ -86,6 +86,28 @@ int osql_bplog_commit(struct ireq *iq, void *iq_trans, int *nops,
  */
 int osql_bplog_free(struct ireq *iq, int are_sessions_linked, const char *func, const char *callfunc, int line);
 
+/**
+ * Allocate/free memory that is needed no longer than the bplog of this
+ * request; the arena is pooled, so every allocation must be freed.
+ *
+ */
+void *osql_bplog_malloc(struct ireq *iq, size_t sz);
+void osql_bplog_mfree(struct ireq *iq, void *ptr);
+
+/**
+ * Allocate/free a transient reply copy from the calling thread's arena;
+ * both must be called by the same thread.
+ *
+ */
+void *osql_bplog_rpl_malloc(size_t sz);
+void osql_bplog_rpl_free(void *ptr);
+
+/**
+ * Returns the peak memory this request's bplog allocated from its arena
+ *
+ */
+size_t osql_bplog_peak_mem(struct ireq *iq);
+
 /**
  * Prints summary for the current osql bp transaction
  * It uses the specified "printfn" function to dump the information
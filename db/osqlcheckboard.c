@@ -266,6 +266,9 @@ int osql_unregister_sqlthr(struct sqlclntstate *clnt)
     if (clnt->osql.rqid == 0)
         return 0;
 
+    /* nothing left in this thread's frame belongs to a live session */
+    osql_batch_discard();
+
     if ((rc = pthread_rwlock_wrlock(&checkboard->rwlock))) {
         logmsg(LOGMSG_ERROR, "pthread_rwlock_wrlock: error code %d\n", rc);
         return -1;
@@ -25,6 +25,7 @@
 #include "osqlcheckboard.h"
 #include "osqlrepository.h"
 #include "osqlblockproc.h"
+#include "comdb2_atomic.h"
 #include <compile_time_assert.h>
 #include <netinet/in.h>
 #include <endian_core.h>
@@ -2743,6 +2744,14 @@ static int osql_nettype_is_uuid(int type)
 
 static osql_stats_t stats[OSQL_MAX_REQ] = {0};
 
+/* NET_OSQL_RPL_BATCH frames and the ops they carried */
+static struct {
+    unsigned int snd_frames;
+    unsigned int snd_ops;
+    unsigned int rcv_frames;
+    unsigned int rcv_ops;
+} batch_stats;
+
 /* echo service */
 #define MAX_ECHOES 256
 #define MAX_LATENCY 1000
@@ -2827,6 +2836,9 @@ static void net_snap_uid_req(void *hndl, void *uptr, char *fromhost,
 static void net_snap_uid_rpl(void *hndl, void *uptr, char *fromhost,
                              int usertype, void *dtap, int dtalen,
                              uint8_t is_tcp);
+static void net_osql_rpl_batch(void *hndl, void *uptr, char *fromhost,
+                               int usertype, void *dtap, int dtalen,
+                               uint8_t is_tcp);
 
 #include <net/net.h>
 /**
@@ -2954,6 +2966,9 @@ int osql_comm_init(struct dbenv *dbenv)
     net_register_handler(tmp->handle_sibling, NET_OSQL_MASTER_CHECKED_UUID,
                          net_osql_master_checked);
 
+    net_register_handler(tmp->handle_sibling, NET_OSQL_RPL_BATCH,
+                         net_osql_rpl_batch);
+
     /* this guy will terminate pending requests */
     net_register_hostdown(tmp->handle_sibling, net_osql_nodedwn);
 
@@ -5140,6 +5155,9 @@ int osql_comm_quick_stat(void)
                reqtypes[i], stats[i].snd, stats[i].snd_failed, stats[i].rcv,
                stats[i].rcv_failed, stats[i].rcv_rdndt);
     }
+    logmsg(LOGMSG_USER, "batch frames(ops) snd %u(%u) rcv %u(%u)\n",
+           batch_stats.snd_frames, batch_stats.snd_ops, batch_stats.rcv_frames,
+           batch_stats.rcv_ops);
     return 0;
 }
 
@@ -5710,6 +5728,246 @@ int osql_comm_check_bdb_lock(void)
     return 0;
 }
 
+/* Batched osql ops.  With osql_send_batch, a replicant thread packs the
+ * ops it sends to a remote master with nodelay off (usedb, records, keys,
+ * blobs...) into one NET_OSQL_RPL_BATCH frame instead of sending each as its
+ * own net message:
+ *
+ *    [4] frame length   [4] usertype of the ops   [4] number of ops
+ *    per op: varint length, then the op exactly as it would have been sent
+ *
+ * Any other send from the thread flushes the frame first, so the master sees
+ * the same messages in the same order; it walks the frame in place and hands
+ * each op to net_osql_rpl. */
+int gbl_osql_send_batch = 0;
+int gbl_osql_send_batch_bytes = 65536;
+
+enum { OSQL_BATCH_HDR_LEN = 12 };
+
+typedef struct osql_batch {
+    char *tohost;
+    int usertype;
+    int nops;
+    int len;
+    int alloc;
+    uint8_t *buf;
+} osql_batch_t;
+
+static pthread_key_t osql_batch_key;
+static pthread_once_t osql_batch_once = PTHREAD_ONCE_INIT;
+
+/* set once any thread has batched, so flushes are free until then */
+static int osql_batch_key_used;
+
+static void osql_batch_free(void *arg)
+{
+    osql_batch_t *batch = arg;
+    free(batch->buf);
+    free(batch);
+}
+
+static void osql_batch_key_init(void)
+{
+    pthread_key_create(&osql_batch_key, osql_batch_free);
+}
+
+static uint8_t *osql_varint_put(unsigned int v, uint8_t *p_buf)
+{
+    while (v >= 0x80) {
+        *p_buf++ = (v & 0x7f) | 0x80;
+        v >>= 7;
+    }
+    *p_buf++ = v;
+    return p_buf;
+}
+
+static const uint8_t *osql_varint_get(unsigned int *v, const uint8_t *p_buf,
+                                      const uint8_t *p_buf_end)
+{
+    unsigned int shift = 0;
+
+    *v = 0;
+    while (p_buf < p_buf_end && shift < 32) {
+        *v |= (unsigned int)(*p_buf & 0x7f) << shift;
+        if (!(*p_buf++ & 0x80))
+            return p_buf;
+        shift += 7;
+    }
+    return NULL;
+}
+
+static int osql_batch_type(int usertype)
+{
+    switch (usertype) {
+    case NET_OSQL_SOCK_RPL:
+    case NET_OSQL_SOCK_RPL_UUID:
+    case NET_OSQL_RECOM_RPL:
+    case NET_OSQL_RECOM_RPL_UUID:
+    case NET_OSQL_SNAPISOL_RPL:
+    case NET_OSQL_SNAPISOL_RPL_UUID:
+    case NET_OSQL_SERIAL_RPL:
+    case NET_OSQL_SERIAL_RPL_UUID:
+        return 1;
+    }
+    return 0;
+}
+
+static int offload_net_send(char *host, int usertype, void *data, int datalen,
+                            int nodelay);
+
+/* Send the pending frame of this thread, if any. */
+static int osql_batch_flush(void)
+{
+    osql_batch_t *batch;
+    uint8_t *p_buf;
+    int nops, rc;
+
+    if (!osql_batch_key_used)
+        return 0;
+    batch = pthread_getspecific(osql_batch_key);
+    if (!batch || batch->nops == 0)
+        return 0;
+
+    p_buf = batch->buf;
+    p_buf = buf_put(&batch->len, sizeof(int), p_buf, p_buf + sizeof(int));
+    p_buf = buf_put(&batch->usertype, sizeof(int), p_buf, p_buf + sizeof(int));
+    buf_put(&batch->nops, sizeof(int), p_buf, p_buf + sizeof(int));
+
+    /* reset first: offload_net_send calls back in here */
+    nops = batch->nops;
+    batch->nops = 0;
+    rc = offload_net_send(batch->tohost, NET_OSQL_RPL_BATCH, batch->buf,
+                          batch->len, 0);
+    batch->len = OSQL_BATCH_HDR_LEN;
+    if (rc == 0) {
+        ATOMIC_ADD(batch_stats.snd_frames, 1);
+        ATOMIC_ADD(batch_stats.snd_ops, nops);
+    }
+    return rc;
+}
+
+/**
+ * Drop the ops this thread has framed but not sent.  Called when its
+ * transaction is aborted or torn down, so they don't go out ahead of the
+ * next transaction's ops.
+ *
+ */
+void osql_batch_discard(void)
+{
+    osql_batch_t *batch;
+
+    if (!osql_batch_key_used)
+        return;
+    batch = pthread_getspecific(osql_batch_key);
+    if (!batch || batch->nops == 0)
+        return;
+    batch->nops = 0;
+    batch->len = OSQL_BATCH_HDR_LEN;
+}
+
+/* Called on every offload send.  Returns 1 with *rc set if the message went
+ * into the frame, 0 if the caller has to send it (after we flushed the frame
+ * if there was one). */
+static int osql_batch_add(char *host, int usertype, void *data, int datalen,
+                          int nodelay, int ntails, void **tails, int *tailens,
+                          int *rc)
+{
+    osql_batch_t *batch;
+    int oplen = datalen, need, i;
+    uint8_t *p_buf;
+
+    *rc = 0;
+    if (!gbl_osql_send_batch || !host || nodelay || !osql_batch_type(usertype))
+        goto nobatch;
+    for (i = 0; i < ntails; i++)
+        oplen += tailens[i];
+    need = oplen + 5;
+    if (OSQL_BATCH_HDR_LEN + need > gbl_osql_send_batch_bytes)
+        goto nobatch;
+
+    pthread_once(&osql_batch_once, osql_batch_key_init);
+    osql_batch_key_used = 1;
+    batch = pthread_getspecific(osql_batch_key);
+    if (!batch) {
+        batch = calloc(1, sizeof(osql_batch_t));
+        if (!batch)
+            goto nobatch;
+        batch->len = OSQL_BATCH_HDR_LEN;
+        pthread_setspecific(osql_batch_key, batch);
+    }
+    if (batch->nops && (strcmp(batch->tohost, host) != 0 ||
+                        batch->usertype != usertype ||
+                        batch->len + need > gbl_osql_send_batch_bytes)) {
+        if ((*rc = osql_batch_flush()) != 0)
+            return 1;
+    }
+    if (batch->len + need > batch->alloc) {
+        int alloc = batch->len + need;
+        if (alloc < gbl_osql_send_batch_bytes)
+            alloc = gbl_osql_send_batch_bytes;
+        uint8_t *buf = realloc(batch->buf, alloc);
+        if (!buf)
+            goto nobatch;
+        batch->buf = buf;
+        batch->alloc = alloc;
+    }
+
+    batch->tohost = host;
+    batch->usertype = usertype;
+    p_buf = osql_varint_put(oplen, batch->buf + batch->len);
+    memcpy(p_buf, data, datalen);
+    p_buf += datalen;
+    for (i = 0; i < ntails; i++) {
+        if (tailens[i] > 0)
+            memcpy(p_buf, tails[i], tailens[i]);
+        p_buf += tailens[i];
+    }
+    batch->len = p_buf - batch->buf;
+    batch->nops++;
+    return 1;
+
+nobatch:
+    *rc = osql_batch_flush();
+    return *rc != 0;
+}
+
+static void net_osql_rpl_batch(void *hndl, void *uptr, char *fromhost,
+                               int usertype, void *dtap, int dtalen,
+                               uint8_t is_tcp)
+{
+    const uint8_t *p_buf = dtap;
+    const uint8_t *p_buf_end = p_buf + dtalen;
+    int framelen, optype, nops, i;
+    unsigned int oplen;
+
+    if (dtalen < OSQL_BATCH_HDR_LEN) {
+        logmsg(LOGMSG_ERROR, "%s: short frame %d bytes\n", __func__, dtalen);
+        return;
+    }
+    p_buf = buf_get(&framelen, sizeof(int), p_buf, p_buf_end);
+    p_buf = buf_get(&optype, sizeof(int), p_buf, p_buf_end);
+    p_buf = buf_get(&nops, sizeof(int), p_buf, p_buf_end);
+    if (framelen != dtalen || !osql_batch_type(optype)) {
+        logmsg(LOGMSG_ERROR, "%s: bad frame len %d/%d type %d\n", __func__,
+               framelen, dtalen, optype);
+        return;
+    }
+
+    ATOMIC_ADD(batch_stats.rcv_frames, 1);
+    for (i = 0; i < nops; i++) {
+        if (!(p_buf = osql_varint_get(&oplen, p_buf, p_buf_end)) ||
+            oplen > p_buf_end - p_buf) {
+            logmsg(LOGMSG_ERROR, "%s: truncated frame at op %d of %d\n",
+                   __func__, i, nops);
+            return;
+        }
+        net_osql_rpl(hndl, uptr, fromhost, optype, (void *)p_buf, oplen,
+                     is_tcp);
+        p_buf += oplen;
+        ATOMIC_ADD(batch_stats.rcv_ops, 1);
+    }
+}
+
 /* this wrapper tries to provide a reliable net_send that will prevent loosing
    packets
    due to queue being full */
@@ -5733,6 +5991,11 @@ static int offload_net_send(char *host, int usertype, void *data, int datalen,
     if (host == gbl_mynode)
         host = NULL;
 
+    if (osql_batch_add(host, usertype, data, datalen, nodelay, 0, NULL, NULL,
+                       &rc))
+        return rc;
+    rc = -1;
+
     if (host) {
 
         /* remote send */
@@ -5812,6 +6075,11 @@ static int offload_net_send_tails(char *host, int usertype, void *data,
     int unknownerror_retry = 0;
     int rc = -1;
 
+    if (osql_batch_add(host == gbl_mynode ? NULL : host, usertype, data,
+                       datalen, nodelay, ntails, tails, tailens, &rc))
+        return rc;
+    rc = -1;
+
     while (rc) {
         if (host == gbl_mynode)
             host = NULL;
@@ -5989,11 +6257,12 @@ static int net_osql_rpl_tail(void *hndl, void *uptr, char *fromhost,
     int found = 0;
     uint8_t *p_buf, *p_buf_end;
     uuid_t uuid;
+    int big = (dtalen + tailen > gbl_blob_sz_thresh_bytes);
 
-    if (dtalen + tailen > gbl_blob_sz_thresh_bytes)
+    if (big)
         dup = comdb2_bmalloc(blobmem, dtalen + tailen);
     else
-        dup = malloc(dtalen + tailen);
+        dup = osql_bplog_rpl_malloc(dtalen + tailen);
 
     stats[netrpl2req(usertype)].rcv++;
 
@@ -6046,7 +6315,10 @@ static int net_osql_rpl_tail(void *hndl, void *uptr, char *fromhost,
             }
         }
 
-        free(dup);
+        if (big)
+            free(dup);
+        else
+            osql_bplog_rpl_free(dup);
     }
 
     if (rc)
@@ -6752,7 +7024,7 @@ int osql_process_packet(struct ireq *iq, unsigned long long rqid, uuid_t uuid,
         }
 
         if (*updCols) {
-            free(*updCols);
+            osql_bplog_mfree(iq, *updCols);
             *updCols = NULL;
             /* reset blob optimization, just in case; should
                be enabled by a new updCols
@@ -6818,7 +7090,7 @@ int osql_process_packet(struct ireq *iq, unsigned long long rqid, uuid_t uuid,
                 __func__);
         } else {
             int sz = sizeof(int) * (dt.ncols + 1);
-            *updCols = (int *)malloc(sz);
+            *updCols = (int *)osql_bplog_malloc(iq, sz);
 
             /* reset to the end of the buffer */
             p_buf_end = p_buf + sz;
@@ -8618,7 +8890,7 @@ int osql_page_prefault(char *rpl, int rplen, struct dbtable **last_db,
                        int **iq_step_ix, unsigned long long rqid, uuid_t uuid,
                        unsigned long long seq)
 {
-    static int last_step_idex = 0;
+    int last_step_idex;
     int *ii;
     int rc;
     osql_rpl_t rpl_op;
@@ -8626,7 +8898,12 @@ int osql_page_prefault(char *rpl, int rplen, struct dbtable **last_db,
     uint8_t *p_buf_end = p_buf + rplen;
     osqlcomm_rpl_type_get(&rpl_op, p_buf, p_buf_end);
 
-    if (seq == 0) {
+    /* a retried apply already owns a step slot */
+    if (*iq_step_ix) {
+        last_step_idex = **iq_step_ix;
+        if (seq == 0)
+            gbl_osqlpf_step[last_step_idex].step = 0;
+    } else if (seq == 0) {
         rc = pthread_mutex_lock(&osqlpf_mutex);
         if (rc != 0) {
             logmsg(LOGMSG_ERROR, "osql_page_prefault: Failed to lock osqlpf_mutex\n");
@@ -8646,6 +8923,8 @@ int osql_page_prefault(char *rpl, int rplen, struct dbtable **last_db,
         *iq_step_ix = ii;
         gbl_osqlpf_step[last_step_idex].rqid = rqid;
         comdb2uuidcpy(gbl_osqlpf_step[last_step_idex].uuid, uuid);
+    } else {
+        return 0;
     }
 
     switch (rpl_op.type) {
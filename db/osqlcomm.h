@@ -363,6 +363,12 @@ int osql_disable_net_test(void);
  */
 int osql_comm_check_bdb_lock(void);
 
+/**
+ * Drop the osql ops this thread has framed for a batched send but not sent
+ *
+ */
+void osql_batch_discard(void);
+
 int osql_send_updstat(char *tohost, unsigned long long rqid, uuid_t uuid,
                       unsigned long long seq, char *pData, int nData, int nStat,
                       int type, SBUF2 *logsb);
@@ -590,11 +590,10 @@ int osql_fetch_shadblobs_by_genid(BtCursor *pCur, int *blobnum,
 
         blobs->bloblens[0] = bdb_temp_table_datasize(tbl->blb_cur);
         blobs->bloboffs[0] = 0;
-        blobs->blobptrs[0] = bdb_temp_table_data(tbl->blb_cur);
 
-        /* reset data pointer in cursor; blob will be freed when blobs is freed
-         */
-        bdb_temp_table_reset_datapointers(tbl->blb_cur);
+        /* take the data from the cursor; blob will be freed when blobs is
+         * freed */
+        blobs->blobptrs[0] = bdb_temp_table_detach_data(tbl->blb_cur);
 
     } else {
         free(key);
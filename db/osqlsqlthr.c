@@ -533,6 +533,8 @@ int osql_sock_restart(struct sqlclntstate *clnt, int maxretries,
 
 again:
 
+    /* the ops framed for the old session are resent from the shadow tables */
+    osql_batch_discard();
     sentops = 0;
 
     /* we need to check if we need bdb write lock here to prevent a master
@@ -923,6 +925,9 @@ int osql_sock_abort(struct sqlclntstate *clnt, int type)
     int irc = 0;
     int bdberr = 0;
 
+    /* the master throws the ops away anyway */
+    osql_batch_discard();
+
     /* am I talking already with the master? rqid != 0 */
     if (clnt->osql.rqid != 0) {
         /* send results of sql processing to block master */
@@ -123,6 +123,7 @@ extern bool gbl_rcache;
 
 static pthread_mutex_t testguard = PTHREAD_MUTEX_INITIALIZER;
 void bdb_locktest(void *);
+void bdb_pagelock_bench(void *, int, int);
 void bdb_berktest(void *, uint32_t);
 void bdb_berktest_multi(void *);
 void bdb_berktest_commit_delay(uint32_t);
@@ -132,6 +133,7 @@ void rowlocks_bench(void *, int, int);
 void rowlocks_lock1_bench(void *, int, int);
 void rowlocks_lock2_bench(void *, int, int);
 void commit_bench(void *, int, int);
+void ondisk_decode_bench(const char *, int, int);
 void bdb_detect(void *);
 void enable_ack_trace(void);
 void disable_ack_trace(void);
@@ -622,6 +624,7 @@ extern int gbl_new_snapisol;
 void bdb_print_logfile_pglogs_stat();
 #endif
 void bdb_osql_trn_clients_status();
+void bdb_osql_vers_stat(void);
 
 
 void *handle_exit_thd(void *arg) 
@@ -997,6 +1000,7 @@ int process_command(struct dbenv *dbenv, char *line, int lline, int st)
                gbl_new_snapisol_logging ? "ENABLED" : "DISABLED",
                gbl_new_snapisol_asof ? "ENABLED" : "DISABLED");
         bdb_osql_trn_clients_status();
+        bdb_osql_vers_stat();
     } else if (tokcmp(tok, ltok, "stack_warn_threshold") == 0) {
         int thresh;
         tok = segtok(line, lline, &st, &ltok);
@@ -2062,6 +2066,22 @@ int process_command(struct dbenv *dbenv, char *line, int lline, int st)
             quantize_dump(q_sql_steps_hour, stdout);
             logmsg(LOGMSG_ERROR, "SQL steps/query since startup:\n");
             quantize_dump(q_sql_steps_all, stdout);
+        } else if (tokcmp(tok, ltok, "groupcommit") == 0) {
+            extern int gbl_log_group_commit, gbl_log_group_fsync_us,
+                gbl_log_group_arrival_us, gbl_log_group_window_us;
+            extern int64_t gbl_log_group_waits;
+            logmsg(LOGMSG_USER, "Group commit %s\n",
+                   gbl_log_group_commit ? "enabled" : "disabled");
+            logmsg(LOGMSG_USER, "  fsync latency avg  %d usec\n",
+                   gbl_log_group_fsync_us);
+            logmsg(LOGMSG_USER, "  commit interarrival avg  %d usec\n",
+                   gbl_log_group_arrival_us);
+            logmsg(LOGMSG_USER, "  last window  %d usec\n",
+                   gbl_log_group_window_us);
+            logmsg(LOGMSG_USER, "  windows taken  %" PRId64 "\n",
+                   gbl_log_group_waits);
+            logmsg(LOGMSG_USER, "Commits per log flush:\n");
+            quantize_dump(q_log_group_commit, stdout);
         } else if (tokcmp(tok, ltok, "trigger") == 0) {
             trigger_stat();
         } else if (tokcmp(tok, ltok, "keycompr") == 0) {
@@ -3667,6 +3687,12 @@ int process_command(struct dbenv *dbenv, char *line, int lline, int st)
         logmsg(LOGMSG_USER, 
             "Read: %llu    Written: %llu    Throttles: %llu   Reorders: %llu\n",
             read, written, waits, reorders);
+        unsigned long long copied, referenced, writevs;
+        net_get_copy_stats(thedb->handle_sibling, &copied, &referenced,
+                           &writevs);
+        logmsg(LOGMSG_USER,
+               "Copied: %llu    Referenced: %llu    Writevs: %llu\n", copied,
+               referenced, writevs);
         num_nodes = net_get_all_nodes(thedb->handle_sibling, hosts);
         if (num_nodes > 0) {
             int i;
@@ -4654,6 +4680,23 @@ int process_command(struct dbenv *dbenv, char *line, int lline, int st)
         pthread_mutex_lock(&testguard);
         bdb_locktest(thedb->bdb_env);
         pthread_mutex_unlock(&testguard);
+    } else if (tokcmp(tok, ltok, "pagelock_bench") == 0) {
+        int maxthds = 64;
+        int nops = 1000000;
+        tok = segtok(line, lline, &st, &ltok);
+        if (ltok > 0) {
+            maxthds = toknum(tok, ltok);
+            tok = segtok(line, lline, &st, &ltok);
+            if (ltok > 0)
+                nops = toknum(tok, ltok);
+        }
+        if (maxthds <= 0 || nops <= 0) {
+            logmsg(LOGMSG_ERROR, "pagelock_bench [max-threads] [ops-per-thread]\n");
+        } else {
+            pthread_mutex_lock(&testguard);
+            bdb_pagelock_bench(thedb->bdb_env, maxthds, nops);
+            pthread_mutex_unlock(&testguard);
+        }
     } else if (tokcmp(tok, ltok, "berkdelay") == 0) {
         uint32_t commit_delay_ms = 0;
         tok = segtok(line, lline, &st, &ltok);
@@ -4837,6 +4880,62 @@ int process_command(struct dbenv *dbenv, char *line, int lline, int st)
             rowlocks_lock2_bench(thedb->bdb_env, lcnt, pcnt);
             pthread_mutex_unlock(&testguard);
         }
+    } else if (tokcmp(tok, ltok, "decode_bench") == 0) {
+        char table[MAXTABLELEN];
+        int nrows = 10000;
+        int passes = 100;
+        tok = segtok(line, lline, &st, &ltok);
+        if (ltok <= 0) {
+            logmsg(LOGMSG_ERROR, "decode_bench requires <table> [rows] [passes]\n");
+        } else {
+            tokcpy0(tok, ltok, table, sizeof(table));
+            tok = segtok(line, lline, &st, &ltok);
+            if (ltok > 0) {
+                nrows = toknum(tok, ltok);
+                tok = segtok(line, lline, &st, &ltok);
+                if (ltok > 0)
+                    passes = toknum(tok, ltok);
+            }
+            if (nrows <= 0 || passes <= 0) {
+                logmsg(LOGMSG_ERROR, "decode_bench rows and passes must be positive\n");
+            } else {
+                rdlock_schema_lk();
+                ondisk_decode_bench(table, nrows, passes);
+                unlock_schema_lk();
+            }
+        }
+    } else if (tokcmp(tok, ltok, "thdpool_bench") == 0) {
+        int maxthreads = 128;
+        int nitems = 1000000;
+        tok = segtok(line, lline, &st, &ltok);
+        if (ltok > 0) {
+            maxthreads = toknum(tok, ltok);
+            tok = segtok(line, lline, &st, &ltok);
+            if (ltok > 0)
+                nitems = toknum(tok, ltok);
+        }
+        if (maxthreads <= 0 || nitems < maxthreads) {
+            logmsg(LOGMSG_ERROR, "thdpool_bench [maxthreads] [items], "
+                                 "items must be at least maxthreads\n");
+        } else {
+            thdpool_bench(maxthreads, nitems);
+        }
+    } else if (tokcmp(tok, ltok, "temptable_bench") == 0) {
+        int nrows = 100000;
+        int passes = 10;
+        tok = segtok(line, lline, &st, &ltok);
+        if (ltok > 0) {
+            nrows = toknum(tok, ltok);
+            tok = segtok(line, lline, &st, &ltok);
+            if (ltok > 0)
+                passes = toknum(tok, ltok);
+        }
+        if (nrows <= 0 || passes <= 0) {
+            logmsg(LOGMSG_ERROR, "temptable_bench [rows] [passes], rows and "
+                                 "passes must be positive\n");
+        } else {
+            bdb_temp_table_bench(thedb->bdb_env, nrows, passes);
+        }
     } else if (tokcmp(tok, ltok, "deadlock_policy_override") == 0) {
         tok = segtok(line, lline, &st, &ltok);
         if (ltok > 0) {
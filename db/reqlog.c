@@ -2291,6 +2291,11 @@ void reqlog_set_fingerprint(struct reqlogger *logger,
 void reqlog_set_request(struct reqlogger *logger, CDB2SQLQUERY *request)
 {
     logger->request = request;
+    if (request && request->client_info) {
+        logger->have_client_info = 1;
+        logger->client_pid = request->client_info->pid;
+        logger->client_tid = request->client_info->th_id;
+    }
 }
 
 void reqlog_set_event(struct reqlogger *logger, const char *evtype)
@@ -119,6 +119,10 @@ struct reqlogger {
     const char *event_type;
 
     CDB2SQLQUERY *request;
+    /* who sent it, so a replay can tell client connections apart */
+    int have_client_info;
+    int client_pid;
+    int client_tid;
 
     int ntables;
     int alloctables;
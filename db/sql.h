@@ -116,6 +116,21 @@ void touch_stmt_entry(struct sqlthdstate *thd, stmt_hash_entry_type *entry);
 int add_stmt_table(struct sqlthdstate *, const char *sql, char *actual_sql,
                    sqlite3_stmt *, struct schema *params_to_bind);
 
+/* A statement shared by all sql threads, and how it was obtained */
+struct stmt_cache_stats {
+    char *sql;
+    int dbopen_gen;
+    int analyze_gen;
+    unsigned int hits;     /* found in a thread's statement cache */
+    unsigned int clones;   /* cloned from the shared program */
+    unsigned int prepares; /* compiled with sqlite3_prepare */
+    unsigned int last_prepare_us;
+    int memused; /* size of the shared program, 0 if it can't be shared */
+};
+void init_shared_stmts(void);
+int get_stmt_cache_stats(struct stmt_cache_stats **stats, int *nstats);
+void free_stmt_cache_stats(struct stmt_cache_stats *stats, int nstats);
+
 typedef struct osqltimings {
     unsigned long long query_received; /* query received, in need of dispatch */
     unsigned long long query_dispatched; /* start sql processing */
@@ -245,11 +260,14 @@ typedef struct {
     int sampling_pct;
     unsigned long long n_recs;
     unsigned long long n_sampled_recs;
+    struct summarize_sketch *sketch; /* instead of sampled_table */
 } sampled_idx_t;
 
 typedef struct sqlclntstate_fdb {
     SBUF2 *remote_sql_sb; /* IN REMOTE DB: set if this is on behalf of a remote
                              sql session */
+    uint64_t stream_batch_start; /* IN REMOTE DB: when the oldest row still in
+                                    remote_sql_sb was written, 0 if none */
     int flags; /* requester flags, like is this a sqlite_master special request
                   ?*/
     char *trim_key;  /* key used in prefiltering for find ops (sqlite_packed) */
@@ -787,6 +805,10 @@ void reset_query_effects(struct sqlclntstate *);
 int sqlite_to_ondisk(struct schema *s, const void *inp, int len, void *outp,
                      const char *tzname, blob_buffer_t *outblob, int maxblobs,
                      struct convert_failure *fail_reason, BtCursor *pCur);
+int ondisk_decode_rows(BtCursor *pCur, struct schema *sc, uint8_t **rows,
+                       int nrows, int ncols, Mem *out, const char *tzname);
+int ondisk_key_to_sqlite(struct dbtable *db, int ixnum, void *key, void *outp,
+                         int maxout, int *reqsize);
 
 int emit_sql_row(struct sqlthdstate *thd, struct column_info *cols,
                  struct sqlfield *offsets, struct sqlclntstate *clnt,
@@ -36,6 +36,9 @@
 #include <comdb2_atomic.h>
 #include <ctrace.h>
 #include <logmsg.h>
+#include <strbuf.h>
+#include <sketch.h>
+#include <math.h>
 
 /* amount of thread-memory initialized for this thread */
 static int analyze_thread_memory = 1048576;
@@ -50,6 +53,14 @@ static int sampled_tables_enabled = 1;
 /* sampling threshold defaults to 100 Mb */
 long long sampling_threshold = 104857600;
 
+/* build stats for tables over the sampling threshold from streaming sketches
+ * of every key rather than from a sample of them */
+int gbl_analyze_sketches = 0;
+
+/* sqlite_stat4 rows written per sketched index, as many as sqlite's own
+ * analyze aims for */
+#define ANALYZE_SKETCH_SAMPLES 24
+
 /* hard-maximum number of analyze-table threads */
 static int analyze_hard_max_table_threads = 15;
 
@@ -107,6 +118,7 @@ typedef struct index_descriptor {
     struct dbtable *tbl;
     int ix;
     int sampling_pct;
+    int sketch;
 } index_descriptor_t;
 
 /* table-descriptor */
@@ -238,6 +250,34 @@ static sampled_idx_t *find_sampled_index(struct sqlclntstate *client,
     return NULL;
 }
 
+/* Allocate a sketch request for the key columns of index schema s */
+static struct summarize_sketch *new_sketch(struct schema *s)
+{
+    struct summarize_sketch *sketch;
+    int *colend;
+    int i;
+
+    sketch = calloc(1, sizeof(struct summarize_sketch) +
+                           s->nmembers * (sizeof(double) + sizeof(int)));
+    if (sketch == NULL)
+        return NULL;
+    sketch->ncols = s->nmembers;
+    sketch->ndistinct = (double *)(sketch + 1);
+    colend = (int *)(sketch->ndistinct + s->nmembers);
+    for (i = 0; i < s->nmembers; i++)
+        colend[i] = s->member[i].offset + s->member[i].len;
+    sketch->colend = colend;
+    return sketch;
+}
+
+static void free_sketch(struct summarize_sketch *sketch)
+{
+    if (sketch == NULL)
+        return;
+    kll_free(sketch->kll);
+    free(sketch);
+}
+
 /* sample (previously misnamed compress) this index */
 static int sample_index_int(index_descriptor_t *ix_des)
 {
@@ -250,18 +290,25 @@ static int sample_index_int(index_descriptor_t *ix_des)
     unsigned long long n_recs;
     unsigned long long n_sampled_recs;
     struct temp_table *tmptbl = NULL;
+    struct summarize_sketch *sketch = NULL;
 
     /* cache the tablename for sqlglue */
     strncpy(s_ix->name, tbl->tablename, sizeof(s_ix->name));
 
-    /* ask bdb to put a summary of this into a temp-table */
-    rc = bdb_summarize_table(tbl->handle, ix, sampling_pct, &tmptbl,
+    if (ix_des->sketch && (sketch = new_sketch(tbl->ixschema[ix])) == NULL) {
+        logmsg(LOGMSG_ERROR, "%s: out of memory\n", __func__);
+        return -1;
+    }
+
+    /* ask bdb to put a summary of this into a temp-table, or sketches */
+    rc = bdb_summarize_table(tbl->handle, ix, sampling_pct, sketch, &tmptbl,
                              &n_sampled_recs, &n_recs, &bdberr);
 
     /* failed */
     if (rc) {
         logmsg(LOGMSG_ERROR, "%s: failed to sample table '%s' idx %d\n",
                __func__, tbl->tablename, ix);
+        free_sketch(sketch);
         return -1;
     }
 
@@ -271,6 +318,7 @@ static int sample_index_int(index_descriptor_t *ix_des)
     s_ix->sampling_pct = sampling_pct;
     s_ix->n_recs = n_recs;
     s_ix->n_sampled_recs = n_sampled_recs;
+    s_ix->sketch = sketch;
 
     return 0;
 }
@@ -355,7 +403,8 @@ static int wait_for_index(index_descriptor_t *ix_des)
 
 /* sample all indicies in this table */
 static int sample_indicies(table_descriptor_t *td, struct sqlclntstate *client,
-                           struct dbtable *tbl, int sampling_pct, SBUF2 *sb)
+                           struct dbtable *tbl, int sampling_pct, int sketch,
+                           SBUF2 *sb)
 {
     int i;
     int err = 0;
@@ -384,6 +433,7 @@ static int sample_indicies(table_descriptor_t *td, struct sqlclntstate *client,
         ix_des->tbl = tbl;
         ix_des->ix = i;
         ix_des->sampling_pct = sampling_pct;
+        ix_des->sketch = sketch;
 
         /* start an index sampling thread */
         int rc = dispatch_sample_index_thread(ix_des);
@@ -418,6 +468,7 @@ static int cleanup_sampled_indicies(struct sqlclntstate *client, struct dbtable
         sampled_idx_t *s_ix = &client->sampled_idx_tbl[i];
         if (!s_ix)
             continue;
+        free_sketch(s_ix->sketch);
         if (!s_ix->sampled_table)
             continue;
 
@@ -688,6 +739,155 @@ int update_sav(sqlite3 *sqldb, struct sqlclntstate *client, SBUF2 *sb,
 }
 
 
+static void append_counts(strbuf *sql, const uint64_t *counts, int n)
+{
+    int i;
+    strbuf_append(sql, ", '");
+    for (i = 0; i < n; i++)
+        strbuf_appendf(sql, i ? " %" PRIu64 : "%" PRIu64, counts[i]);
+    strbuf_append(sql, "'");
+}
+
+/* Write the sqlite_stat1 and sqlite_stat4 rows for index ix from the sketches
+ * summarize built of it.  stat1 comes from the distinct prefix counts.  The
+ * stat4 samples are evenly spaced quantiles of the keys, and their counts are
+ * estimated from their ranks in the quantile sketch. */
+static int write_sketch_stats(struct sqlclntstate *clnt, struct dbtable *tbl,
+                              int ix, struct summarize_sketch *sketch,
+                              strbuf *sql)
+{
+    struct schema *s = tbl->ixschema[ix];
+    struct kll *kll = sketch->kll;
+    int ncols = sketch->ncols;
+    int keylen = sketch->colend[ncols - 1];
+    uint64_t n = kll_count(kll);
+    uint64_t *nd = NULL, *neq, *nlt, *ndlt;
+    uint8_t *samples = NULL, *rec = NULL;
+    int nsamples, reclen, reqsize, i, j, rc = 0;
+
+    /* sqlite keeps no stats for the stat tables or for empty indexes */
+    if (s->sqlitetag == NULL || n == 0)
+        return 0;
+
+    nd = malloc(sizeof(uint64_t) * (ncols + 3 * (ncols + 1)));
+    if (nd == NULL) {
+        rc = -1;
+        goto done;
+    }
+    neq = nd + ncols;
+    nlt = neq + ncols + 1;
+    ndlt = nlt + ncols + 1;
+
+    /* distinct counts only grow with the prefix and never pass the number of
+     * keys, which is exactly the count of a unique index's full keys */
+    for (i = 0; i < ncols; i++) {
+        double est = round(sketch->ndistinct[i]);
+        nd[i] = est < 1 ? 1 : est > n ? n : (uint64_t)est;
+        if (i && nd[i] < nd[i - 1])
+            nd[i] = nd[i - 1];
+    }
+    if (!(s->flags & SCHEMA_DUP))
+        nd[ncols - 1] = n;
+
+    strbuf_clear(sql);
+    strbuf_appendf(sql, "insert into sqlite_stat1(tbl, idx, stat) values"
+                        "('%s', '%s', '%" PRIu64,
+                   tbl->tablename, s->sqlitetag, n);
+    for (i = 0; i < ncols; i++)
+        strbuf_appendf(sql, " %" PRIu64, (n + nd[i] - 1) / nd[i]);
+    strbuf_append(sql, "')");
+    if ((rc = run_internal_sql_clnt(clnt, (char *)strbuf_buf(sql))) != 0)
+        goto done;
+
+    if (!get_dbtable_by_name("sqlite_stat4"))
+        goto done;
+
+    reclen = keylen * 2 + 9 * (ncols + 1);
+    samples = malloc((size_t)ANALYZE_SKETCH_SAMPLES * keylen);
+    rec = malloc(reclen);
+    if (samples == NULL || rec == NULL) {
+        rc = -1;
+        goto done;
+    }
+    nsamples = kll_quantiles(kll, ANALYZE_SKETCH_SAMPLES, samples);
+    if (nsamples < 0) {
+        rc = -1;
+        goto done;
+    }
+
+    for (j = 0; j < nsamples; j++) {
+        uint8_t *key = samples + (size_t)j * keylen;
+
+        for (i = 0; i < ncols; i++) {
+            uint64_t lt = kll_rank(kll, key, sketch->colend[i], 0);
+            uint64_t le = kll_rank(kll, key, sketch->colend[i], 1);
+            /* below about 1% of n a count is lost in the sketch's rank error
+             * and the average rows per distinct prefix is the better guess */
+            neq[i] = le - lt > n / 100 ? le - lt : (n + nd[i] - 1) / nd[i];
+            if (i && neq[i] > neq[i - 1])
+                neq[i] = neq[i - 1];
+            nlt[i] = lt;
+            ndlt[i] = (uint64_t)((double)lt * nd[i] / n);
+        }
+        if (!(s->flags & SCHEMA_DUP))
+            neq[ncols - 1] = 1;
+        /* the trailing rowid column is unique */
+        neq[ncols] = 1;
+        nlt[ncols] = ndlt[ncols] = nlt[ncols - 1];
+
+        rc = ondisk_key_to_sqlite(tbl, ix, key, rec, reclen, &reqsize);
+        if (rc == -2) {
+            uint8_t *bigger = realloc(rec, reqsize);
+            if (bigger == NULL)
+                goto done;
+            rec = bigger;
+            reclen = reqsize;
+            rc = ondisk_key_to_sqlite(tbl, ix, key, rec, reclen, &reqsize);
+        }
+        if (rc)
+            goto done;
+
+        strbuf_clear(sql);
+        strbuf_appendf(sql, "insert into sqlite_stat4(tbl, idx, neq, nlt, "
+                            "ndlt, sample) values('%s', '%s'",
+                       tbl->tablename, s->sqlitetag);
+        append_counts(sql, neq, ncols + 1);
+        append_counts(sql, nlt, ncols + 1);
+        append_counts(sql, ndlt, ncols + 1);
+        strbuf_append(sql, ", x'");
+        for (i = 0; i < reqsize; i++)
+            strbuf_appendf(sql, "%02x", rec[i]);
+        strbuf_append(sql, "')");
+        if ((rc = run_internal_sql_clnt(clnt, (char *)strbuf_buf(sql))) != 0)
+            goto done;
+    }
+
+done:
+    if (rc)
+        logmsg(LOGMSG_ERROR, "%s: failed to write stats for table '%s' idx "
+                             "%d rc %d\n",
+               __func__, tbl->tablename, ix, rc);
+    free(nd);
+    free(samples);
+    free(rec);
+    return rc;
+}
+
+/* Write the stats of every sketched index of the table */
+static int write_sketched_table(struct sqlclntstate *clnt, struct dbtable *tbl)
+{
+    strbuf *sql = strbuf_new();
+    int i, rc = 0;
+
+    for (i = 0; i < clnt->n_cmp_idx && rc == 0; i++) {
+        sampled_idx_t *s_ix = &clnt->sampled_idx_tbl[i];
+        if (s_ix->sketch)
+            rc = write_sketch_stats(clnt, tbl, s_ix->ixnum, s_ix->sketch, sql);
+    }
+    strbuf_free(sql);
+    return rc;
+}
+
 static int analyze_table_int(table_descriptor_t *td,
                              struct thr_handle *thr_self)
 {
@@ -783,29 +983,44 @@ static int analyze_table_int(table_descriptor_t *td,
     /* grab the size of the table */
     int64_t totsiz = calc_table_size_analyze(tbl);
     int sampled_table = 0;
+    int sketch = gbl_analyze_sketches && tbl->nix > 0;
 
     if (sampled_tables_enabled)
         get_sampling_threshold(td->table, &sampling_threshold);
 
     /* sample if enabled & large */
     if (sampled_tables_enabled && totsiz > sampling_threshold) {
-        logmsg(LOGMSG_INFO, "Sampling table '%s' at %d%% coverage\n", td->table, td->scale);
+        if (sketch)
+            logmsg(LOGMSG_INFO, "Sketching table '%s'\n", td->table);
+        else
+            logmsg(LOGMSG_INFO, "Sampling table '%s' at %d%% coverage\n",
+                   td->table, td->scale);
         sampled_table = 1;
-        rc = sample_indicies(td, &clnt, tbl, td->scale, td->sb);
+        rc = sample_indicies(td, &clnt, tbl, td->scale, sketch, td->sb);
         if (rc) {
             snprintf(sql, sizeof(sql), "Sampling table '%s'", td->table);
             goto error;
         }
     }
 
-    clnt.is_analyze = 1;
+    if (sampled_table && sketch) {
+        /* the sketches already summarize every key; sqlite has nothing to
+         * scan */
+        snprintf(sql, sizeof(sql), "Writing sketched stats for '%s'",
+                 td->table);
+        rc = write_sketched_table(&clnt, tbl);
+        if (rc)
+            goto error;
+    } else {
+        clnt.is_analyze = 1;
 
-    /* run analyze as sql query */
-    snprintf(sql, sizeof(sql), "analyzesqlite main.\"%s\"", td->table);
-    rc = run_internal_sql_clnt(&clnt, sql);
-    clnt.is_analyze = 0;
-    if (rc)
-        goto error;
+        /* run analyze as sql query */
+        snprintf(sql, sizeof(sql), "analyzesqlite main.\"%s\"", td->table);
+        rc = run_internal_sql_clnt(&clnt, sql);
+        clnt.is_analyze = 0;
+        if (rc)
+            goto error;
+    }
 
     snprintf(sql, sizeof(sql), "COMMIT");
     rc = run_internal_sql_clnt(&clnt, sql);
@@ -101,6 +101,7 @@
 #include "eventlog.h"
 
 #include <bbinc/str0.h>
+#include <gettimeofday_ms.h>
 
 unsigned long long get_id(bdb_state_type *);
 
@@ -134,6 +135,7 @@ void free_cached_idx(uint8_t **cached_idx)
 
 extern int sqldbgflag;
 extern int gbl_notimeouts;
+extern int gbl_fdb_stream_flush_ms;
 extern int gbl_move_deadlk_max_attempt;
 extern int gbl_fdb_track;
 extern int gbl_selectv_rangechk;
@@ -566,6 +568,15 @@ static int sql_tick(struct sql_thread *thd, int uses_bdb_locking)
         }
     }
 
+    /* rows of a remote cursor waiting in the socket buffer go out once they
+       are old enough, even if the scan finds nothing else for a while */
+    if (clnt->fdb_state.stream_batch_start && clnt->fdb_state.remote_sql_sb &&
+        gettimeofday_ms() - clnt->fdb_state.stream_batch_start >=
+            gbl_fdb_stream_flush_ms) {
+        clnt->fdb_state.stream_batch_start = 0;
+        sbuf2flush(clnt->fdb_state.remote_sql_sb);
+    }
+
     if (clnt->limits.maxcost && (thd->cost > clnt->limits.maxcost))
         /* TODO: we need a nice way to set sqlite3_errmsg() */
         return SQLITE_LIMIT;
@@ -690,6 +701,9 @@ void done_sql_thread(void)
 
 static int get_data_int(BtCursor *, struct schema *, uint8_t *in, int fnum,
                         Mem *, uint8_t flip_orig, const char *tzname);
+static inline int ondisk_decode_field(BtCursor *, struct schema *, uint8_t *in,
+                                      int fnum, Mem *, uint8_t flip_orig,
+                                      const char *tzname);
 
 static int ondisk_to_sqlite_tz(struct dbtable *db, struct schema *s, void *inp,
                                int rrn, unsigned long long genid, void *outp,
@@ -737,7 +751,7 @@ static int ondisk_to_sqlite_tz(struct dbtable *db, struct schema *s, void *inp,
 
     for (fnum = 0; fnum < nField; fnum++) {
         memset(&m[fnum], 0, sizeof(Mem));
-        rc = get_data_int(pCur, s, in, fnum, &m[fnum], 1, tzname);
+        rc = ondisk_decode_field(pCur, s, in, fnum, &m[fnum], 1, tzname);
         if (rc)
             goto done;
         type[fnum] =
@@ -821,6 +835,22 @@ static int ondisk_to_sqlite(struct dbtable *db, struct schema *s, void *inp, int
                                blob, blobsz, bloboffs, reqsize, NULL, NULL);
 }
 
+/* Convert an ondisk key of index ixnum to a sqlite record of its key columns,
+ * without a genid.  There is no cursor behind the key, so every field must be
+ * stored in the key itself.  Same return codes as ondisk_to_sqlite. */
+int ondisk_key_to_sqlite(struct dbtable *db, int ixnum, void *key, void *outp,
+                         int maxout, int *reqsize)
+{
+    BtCursor cur = {0};
+
+    cur.db = db;
+    cur.sc = db->ixschema[ixnum];
+    cur.ixnum = -1;
+    cur.nCookFields = -1;
+    return ondisk_to_sqlite_tz(db, cur.sc, key, 0, 0, outp, maxout, 0, NULL,
+                               NULL, NULL, reqsize, NULL, &cur);
+}
+
 /* Called by convert_failure_reason_str() to decode the sql specific part. */
 int convert_sql_failure_reason_str(const struct convert_failure *reason,
                                    char *out, size_t outlen)
@@ -6795,14 +6825,403 @@ done:
     return rc;
 }
 
+/*
+ * Precompiled ondisk -> Mem decode plans.
+ *
+ * get_data_int() re-examines the field type, the descend flag and the
+ * conversion options for every column of every row.  The plan resolves that
+ * once per schema (and therefore once per schema version, since a schema
+ * change installs new schema objects) into an array of decoder functions.
+ * The common fixed-width types get a specialised decoder; everything else
+ * (descending keys, datetimes, intervals, decimals, blobs) maps to
+ * get_data_int() itself.
+ */
+typedef int (*ondisk_decode_f)(BtCursor *, struct schema *, uint8_t *in,
+                               int fnum, Mem *, uint8_t flip_orig,
+                               const char *tzname);
+
+struct ondisk_decode_plan {
+    int nfields;
+    ondisk_decode_f decode[1];
+};
+
+int gbl_sql_decode_plan = 1;
+
+static inline int ondisk_decode_null(uint8_t *in, Mem *m)
+{
+    if (stype_is_null(in)) {
+        m->z = NULL;
+        m->n = 0;
+        m->flags = MEM_Null;
+        return 1;
+    }
+    return 0;
+}
+
+static int decode_bint2(BtCursor *pCur, struct schema *sc, uint8_t *in,
+                        int fnum, Mem *m, uint8_t flip_orig,
+                        const char *tzname)
+{
+    int2b from;
+    comdb2_int2 val;
+
+    in += sc->member[fnum].offset;
+    if (ondisk_decode_null(in, m))
+        return 0;
+    memcpy(&from, &in[1], sizeof(from));
+    int2b_to_int2(ntohs(from), &val);
+    m->u.i = val;
+    m->flags = MEM_Int;
+    return 0;
+}
+
+static int decode_bint4(BtCursor *pCur, struct schema *sc, uint8_t *in,
+                        int fnum, Mem *m, uint8_t flip_orig,
+                        const char *tzname)
+{
+    int4b from;
+    comdb2_int4 val;
+
+    in += sc->member[fnum].offset;
+    if (ondisk_decode_null(in, m))
+        return 0;
+    memcpy(&from, &in[1], sizeof(from));
+    int4b_to_int4(ntohl(from), &val);
+    m->u.i = val;
+    m->flags = MEM_Int;
+    return 0;
+}
+
+static int decode_bint8(BtCursor *pCur, struct schema *sc, uint8_t *in,
+                        int fnum, Mem *m, uint8_t flip_orig,
+                        const char *tzname)
+{
+    int8b from;
+    comdb2_int8 val;
+
+    in += sc->member[fnum].offset;
+    if (ondisk_decode_null(in, m))
+        return 0;
+    memcpy(&from, &in[1], sizeof(from));
+    int8b_to_int8(flibc_ntohll(from), &val);
+    m->u.i = val;
+    m->flags = MEM_Int;
+    return 0;
+}
+
+static int decode_uint2(BtCursor *pCur, struct schema *sc, uint8_t *in,
+                        int fnum, Mem *m, uint8_t flip_orig,
+                        const char *tzname)
+{
+    unsigned short from;
+
+    in += sc->member[fnum].offset;
+    if (ondisk_decode_null(in, m))
+        return 0;
+    memcpy(&from, &in[1], sizeof(from));
+    m->u.i = ntohs(from);
+    m->flags = MEM_Int;
+    return 0;
+}
+
+static int decode_uint4(BtCursor *pCur, struct schema *sc, uint8_t *in,
+                        int fnum, Mem *m, uint8_t flip_orig,
+                        const char *tzname)
+{
+    unsigned int from;
+
+    in += sc->member[fnum].offset;
+    if (ondisk_decode_null(in, m))
+        return 0;
+    memcpy(&from, &in[1], sizeof(from));
+    m->u.i = ntohl(from);
+    m->flags = MEM_Int;
+    return 0;
+}
+
+static int decode_breal4(BtCursor *pCur, struct schema *sc, uint8_t *in,
+                         int fnum, Mem *m, uint8_t flip_orig,
+                         const char *tzname)
+{
+    ieee4b from;
+    ieee4 val;
+
+    in += sc->member[fnum].offset;
+    if (ondisk_decode_null(in, m))
+        return 0;
+    memcpy(&from, &in[1], sizeof(from));
+    ieee4b_to_ieee4(ntohl(from), &val);
+    m->u.r = val;
+    m->flags = MEM_Real;
+    return 0;
+}
+
+static int decode_breal8(BtCursor *pCur, struct schema *sc, uint8_t *in,
+                         int fnum, Mem *m, uint8_t flip_orig,
+                         const char *tzname)
+{
+    ieee8b from;
+    ieee8 val;
+
+    in += sc->member[fnum].offset;
+    if (ondisk_decode_null(in, m))
+        return 0;
+    memcpy(&from, &in[1], sizeof(from));
+    ieee8b_to_ieee8(flibc_ntohll(from), &val);
+    m->u.r = val;
+    m->flags = MEM_Real;
+    return 0;
+}
+
+static int decode_bcstr(BtCursor *pCur, struct schema *sc, uint8_t *in,
+                        int fnum, Mem *m, uint8_t flip_orig,
+                        const char *tzname)
+{
+    struct field *f = &sc->member[fnum];
+
+    in += f->offset;
+    if (ondisk_decode_null(in, m))
+        return 0;
+    m->z = (char *)&in[1];
+    m->n = cstrlenlim((char *)&in[1], f->len - 1);
+    m->flags = MEM_Str | MEM_Ephem;
+    return 0;
+}
+
+static int decode_bytearray(BtCursor *pCur, struct schema *sc, uint8_t *in,
+                            int fnum, Mem *m, uint8_t flip_orig,
+                            const char *tzname)
+{
+    struct field *f = &sc->member[fnum];
+
+    in += f->offset;
+    if (ondisk_decode_null(in, m))
+        return 0;
+    m->z = (char *)&in[1];
+    m->n = f->len - 1;
+    m->flags = MEM_Blob | MEM_Ephem;
+    return 0;
+}
+
+static ondisk_decode_f ondisk_decode_for_field(const struct field *f)
+{
+    if (f->flags & INDEX_DESCEND)
+        return get_data_int;
+
+    switch (f->type) {
+    case SERVER_BINT:
+        switch (f->len) {
+        case 3:
+            return decode_bint2;
+        case 5:
+            return decode_bint4;
+        case 9:
+            return decode_bint8;
+        }
+        break;
+    case SERVER_UINT:
+        /* 8 byte unsigned needs the range check in get_data_int */
+        switch (f->len) {
+        case 3:
+            return decode_uint2;
+        case 5:
+            return decode_uint4;
+        }
+        break;
+    case SERVER_BREAL:
+        switch (f->len) {
+        case 5:
+            return decode_breal4;
+        case 9:
+            return decode_breal8;
+        }
+        break;
+    case SERVER_BCSTR:
+        return decode_bcstr;
+    case SERVER_BYTEARRAY:
+        return decode_bytearray;
+    }
+    return get_data_int;
+}
+
+static struct ondisk_decode_plan *ondisk_decode_plan_get(struct schema *sc)
+{
+    struct ondisk_decode_plan *plan = sc->decode_plan;
+    int i;
+
+    if (likely(plan != NULL))
+        return plan;
+
+    plan = malloc(offsetof(struct ondisk_decode_plan, decode) +
+                  sizeof(ondisk_decode_f) * (sc->nmembers + 1));
+    if (plan == NULL)
+        return NULL;
+    plan->nfields = sc->nmembers;
+    for (i = 0; i < sc->nmembers; i++)
+        plan->decode[i] = ondisk_decode_for_field(&sc->member[i]);
+
+    /* Plans are immutable once published; if another cursor beat us to it,
+     * use theirs.  The plan is freed with the schema. */
+    if (!__sync_bool_compare_and_swap(&sc->decode_plan, NULL, plan)) {
+        free(plan);
+        plan = sc->decode_plan;
+    }
+    return plan;
+}
+
+static inline int ondisk_decode_field(BtCursor *pCur, struct schema *sc,
+                                      uint8_t *in, int fnum, Mem *m,
+                                      uint8_t flip_orig, const char *tzname)
+{
+    struct ondisk_decode_plan *plan;
+
+    if (gbl_sql_decode_plan && (plan = ondisk_decode_plan_get(sc)) != NULL)
+        return plan->decode[fnum](pCur, sc, in, fnum, m, flip_orig, tzname);
+    return get_data_int(pCur, sc, in, fnum, m, flip_orig, tzname);
+}
+
+/* Decode the first ncols columns of nrows ondisk rows of schema sc into a
+ * column-major array of Mems: out[col * nrows + row].  Walking the plan one
+ * column at a time keeps the same decoder hot for the whole batch.  The Mems
+ * may point into the row buffers, which must outlive them.  Returns 0 on
+ * success or the first decoder error. */
+int ondisk_decode_rows(BtCursor *pCur, struct schema *sc, uint8_t **rows,
+                       int nrows, int ncols, Mem *out, const char *tzname)
+{
+    struct ondisk_decode_plan *plan;
+    ondisk_decode_f decode;
+    int col, row, rc;
+    Mem *m;
+
+    if (ncols > sc->nmembers)
+        ncols = sc->nmembers;
+
+    plan = gbl_sql_decode_plan ? ondisk_decode_plan_get(sc) : NULL;
+
+    for (col = 0; col < ncols; col++) {
+        decode = plan ? plan->decode[col] : get_data_int;
+        m = &out[col * nrows];
+        for (row = 0; row < nrows; row++, m++) {
+            memset(m, 0, sizeof(Mem));
+            rc = decode(pCur, sc, rows[row], col, m, 0, tzname);
+            if (rc)
+                return rc;
+        }
+    }
+    return 0;
+}
+
+enum { DECODE_BENCH_BATCH = 256 };
+
+/* "decode_bench" message trap: load up to nrows records of a table and time
+ * decoding them passes times through the per-field get_data_int() switch and
+ * through the batched plan in ondisk_decode_rows(). */
+void ondisk_decode_bench(const char *tablename, int nrows, int passes)
+{
+    struct dbtable *db;
+    struct schema *sc;
+    struct ireq iq;
+    unsigned long long genids[MAXDTASTRIPE] = {0};
+    unsigned long long genid;
+    uint8_t *dta = NULL, **rows = NULL;
+    Mem *m = NULL;
+    BtCursor cur = {0};
+    uint64_t start, switch_ms, plan_ms;
+    int stripe = 0, dtalen, n, i, row, col, pass, rc = 0;
+
+    db = get_dbtable_by_name(tablename);
+    if (db == NULL) {
+        logmsg(LOGMSG_ERROR, "decode_bench: no such table %s\n", tablename);
+        return;
+    }
+    sc = db->schema;
+    if (sc->numblobs) {
+        /* blob and vutf8 overflow fetches need a live cursor */
+        logmsg(LOGMSG_ERROR, "decode_bench: table %s has blob fields\n",
+               tablename);
+        return;
+    }
+
+    dta = malloc((size_t)nrows * db->lrl);
+    rows = malloc(sizeof(uint8_t *) * nrows);
+    m = malloc(sizeof(Mem) * sc->nmembers * DECODE_BENCH_BATCH);
+    if (!dta || !rows || !m) {
+        logmsg(LOGMSG_ERROR, "decode_bench: out of memory\n");
+        goto done;
+    }
+
+    init_fake_ireq(thedb, &iq);
+    iq.usedb = db;
+    for (n = 0; n < nrows; n++) {
+        rows[n] = dta + (size_t)n * db->lrl;
+        rc = dtas_next(&iq, genids, &genid, &stripe, 0, rows[n], NULL,
+                       db->lrl, &dtalen, NULL);
+        if (rc)
+            break;
+        genids[stripe] = genid;
+    }
+    if (rc < 0) {
+        logmsg(LOGMSG_ERROR, "decode_bench: dtas_next rc %d\n", rc);
+        goto done;
+    }
+    if (n == 0) {
+        logmsg(LOGMSG_ERROR, "decode_bench: table %s is empty\n", tablename);
+        goto done;
+    }
+
+    cur.db = db;
+    cur.sc = sc;
+    cur.ixnum = -1;
+
+    start = gettimeofday_ms();
+    for (pass = 0; pass < passes; pass++) {
+        for (row = 0; row < n; row++) {
+            for (col = 0; col < sc->nmembers; col++) {
+                memset(&m[col], 0, sizeof(Mem));
+                if ((rc = get_data_int(&cur, sc, rows[row], col, &m[col], 0,
+                                       NULL)) != 0)
+                    goto decode_err;
+            }
+        }
+    }
+    switch_ms = gettimeofday_ms() - start;
+
+    start = gettimeofday_ms();
+    for (pass = 0; pass < passes; pass++) {
+        for (row = 0; row < n; row += DECODE_BENCH_BATCH) {
+            i = (n - row) < DECODE_BENCH_BATCH ? (n - row) : DECODE_BENCH_BATCH;
+            if ((rc = ondisk_decode_rows(&cur, sc, &rows[row], i, sc->nmembers,
+                                         m, NULL)) != 0)
+                goto decode_err;
+        }
+    }
+    plan_ms = gettimeofday_ms() - start;
+
+    logmsg(LOGMSG_USER, "decode_bench %s: %d rows x %d columns x %d passes\n",
+           tablename, n, sc->nmembers, passes);
+    logmsg(LOGMSG_USER, "  per-field switch: %" PRIu64 " ms, %.0f rows/sec\n",
+           switch_ms,
+           switch_ms ? (double)n * passes * 1000 / switch_ms : 0.0);
+    logmsg(LOGMSG_USER, "  batched plan:     %" PRIu64 " ms, %.0f rows/sec\n",
+           plan_ms, plan_ms ? (double)n * passes * 1000 / plan_ms : 0.0);
+    goto done;
+
+decode_err:
+    logmsg(LOGMSG_ERROR, "decode_bench: decode failed rc %d\n", rc);
+done:
+    free(m);
+    free(rows);
+    free(dta);
+}
+
 int get_data(BtCursor *pCur, void *invoid, int fnum, Mem *m)
 {
     if (unlikely(pCur->cursor_class == CURSORCLASS_REMOTE)) {
         /* convert the remote buffer to M array */
         abort(); /* this is suppsed to be a cooked access */
     } else {
-        return get_data_int(pCur, pCur->sc, invoid, fnum, m, 0,
-                            pCur->clnt->tzname);
+        return ondisk_decode_field(pCur, pCur->sc, invoid, fnum, m, 0,
+                                   pCur->clnt->tzname);
     }
 }
 
@@ -6816,8 +7235,8 @@ int get_datacopy(BtCursor *pCur, int fnum, Mem *m)
         vtag_to_ondisk_vermap(pCur->db, in, NULL, ver);
     }
 
-    return get_data_int(pCur, pCur->db->schema, in, fnum, m, 0,
-                        pCur->clnt->tzname);
+    return ondisk_decode_field(pCur, pCur->db->schema, in, fnum, m, 0,
+                               pCur->clnt->tzname);
 }
 
 static int
@@ -105,6 +105,7 @@
 #include "mem.h"
 #include "comdb2_atomic.h"
 #include "logmsg.h"
+#include <gettimeofday_ms.h>
 
 /* delete this after comdb2_api.h changes makes it through */
 #define SQLHERR_MASTER_QUEUE_FULL -108
@@ -117,6 +118,8 @@ extern unsigned int gbl_new_row_data;
 extern int gbl_use_appsock_as_sqlthread;
 extern int g_osql_max_trans;
 extern int gbl_fdb_track;
+extern int gbl_fdb_stream_batch_bytes;
+extern int gbl_fdb_stream_flush_ms;
 extern int gbl_return_long_column_names;
 extern int gbl_stable_rootpages_test;
 
@@ -2851,23 +2854,21 @@ int sqlhint_cmp(const void *key1, const void *key2, int len)
     return strcmp((char *)s1, (char *)s2);
 }
 
+/* Every sql thread looks hints up here, so the cache locks per shard
+ * instead of behind gbl_sql_lock. */
+#define SQL_HINT_CACHE_SHARDS 16
+
 void init_sql_hint_table()
 {
-    sql_hints = lrucache_init(sqlhint_hash, sqlhint_cmp, free,
-                              offsetof(sql_hint_hash_entry_type, lnk),
-                              offsetof(sql_hint_hash_entry_type, sql_hint),
-                              sizeof(char *), gbl_max_sql_hint_cache);
+    sql_hints = lrucache_init_concurrent(
+        sqlhint_hash, sqlhint_cmp, free, offsetof(sql_hint_hash_entry_type, lnk),
+        offsetof(sql_hint_hash_entry_type, sql_hint), sizeof(char *),
+        gbl_max_sql_hint_cache, SQL_HINT_CACHE_SHARDS);
 }
 
-void reinit_sql_hint_table()
-{
-    pthread_mutex_lock(&gbl_sql_lock);
-    {
-        delete_sql_hint_table();
-        init_sql_hint_table();
-    }
-    pthread_mutex_unlock(&gbl_sql_lock);
-}
+/* Lookups don't take gbl_sql_lock, so the cache itself can't be replaced
+ * here; drop everything that isn't in use instead. */
+void reinit_sql_hint_table() { lrucache_clear(sql_hints); }
 
 static int add_sql_hint_table(char *sql_hint, char *sql_str, char *tag)
 {
@@ -2894,6 +2895,7 @@ static int add_sql_hint_table(char *sql_hint, char *sql_str, char *tag)
         entry->tag = NULL;
     }
 
+    /* the check and the add have to be atomic */
     pthread_mutex_lock(&gbl_sql_lock);
     {
         if (lrucache_hasentry(sql_hints, &sql_hint) == 0) {
@@ -2911,11 +2913,7 @@ static int add_sql_hint_table(char *sql_hint, char *sql_str, char *tag)
 static int find_sql_hint_table(char *sql_hint, char **sql_str, char **tag)
 {
     sql_hint_hash_entry_type *entry;
-    pthread_mutex_lock(&gbl_sql_lock);
-    {
-        entry = lrucache_find(sql_hints, &sql_hint);
-    }
-    pthread_mutex_unlock(&gbl_sql_lock);
+    entry = lrucache_find(sql_hints, &sql_hint);
     if (entry) {
         *sql_str = entry->sql_str;
         *tag = entry->tag;
@@ -2926,13 +2924,230 @@ static int find_sql_hint_table(char *sql_hint, char **sql_str, char **tag)
 
 static int has_sql_hint_table(char *sql_hint)
 {
-    int ret;
-    pthread_mutex_lock(&gbl_sql_lock);
-    {
-        ret = lrucache_hasentry(sql_hints, &sql_hint);
+    return lrucache_hasentry(sql_hints, &sql_hint);
+}
+
+/** Compiled statements shared by all sql threads.
+  * Every sql thread has its own statement cache, so a hot statement used to
+  * be compiled once per thread, and again by each of them after a schema
+  * change.  A thread that misses in its own cache looks here first.  Each
+  * entry holds a template of the compiled program (sqlite/vdbeclone.c),
+  * which any thread can clone into its own sqlite handle: that looks up the
+  * tables, indices, collations and functions the program uses by name,
+  * instead of parsing and planning the statement again.
+  *
+  * Entries are keyed by the statement text (or its cache hint) with leading
+  * and trailing blanks and semicolons removed, the schema and analyze
+  * generations the thread's handle was built from, and the planner effort.
+  * Blanks inside the statement are kept: result column names are taken
+  * from the statement text.
+  **/
+
+int gbl_max_shared_sqlcache = 0;
+
+struct shared_stmt_key {
+    int dbopen_gen;
+    int analyze_gen;
+    int planner_effort;
+    int len;
+    const char *sql;
+};
+
+typedef struct {
+    struct shared_stmt_key key;
+    lrucache_link lnk;
+    sqlite3_stmt_template *tmpl; /* set once, by the first thread to compile */
+    unsigned int hits;
+    unsigned int clones;
+    unsigned int prepares;
+    unsigned int last_prepare_us;
+    char sql[1];
+} shared_stmt_entry;
+
+static lrucache *shared_stmts = NULL;
+static pthread_mutex_t shared_stmts_add_lk = PTHREAD_MUTEX_INITIALIZER;
+
+static unsigned int shared_stmt_hash(const void *p, int len)
+{
+    const struct shared_stmt_key *k = p;
+    const unsigned char *s = (const unsigned char *)k->sql;
+    unsigned h = (k->dbopen_gen * 31 + k->analyze_gen) * 31 + k->planner_effort;
+
+    for (int i = 0; i < k->len; i++)
+        h = ((h % 8388013) << 8) + s[i];
+    return h;
+}
+
+static int shared_stmt_cmp(const void *key1, const void *key2, int len)
+{
+    const struct shared_stmt_key *k1 = key1, *k2 = key2;
+    if (k1->dbopen_gen != k2->dbopen_gen)
+        return k1->dbopen_gen - k2->dbopen_gen;
+    if (k1->analyze_gen != k2->analyze_gen)
+        return k1->analyze_gen - k2->analyze_gen;
+    if (k1->planner_effort != k2->planner_effort)
+        return k1->planner_effort - k2->planner_effort;
+    if (k1->len != k2->len)
+        return k1->len - k2->len;
+    return memcmp(k1->sql, k2->sql, k1->len);
+}
+
+static void free_shared_stmt(void *p)
+{
+    shared_stmt_entry *entry = p;
+    sqlite3_stmt_template_free(entry->tmpl);
+    free(entry);
+}
+
+void init_shared_stmts(void)
+{
+    if (gbl_max_shared_sqlcache <= 0)
+        return;
+    shared_stmts = lrucache_init_concurrent(
+        shared_stmt_hash, shared_stmt_cmp, free_shared_stmt,
+        offsetof(shared_stmt_entry, lnk), offsetof(shared_stmt_entry, key),
+        sizeof(struct shared_stmt_key), gbl_max_shared_sqlcache,
+        SQL_HINT_CACHE_SHARDS);
+}
+
+/* Find, adding it if needed, and pin the shared entry for sql.  Returns
+ * NULL if sharing is off or the statement is too long to share. */
+static shared_stmt_entry *get_shared_stmt(struct sqlthdstate *thd,
+                                          struct sqlclntstate *clnt,
+                                          const char *sql,
+                                          struct shared_stmt_key *k)
+{
+    shared_stmt_entry *entry;
+    int len;
+
+    if (shared_stmts == NULL)
+        return NULL;
+
+    while (isspace((unsigned char)*sql) || *sql == ';')
+        sql++;
+    len = strlen(sql);
+    while (len > 0 &&
+           (isspace((unsigned char)sql[len - 1]) || sql[len - 1] == ';'))
+        len--;
+    if (len == 0 || len >= MAX_HASH_SQL_LENGTH)
+        return NULL;
+
+    k->dbopen_gen = thd->dbopen_gen;
+    k->analyze_gen = thd->analyze_gen;
+    k->planner_effort = clnt->planner_effort;
+    k->len = len;
+    k->sql = sql;
+
+    entry = lrucache_find(shared_stmts, k);
+    if (entry == NULL) {
+        pthread_mutex_lock(&shared_stmts_add_lk);
+        if (!lrucache_hasentry(shared_stmts, k)) {
+            entry = calloc(1, offsetof(shared_stmt_entry, sql) + len + 1);
+            memcpy(entry->sql, sql, len);
+            entry->key = *k;
+            entry->key.sql = entry->sql;
+            lrucache_add(shared_stmts, entry);
+        }
+        pthread_mutex_unlock(&shared_stmts_add_lk);
+        entry = lrucache_find(shared_stmts, k);
     }
-    pthread_mutex_unlock(&gbl_sql_lock);
-    return ret;
+    return entry;
+}
+
+/* Build a statement from the shared template, if there is one that fits
+ * this thread's handle. */
+static int clone_shared_stmt(struct sqlthdstate *thd, shared_stmt_entry *entry,
+                             struct sql_state *rec)
+{
+    if (entry == NULL || entry->tmpl == NULL)
+        return -1;
+    if (sqlite3_stmt_template_clone(thd->sqldb, entry->tmpl, rec->sql,
+                                    &rec->stmt) != SQLITE_OK)
+        return -1;
+    return 0;
+}
+
+/* Offer a statement this thread just compiled, and hasn't run yet, as the
+ * entry's template.  The first thread to get there wins.  Text after the
+ * statement wasn't compiled, so such statements aren't shared. */
+static void share_stmt(shared_stmt_entry *entry, sqlite3_stmt *stmt,
+                       const char *tail)
+{
+    sqlite3_stmt_template *tmpl;
+
+    if (entry == NULL || entry->tmpl != NULL)
+        return;
+    while (tail && (isspace((unsigned char)*tail) || *tail == ';'))
+        tail++;
+    if (tail && *tail)
+        return;
+    if ((tmpl = sqlite3_stmt_template_create(stmt)) == NULL)
+        return;
+    if (!__sync_bool_compare_and_swap(&entry->tmpl, NULL, tmpl))
+        sqlite3_stmt_template_free(tmpl);
+}
+
+/* Count a statement cache hit, a clone, or a compile that took prepare_us,
+ * and unpin the entry.  Failed compiles aren't counted. */
+static void put_shared_stmt(shared_stmt_entry *entry,
+                            struct shared_stmt_key *k, sqlite3_stmt *stmt,
+                            int hit, int cloned, unsigned int prepare_us)
+{
+    if (entry == NULL)
+        return;
+    if (hit) {
+        ATOMIC_ADD(entry->hits, 1);
+    } else if (cloned) {
+        ATOMIC_ADD(entry->clones, 1);
+    } else if (stmt) {
+        ATOMIC_ADD(entry->prepares, 1);
+        entry->last_prepare_us = prepare_us;
+    }
+    lrucache_release(shared_stmts, k);
+}
+
+struct shared_stmt_collect {
+    struct stmt_cache_stats *stats;
+    int nstats;
+    int alloc;
+};
+
+static void collect_shared_stmt(void *ent, void *arg)
+{
+    shared_stmt_entry *entry = ent;
+    struct shared_stmt_collect *c = arg;
+
+    if (c->nstats == c->alloc) {
+        c->alloc = c->alloc ? c->alloc * 2 : 64;
+        c->stats = realloc(c->stats, c->alloc * sizeof(struct stmt_cache_stats));
+    }
+    struct stmt_cache_stats *st = &c->stats[c->nstats++];
+    st->sql = strdup(entry->sql);
+    st->dbopen_gen = entry->key.dbopen_gen;
+    st->analyze_gen = entry->key.analyze_gen;
+    st->hits = entry->hits;
+    st->clones = entry->clones;
+    st->prepares = entry->prepares;
+    st->last_prepare_us = entry->last_prepare_us;
+    st->memused = sqlite3_stmt_template_size(entry->tmpl);
+}
+
+int get_stmt_cache_stats(struct stmt_cache_stats **stats, int *nstats)
+{
+    struct shared_stmt_collect c = {0};
+
+    if (shared_stmts)
+        lrucache_for(shared_stmts, collect_shared_stmt, &c);
+    *stats = c.stats;
+    *nstats = c.nstats;
+    return 0;
+}
+
+void free_stmt_cache_stats(struct stmt_cache_stats *stats, int nstats)
+{
+    for (int i = 0; i < nstats; i++)
+        free(stats[i].sql);
+    free(stats);
 }
 
 #define SQLCACHEHINT "/*+ RUNCOMDB2SQL"
@@ -3890,11 +4105,7 @@ void put_prepared_stmt(struct sqlthdstate *thd, struct sqlclntstate *clnt,
     clear_stmt_record(rec);
     if ((rec->status & CACHE_HAS_HINT) && (rec->status & CACHE_FOUND_STR)) {
         char *k = rec->cache_hint;
-        pthread_mutex_lock(&gbl_sql_lock);
-        {
-            lrucache_release(sql_hints, &k);
-        }
-        pthread_mutex_unlock(&gbl_sql_lock);
+        lrucache_release(sql_hints, &k);
     }
 }
 
@@ -4095,9 +4306,24 @@ static int get_prepared_stmt_int(struct sqlthdstate *thd,
     if (rec->sql)
         reqlog_set_sql(thd->logger, rec->sql);
     const char *tail = NULL;
+    int cached = rec->stmt != NULL;
+    int cloned = 0;
+    struct shared_stmt_key shared_key;
+    shared_stmt_entry *shared = get_shared_stmt(
+        thd, clnt, (rec->status & CACHE_HAS_HINT) ? rec->cache_hint : rec->sql,
+        &shared_key);
+    uint64_t prepare_start = (cached || !shared) ? 0 : time_epochus();
     while (rec->stmt == NULL) {
         clnt->no_transaction = 1;
-        rc = sqlite3_prepare_v2(thd->sqldb, rec->sql, -1, &rec->stmt, &tail);
+        if (clone_shared_stmt(thd, shared, rec) == 0) {
+            cloned = 1;
+            rc = SQLITE_OK;
+        } else {
+            rc = sqlite3_prepare_v2(thd->sqldb, rec->sql, -1, &rec->stmt,
+                                    &tail);
+            if (rc == SQLITE_OK && rec->stmt)
+                share_stmt(shared, rec->stmt, tail);
+        }
         clnt->no_transaction = 0;
         if (rc == SQLITE_OK) {
             rc = sqlite3LockStmtTables(rec->stmt);
@@ -4108,6 +4334,8 @@ static int get_prepared_stmt_int(struct sqlthdstate *thd,
         sql_remote_schema_changed(clnt, rec->stmt);
         update_schema_remotes(clnt, rec);
     }
+    put_shared_stmt(shared, &shared_key, rec->stmt, cached, cloned,
+                    shared && !cached ? time_epochus() - prepare_start : 0);
     if (rec->stmt) {
         sqlite3_resetclock(rec->stmt);
         thr_set_current_sql(rec->sql);
@@ -7860,112 +8088,93 @@ static int do_query_on_master_check(struct sqlclntstate *clnt,
     return 0;
 }
 
-int handle_newsql_requests(struct thr_handle *thr_self, SBUF2 *sb)
+/* Nothing is in flight and nothing is buffered, so the connection can wait
+   for its next query without holding an appsock thread. */
+static int newsql_can_park(struct sqlclntstate *clnt)
 {
-    int rc = 0;
-    struct sqlclntstate clnt;
-
-    reset_clnt(&clnt, sb, 1);
-    clnt.tzname[0] = '\0';
-    clnt.is_newsql = 1;
-
-    if (active_appsock_conns >
-        bdb_attr_get(thedb->bdb_attr, BDB_ATTR_MAXAPPSOCKSLIMIT)) {
-        logmsg(LOGMSG_WARN,
-               "%s: Exhausted appsock connections, total %d connections \n",
-               __func__, active_appsock_conns);
-        char *err = "Exhausted appsock connections.";
-        struct fsqlresp resp;
-        bzero(&resp, sizeof(resp));
-        resp.response = FSQL_ERROR;
-        resp.rcode = SQLHERR_APPSOCK_LIMIT;
-        rc = fsql_write_response(&clnt, &resp, err, strlen(err) + 1, 1,
-                                 __func__, __LINE__);
-        goto done;
-    }
+    if (!gbl_newsql_park_idle)
+        return 0;
+    if (clnt->in_client_trans || clnt->ctrl_sqlengine != SQLENG_NORMAL_PROCESS ||
+        clnt->osql.history || clnt->query)
+        return 0;
+    return sbuf2pending(clnt->sb) == 0;
+}
 
-    extern int gbl_allow_incoherent_sql;
-    if (!gbl_allow_incoherent_sql && !bdb_am_i_coherent(thedb->bdb_env)) {
-        logmsg(LOGMSG_ERROR,
-               "%s:%d td %u new query on incoherent node, dropping socket\n",
-               __func__, __LINE__, (uint32_t)pthread_self());
-        goto done;
+static void newsql_done(struct sqlclntstate *clnt)
+{
+    if (clnt->ctrl_sqlengine == SQLENG_INTRANS_STATE) {
+        handle_sql_intrans_unrecoverable_error(clnt);
     }
 
-    CDB2QUERY *query = read_newsql_query(&clnt, sb);
-    if (query == NULL)
-        goto done;
-    assert(query->sqlquery);
-    CDB2SQLQUERY *sql_query = query->sqlquery;
-    clnt.query = query;
-
-    if (do_query_on_master_check(&clnt, sql_query))
-        goto done;
+    close_sp(clnt);
+    osql_clean_sqlclntstate(clnt);
 
-#ifdef DEBUGQUERY
-    printf("\n Query '%s'\n", sql_query->sql_query);
-#endif
+    if (clnt->dbglog) {
+        sbuf2close(clnt->dbglog);
+        clnt->dbglog = NULL;
+    }
 
-    pthread_mutex_init(&clnt.wait_mutex, NULL);
-    pthread_cond_init(&clnt.wait_cond, NULL);
-    pthread_mutex_init(&clnt.write_lock, NULL);
-    pthread_mutex_init(&clnt.dtran_mtx, NULL);
+    if (clnt->query) {
+        if (clnt->added_to_hist == 1) {
+            clnt->query = NULL;
+        } else {
+            cdb2__query__free_unpacked(clnt->query, &pb_alloc);
+            clnt->query = NULL;
+        }
+    }
 
-    clnt.osql.count_changes = 1;
-    clnt.dbtran.mode = tdef_to_tranlevel(gbl_sql_tranlevel_default);
-    set_high_availability(&clnt, 0);
-    // clnt.high_availability = 0;
+    /* XXX free logical tran?  */
+    close_appsock(clnt->sb);
 
-    /* these connections shouldn't time out */
-    sbuf2settimeout(clnt.sb, 0, 0);
+    clnt->dbtran.mode = TRANLEVEL_INVALID;
+    set_high_availability(clnt, 0);
+    if (clnt->query_stats)
+        free(clnt->query_stats);
 
-    int notimeout = disable_server_sql_timeouts();
-    sbuf2settimeout(
-        sb, bdb_attr_get(thedb->bdb_attr, BDB_ATTR_MAX_SQL_IDLE_TIME) * 1000,
-        notimeout ? 0 : gbl_sqlwrtimeoutms);
-    sbuf2flush(sb);
-    net_set_writefn(sb, fsql_writer);
+    for (int i = 0, len = clnt->ncontext; i != len; ++i)
+        free(clnt->context[i]);
+    free(clnt->context);
 
-    int wrtimeoutsec;
-    if (gbl_sqlwrtimeoutms == 0 || notimeout)
-        wrtimeoutsec = 0;
-    else
-        wrtimeoutsec = gbl_sqlwrtimeoutms / 1000;
+    pthread_mutex_destroy(&clnt->wait_mutex);
+    pthread_cond_destroy(&clnt->wait_cond);
+    pthread_mutex_destroy(&clnt->write_lock);
+    pthread_mutex_destroy(&clnt->dtran_mtx);
 
-    net_add_watch_warning(
-        sb, bdb_attr_get(thedb->bdb_attr, BDB_ATTR_MAX_SQL_IDLE_TIME),
-        wrtimeoutsec, &clnt, watcher_warning_function);
+    free(clnt);
+}
 
-    /* appsock threads aren't sql threads so for appsock pool threads
-     * sqlthd will be NULL */
-    struct sql_thread *sqlthd = pthread_getspecific(query_info_key);
-    if (sqlthd) {
-        bzero(&sqlthd->sqlclntstate->conn, sizeof(struct conninfo));
-        sqlthd->sqlclntstate->origin[0] = 0;
-    }
+/* Run queries on this connection until it closes or fails.  Returns 1 if the
+   connection went idle and was parked, in which case clnt no longer belongs
+   to the caller. */
+static int newsql_loop(struct thr_handle *thr_self, struct sqlclntstate *clnt,
+                       CDB2QUERY *query)
+{
+    CDB2SQLQUERY *sql_query;
+    SBUF2 *sb = clnt->sb;
+    int rc = 0;
 
     while (query) {
         assert(query->sqlquery);
         sql_query = query->sqlquery;
-        clnt.sql_query = sql_query;
-        clnt.sql = sql_query->sql_query;
-        clnt.query = query;
-        clnt.added_to_hist = 0;
+        clnt->sql_query = sql_query;
+        clnt->sql = sql_query->sql_query;
+        clnt->query = query;
+        clnt->added_to_hist = 0;
 
-        if (!clnt.in_client_trans) {
-            bzero(&clnt.effects, sizeof(clnt.effects));
-            bzero(&clnt.log_effects, sizeof(clnt.log_effects));
-            clnt.trans_has_sp = 0;
+        if (!clnt->in_client_trans) {
+            bzero(&clnt->effects, sizeof(clnt->effects));
+            bzero(&clnt->log_effects, sizeof(clnt->log_effects));
+            clnt->trans_has_sp = 0;
         }
-        clnt.is_newsql = 1;
-        if (clnt.dbtran.mode < TRANLEVEL_SOSQL) {
-            clnt.dbtran.mode = TRANLEVEL_SOSQL;
+        clnt->is_newsql = 1;
+        if (clnt->dbtran.mode < TRANLEVEL_SOSQL) {
+            clnt->dbtran.mode = TRANLEVEL_SOSQL;
         }
-        clnt.osql.sent_column_data = 0;
-        clnt.stop_this_statement = 0;
+        clnt->osql.sent_column_data = 0;
+        clnt->stop_this_statement = 0;
 
-        if ((clnt.tzname[0] == '\0') && sql_query->tzname)
-            strncpy(clnt.tzname, sql_query->tzname, sizeof(clnt.tzname));
+        if ((clnt->tzname[0] == '\0') && sql_query->tzname)
+            strncpy(clnt->tzname, sql_query->tzname, sizeof(clnt->tzname));
 
         if (sql_query->dbname && thedb->envname &&
             strcasecmp(sql_query->dbname, thedb->envname)) {
@@ -7979,151 +8188,230 @@ int handle_newsql_requests(struct thr_handle *thr_self, SBUF2 *sb)
             resp.response = FSQL_COLUMN_DATA;
             resp.flags = 0;
             resp.rcode = CDB2__ERROR_CODE__WRONG_DB;
-            fsql_write_response(&clnt, &resp, (void *)errstr, strlen(errstr) + 1, 1 /*flush*/, __func__, __LINE__);
-            goto done;
+            fsql_write_response(clnt, &resp, (void *)errstr, strlen(errstr) + 1, 1 /*flush*/, __func__, __LINE__);
+            return 0;
         }
 
         if (sql_query->client_info) {
-            if (clnt.conninfo.pid &&
-                clnt.conninfo.pid != sql_query->client_info->pid) {
+            if (clnt->conninfo.pid &&
+                clnt->conninfo.pid != sql_query->client_info->pid) {
                 /* Different pid is coming without reset. */
                 logmsg(LOGMSG_WARN,
                        "Multiple processes using same socket PID 1 %d "
                        "PID 2 %d Host %.8x\n",
-                       clnt.conninfo.pid, sql_query->client_info->pid,
+                       clnt->conninfo.pid, sql_query->client_info->pid,
                        sql_query->client_info->host_id);
             }
-            clnt.conninfo.pid = sql_query->client_info->pid;
-            clnt.conninfo.node = sql_query->client_info->host_id;
+            clnt->conninfo.pid = sql_query->client_info->pid;
+            clnt->conninfo.node = sql_query->client_info->host_id;
         }
 
-        if (process_set_commands(&clnt))
-            goto done;
+        if (process_set_commands(clnt))
+            return 0;
 
-        if (gbl_rowlocks && clnt.dbtran.mode != TRANLEVEL_SERIAL)
-            clnt.dbtran.mode = TRANLEVEL_SNAPISOL;
+        if (gbl_rowlocks && clnt->dbtran.mode != TRANLEVEL_SERIAL)
+            clnt->dbtran.mode = TRANLEVEL_SNAPISOL;
 
         if (sql_query->little_endian) {
-            clnt.have_endian = 1;
-            clnt.endian = FSQL_ENDIAN_LITTLE_ENDIAN;
+            clnt->have_endian = 1;
+            clnt->endian = FSQL_ENDIAN_LITTLE_ENDIAN;
         } else {
-            clnt.have_endian = 0;
+            clnt->have_endian = 0;
         }
 
         /* avoid new accepting new queries/transaction on opened connections
            if we are incoherent (and not in a transaction). */
-        if (clnt.ignore_coherency == 0 && !bdb_am_i_coherent(thedb->bdb_env) &&
-            (clnt.ctrl_sqlengine == SQLENG_NORMAL_PROCESS)) {
+        if (clnt->ignore_coherency == 0 && !bdb_am_i_coherent(thedb->bdb_env) &&
+            (clnt->ctrl_sqlengine == SQLENG_NORMAL_PROCESS)) {
             logmsg(LOGMSG_ERROR, "%s line %d td %u new query on incoherent node, "
                             "dropping socket\n",
                     __func__, __LINE__, (uint32_t)pthread_self());
-            goto done;
+            return 0;
         }
 
-        clnt.heartbeat = 1;
+        clnt->heartbeat = 1;
 
-        if (clnt.had_errors && strncasecmp(clnt.sql, "commit", 6) &&
-            strncasecmp(clnt.sql, "rollback", 8)) {
-            if (clnt.in_client_trans == 0) {
-                clnt.had_errors = 0;
+        if (clnt->had_errors && strncasecmp(clnt->sql, "commit", 6) &&
+            strncasecmp(clnt->sql, "rollback", 8)) {
+            if (clnt->in_client_trans == 0) {
+                clnt->had_errors = 0;
                 /* tell blobmem that I want my priority back
                    when the sql thread is done */
                 comdb2bma_pass_priority_back(blobmem);
-                rc = dispatch_sql_query(&clnt);
+                rc = dispatch_sql_query(clnt);
             } else {
                 /* Do Nothing */
-                send_heartbeat(&clnt);
+                send_heartbeat(clnt);
             }
-        } else if (clnt.had_errors) {
+        } else if (clnt->had_errors) {
             /* Do Nothing */
-            if (clnt.ctrl_sqlengine == SQLENG_STRT_STATE)
-                clnt.ctrl_sqlengine = SQLENG_NORMAL_PROCESS;
+            if (clnt->ctrl_sqlengine == SQLENG_STRT_STATE)
+                clnt->ctrl_sqlengine = SQLENG_NORMAL_PROCESS;
 
-            clnt.had_errors = 0;
-            clnt.in_client_trans = 0;
+            clnt->had_errors = 0;
+            clnt->in_client_trans = 0;
             rc = -1;
         } else {
             /* tell blobmem that I want my priority back
                when the sql thread is done */
             comdb2bma_pass_priority_back(blobmem);
-            rc = dispatch_sql_query(&clnt);
+            rc = dispatch_sql_query(clnt);
         }
 
-        if (clnt.osql.replay == OSQL_RETRY_DO) {
-            if (clnt.trans_has_sp == 0) {
-                srs_tran_replay(&clnt, thr_self);
+        if (clnt->osql.replay == OSQL_RETRY_DO) {
+            if (clnt->trans_has_sp == 0) {
+                srs_tran_replay(clnt, thr_self);
             } else {
-                osql_set_replay(__FILE__, __LINE__, &clnt, OSQL_RETRY_NONE);
-                srs_tran_destroy(&clnt);
+                osql_set_replay(__FILE__, __LINE__, clnt, OSQL_RETRY_NONE);
+                srs_tran_destroy(clnt);
             }
         } else {
             /* if this transaction is done (marked by SQLENG_NORMAL_PROCESS),
                clean transaction sql history
             */
-            if (clnt.osql.history &&
-                clnt.ctrl_sqlengine == SQLENG_NORMAL_PROCESS)
-                srs_tran_destroy(&clnt);
+            if (clnt->osql.history &&
+                clnt->ctrl_sqlengine == SQLENG_NORMAL_PROCESS)
+                srs_tran_destroy(clnt);
         }
 
-        if (rc && !clnt.in_client_trans)
-            goto done;
+        if (rc && !clnt->in_client_trans)
+            return 0;
 
-        pthread_mutex_lock(&clnt.wait_mutex);
-        if (clnt.query) {
-            if (clnt.added_to_hist == 1) {
-                clnt.query = NULL;
+        pthread_mutex_lock(&clnt->wait_mutex);
+        if (clnt->query) {
+            if (clnt->added_to_hist == 1) {
+                clnt->query = NULL;
             } else {
-                cdb2__query__free_unpacked(clnt.query, &pb_alloc);
-                clnt.query = NULL;
+                cdb2__query__free_unpacked(clnt->query, &pb_alloc);
+                clnt->query = NULL;
             }
         }
-        pthread_mutex_unlock(&clnt.wait_mutex);
+        pthread_mutex_unlock(&clnt->wait_mutex);
 
-        query = read_newsql_query(&clnt, sb);
-    }
+        if (newsql_can_park(clnt) && appsock_park_newsql(sb, clnt) == 0)
+            return 1;
 
-done:
-    if (clnt.ctrl_sqlengine == SQLENG_INTRANS_STATE) {
-        handle_sql_intrans_unrecoverable_error(&clnt);
+        query = read_newsql_query(clnt, sb);
     }
 
-    close_sp(&clnt);
-    osql_clean_sqlclntstate(&clnt);
+    return 0;
+}
 
-    if (clnt.dbglog) {
-        sbuf2close(clnt.dbglog);
-        clnt.dbglog = NULL;
+int handle_newsql_requests(struct thr_handle *thr_self, SBUF2 *sb)
+{
+    int rc = 0;
+    struct sqlclntstate *clnt;
+
+    clnt = malloc(sizeof(struct sqlclntstate));
+    if (clnt == NULL) {
+        logmsg(LOGMSG_ERROR, "%s: out of memory\n", __func__);
+        close_appsock(sb);
+        return 0;
     }
+    reset_clnt(clnt, sb, 1);
+    clnt->tzname[0] = '\0';
+    clnt->is_newsql = 1;
 
-    if (clnt.query) {
-        if (clnt.added_to_hist == 1) {
-            clnt.query = NULL;
-        } else {
-            cdb2__query__free_unpacked(clnt.query, &pb_alloc);
-            clnt.query = NULL;
-        }
+    if (active_appsock_conns >
+        bdb_attr_get(thedb->bdb_attr, BDB_ATTR_MAXAPPSOCKSLIMIT)) {
+        logmsg(LOGMSG_WARN,
+               "%s: Exhausted appsock connections, total %d connections \n",
+               __func__, active_appsock_conns);
+        char *err = "Exhausted appsock connections.";
+        struct fsqlresp resp;
+        bzero(&resp, sizeof(resp));
+        resp.response = FSQL_ERROR;
+        resp.rcode = SQLHERR_APPSOCK_LIMIT;
+        rc = fsql_write_response(clnt, &resp, err, strlen(err) + 1, 1,
+                                 __func__, __LINE__);
+        goto done;
     }
 
-    /* XXX free logical tran?  */
-    close_appsock(sb);
+    extern int gbl_allow_incoherent_sql;
+    if (!gbl_allow_incoherent_sql && !bdb_am_i_coherent(thedb->bdb_env)) {
+        logmsg(LOGMSG_ERROR,
+               "%s:%d td %u new query on incoherent node, dropping socket\n",
+               __func__, __LINE__, (uint32_t)pthread_self());
+        goto done;
+    }
 
-    clnt.dbtran.mode = TRANLEVEL_INVALID;
-    set_high_availability(&clnt, 0);
-    if (clnt.query_stats)
-        free(clnt.query_stats);
+    CDB2QUERY *query = read_newsql_query(clnt, sb);
+    if (query == NULL)
+        goto done;
+    assert(query->sqlquery);
+    CDB2SQLQUERY *sql_query = query->sqlquery;
+    clnt->query = query;
 
-    for (int i = 0, len = clnt.ncontext; i != len; ++i)
-        free(clnt.context[i]);
-    free(clnt.context);
+    if (do_query_on_master_check(clnt, sql_query))
+        goto done;
 
-    pthread_mutex_destroy(&clnt.wait_mutex);
-    pthread_cond_destroy(&clnt.wait_cond);
-    pthread_mutex_destroy(&clnt.write_lock);
-    pthread_mutex_destroy(&clnt.dtran_mtx);
+#ifdef DEBUGQUERY
+    printf("\n Query '%s'\n", sql_query->sql_query);
+#endif
+
+    pthread_mutex_init(&clnt->wait_mutex, NULL);
+    pthread_cond_init(&clnt->wait_cond, NULL);
+    pthread_mutex_init(&clnt->write_lock, NULL);
+    pthread_mutex_init(&clnt->dtran_mtx, NULL);
+
+    clnt->osql.count_changes = 1;
+    clnt->dbtran.mode = tdef_to_tranlevel(gbl_sql_tranlevel_default);
+    set_high_availability(clnt, 0);
+    // clnt->high_availability = 0;
+
+    /* these connections shouldn't time out */
+    sbuf2settimeout(clnt->sb, 0, 0);
 
+    int notimeout = disable_server_sql_timeouts();
+    sbuf2settimeout(
+        sb, bdb_attr_get(thedb->bdb_attr, BDB_ATTR_MAX_SQL_IDLE_TIME) * 1000,
+        notimeout ? 0 : gbl_sqlwrtimeoutms);
+    sbuf2flush(sb);
+    net_set_writefn(sb, fsql_writer);
+
+    int wrtimeoutsec;
+    if (gbl_sqlwrtimeoutms == 0 || notimeout)
+        wrtimeoutsec = 0;
+    else
+        wrtimeoutsec = gbl_sqlwrtimeoutms / 1000;
+
+    net_add_watch_warning(
+        sb, bdb_attr_get(thedb->bdb_attr, BDB_ATTR_MAX_SQL_IDLE_TIME),
+        wrtimeoutsec, clnt, watcher_warning_function);
+
+    /* appsock threads aren't sql threads so for appsock pool threads
+     * sqlthd will be NULL */
+    struct sql_thread *sqlthd = pthread_getspecific(query_info_key);
+    if (sqlthd) {
+        bzero(&sqlthd->sqlclntstate->conn, sizeof(struct conninfo));
+        sqlthd->sqlclntstate->origin[0] = 0;
+    }
+
+    if (newsql_loop(thr_self, clnt, query))
+        return 0;
+
+done:
+    newsql_done(clnt);
     return 0;
 }
 
+/* A parked connection is ready (its next query is in the socket) or is being
+   dropped; pick it up on this appsock thread. */
+void newsql_resume(struct thr_handle *thr_self, struct sqlclntstate *clnt,
+                   int action)
+{
+    CDB2QUERY *query;
+
+    if (action == NEWSQL_RESUME) {
+        query = read_newsql_query(clnt, clnt->sb);
+        if (query && newsql_loop(thr_self, clnt, query))
+            return;
+    } else if (action == NEWSQL_IDLE_TIMEOUT) {
+        handle_failed_dispatch(clnt, "Socket read timeout.");
+    }
+    newsql_done(clnt);
+}
+
 int handle_fastsql_requests(struct thr_handle *thr_self, SBUF2 *sb,
                             int *keepsocket, int wrong_db)
 {
@@ -8482,6 +8770,8 @@ static int execute_sql_query_offload_inner_loop(struct sqlclntstate *clnt,
     int rc = 0;
     int tmp;
     int sent;
+    int flush;
+    int first = 1;
 
     if (!clnt->fdb_state.remote_sql_sb) {
         while ((ret = sqlite3_step(stmt)) == SQLITE_ROW)
@@ -8519,10 +8809,27 @@ static int execute_sql_query_offload_inner_loop(struct sqlclntstate *clnt,
             }
 
             if (res.z) {
+                /* stream in batches: the socket buffer sends full ones on
+                   its own, a partial one goes out once it is old enough,
+                   either here or from sql_tick() while the scan runs; the
+                   first row is not held back */
+                flush = 1;
+                if (gbl_fdb_stream_batch_bytes > 0 && !first) {
+                    uint64_t now = gettimeofday_ms();
+                    if (!clnt->fdb_state.stream_batch_start)
+                        clnt->fdb_state.stream_batch_start = now;
+                    flush = (now - clnt->fdb_state.stream_batch_start >=
+                             gbl_fdb_stream_flush_ms);
+                }
+                if (flush)
+                    clnt->fdb_state.stream_batch_start = 0;
+                first = 0;
+
                 /* now we have the packed sqlite row in Mem->z */
                 rc = fdb_svc_sql_row(clnt->fdb_state.remote_sql_sb, cid, res.z,
                                      res.n, IX_FNDMORE,
-                                     clnt->osql.rqid == OSQL_RQID_USE_UUID);
+                                     clnt->osql.rqid == OSQL_RQID_USE_UUID,
+                                     flush);
                 if (rc) {
                     /*
                     fprintf(stderr, "%s: failed to send back sql row\n",
@@ -8557,16 +8864,18 @@ static int execute_sql_query_offload_inner_loop(struct sqlclntstate *clnt,
             sent = 1;
         }
 
+        clnt->fdb_state.stream_batch_start = 0;
+
         /* send the last row, marking flag as such */
         if (!rc) {
             if (sent == 1) {
                 rc = fdb_svc_sql_row(clnt->fdb_state.remote_sql_sb, cid, res.z,
                                      res.n, IX_FND,
-                                     clnt->osql.rqid == OSQL_RQID_USE_UUID);
+                                     clnt->osql.rqid == OSQL_RQID_USE_UUID, 1);
             } else {
                 rc = fdb_svc_sql_row(clnt->fdb_state.remote_sql_sb, cid, res.z,
                                      res.n, IX_EMPTY,
-                                     clnt->osql.rqid == OSQL_RQID_USE_UUID);
+                                     clnt->osql.rqid == OSQL_RQID_USE_UUID, 1);
             }
             if (rc) {
                 /*
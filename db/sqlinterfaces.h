@@ -227,6 +227,13 @@ int handle_fastsql_requests(struct thr_handle *thr_self, SBUF2 *sb,
 
 int handle_newsql_requests(struct thr_handle *thr_self, SBUF2 *sb);
 
+/* idle newsql connections parked with the appsock epoll thread */
+enum { NEWSQL_RESUME = 0, NEWSQL_DROP = 1, NEWSQL_IDLE_TIMEOUT = 2 };
+extern int gbl_newsql_park_idle;
+int appsock_park_newsql(SBUF2 *sb, struct sqlclntstate *clnt);
+void newsql_resume(struct thr_handle *thr_self, struct sqlclntstate *clnt,
+                   int action);
+
 int sql_check_errors(struct sqlclntstate *clnt, sqlite3 *sqldb,
                      sqlite3_stmt *stmt, const char **errstr);
 
@@ -2630,6 +2630,128 @@ int static_tag_blob_conversion(const char *table, const char *ctag,
     return 0;
 }
 
+/* A conversion program for one (from schema, to schema) pair: for every
+ * field of the target, the index of the source field with the same name and,
+ * where the field needs nothing but a plain type conversion, the resolved
+ * SERVER_to_SERVER converter with its offsets and lengths.  Programs hang off
+ * the target schema and go away with it; the source is identified by pointer
+ * and serial, so a schema allocated at the address of a freed one never
+ * picks up a stale program.  Dynamic tags and .NEW. schemas are made and
+ * thrown away per request or per schema change, so conversions from or to
+ * them are not given a program. */
+struct convert_step {
+    int from_idx;            /* -1 if the field is not in the source */
+    server_to_server_f conv; /* NULL: take the stag_to_stag_field path */
+    int in_off;
+    int in_len;
+    int out_off;
+    int out_len;
+};
+
+struct convert_plan {
+    struct convert_plan *next;
+    const struct schema *from;
+    unsigned long long from_serial;
+    int nmembers;
+    struct convert_step step[1];
+};
+
+int gbl_tag_convert_plan = 1;
+static unsigned long long schema_serial;
+
+static unsigned long long get_schema_serial(struct schema *sc)
+{
+    unsigned long long serial = sc->serial;
+    if (serial == 0) {
+        serial = __sync_add_and_fetch(&schema_serial, 1);
+        if (!__sync_bool_compare_and_swap(&sc->serial, 0, serial))
+            serial = sc->serial;
+    }
+    return serial;
+}
+
+static server_to_server_f convert_step_func(const struct schema *from,
+                                            const struct field *from_field,
+                                            const struct schema *to,
+                                            const struct field *to_field)
+{
+    if (from_field->blob_index >= 0 || to_field->blob_index >= 0)
+        return NULL;
+    if ((from_field->flags & INDEX_DESCEND) || (to_field->flags & INDEX_DESCEND))
+        return NULL;
+    if ((to->flags & SCHEMA_INDEX) && to_field->isExpr)
+        return NULL;
+    /* comdb2_seqno may be regenerated, see stag_to_stag_field */
+    if (strcasecmp(to_field->name, "comdb2_seqno") == 0)
+        return NULL;
+    return SERVER_to_SERVER_func(from_field->type, to_field->type);
+}
+
+static struct convert_plan *get_convert_plan(struct schema *from,
+                                             struct schema *to)
+{
+    struct convert_plan *plan, *head;
+    unsigned long long from_serial;
+
+    if (!gbl_tag_convert_plan)
+        return NULL;
+    if ((from->flags & SCHEMA_DYNAMIC) || (to->flags & SCHEMA_DYNAMIC))
+        return NULL;
+    if (from->tag && strncasecmp(from->tag, ".NEW.", 5) == 0)
+        return NULL;
+
+    from_serial = get_schema_serial(from);
+    head = to->convert_plans;
+    for (plan = head; plan; plan = plan->next) {
+        if (plan->from == from && plan->from_serial == from_serial &&
+            plan->nmembers == to->nmembers)
+            return plan;
+    }
+
+    plan = malloc(offsetof(struct convert_plan, step) +
+                  (to->nmembers ? to->nmembers : 1) *
+                      sizeof(struct convert_step));
+    if (plan == NULL)
+        return NULL;
+    plan->from = from;
+    plan->from_serial = from_serial;
+    plan->nmembers = to->nmembers;
+    for (int i = 0; i < to->nmembers; i++) {
+        struct convert_step *step = &plan->step[i];
+        struct field *to_field = &to->member[i];
+
+        step->from_idx = find_field_idx_in_tag(from, to_field->name);
+        step->conv = NULL;
+        if (step->from_idx >= 0) {
+            struct field *from_field = &from->member[step->from_idx];
+            step->conv = convert_step_func(from, from_field, to, to_field);
+            step->in_off = from_field->offset;
+            step->in_len = from_field->len;
+        }
+        step->out_off = to_field->offset;
+        step->out_len = to_field->len;
+    }
+
+    /* Publish; another thread may have raced us in with an equivalent plan,
+     * which is harmless. */
+    do {
+        head = to->convert_plans;
+        plan->next = head;
+    } while (!__sync_bool_compare_and_swap(&to->convert_plans, head, plan));
+    return plan;
+}
+
+static void free_convert_plans(struct schema *sc)
+{
+    struct convert_plan *plan = sc->convert_plans;
+    while (plan) {
+        struct convert_plan *next = plan->next;
+        free(plan);
+        plan = next;
+    }
+    sc->convert_plans = NULL;
+}
+
 /* Form server side record from client record.
 *
 * Inputs:
@@ -2760,11 +2882,16 @@ static int ctag_to_stag_int(const char *table, const char *ctag,
         }
     }
 
+    struct convert_plan *plan = get_convert_plan(from, to);
+
     for (field = 0; field < to->nmembers; field++) {
         int outdtsz = 0;
         blob_buffer_t *outblob = NULL;
         to_field = &to->member[field];
-        field_idx = find_field_idx_in_tag(from, to_field->name);
+        if (plan)
+            field_idx = plan->step[field].from_idx;
+        else
+            field_idx = find_field_idx_in_tag(from, to_field->name);
         /* field in index set to be descending if converting from
            a client index and that field is marked descending
            */
@@ -3341,11 +3468,16 @@ static int _stag_to_ctag_buf(const char *table, const char *stag,
     if (flags & CONVERT_LITTLE_ENDIAN_CLIENT)
         outopts.flags |= FLD_CONV_LENDIAN;
 
+    struct convert_plan *plan = get_convert_plan(from, to);
+
     for (field = 0; field < to->nmembers; field++) {
         int outdtsz = 0;
         blob_buffer_t *outblob = NULL;
         to_field = &to->member[field];
-        field_idx = find_field_idx_in_tag(from, to_field->name);
+        if (plan)
+            field_idx = plan->step[field].from_idx;
+        else
+            field_idx = find_field_idx_in_tag(from, to_field->name);
         null = 0;
 
         if (outblobs && to_field->blob_index >= 0) {
@@ -4088,6 +4220,91 @@ static int stag_to_stag_field(const char *inbuf, char *outbuf, int flags,
     return 0;
 }
 
+/* Same as stag_to_stag_field for a field the plan resolved to a plain type
+ * conversion: no blobs, no descending columns, no expressions, no defaults. */
+static int stag_to_stag_step(const char *inbuf, char *outbuf,
+                             struct convert_failure *fail_reason,
+                             const char *tzname, const struct convert_step *step,
+                             int field, struct schema *fromsch,
+                             struct schema *tosch)
+{
+    struct field *from_field = &fromsch->member[step->from_idx];
+    struct field *to_field = &tosch->member[field];
+    const struct field_conv_opts *outopts = &to_field->convopts;
+    struct field_conv_opts_tz tzopts;
+    int outdtsz = 0;
+    int rc;
+
+    if (fail_reason) {
+        fail_reason->target_field_idx = field;
+        fail_reason->source_field_idx = -1;
+    }
+
+    if ((to_field->flags & NO_NULL) &&
+        field_is_null(fromsch, from_field, inbuf)) {
+        if (fail_reason)
+            fail_reason->reason = CONVERT_FAILED_NULL_CONSTRAINT_VIOLATION;
+        return -1;
+    }
+
+    if (tzname && tzname[0]) {
+        bzero(&tzopts, sizeof(tzopts));
+        memcpy(&tzopts, &to_field->convopts, sizeof(struct field_conv_opts));
+        tzopts.flags |= FLD_CONV_TZONE;
+        strncpy(tzopts.tzname, tzname, sizeof(tzopts.tzname));
+        outopts = (const struct field_conv_opts *)&tzopts;
+    }
+
+    rc = step->conv(inbuf + step->in_off, step->in_len, &from_field->convopts,
+                    NULL, outbuf + step->out_off, step->out_len, &outdtsz,
+                    outopts, NULL);
+    if (rc) {
+        if (fail_reason)
+            fail_reason->reason = CONVERT_FAILED_INCOMPATIBLE_VALUES;
+        return -1;
+    }
+    return 0;
+}
+
+/* Convert every field of tosch, through the cached plan when there is one. */
+static int stag_to_stag_fields(const char *inbuf, char *outbuf, int flags,
+                               struct convert_failure *fail_reason,
+                               blob_buffer_t *inblobs, blob_buffer_t *outblobs,
+                               int maxblobs, const char *tzname,
+                               const int *tagmap, struct schema *fromsch,
+                               struct schema *tosch)
+{
+    struct convert_plan *plan = get_convert_plan(fromsch, tosch);
+    int rc;
+
+    for (int field = 0; field < tosch->nmembers; field++) {
+        int field_idx;
+
+        if (plan) {
+            const struct convert_step *step = &plan->step[field];
+            if (step->conv && !gbl_replicate_local) {
+                rc = stag_to_stag_step(inbuf, outbuf, fail_reason, tzname,
+                                       step, field, fromsch, tosch);
+                if (rc)
+                    return rc;
+                continue;
+            }
+            field_idx = step->from_idx;
+        } else if (tagmap) {
+            field_idx = tagmap[field];
+        } else {
+            field_idx =
+                find_field_idx_in_tag(fromsch, tosch->member[field].name);
+        }
+        rc = stag_to_stag_field(inbuf, outbuf, flags, fail_reason, inblobs,
+                                outblobs, maxblobs, tzname, field_idx, field,
+                                fromsch, tosch);
+        if (rc)
+            return rc;
+    }
+    return 0;
+}
+
 /*
  * On success only outblobs will be valid, there is no need to free up inblobs.
  * On failure the caller should free inblobs and outblobs.
@@ -4124,18 +4341,15 @@ static int _stag_to_stag_buf_flags_blobs(
     if (strcmp(fromtag, totag) == 0)
         same_tag = 1;
 
-    for (int field = 0; field < tosch->nmembers; field++) {
-        int field_idx;
+    if (!same_tag)
+        return stag_to_stag_fields(inbuf, outbuf, flags, fail_reason, inblobs,
+                                   outblobs, maxblobs, tzname, NULL, fromsch,
+                                   tosch);
 
-        if (same_tag) {
-            field_idx = field;
-        } else {
-            field_idx =
-                find_field_idx_in_tag(fromsch, tosch->member[field].name);
-        }
+    for (int field = 0; field < tosch->nmembers; field++) {
         int rc = stag_to_stag_field(inbuf, outbuf, flags, fail_reason, inblobs,
-                                    outblobs, maxblobs, tzname, field_idx,
-                                    field, fromsch, tosch);
+                                    outblobs, maxblobs, tzname, field, field,
+                                    fromsch, tosch);
 
         if (rc)
             return rc;
@@ -4207,14 +4421,8 @@ int stag_to_stag_buf_cachedmap(int tagmap[], struct schema *from,
         maxblobs = 0;
     }
 
-    for (int field = 0; field < to->nmembers; field++) {
-        rc = stag_to_stag_field(inbuf, outbuf, flags, fail_reason, inblobs,
-                                p_newblobs, maxblobs, NULL, tagmap[field],
-                                field, from, to);
-
-        if (rc)
-            break;
-    }
+    rc = stag_to_stag_fields(inbuf, outbuf, flags, fail_reason, inblobs,
+                             p_newblobs, maxblobs, NULL, tagmap, from, to);
 
     if (inblobs) /* if we were given blobs */
     {
@@ -6036,6 +6244,7 @@ void free_tag_schema(struct schema *sc)
             free(sc->member[i].name);
         free(sc->member);
     }
+    free_convert_plans(sc);
     free(sc);
 }
 
@@ -6884,6 +7093,12 @@ void freeschema_internals(struct schema *schema)
         free(schema->sqlitetag);
         schema->sqlitetag = NULL;
     }
+    if (schema->decode_plan) {
+        free(schema->decode_plan);
+        schema->decode_plan = NULL;
+    }
+    free_convert_plans(schema);
+    schema->serial = 0;
 }
 
 void freeschema(struct schema *schema)
@@ -71,6 +71,9 @@ struct schema {
     char *sqlitetag;
     int *datacopy;
     char *where;
+    void *decode_plan; /* sqlglue.c: precompiled ondisk -> Mem decoders */
+    void *convert_plans; /* tag.c: stag_to_stag programs to this schema */
+    unsigned long long serial; /* tag.c: identifies this schema to plans */
     LINKC_T(struct schema) lnk;
 };
 
@@ -13169,6 +13169,20 @@ TYPES_INLINE int SERVER_to_SERVER(const void *in, int inlen, int intype,
     return rc;
 }
 
+/* Return the converter SERVER_to_SERVER would dispatch to for this pair of
+ * types, so callers converting many records can resolve it once. */
+server_to_server_f SERVER_to_SERVER_func(int intype, int outtype)
+{
+    if (intype < SERVER_MINTYPE || intype > SERVER_MAXTYPE)
+        return NULL;
+
+    if (outtype < SERVER_MINTYPE || outtype > SERVER_MAXTYPE)
+        return NULL;
+
+    return server_to_server_convert_map[intype - SERVER_MINTYPE]
+                                       [outtype - SERVER_MINTYPE];
+}
+
 TYPES_INLINE int NULL_to_SERVER(void *out, int outlen, int outtype)
 {
     set_null(out, outlen);
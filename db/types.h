@@ -1847,6 +1847,13 @@ int SERVER_to_SERVER(const void *in, int inlen, int intype,
                      int outtype, int oflags, int *outdtsz,
                      const struct field_conv_opts *outopts,
                      blob_buffer_t *outblob);
+typedef int (*server_to_server_f)(const void *in, int inlen,
+                                  const struct field_conv_opts *inopts,
+                                  blob_buffer_t *inblob, void *out, int outlen,
+                                  int *outdtsz,
+                                  const struct field_conv_opts *outopts,
+                                  blob_buffer_t *outblob);
+server_to_server_f SERVER_to_SERVER_func(int intype, int outtype);
 int SERVER_DATETIME_to_CLIENT_DATETIME(const void *in, int inlen,
                                        const struct field_conv_opts *inopts,
                                        blob_buffer_t *inblob, void *out,
@@ -74,6 +74,9 @@ extern int gbl_break_lua;
 char *gbl_break_spname;
 void *debug_clnt;
 
+int gbl_trigger_batch = 1; /* queue events per trigger transaction */
+int gbl_lua_vm_pool_size = 32; /* idle lua vms kept across connections */
+
 pthread_mutex_t lua_debug_mutex = PTHREAD_MUTEX_INITIALIZER;
 pthread_cond_t lua_debug_cond = PTHREAD_COND_INITIALIZER;
 
@@ -562,6 +565,60 @@ again:  if (*q->open) {
     }
 }
 
+// Checked between the events of a trigger batch.  If this thread should
+// yield (exit, lock desired, incoherent) or re-register with the master, the
+// batch ends early: what has run is committed, and the next dbq_poll()
+// deals with the condition.  The events not run stay queued.
+static int dbq_batch_interrupted(Lua L, dbconsumer_t *q)
+{
+    if (thedb->stopped || thedb->exiting)
+        return 1;
+    if (bdb_lock_desired(thedb->bdb_env))
+        return 1;
+    if (!bdb_am_i_coherent(thedb->bdb_env))
+        return 1;
+    return check_register_condition(L, q);
+}
+
+// Read up to max events queued after prev in one pass, for a trigger which
+// handles several per transaction.  Returns the number read into *out.
+static int dbq_read_batch(dbconsumer_t *q, genid_t prev, int max,
+                          struct qfound **out)
+{
+    struct dbq_cursor cur = {{0}};
+    void **items = malloc(max * sizeof(void *));
+    size_t *lens = malloc(max * sizeof(size_t));
+    int n = 0, rc = -1;
+    memcpy(cur.cursordata, &prev, sizeof(prev));
+    pthread_mutex_lock(q->lock);
+    if (*q->open)
+        rc = dbq_get_batch(&q->iq, 0, &cur, 0, max, items, lens, &n);
+    pthread_mutex_unlock(q->lock);
+    *out = NULL;
+    if (rc == 0) {
+        struct qfound *f = malloc(n * sizeof(struct qfound));
+        for (int i = 0; i < n; ++i) {
+            size_t dtalen;
+            f[i].item = items[i];
+            f[i].len = lens[i];
+            dbq_get_item_info(items[i], &f[i].dtaoff, &dtalen);
+        }
+        *out = f;
+    } else {
+        n = 0;
+    }
+    free(items);
+    free(lens);
+    return n;
+}
+
+static void dbq_free_batch(struct qfound *f, int from, int n)
+{
+    for (int i = from; i < n; ++i)
+        free(f[i].item);
+    free(f);
+}
+
 // this call will block until queue item available
 static int dbconsumer_get_int(Lua L, dbconsumer_t *q)
 {
@@ -2997,8 +3054,20 @@ static int get_func_by_name(Lua L, const char *func, char **err)
 
 static int process_src(Lua L, const char *src, char **err)
 {
+    SP sp = getsp(L);
     int rc;
-    if ((rc = luaL_dostring(L, src)) != 0) {
+    if (src == sp->src && sp->src_ref) {
+        // compiled when it was loaded -- only need to run it again
+        lua_rawgeti(L, LUA_REGISTRYINDEX, sp->src_ref);
+        rc = lua_pcall(L, 0, LUA_MULTRET, 0);
+    } else if ((rc = luaL_loadstring(L, src)) == 0) {
+        if (src == sp->src) {
+            lua_pushvalue(L, -1);
+            sp->src_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+        }
+        rc = lua_pcall(L, 0, LUA_MULTRET, 0);
+    }
+    if (rc != 0) {
         *err = strdup(lua_tostring(L, -1));
         return -1;
     }
@@ -3115,11 +3184,20 @@ static void reset_sp(SP sp)
     LIST_INIT(&sp->tmptbls);
 }
 
-static void free_spversion(SP sp)
+static void free_src(SP sp)
 {
-    sp->spname[0] = 0;
+    if (sp->src_ref) {
+        luaL_unref(sp->lua, LUA_REGISTRYINDEX, sp->src_ref);
+        sp->src_ref = 0;
+    }
     free(sp->src);
     sp->src = NULL;
+}
+
+static void free_spversion(SP sp)
+{
+    sp->spname[0] = 0;
+    free_src(sp);
     sp->spversion.version_num = 0;
     free(sp->spversion.version_str);
     sp->spversion.version_str = NULL;
@@ -3131,6 +3209,8 @@ static void close_sp_int(SP sp, int freesp)
     if (!sp) return;
     reset_sp(sp);
     if (sp->lua) lua_close(sp->lua);
+    sp->lua = NULL;
+    sp->src_ref = 0;
     comdb2ma mspace = sp->mspace;
     free_spversion(sp);
     comdb2ma_destroy(mspace);
@@ -4412,6 +4492,7 @@ static int create_sp_int(SP sp, char **err)
     lua_atpanic(lua, l_panic);
 
     sp->lua = lua;
+    sp->src_ref = 0;
     sp->max_num_instructions = gbl_max_lua_instructions;
     LIST_INIT(&sp->dbstmts);
     LIST_INIT(&sp->tmptbls);
@@ -5752,18 +5833,93 @@ static void process_clnt_sp_override(struct sqlclntstate *clnt)
     apply_clnt_override(clnt, sp);
 }
 
+// Lua vms which connections gave back when they closed, most recently used
+// first.  The next connection to run the same procedure takes one of these
+// with its globals, metatables and compiled src already set up.
+static pthread_mutex_t sp_pool_lk = PTHREAD_MUTEX_INITIALIZER;
+static TAILQ_HEAD(sp_pool_head, stored_proc) sp_pool =
+    TAILQ_HEAD_INITIALIZER(sp_pool);
+static int sp_pool_count;
+
+// Take an idle vm which last ran spname.  Vms loaded before the last
+// procedure change are thrown away.
+static SP get_pooled_sp(const char *spname)
+{
+    SP sp, tmp, found = NULL;
+    struct sp_pool_head stale;
+    TAILQ_INIT(&stale);
+    pthread_mutex_lock(&sp_pool_lk);
+    TAILQ_FOREACH_SAFE(sp, &sp_pool, pool_entry, tmp) {
+        if (sp->lua_version != gbl_lua_version) {
+            TAILQ_REMOVE(&sp_pool, sp, pool_entry);
+            TAILQ_INSERT_TAIL(&stale, sp, pool_entry);
+            --sp_pool_count;
+        } else if (strcmp(sp->spname, spname) == 0) {
+            TAILQ_REMOVE(&sp_pool, sp, pool_entry);
+            --sp_pool_count;
+            found = sp;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&sp_pool_lk);
+    while ((sp = TAILQ_FIRST(&stale)) != NULL) {
+        TAILQ_REMOVE(&stale, sp, pool_entry);
+        close_sp_int(sp, 1);
+    }
+    return found;
+}
+
+// Keep a closing connection's vm for the next caller of the same procedure.
+// Returns 0 if the pool took it.
+static int put_pooled_sp(SP sp)
+{
+    if (gbl_lua_vm_pool_size <= 0 || sp->lua == NULL || sp->src == NULL ||
+        sp->parent != sp || sp->have_consumer ||
+        sp->lua_version != gbl_lua_version) {
+        return -1;
+    }
+    reset_sp(sp);
+    lua_settop(sp->lua, 0);
+    sp->clnt = NULL;
+    sp->debug_clnt = NULL;
+    sp->thd = NULL;
+    sp->emit_mutex = NULL;
+
+    struct sp_pool_head evict;
+    TAILQ_INIT(&evict);
+    pthread_mutex_lock(&sp_pool_lk);
+    TAILQ_INSERT_HEAD(&sp_pool, sp, pool_entry);
+    ++sp_pool_count;
+    while (sp_pool_count > gbl_lua_vm_pool_size) {
+        SP last = TAILQ_LAST(&sp_pool, sp_pool_head);
+        TAILQ_REMOVE(&sp_pool, last, pool_entry);
+        TAILQ_INSERT_TAIL(&evict, last, pool_entry);
+        --sp_pool_count;
+    }
+    pthread_mutex_unlock(&sp_pool_lk);
+    while ((sp = TAILQ_FIRST(&evict)) != NULL) {
+        TAILQ_REMOVE(&evict, sp, pool_entry);
+        close_sp_int(sp, 1);
+    }
+    return 0;
+}
+
 static int setup_sp(char *spname, struct sqlthdstate *thd,
                     struct sqlclntstate *clnt,
                     int *new_vm, // out param
                     char **err)  // out param
 {
     SP sp = clnt->sp;
+    int pooled = 0;
     if (sp) {
         if (clnt->want_stored_procedure_trace ||
             clnt->want_stored_procedure_debug) {
             close_sp(clnt);
             sp = NULL;
         }
+    } else if (!clnt->want_stored_procedure_trace &&
+               !clnt->want_stored_procedure_debug) {
+        pooled = (sp = get_pooled_sp(spname)) != NULL;
     }
     if (sp && sp->lua) {
         // Have lua vm
@@ -5796,8 +5952,7 @@ static int setup_sp(char *spname, struct sqlthdstate *thd,
         }
         if (sp->lua_version != gbl_lua_version) {
             // Stale src
-            free(sp->src);
-            sp->src = NULL;
+            free_src(sp);
         }
     } else {
         // Create lua vm
@@ -5834,6 +5989,10 @@ static int setup_sp(char *spname, struct sqlthdstate *thd,
         }
         *new_vm = 1;
         strcpy(sp->spname, spname);
+    } else if (pooled) {
+        // src is compiled but callers still need to run it and do their
+        // per-vm setup
+        *new_vm = 1;
     }
     if (clnt && (clnt->want_stored_procedure_trace ||
                  clnt->want_stored_procedure_debug)) {
@@ -6621,8 +6780,13 @@ int db_verify_table_callback(void *v, const char *buf)
 
 void close_sp(struct sqlclntstate *clnt)
 {
-    close_sp_int(clnt->sp, 1);
+    SP sp = clnt->sp;
     clnt->sp = NULL;
+    if (sp && !clnt->want_stored_procedure_trace &&
+        !clnt->want_stored_procedure_debug && put_pooled_sp(sp) == 0) {
+        return;
+    }
+    close_sp_int(sp, 1);
 }
 
 void lua_final(sqlite3_context *context)
@@ -6725,9 +6889,12 @@ void *exec_trigger(trigger_reg_t *reg)
     // We're making unprotected calls to lua below.
     // luaL_error() will cause abort()
     dbconsumer_t *q = NULL;
+    struct qfound *batch;
+    int nbatch, ibatch;
     while (1) {
         int rc, args;
         char *err = NULL;
+        batch = NULL;
         get_curtran(thedb->bdb_env, &clnt);
         if (setup_sp_for_trigger(reg, &err, &thd, &clnt, &q) != 0) {
             goto bad;
@@ -6745,10 +6912,17 @@ void *exec_trigger(trigger_reg_t *reg)
             err = strdup(sp->error);
             goto bad;
         }
+        // with trigger_batch > 1, the events after this one are read in one
+        // pass and handled in the same transaction
+        batch = NULL;
+        nbatch = ibatch = 0;
+    next:
         if ((rc = run_sp(&clnt, args, &err)) != 0) {
         rollback:
             db_rollback_int(L, &rc);
         bad:
+            if (batch)
+                dbq_free_batch(batch, ibatch, nbatch);
             puts(err);
             free(err);
             if (args != -2) {
@@ -6763,10 +6937,27 @@ void *exec_trigger(trigger_reg_t *reg)
             err = strdup("trigger returned bad rc");
             goto rollback;
         }
+        genid_t last = q->genid;
         if ((rc = dbconsumer_consume_int(L, q)) != 0) {
             err = strdup("trigger failed to consume");
             goto rollback;
         }
+        if (batch == NULL && gbl_trigger_batch > 1)
+            nbatch = dbq_read_batch(q, last, gbl_trigger_batch - 1, &batch);
+        if (ibatch < nbatch && !dbq_batch_interrupted(L, q)) {
+            if ((rc = get_func_by_name(L, "main", &err)) != 0)
+                goto rollback;
+            sp->num_instructions = 0;
+            if ((args = dbq_pushargs(L, q, &batch[ibatch++])) < 0) {
+                err = strdup(sp->error);
+                goto rollback;
+            }
+            goto next;
+        }
+        if (batch) {
+            dbq_free_batch(batch, ibatch, nbatch);
+            batch = NULL;
+        }
         if ((rc = commit_sp(L, &err)) != 0) {
             logmsg(LOGMSG_ERROR, "trigger:%s commit failed rc:%d -- %s\n",
                    sp->spname, rc, sp->error);
@@ -39,6 +39,7 @@ struct stored_proc {
     char spname[MAX_SPNAME];
     struct spversion_t spversion;
     char *src;
+    int src_ref; // registry ref to src compiled, 0 if not yet
     struct sqlclntstate *clnt;
     struct sqlclntstate *debug_clnt;
     struct sqlthdstate *thd;
@@ -61,6 +62,8 @@ struct stored_proc {
 
     dbstmt_t *prev_dbstmt; // for db_bind -- deprecated
 
+    TAILQ_ENTRY(stored_proc) pool_entry; // idle in vm pool
+
     unsigned initial           : 1;
     unsigned pingpong          : 1;
     unsigned have_consumer     : 1;
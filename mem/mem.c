@@ -840,6 +840,15 @@ void comdb2_free(void *ptr)
     }
 }
 
+comdb2ma comdb2_malloc_owner(void *ptr)
+{
+    void **p = (void **)ptr;
+
+    if (p == NULL || !COMDB2MA_OK_SENTINEL(p))
+        return NULL;
+    return (comdb2ma)p[COMDB2MA_ALLOC_OFS];
+}
+
 char *comdb2_strdup(comdb2ma cm, const char *s)
 {
     size_t len = strlen(s) + 1;
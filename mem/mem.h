@@ -360,6 +360,15 @@ void *comdb2_realloc(comdb2ma ma, void *ptr, size_t n);
 */
 void comdb2_free(void *ptr);
 
+/*
+** Returns the allocator which ptr was allocated from, or NULL if it came
+** from the system malloc.
+**
+** PARAMETERS
+** ptr - pointer.
+*/
+comdb2ma comdb2_malloc_owner(void *ptr);
+
 /*
 ** Comdb2ma strdup.
 **
@@ -60,6 +60,7 @@
 #include <dirent.h>
 #include <utime.h>
 #include <sys/time.h>
+#include <sys/uio.h>
 #include <poll.h>
 
 #include <bb_oscompat.h>
@@ -110,9 +111,14 @@ static int curr_udp_cnt = 0;
 #define MILLION 1000000
 #define BILLION 1000000000
 
+/* Most iovecs handed to a single writev by the writer thread */
+#define NET_WRITEV_IOVS 128
+
 extern int gbl_pmux_route_enabled;
 
 int gbl_verbose_net = 0;
+/* Writer thread sends queued messages with writev instead of through sbuf */
+int gbl_net_writev = 1;
 int subnet_blackout_timems = 5000;
 
 void net_set_subnet_blackout(int ms)
@@ -614,13 +620,14 @@ static void check_list_sizes(host_node_type *host_node_ptr)
  */
 static int write_list(netinfo_type *netinfo_ptr, host_node_type *host_node_ptr,
                       const wire_header_type *headptr, const struct iovec *iov,
-                      int iovcount, int flags)
+                      int iovcount, net_buf_t *ref, int flags)
 {
     write_data *insert;
     int ii;
     size_t datasz;
     char *ptr;
     int rc;
+    int copyref = 0;
 
     Pthread_mutex_lock(&(host_node_ptr->enquelk));
 
@@ -656,6 +663,13 @@ static int write_list(netinfo_type *netinfo_ptr, host_node_type *host_node_ptr,
         if (iov[ii].iov_base)
             datasz += iov[ii].iov_len;
     }
+
+    /* netcmp_rtn looks at the whole message, so a reordered one can't leave
+     * its tail behind */
+    if (ref && (flags & WRITE_MSG_INORDER) && netinfo_ptr->netcmp_rtn) {
+        copyref = 1;
+        datasz += ref->len;
+    }
     if (netinfo_ptr->myhostname_len >= HOSTNAME_LEN)
         datasz += netinfo_ptr->myhostname_len;
     if (host_node_ptr->hostname_len >= HOSTNAME_LEN)
@@ -730,6 +744,16 @@ fprintf(stderr, "[%s] using malloc for %d bytes\n",
             ptr += iov[ii].iov_len;
         }
     }
+    insert->ref = NULL;
+    if (copyref) {
+        memcpy(ptr, ref->data, ref->len);
+        ptr += ref->len;
+    } else if (ref) {
+        net_buf_ref(ref);
+        insert->ref = ref;
+        netinfo_ptr->stats.bytes_referenced += ref->len;
+    }
+    netinfo_ptr->stats.bytes_copied += insert->len;
 
     Pthread_mutex_lock(&(host_node_ptr->enquelk));
 
@@ -797,6 +821,8 @@ fprintf(stderr, "[%s] using malloc for %d bytes\n",
         host_node_ptr->peak_enque_count_time = time_epoch();
     }
     host_node_ptr->enque_bytes += insert->len;
+    if (insert->ref)
+        host_node_ptr->enque_bytes += insert->ref->len;
     if (host_node_ptr->enque_bytes > host_node_ptr->peak_enque_bytes) {
         host_node_ptr->peak_enque_bytes = host_node_ptr->enque_bytes;
         host_node_ptr->peak_enque_bytes_time = time_epoch();
@@ -1109,6 +1135,24 @@ static int read_connect_message(SBUF2 *sb, char hostname[], int hostnamel,
     return 0;
 }
 
+static void free_write_data(host_node_type *host_node_ptr, write_data *ptr)
+{
+    if (ptr->ref)
+        net_buf_unref(ptr->ref);
+
+    if (ptr->pooled) {
+        Pthread_mutex_lock(&(host_node_ptr->pool_lock));
+        pool_relablk(host_node_ptr->write_pool, ptr);
+        Pthread_mutex_unlock(&(host_node_ptr->pool_lock));
+    } else {
+#ifdef PER_THREAD_MALLOC
+        free(ptr);
+#else
+        comdb2_free(ptr);
+#endif
+    }
+}
+
 static int empty_write_list(host_node_type *host_node_ptr)
 {
     write_data *ptr, *nxt;
@@ -1118,19 +1162,7 @@ static int empty_write_list(host_node_type *host_node_ptr)
     nxt = ptr = host_node_ptr->write_head;
     while (nxt != NULL) {
         ptr = ptr->next;
-
-        if (nxt->pooled) {
-            Pthread_mutex_lock(&(host_node_ptr->pool_lock));
-            pool_relablk(host_node_ptr->write_pool, nxt);
-            Pthread_mutex_unlock(&(host_node_ptr->pool_lock));
-        } else {
-#ifdef PER_THREAD_MALLOC
-            free(nxt);
-#else
-            comdb2_free(nxt);
-#endif
-        }
-
+        free_write_data(host_node_ptr, nxt);
         nxt = ptr;
     }
     host_node_ptr->write_head = host_node_ptr->write_tail = NULL;
@@ -1238,9 +1270,10 @@ static int write_connect_message(netinfo_type *netinfo_ptr,
 
 /* To reduce double buffering and other daftness this has evolved a sort of
  * writev style interface with data1 and data2. */
-static int write_message_int(netinfo_type *netinfo_ptr,
+static int write_message_ref(netinfo_type *netinfo_ptr,
                              host_node_type *host_node_ptr, int type,
-                             const struct iovec *iov, int iovcount, int flags)
+                             const struct iovec *iov, int iovcount,
+                             net_buf_t *ref, int flags)
 {
     wire_header_type wire_header;
     int rc;
@@ -1272,7 +1305,7 @@ static int write_message_int(netinfo_type *netinfo_ptr,
 
     /* Add this message to our linked list to send. */
     rc = write_list(netinfo_ptr, host_node_ptr, &wire_header, iov, iovcount,
-                    flags);
+                    ref, flags);
     if (rc < 0) {
         if (rc == -1) {
             logmsg(LOGMSG_ERROR, "%s: got reallybad failure?\n", __func__);
@@ -1289,13 +1322,22 @@ static int write_message_int(netinfo_type *netinfo_ptr,
     return 0;
 }
 
+static int write_message_int(netinfo_type *netinfo_ptr,
+                             host_node_type *host_node_ptr, int type,
+                             const struct iovec *iov, int iovcount, int flags)
+{
+    return write_message_ref(netinfo_ptr, host_node_ptr, type, iov, iovcount,
+                             NULL, flags);
+}
+
 static int write_message_checkhello(netinfo_type *netinfo_ptr,
                                     host_node_type *host_node_ptr, int type,
                                     const struct iovec *iov, int iovcount,
-                                    int nodelay, int nodrop, int inorder)
+                                    net_buf_t *ref, int nodelay, int nodrop,
+                                    int inorder)
 {
-    return write_message_int(netinfo_ptr, host_node_ptr, type, iov, iovcount,
-                             (nodelay ? WRITE_MSG_NODELAY : 0) |
+    return write_message_ref(netinfo_ptr, host_node_ptr, type, iov, iovcount,
+                             ref, (nodelay ? WRITE_MSG_NODELAY : 0) |
                                  WRITE_MSG_NOHELLOCHECK |
                                  (nodrop ? WRITE_MSG_NOLIMIT : 0) |
                                  (inorder ? WRITE_MSG_INORDER : 0));
@@ -1825,8 +1867,8 @@ int net_send_message_payload_ack(netinfo_type *netinfo_ptr, const char *to_host,
         seq_ptr = NULL;
 
     rc = write_message_checkhello(netinfo_ptr, host_node_ptr,
-                                  WIRE_HEADER_USER_MSG, iov, 2, 1 /*nodelay*/,
-                                  0, 0);
+                                  WIRE_HEADER_USER_MSG, iov, 2, NULL,
+                                  1 /*nodelay*/, 0, 0);
 
     if (rc != 0) {
         if (seq_ptr)
@@ -2015,8 +2057,8 @@ void net_set_stack_flush_threshold(int thresh) { stack_flush_min = thresh; }
 
 static int net_send_int(netinfo_type *netinfo_ptr, const char *host,
                         int usertype, void *data, int datalen, int nodelay,
-                        int numtails, void **tails, int *taillens, int nodrop,
-                        int inorder)
+                        int numtails, void **tails, int *taillens,
+                        net_buf_t *reftail, int nodrop, int inorder)
 {
     host_node_type *host_node_ptr;
     net_send_message_header tmphd, msghd;
@@ -2056,6 +2098,8 @@ static int net_send_int(netinfo_type *netinfo_ptr, const char *host,
 
     tailen =
         (numtails > 0 && tails && total_tails_len > 0) ? total_tails_len : 0;
+    if (reftail)
+        tailen += reftail->len;
 
     Pthread_rwlock_rdlock(&(netinfo_ptr->lock));
     host_node_ptr = get_host_node_by_name_ll(netinfo_ptr, host);
@@ -2123,8 +2167,8 @@ static int net_send_int(netinfo_type *netinfo_ptr, const char *host,
     }
 
     rc = write_message_checkhello(netinfo_ptr, host_node_ptr,
-                                  WIRE_HEADER_USER_MSG, iov, iovcount, nodelay,
-                                  nodrop, inorder);
+                                  WIRE_HEADER_USER_MSG, iov, iovcount, reftail,
+                                  nodelay, nodrop, inorder);
 
     /* queue is full */
     if (-2 == rc) {
@@ -2179,7 +2223,7 @@ int net_send_inorder(netinfo_type *netinfo_ptr, const char *host, int usertype,
                      void *data, int datalen, int nodelay)
 {
     return net_send_int(netinfo_ptr, host, usertype, data, datalen, nodelay, 0,
-                        NULL, 0, 0, 1);
+                        NULL, 0, NULL, 0, 1);
 }
 
 int net_send(netinfo_type *netinfo_ptr, const char *host, int usertype,
@@ -2187,7 +2231,7 @@ int net_send(netinfo_type *netinfo_ptr, const char *host, int usertype,
 {
 
     return net_send_int(netinfo_ptr, host, usertype, data, datalen, nodelay, 0,
-                        NULL, 0, 0, 0);
+                        NULL, 0, NULL, 0, 0);
 }
 
 int net_send_nodrop(netinfo_type *netinfo_ptr, const char *host, int usertype,
@@ -2195,7 +2239,7 @@ int net_send_nodrop(netinfo_type *netinfo_ptr, const char *host, int usertype,
 {
 
     return net_send_int(netinfo_ptr, host, usertype, data, datalen, nodelay, 0,
-                        NULL, 0, 1, 0);
+                        NULL, 0, NULL, 1, 0);
 }
 
 int net_send_tails(netinfo_type *netinfo_ptr, const char *host, int usertype,
@@ -2204,7 +2248,7 @@ int net_send_tails(netinfo_type *netinfo_ptr, const char *host, int usertype,
 {
 
     return net_send_int(netinfo_ptr, host, usertype, data, datalen, nodelay,
-                        numtails, tails, taillens, 0, 0);
+                        numtails, tails, taillens, NULL, 0, 0);
 }
 
 int net_send_tail(netinfo_type *netinfo_ptr, const char *host, int usertype,
@@ -2224,7 +2268,35 @@ int net_send_tail(netinfo_type *netinfo_ptr, const char *host, int usertype,
     printf("\n");
 #endif
     return net_send_int(netinfo_ptr, host, usertype, data, datalen, nodelay, 1,
-                        &tail, &tailen, 0, 0);
+                        &tail, &tailen, NULL, 0, 0);
+}
+
+net_buf_t *net_buf_alloc(int len)
+{
+    net_buf_t *buf = malloc(sizeof(net_buf_t) + len);
+    if (buf == NULL)
+        return NULL;
+    buf->refcnt = 1;
+    buf->len = len;
+    buf->data = (char *)(buf + 1);
+    return buf;
+}
+
+void net_buf_ref(net_buf_t *buf) { __sync_add_and_fetch(&buf->refcnt, 1); }
+
+void net_buf_unref(net_buf_t *buf)
+{
+    if (__sync_sub_and_fetch(&buf->refcnt, 1) == 0)
+        free(buf);
+}
+
+/* The message keeps a reference to tail; the caller still owns its own. */
+int net_send_ref(netinfo_type *netinfo_ptr, const char *host, int usertype,
+                 void *data, int datalen, int nodelay, net_buf_t *tail,
+                 int nodrop, int inorder)
+{
+    return net_send_int(netinfo_ptr, host, usertype, data, datalen, nodelay, 0,
+                        NULL, NULL, tail, nodrop, inorder);
 }
 
 /* returns all nodes MINUS you */
@@ -2636,6 +2708,8 @@ static host_node_type *add_to_netinfo_ll(netinfo_type *netinfo_ptr,
     netinfo_ptr->head = ptr;
     ptr->stats.bytes_written = ptr->stats.bytes_read = 0;
     ptr->stats.throttle_waits = ptr->stats.reorders = 0;
+    ptr->stats.bytes_copied = ptr->stats.bytes_referenced = 0;
+    ptr->stats.writevs = 0;
 
     return ptr;
 
@@ -3231,6 +3305,8 @@ static netinfo_type *create_netinfo_int(char myhostname[], int myportnum,
 
     netinfo_ptr->stats.bytes_read = netinfo_ptr->stats.bytes_written = 0;
     netinfo_ptr->stats.throttle_waits = netinfo_ptr->stats.reorders = 0;
+    netinfo_ptr->stats.bytes_copied = netinfo_ptr->stats.bytes_referenced = 0;
+    netinfo_ptr->stats.writevs = 0;
 
     host_node_ptr = add_to_netinfo(netinfo_ptr, myhostname, myportnum);
     if (host_node_ptr == NULL) {
@@ -4177,12 +4253,138 @@ void kill_subnet(char *subnet)
     Pthread_mutex_unlock(&nets_list_lk);
 }
 
+/* Fill in the wire header with the correct details for our current
+ * connection. */
+static void fill_wire_header(netinfo_type *netinfo_ptr,
+                             host_node_type *host_node_ptr, write_data *ptr)
+{
+    wire_header_type *wire_header, tmp_wire_hdr;
+    uint8_t *p_buf, *p_buf_end;
+
+    wire_header = &ptr->payload.header;
+    if (netinfo_ptr->myhostname_len >= HOSTNAME_LEN) {
+        snprintf(tmp_wire_hdr.fromhost, sizeof(tmp_wire_hdr.fromhost), ".%d",
+                 netinfo_ptr->myhostname_len);
+    } else {
+        strncpy(tmp_wire_hdr.fromhost, netinfo_ptr->myhostname,
+                sizeof(tmp_wire_hdr.fromhost));
+    }
+    tmp_wire_hdr.fromport = netinfo_ptr->myport;
+    tmp_wire_hdr.fromnode = 0;
+    if (host_node_ptr->hostname_len >= HOSTNAME_LEN) {
+        snprintf(tmp_wire_hdr.tohost, sizeof(tmp_wire_hdr.tohost), ".%d",
+                 host_node_ptr->hostname_len);
+    } else {
+        strncpy(tmp_wire_hdr.tohost, host_node_ptr->host,
+                sizeof(tmp_wire_hdr.tohost));
+    }
+    tmp_wire_hdr.toport = host_node_ptr->port;
+    tmp_wire_hdr.tonode = 0;
+    tmp_wire_hdr.type = wire_header->type;
+
+    /* This shouldn't happen.. but for a while it was happening
+     * due to various races. */
+    if (tmp_wire_hdr.toport == 0)
+        host_node_errf(LOGMSG_WARN, host_node_ptr, "PORT IS ZERO! type %d\n",
+                       tmp_wire_hdr.type);
+
+    p_buf = (uint8_t *)wire_header;
+    p_buf_end = ((uint8_t *)wire_header + sizeof(*wire_header));
+
+    /* endianize this */
+    net_wire_header_put(&tmp_wire_hdr, p_buf, p_buf_end);
+}
+
+/* Write all of iov to the socket, picking up after short writes.  Waits for
+ * the socket to drain no longer than the sbuf write timeout, like the sbuf
+ * write path does. */
+static int writev_all(netinfo_type *netinfo_ptr, host_node_type *host_node_ptr,
+                      struct iovec *iov, int iovcnt)
+{
+    const int fd = sbuf2fileno(host_node_ptr->sb);
+    int readtimeout, writetimeout;
+    ssize_t n;
+
+    sbuf2gettimeout(host_node_ptr->sb, &readtimeout, &writetimeout);
+
+    while (iovcnt > 0) {
+        n = writev(fd, iov, iovcnt);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN) {
+                struct pollfd pol;
+                int rc;
+                pol.fd = fd;
+                pol.events = POLLOUT;
+                rc = poll(&pol, 1, writetimeout > 0 ? writetimeout : -1);
+                if (rc < 0 && errno == EINTR)
+                    continue;
+                if (rc > 0 && (pol.revents & POLLOUT))
+                    continue;
+                if (rc == 0)
+                    logmsg(LOGMSG_ERROR, "%s: write to %s timed out after "
+                                         "%dms\n",
+                           __func__, host_node_ptr->host, writetimeout);
+            }
+            return -1;
+        }
+        netinfo_ptr->stats.writevs++;
+        netinfo_ptr->stats.bytes_written += n;
+        host_node_ptr->stats.bytes_written += n;
+        while (iovcnt > 0 && n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return 0;
+}
+
+/* Put a batch taken off the write list on the wire with as few syscalls as
+ * possible: each message's copied payload followed by its referenced tail,
+ * straight from the list nodes rather than through the sbuf.  Anything
+ * already buffered in the sbuf goes first. */
+static int writev_list(netinfo_type *netinfo_ptr,
+                       host_node_type *host_node_ptr, write_data *list)
+{
+    struct iovec iov[NET_WRITEV_IOVS];
+    int niov = 0;
+    write_data *ptr;
+
+    if (sbuf2flush(host_node_ptr->sb) < 0)
+        return -1;
+
+    for (ptr = list; ptr != NULL; ptr = ptr->next) {
+        if (niov + 2 > NET_WRITEV_IOVS) {
+            if (writev_all(netinfo_ptr, host_node_ptr, iov, niov))
+                return -1;
+            niov = 0;
+        }
+        iov[niov].iov_base = ptr->payload.raw;
+        iov[niov].iov_len = ptr->len;
+        niov++;
+        if (ptr->ref && ptr->ref->len > 0) {
+            iov[niov].iov_base = ptr->ref->data;
+            iov[niov].iov_len = ptr->ref->len;
+            niov++;
+        }
+    }
+    if (niov && writev_all(netinfo_ptr, host_node_ptr, iov, niov))
+        return -1;
+    return 0;
+}
+
 static void *writer_thread(void *args)
 {
     netinfo_type *netinfo_ptr;
     host_node_type *host_node_ptr;
-    write_data *write_list_ptr, *write_list_back;
-    int rc, flags, maxage;
+    write_data *write_list_ptr, *write_list_back, *ptr;
+    int rc, flags, maxage, use_writev;
     int th_start_time = time_epoch();
     struct timespec waittime;
 #ifndef HAS_CLOCK_GETTIME
@@ -4230,61 +4432,53 @@ static void *writer_thread(void *args)
 
             Pthread_mutex_lock(&(host_node_ptr->write_lock));
             start_time = time_epoch();
+            use_writev =
+                gbl_net_writev && !sslio_has_ssl(host_node_ptr->sb);
+            for (ptr = write_list_ptr; use_writev && ptr; ptr = ptr->next) {
+                if (flags & WRITE_MSG_NODELAY) {
+                    int age = time_epoch() - ptr->enque_time;
+                    if (age > maxage)
+                        maxage = age;
+                }
+                fill_wire_header(netinfo_ptr, host_node_ptr, ptr);
+                flags |= ptr->flags;
+            }
+            if (use_writev) {
+                if (host_node_ptr->closed) {
+                    rc = -1;
+                } else {
+                    if (flags & WRITE_MSG_NODELAY) {
+                        net_delay(host_node_ptr->host);
+                        if (netinfo_ptr->trace && debug_switch_net_verbose())
+                            logmsg(LOGMSG_USER, "Flushing %llu\n", gettmms());
+                    }
+                    rc = writev_list(netinfo_ptr, host_node_ptr,
+                                     write_list_ptr);
+                }
+            }
             while (write_list_ptr != NULL) {
                 /* stop writing if we've hit an error or if we've disconnected
                  */
-                if (!host_node_ptr->closed && rc >= 0) {
-                    int age;
-                    wire_header_type *wire_header, tmp_wire_hdr;
-                    uint8_t *p_buf, *p_buf_end;
-
+                if (use_writev) {
+                    /* already written */
+                } else if (!host_node_ptr->closed && rc >= 0) {
                     if (flags & WRITE_MSG_NODELAY) {
-                        age = time_epoch() - write_list_ptr->enque_time;
+                        int age = time_epoch() - write_list_ptr->enque_time;
                         if (age > maxage)
                             maxage = age;
                     }
 
-                    /* File in the wire header with correct details for our
-                     * current connection. */
-
-                    wire_header = &write_list_ptr->payload.header;
-                    if (netinfo_ptr->myhostname_len >= HOSTNAME_LEN) {
-                        snprintf(tmp_wire_hdr.fromhost,
-                                 sizeof(tmp_wire_hdr.fromhost), ".%d",
-                                 netinfo_ptr->myhostname_len);
-                    } else {
-                        strncpy(tmp_wire_hdr.fromhost, netinfo_ptr->myhostname,
-                                sizeof(tmp_wire_hdr.fromhost));
-                    }
-                    tmp_wire_hdr.fromport = netinfo_ptr->myport;
-                    tmp_wire_hdr.fromnode = 0;
-                    if (host_node_ptr->hostname_len >= HOSTNAME_LEN) {
-                        snprintf(tmp_wire_hdr.tohost,
-                                 sizeof(tmp_wire_hdr.tohost), ".%d",
-                                 host_node_ptr->hostname_len);
-                    } else {
-                        strncpy(tmp_wire_hdr.tohost, host_node_ptr->host,
-                                sizeof(tmp_wire_hdr.tohost));
-                    }
-                    tmp_wire_hdr.toport = host_node_ptr->port;
-                    tmp_wire_hdr.tonode = 0;
-                    tmp_wire_hdr.type = wire_header->type;
-
-                    /* This shouldn't happen.. but for a while it was happening
-                     * due to various races. */
-                    if (tmp_wire_hdr.toport == 0)
-                        host_node_errf(LOGMSG_WARN, host_node_ptr, "PORT IS ZERO! type %d\n",
-                                       tmp_wire_hdr.type);
-
-                    p_buf = (uint8_t *)wire_header;
-                    p_buf_end = ((uint8_t *)wire_header + sizeof(*wire_header));
-
-                    /* endianize this */
-                    net_wire_header_put(&tmp_wire_hdr, p_buf, p_buf_end);
+                    fill_wire_header(netinfo_ptr, host_node_ptr,
+                                     write_list_ptr);
 
                     rc = write_stream(
                         netinfo_ptr, host_node_ptr, host_node_ptr->sb,
                         write_list_ptr->payload.raw, write_list_ptr->len);
+                    if (rc >= 0 && write_list_ptr->ref)
+                        rc = write_stream(netinfo_ptr, host_node_ptr,
+                                          host_node_ptr->sb,
+                                          write_list_ptr->ref->data,
+                                          write_list_ptr->ref->len);
                     flags |= write_list_ptr->flags;
                 } else
                     rc = -1;
@@ -4292,22 +4486,12 @@ static void *writer_thread(void *args)
                 write_list_back = write_list_ptr;
                 write_list_ptr = write_list_ptr->next;
 
-                if (write_list_back->pooled) {
-                    Pthread_mutex_lock(&(host_node_ptr->pool_lock));
-                    pool_relablk(host_node_ptr->write_pool, write_list_back);
-                    Pthread_mutex_unlock(&(host_node_ptr->pool_lock));
-                } else {
-#ifdef PER_THREAD_MALLOC
-                    free(write_list_back);
-#else
-                    comdb2_free(write_list_back);
-#endif
-                }
+                free_write_data(host_node_ptr, write_list_back);
             }
             /* we seem to set nodelay on virtually every message.  try to get
              * slightly better streaming performance by moving the flush out of
              * the main loop. */
-            if (flags & WRITE_MSG_NODELAY) {
+            if ((flags & WRITE_MSG_NODELAY) && !use_writev) {
                 net_delay(host_node_ptr->host);
                 if (netinfo_ptr->trace && debug_switch_net_verbose())
                     logmsg(LOGMSG_USER, "Flushing %llu\n", gettmms());
@@ -6671,6 +6855,16 @@ int net_get_network_usage(netinfo_type *netinfo_ptr,
     return 0;
 }
 
+int net_get_copy_stats(netinfo_type *netinfo_ptr, unsigned long long *copied,
+                       unsigned long long *referenced,
+                       unsigned long long *writevs)
+{
+    *copied = netinfo_ptr->stats.bytes_copied;
+    *referenced = netinfo_ptr->stats.bytes_referenced;
+    *writevs = netinfo_ptr->stats.writevs;
+    return 0;
+}
+
 int net_get_my_port(netinfo_type *netinfo_ptr) { return netinfo_ptr->myport; }
 
 void net_trace(netinfo_type *netinfo_ptr, int on) { netinfo_ptr->trace = on; }
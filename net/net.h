@@ -296,6 +296,26 @@ int net_send_tails(netinfo_type *netinfo_ptr, const char *host, int usertype,
                    void *data, int datalen, int nodelay, int numtails,
                    void **tails, int *taillens);
 
+/* Refcounted send buffer.  Messages sent with net_send_ref hold a reference
+ * to it instead of a copy until the writer thread has put them on the wire;
+ * the buffer is freed when the last reference is dropped. */
+typedef struct net_buf {
+    int refcnt;
+    int len;
+    char *data;
+} net_buf_t;
+
+net_buf_t *net_buf_alloc(int len);
+void net_buf_ref(net_buf_t *buf);
+void net_buf_unref(net_buf_t *buf);
+
+/*
+  same as net_send_tail, but the tail is referenced rather than copied
+*/
+int net_send_ref(netinfo_type *netinfo_ptr, const char *host, int usertype,
+                 void *data, int datalen, int nodelay, net_buf_t *tail,
+                 int nodrop, int inorder);
+
 /* pick a sibling for sql offloading */
 char *net_get_osql_node(netinfo_type *netinfo_ptr);
 
@@ -344,6 +364,10 @@ int net_get_network_usage(netinfo_type *netinfo_ptr,
                           unsigned long long *throttle_waits,
                           unsigned long long *reorders);
 
+int net_get_copy_stats(netinfo_type *netinfo_ptr, unsigned long long *copied,
+                       unsigned long long *referenced,
+                       unsigned long long *writevs);
+
 int net_get_queue_size(netinfo_type *netinfo_type, const char *host, int *limit,
                        int *usage);
 
@@ -66,6 +66,7 @@ typedef struct write_node_data {
     struct write_node_data *next;
     struct write_node_data *prev;
     size_t len;
+    net_buf_t *ref; /* tail sent after the payload without being copied */
     /* Must be last thing in struct; payload immediately follows header */
     union {
         wire_header_type header;
@@ -119,6 +120,9 @@ typedef struct {
     unsigned long long bytes_read;
     unsigned long long throttle_waits;
     unsigned long long reorders;
+    unsigned long long bytes_copied;     /* into write list nodes */
+    unsigned long long bytes_referenced; /* queued as net_buf references */
+    unsigned long long writevs;
 } stats_type;
 
 #define HOSTNAME_LEN 16
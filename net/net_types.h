@@ -84,6 +84,7 @@ enum {
     NET_OSQL_SOCK_REQ_COST_UUID = 169,
     NET_AUTHENTICATION_CHECK = 170,
     NET_OSQL_UUID_REQUEST_MAX,
+    NET_OSQL_RPL_BATCH = 172, /* many osql ops in one frame, offload net only */
 
     MAX_USER_TYPE
 };
@@ -5167,5 +5167,45 @@ char *sqlite3DescribeIndexOrder(
   return ret2;
 }
 
+/* COMDB2 Modifications */
+/*
+** Column list for a remote table scan that only needs the columns in
+** colMask.  Unused columns are sent as NULL so the row keeps the layout of
+** the table.  Returns NULL if every column is needed.
+*/
+char *sqlite3DescribeTableColumns(
+  sqlite3 *db,
+  const char *zName,
+  const char *zDb,
+  unsigned long long colMask)
+{
+  Table          *pTbl;
+  int            i;
+  int            nUsed = 0;
+  char           *ret, *ret2;
+
+  pTbl = sqlite3FindTable(db, zName, zDb);
+  if( !pTbl || pTbl->nCol==0 ){
+    return NULL;
+  }
+
+  ret = NULL;
+  for(i=0; i<pTbl->nCol; i++){
+    int used = (i<63) ? ((colMask>>i)&1) : ((colMask>>63)&1);
+    if( used ) nUsed++;
+    ret2 = sqlite3_mprintf("%s%s%s%s%s", ret?ret:"", ret?", ":"",
+      used?"(":"", used?pTbl->aCol[i].zName:"NULL", used?")":"");
+    sqlite3_free(ret);
+    ret = ret2;
+    if( !ret ) return NULL;
+  }
+
+  if( nUsed==pTbl->nCol ){
+    sqlite3_free(ret);
+    return NULL;
+  }
+  return ret;
+}
+
 
 #endif /* !defined(SQLITE_OMIT_CTE) */
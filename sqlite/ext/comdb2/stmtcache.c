@@ -0,0 +1,202 @@
+/*
+   Copyright 2017 Bloomberg Finance L.P.
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#if (!defined(SQLITE_CORE) || defined(SQLITE_BUILDING_FOR_COMDB2)) &&          \
+    !defined(SQLITE_OMIT_VIRTUALTABLE)
+
+#if defined(SQLITE_BUILDING_FOR_COMDB2) && !defined(SQLITE_CORE)
+#define SQLITE_CORE 1
+#endif
+
+#include <assert.h>
+#include "comdb2systbl.h"
+#include "comdb2systblInt.h"
+#include "comdb2.h"
+#include "sql.h"
+
+/*
+  comdb2_stmt_cache: Compiled statements shared by all sql threads, and how
+  often each was found in a thread's own statement cache, cloned from the
+  shared program, or compiled.
+*/
+
+typedef struct {
+    sqlite3_vtab_cursor base; /* Base class - must be first */
+    sqlite3_int64 rowid;      /* Row ID */
+    struct stmt_cache_stats *stats; /* Snapshot taken when the cursor opens */
+    int nstats;
+} systbl_stmt_cache_cursor;
+
+/* Column numbers (always keep the below table definition in sync). */
+enum {
+    COLUMN_SQL,
+    COLUMN_SCHEMA_VERSION,
+    COLUMN_STATS_VERSION,
+    COLUMN_HITS,
+    COLUMN_CLONES,
+    COLUMN_PREPARES,
+    COLUMN_LAST_PREPARE_US,
+    COLUMN_MEMORY,
+};
+
+static int systblStmtCacheConnect(sqlite3 *db, void *pAux, int argc,
+                                  const char *const *argv,
+                                  sqlite3_vtab **ppVtab, char **pErr)
+{
+    int rc;
+
+    rc = sqlite3_declare_vtab(
+        db, "CREATE TABLE comdb2_stmt_cache(\"sql\", \"schema_version\", "
+            "\"stats_version\", \"hits\", \"clones\", \"prepares\", "
+            "\"last_prepare_us\", \"memory\")");
+
+    if (rc == SQLITE_OK) {
+        if ((*ppVtab = sqlite3_malloc(sizeof(sqlite3_vtab))) == 0) {
+            return SQLITE_NOMEM;
+        }
+        memset(*ppVtab, 0, sizeof(*ppVtab));
+    }
+
+    return SQLITE_OK;
+}
+
+static int systblStmtCacheBestIndex(sqlite3_vtab *tab,
+                                    sqlite3_index_info *pIdxInfo)
+{
+    return SQLITE_OK;
+}
+
+static int systblStmtCacheDisconnect(sqlite3_vtab *pVtab)
+{
+    sqlite3_free(pVtab);
+    return SQLITE_OK;
+}
+
+static int systblStmtCacheOpen(sqlite3_vtab *p, sqlite3_vtab_cursor **ppCursor)
+{
+    systbl_stmt_cache_cursor *cur =
+        sqlite3_malloc(sizeof(systbl_stmt_cache_cursor));
+    if (cur == 0) {
+        return SQLITE_NOMEM;
+    }
+    memset(cur, 0, sizeof(*cur));
+    *ppCursor = &cur->base;
+
+    get_stmt_cache_stats(&cur->stats, &cur->nstats);
+
+    return SQLITE_OK;
+}
+
+static int systblStmtCacheClose(sqlite3_vtab_cursor *cur)
+{
+    systbl_stmt_cache_cursor *pCur = (systbl_stmt_cache_cursor *)cur;
+    free_stmt_cache_stats(pCur->stats, pCur->nstats);
+    sqlite3_free(cur);
+    return SQLITE_OK;
+}
+
+static int systblStmtCacheFilter(sqlite3_vtab_cursor *pVtabCursor, int idxNum,
+                                 const char *idxStr, int argc,
+                                 sqlite3_value **argv)
+{
+    systbl_stmt_cache_cursor *pCur = (systbl_stmt_cache_cursor *)pVtabCursor;
+    pCur->rowid = 0;
+    return SQLITE_OK;
+}
+
+static int systblStmtCacheNext(sqlite3_vtab_cursor *cur)
+{
+    systbl_stmt_cache_cursor *pCur = (systbl_stmt_cache_cursor *)cur;
+    pCur->rowid++;
+    return SQLITE_OK;
+}
+
+static int systblStmtCacheEof(sqlite3_vtab_cursor *cur)
+{
+    systbl_stmt_cache_cursor *pCur = (systbl_stmt_cache_cursor *)cur;
+    return (pCur->rowid >= pCur->nstats) ? 1 : 0;
+}
+
+static int systblStmtCacheColumn(sqlite3_vtab_cursor *cur,
+                                 sqlite3_context *ctx, int pos)
+{
+    systbl_stmt_cache_cursor *pCur = (systbl_stmt_cache_cursor *)cur;
+    struct stmt_cache_stats *st = &pCur->stats[pCur->rowid];
+
+    switch (pos) {
+    case COLUMN_SQL:
+        sqlite3_result_text(ctx, st->sql, -1, NULL);
+        break;
+    case COLUMN_SCHEMA_VERSION:
+        sqlite3_result_int(ctx, st->dbopen_gen);
+        break;
+    case COLUMN_STATS_VERSION:
+        sqlite3_result_int(ctx, st->analyze_gen);
+        break;
+    case COLUMN_HITS:
+        sqlite3_result_int64(ctx, st->hits);
+        break;
+    case COLUMN_CLONES:
+        sqlite3_result_int64(ctx, st->clones);
+        break;
+    case COLUMN_PREPARES:
+        sqlite3_result_int64(ctx, st->prepares);
+        break;
+    case COLUMN_LAST_PREPARE_US:
+        sqlite3_result_int64(ctx, st->last_prepare_us);
+        break;
+    case COLUMN_MEMORY:
+        sqlite3_result_int(ctx, st->memused);
+        break;
+    default: assert(0);
+    };
+
+    return SQLITE_OK;
+}
+
+static int systblStmtCacheRowid(sqlite3_vtab_cursor *cur, sqlite_int64 *pRowid)
+{
+    systbl_stmt_cache_cursor *pCur = (systbl_stmt_cache_cursor *)cur;
+    *pRowid = pCur->rowid;
+
+    return SQLITE_OK;
+}
+
+const sqlite3_module systblStmtCacheModule = {
+    0,                         /* iVersion */
+    0,                         /* xCreate */
+    systblStmtCacheConnect,    /* xConnect */
+    systblStmtCacheBestIndex,  /* xBestIndex */
+    systblStmtCacheDisconnect, /* xDisconnect */
+    0,                         /* xDestroy */
+    systblStmtCacheOpen,       /* xOpen - open a cursor */
+    systblStmtCacheClose,      /* xClose - close a cursor */
+    systblStmtCacheFilter,     /* xFilter - configure scan constraints */
+    systblStmtCacheNext,       /* xNext - advance a cursor */
+    systblStmtCacheEof,        /* xEof - check for end of scan */
+    systblStmtCacheColumn,     /* xColumn - read data */
+    systblStmtCacheRowid,      /* xRowid - read data */
+    0,                         /* xUpdate */
+    0,                         /* xBegin */
+    0,                         /* xSync */
+    0,                         /* xCommit */
+    0,                         /* xRollback */
+    0,                         /* xFindMethod */
+    0,                         /* xRename */
+};
+
+#endif /* (!defined(SQLITE_CORE) || defined(SQLITE_BUILDING_FOR_COMDB2))       \
+          && !defined(SQLITE_OMIT_VIRTUALTABLE) */
@@ -237,6 +237,8 @@ int comdb2SystblInit(
     rc = sqlite3_create_module(db, "comdb2_tunables", &systblTunablesModule, 0);
   if (rc == SQLITE_OK)
     rc = sqlite3_create_module(db, "comdb2_threadpools", &systblThreadPoolsModule, 0);
+  if (rc == SQLITE_OK)
+    rc = sqlite3_create_module(db, "comdb2_stmt_cache", &systblStmtCacheModule, 0);
   if (rc == SQLITE_OK)
     rc = sqlite3_create_module(db, "comdb2_completion", &completionModule, 0);
 #endif
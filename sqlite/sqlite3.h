@@ -5837,6 +5837,28 @@ SQLITE_API void sqlite3_reset_auto_extension(void);
 */
 SQLITE_API int SQLITE_STDCALL sqlite3_stmt_has_remotes(sqlite3_stmt *stmt);
 
+/*
+** COMDB2 MODIFICATION
+** A copy of a prepared statement's program that isn't tied to the
+** connection that compiled it.  sqlite3_stmt_template_create() returns 0
+** for statements that can't be shared, and must be called before the
+** statement is first stepped.  sqlite3_stmt_template_clone() builds a
+** statement for zSql from the template on any connection with the same
+** schema, or returns an error, in which case zSql should be prepared
+** normally.  A template is read-only, and can be cloned by several
+** threads at once.
+*/
+typedef struct sqlite3_stmt_template sqlite3_stmt_template;
+SQLITE_API sqlite3_stmt_template *SQLITE_STDCALL sqlite3_stmt_template_create(
+  sqlite3_stmt *stmt);
+SQLITE_API int SQLITE_STDCALL sqlite3_stmt_template_clone(
+  sqlite3 *db, const sqlite3_stmt_template *tmpl, const char *zSql,
+  sqlite3_stmt **ppStmt);
+SQLITE_API int SQLITE_STDCALL sqlite3_stmt_template_size(
+  const sqlite3_stmt_template *tmpl);
+SQLITE_API void SQLITE_STDCALL sqlite3_stmt_template_free(
+  sqlite3_stmt_template *tmpl);
+
 
 /*
 ** The interface to the virtual-table mechanism is currently considered
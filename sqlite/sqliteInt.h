@@ -4446,6 +4446,9 @@ char *sqlite3DescribeIndexOrder(sqlite3 *db,
       int op,
       int is_equality,
       unsigned long long colMask);
+char *sqlite3DescribeTableColumns(sqlite3 *db,
+      const char *zName, const char *zDb,
+      unsigned long long colMask);
 
 #if defined(SQLITE_ENABLE_DBSTAT_VTAB) || defined(SQLITE_TEST)
 int sqlite3DbstatRegister(sqlite3*);
@@ -0,0 +1,784 @@
+/*
+** 2026 October 18
+**
+** The author disclaims copyright to this source code.  In place of
+** a legal notice, here is a blessing:
+**
+**    May you do good and not evil.
+**    May you find forgiveness for yourself and forgive others.
+**    May you share freely, never taking more than you give.
+**
+*************************************************************************
+**
+** COMDB2 MODIFICATION
+**
+** This file contains code to copy a prepared statement's program out of
+** the connection that compiled it, and to turn that copy back into a
+** prepared statement on another connection.
+**
+** A compiled program points into its connection's schema, collation and
+** function tables, and its memory comes from the allocator of the thread
+** that owns the connection.  A template keeps none of those pointers: it
+** is allocated with plain malloc(), and records tables, indices,
+** collations and functions by name.  Cloning looks the names up again in
+** the target connection, so it does the work of linking a program but
+** not of parsing, resolving and planning it.
+**
+** Only programs that read and write tables of the main database are
+** copied.  Anything that changes the schema, runs triggers, touches
+** virtual, temp or remote tables, or carries comdb2 operator functions
+** is left to sqlite3_prepare().
+*/
+#include "sqliteInt.h"
+#include "vdbeInt.h"
+
+typedef struct TmplOp TmplOp;
+typedef struct TmplKeyInfo TmplKeyInfo;
+
+/*
+** A KeyInfo, with collating sequences recorded by name.
+*/
+struct TmplKeyInfo {
+  u16 nField;              /* Number of key columns */
+  u16 nXField;             /* Number of columns beyond the key columns */
+  u8 *aSortOrder;          /* nField+nXField sort orders */
+  char **azColl;           /* nField+nXField collation names, 0 for BINARY */
+};
+
+/*
+** One instruction.  Pointer operands are replaced by what is needed to
+** find the same object again in another connection.
+*/
+struct TmplOp {
+  u8 opcode;               /* What operation to perform */
+  signed char p4type;      /* P4_xxx, with all strings kept as P4_DYNAMIC */
+  u8 p5;                   /* Fifth parameter */
+  u8 isIndex;              /* zName is an index rather than a table */
+  int p1, p2, p3;          /* Operands */
+  int n;                   /* Bytes at p4.z or p4.mem.z */
+  char *zName;             /* Table, index, collation or function name */
+  union {
+    int i;                 /* P4_INT32 */
+    i64 iv;                /* P4_INT64 */
+    double r;              /* P4_REAL */
+    char *z;               /* P4_DYNAMIC */
+    int *ai;               /* P4_INTARRAY, ai[0]+1 entries */
+    TmplKeyInfo *pKeyInfo; /* P4_KEYINFO */
+    struct {               /* P4_COLLSEQ */
+      u8 enc;
+      int (*xCmp)(void*,int,const void*,int,const void*);
+    } coll;
+    struct {               /* P4_FUNCDEF */
+      i8 nArg;
+      u16 funcFlags;
+      void (*xSFunc)(sqlite3_context*,int,sqlite3_value**);
+      void (*xFinalize)(sqlite3_context*);
+    } func;
+    struct {               /* P4_MEM */
+      u16 flags;           /* One of MEM_Null, Int, Real, Str or Blob */
+      u8 enc;
+      i64 i;
+      double r;
+      char *z;
+    } mem;
+  } p4;
+};
+
+struct sqlite3_stmt_template {
+  int nOp;                 /* Number of instructions */
+  TmplOp *aOp;             /* The program */
+  int nMem;                /* Registers, including those of cursors */
+  int nCursor;             /* Cursors */
+  int nVar;                /* Bound parameters */
+  int nzVar;               /* Entries in azVar[] */
+  char **azVar;            /* Parameter names */
+  int nResColumn;          /* Result columns */
+  char **azColName;        /* COLNAME_N*nResColumn names, 0 if not set */
+  int nTable;              /* Entries in azTable[] */
+  char **azTable;          /* Tables for Vdbe.tbls, in order */
+  int *updCols;            /* Vdbe.updCols, or 0 */
+  yDbMask btreeMask;       /* Vdbe.btreeMask */
+  yDbMask lockMask;        /* Vdbe.lockMask */
+  u8 usesStmtJournal;      /* Vdbe.usesStmtJournal */
+  u8 changeCntOn;          /* Vdbe.changeCntOn */
+  u8 hasFingerprint;       /* fingerprint[] was computed */
+  char tzname[TZNAME_MAX]; /* Timezone the program was compiled under */
+  char fingerprint[16];    /* Fingerprint of the statement */
+  int nByte;               /* Memory held by this template */
+};
+
+/*
+** Allocate memory for a template.  Templates outlive the thread that
+** builds them, so this does not use the sqlite allocator.
+*/
+static void *tmplMalloc(sqlite3_stmt_template *t, size_t n){
+  void *p = calloc(1, n ? n : 1);
+  if( p ) t->nByte += (int)n;
+  return p;
+}
+
+static char *tmplStrNDup(sqlite3_stmt_template *t, const char *z, int n){
+  char *zNew;
+  if( z==0 ) return 0;
+  if( n<0 ) n = sqlite3Strlen30(z);
+  zNew = tmplMalloc(t, n+1);
+  if( zNew ) memcpy(zNew, z, n);
+  return zNew;
+}
+
+/*
+** Return true if the opcode can be part of a shared program.  Schema
+** changes, maintenance, sub-programs, virtual tables and comdb2 operator
+** functions all hold state of the connection or thread that compiled
+** them.
+*/
+static int tmplOpcodeOk(u8 opcode){
+  switch( opcode ){
+    case OP_Savepoint:
+    case OP_AutoCommit:
+    case OP_ReadCookie:
+    case OP_SetCookie:
+    case OP_Destroy:
+    case OP_Clear:
+    case OP_CreateIndex:
+    case OP_CreateTable:
+    case OP_ParseSchema:
+    case OP_LoadAnalysis:
+    case OP_DropTable:
+    case OP_DropIndex:
+    case OP_DropTrigger:
+    case OP_IntegrityCk:
+    case OP_Program:
+    case OP_Param:
+    case OP_Checkpoint:
+    case OP_JournalMode:
+    case OP_Vacuum:
+    case OP_IncrVacuum:
+    case OP_Expire:
+    case OP_TableLock:
+    case OP_VBegin:
+    case OP_VCreate:
+    case OP_VDestroy:
+    case OP_VOpen:
+    case OP_VFilter:
+    case OP_VColumn:
+    case OP_VNext:
+    case OP_VRename:
+    case OP_VUpdate:
+    case OP_Pagecount:
+    case OP_MaxPgcnt:
+    case OP_CursorHint:
+    case OP_OpFuncLoad:
+    case OP_OpFuncExec:
+    case OP_OpFuncInteger:
+    case OP_OpFuncReal:
+    case OP_OpFuncString:
+    case OP_OpFuncNext:
+      return 0;
+  }
+  return 1;
+}
+
+/*
+** Find the table or index of the main database whose root page is tnum.
+*/
+static const char *tmplRootName(Schema *pSchema, int tnum, u8 *pIsIndex){
+  HashElem *k;
+  for(k=sqliteHashFirst(&pSchema->tblHash); k; k=sqliteHashNext(k)){
+    Table *pTab = (Table*)sqliteHashData(k);
+    Index *pIdx;
+    if( pTab->tnum==tnum ){
+      *pIsIndex = 0;
+      return pTab->zName;
+    }
+    for(pIdx=pTab->pIndex; pIdx; pIdx=pIdx->pNext){
+      if( pIdx->tnum==tnum ){
+        *pIsIndex = 1;
+        return pIdx->zName;
+      }
+    }
+  }
+  return 0;
+}
+
+/*
+** Copy the P4 operand of pOp into pT.  Return non-zero if it can't be
+** shared.
+*/
+static int tmplCopyP4(
+  sqlite3_stmt_template *t,
+  sqlite3 *db,
+  const Op *pOp,
+  TmplOp *pT
+){
+  pT->p4type = pOp->p4type;
+  switch( pOp->p4type ){
+    case P4_NOTUSED:
+      break;
+    case P4_ADVANCE:
+      /* Set again by sqlite3VdbeMakeReady() */
+      pT->p4type = P4_NOTUSED;
+      break;
+    case P4_INT32:
+      pT->p4.i = pOp->p4.i;
+      break;
+    case P4_INT64:
+      pT->p4.iv = *pOp->p4.pI64;
+      break;
+    case P4_REAL:
+      pT->p4.r = *pOp->p4.pReal;
+      break;
+    case P4_DYNAMIC:
+    case P4_STATIC:
+    case P4_MPRINTF: {
+      /* OP_Blob and OP_String say how long their operand is, and a blob
+      ** may contain zeros.  Static strings can point into memory of the
+      ** compiling statement, such as the names of its parameters, so
+      ** every string is copied. */
+      if( pOp->opcode==OP_Blob || pOp->opcode==OP_String ){
+        pT->n = pOp->p1;
+      }else{
+        pT->n = sqlite3Strlen30(pOp->p4.z);
+      }
+      pT->p4.z = tmplMalloc(t, pT->n+1);
+      if( pT->p4.z==0 ) return 1;
+      memcpy(pT->p4.z, pOp->p4.z, pT->n);
+      pT->p4type = P4_DYNAMIC;
+      break;
+    }
+    case P4_INTARRAY: {
+      int n = pOp->p4.ai[0] + 1;
+      pT->p4.ai = tmplMalloc(t, n*sizeof(int));
+      if( pT->p4.ai==0 ) return 1;
+      memcpy(pT->p4.ai, pOp->p4.ai, n*sizeof(int));
+      break;
+    }
+    case P4_COLLSEQ: {
+      CollSeq *pColl = pOp->p4.pColl;
+      if( pColl->zName==0 ) return 1;
+      pT->zName = tmplStrNDup(t, pColl->zName, -1);
+      if( pT->zName==0 ) return 1;
+      pT->p4.coll.enc = pColl->enc;
+      pT->p4.coll.xCmp = pColl->xCmp;
+      break;
+    }
+    case P4_FUNCDEF: {
+      FuncDef *pFunc = pOp->p4.pFunc;
+      if( pFunc->funcFlags & SQLITE_FUNC_EPHEM ) return 1;
+      pT->zName = tmplStrNDup(t, pFunc->zName, -1);
+      if( pT->zName==0 ) return 1;
+      pT->p4.func.nArg = pFunc->nArg;
+      pT->p4.func.funcFlags = pFunc->funcFlags;
+      pT->p4.func.xSFunc = pFunc->xSFunc;
+      pT->p4.func.xFinalize = pFunc->xFinalize;
+      break;
+    }
+    case P4_KEYINFO: {
+      KeyInfo *pKeyInfo = pOp->p4.pKeyInfo;
+      TmplKeyInfo *pK;
+      int i, n = pKeyInfo->nField + pKeyInfo->nXField;
+      pK = pT->p4.pKeyInfo = tmplMalloc(t, sizeof(TmplKeyInfo));
+      if( pK==0 ) return 1;
+      pK->nField = pKeyInfo->nField;
+      pK->nXField = pKeyInfo->nXField;
+      pK->aSortOrder = tmplMalloc(t, n);
+      pK->azColl = tmplMalloc(t, n*sizeof(char*));
+      if( pK->aSortOrder==0 || pK->azColl==0 ) return 1;
+      memcpy(pK->aSortOrder, pKeyInfo->aSortOrder, n);
+      for(i=0; i<n; i++){
+        CollSeq *pColl = pKeyInfo->aColl[i];
+        if( pColl==0 ) continue;
+        if( pColl->zName==0 ) return 1;
+        pK->azColl[i] = tmplStrNDup(t, pColl->zName, -1);
+        if( pK->azColl[i]==0 ) return 1;
+      }
+      break;
+    }
+    case P4_MEM: {
+      Mem *pMem = pOp->p4.pMem;
+      if( pMem->flags & MEM_Null ){
+        pT->p4.mem.flags = MEM_Null;
+      }else if( pMem->flags & MEM_Int ){
+        pT->p4.mem.flags = MEM_Int;
+        pT->p4.mem.i = pMem->u.i;
+      }else if( pMem->flags & MEM_Real ){
+        pT->p4.mem.flags = MEM_Real;
+        pT->p4.mem.r = pMem->u.r;
+      }else if( pMem->flags & (MEM_Str|MEM_Blob) ){
+        if( pMem->flags & (MEM_Zero|MEM_Datetime|MEM_Interval) ) return 1;
+        pT->p4.mem.flags = (pMem->flags & MEM_Str) ? MEM_Str : MEM_Blob;
+        pT->p4.mem.enc = pMem->enc;
+        pT->n = pMem->n;
+        pT->p4.mem.z = tmplMalloc(t, pMem->n+1);
+        if( pT->p4.mem.z==0 ) return 1;
+        memcpy(pT->p4.mem.z, pMem->z, pMem->n);
+      }else{
+        return 1;
+      }
+      break;
+    }
+    case P4_TABLE: {
+      /* P4_OPFUNC has the same value, and OP_OpFuncLoad is refused */
+      Table *pTab = pOp->p4.pTab;
+      if( sqlite3HashFind(&db->aDb[0].pSchema->tblHash, pTab->zName)!=pTab ){
+        return 1;
+      }
+      pT->zName = tmplStrNDup(t, pTab->zName, -1);
+      if( pT->zName==0 ) return 1;
+      break;
+    }
+    default:
+      /* P4_VTAB, P4_SUBPROGRAM, P4_EXPR, P4_FUNCCTX */
+      return 1;
+  }
+  return 0;
+}
+
+/*
+** Copy one instruction.  Return non-zero if it can't be shared.
+*/
+static int tmplCopyOp(
+  sqlite3_stmt_template *t,
+  sqlite3 *db,
+  const Op *pOp,
+  TmplOp *pT
+){
+  if( !tmplOpcodeOk(pOp->opcode) ) return 1;
+  pT->opcode = pOp->opcode;
+  pT->p1 = pOp->p1;
+  pT->p2 = pOp->p2;
+  pT->p3 = pOp->p3;
+  pT->p5 = pOp->p5;
+  switch( pOp->opcode ){
+    case OP_Transaction:
+      if( pOp->p1!=0 ) return 1;
+      break;
+    case OP_OpenRead:
+    case OP_OpenWrite:
+    case OP_ReopenIdx: {
+      const char *zName;
+      if( pOp->p3!=0 ) return 1;
+      if( pOp->p5 & OPFLAG_P2ISREG ) return 1;
+      zName = tmplRootName(db->aDb[0].pSchema, pOp->p2, &pT->isIndex);
+      if( zName==0 ) return 1;
+      pT->zName = tmplStrNDup(t, zName, -1);
+      if( pT->zName==0 ) return 1;
+      break;
+    }
+  }
+  return tmplCopyP4(t, db, pOp, pT);
+}
+
+/*
+** Copy the program of a statement that was just prepared, and hasn't been
+** stepped yet.  Return 0 if the statement can't be shared.  The template
+** is not tied to pStmt or its connection.
+*/
+sqlite3_stmt_template *sqlite3_stmt_template_create(sqlite3_stmt *pStmt){
+  Vdbe *v = (Vdbe*)pStmt;
+  sqlite3 *db;
+  sqlite3_stmt_template *t;
+  int i, n;
+
+  if( v==0 || v->magic!=VDBE_MAGIC_RUN || v->pc>=0 ) return 0;
+  if( v->runOnlyOnce || v->expmask || v->explain || v->pProgram ) return 0;
+  db = v->db;
+  for(i=1; i<db->nDb; i++){
+    if( DbMaskTest(v->btreeMask, i) ) return 0;
+  }
+
+  t = calloc(1, sizeof(*t));
+  if( t==0 ) return 0;
+  t->nByte = sizeof(*t);
+
+  sqlite3_mutex_enter(db->mutex);
+  sqlite3BtreeEnterAll(db);
+
+  t->nOp = v->nOp;
+  t->aOp = tmplMalloc(t, v->nOp*sizeof(TmplOp));
+  if( t->aOp==0 ) goto refuse;
+  for(i=0; i<v->nOp; i++){
+    if( tmplCopyOp(t, db, &v->aOp[i], &t->aOp[i]) ) goto refuse;
+  }
+
+  t->nTable = v->numTables;
+  if( v->numTables ){
+    t->azTable = tmplMalloc(t, v->numTables*sizeof(char*));
+    if( t->azTable==0 ) goto refuse;
+  }
+  for(i=0; i<v->numTables; i++){
+    Table *pTab = v->tbls[i];
+    if( sqlite3HashFind(&db->aDb[0].pSchema->tblHash, pTab->zName)!=pTab ){
+      goto refuse;
+    }
+    t->azTable[i] = tmplStrNDup(t, pTab->zName, -1);
+    if( t->azTable[i]==0 ) goto refuse;
+  }
+
+  t->nResColumn = v->nResColumn;
+  n = v->nResColumn*COLNAME_N;
+  if( n ){
+    t->azColName = tmplMalloc(t, n*sizeof(char*));
+    if( t->azColName==0 ) goto refuse;
+  }
+  for(i=0; i<n; i++){
+    Mem *pName = &v->aColName[i];
+    if( (pName->flags & MEM_Str)==0 ) continue;
+    t->azColName[i] = tmplStrNDup(t, pName->z, pName->n);
+    if( t->azColName[i]==0 ) goto refuse;
+  }
+
+  t->nzVar = v->nzVar;
+  if( v->nzVar ){
+    t->azVar = tmplMalloc(t, v->nzVar*sizeof(char*));
+    if( t->azVar==0 ) goto refuse;
+  }
+  for(i=0; i<v->nzVar; i++){
+    if( v->azVar[i]==0 ) continue;
+    t->azVar[i] = tmplStrNDup(t, v->azVar[i], -1);
+    if( t->azVar[i]==0 ) goto refuse;
+  }
+
+  if( v->updCols ){
+    n = v->updCols[0] + 1;
+    t->updCols = tmplMalloc(t, n*sizeof(int));
+    if( t->updCols==0 ) goto refuse;
+    memcpy(t->updCols, v->updCols, n*sizeof(int));
+  }
+
+  t->nMem = v->nMem;
+  t->nCursor = v->nCursor;
+  t->nVar = v->nVar;
+  memcpy(&t->btreeMask, &v->btreeMask, sizeof(yDbMask));
+  memcpy(&t->lockMask, &v->lockMask, sizeof(yDbMask));
+  t->usesStmtJournal = v->usesStmtJournal;
+  t->changeCntOn = v->changeCntOn;
+  memcpy(t->tzname, v->tzname, TZNAME_MAX);
+  if( db->should_fingerprint ){
+    t->hasFingerprint = 1;
+    memcpy(t->fingerprint, db->fingerprint, sizeof(t->fingerprint));
+  }
+
+  sqlite3BtreeLeaveAll(db);
+  sqlite3_mutex_leave(db->mutex);
+  return t;
+
+refuse:
+  sqlite3BtreeLeaveAll(db);
+  sqlite3_mutex_leave(db->mutex);
+  sqlite3_stmt_template_free(t);
+  return 0;
+}
+
+void sqlite3_stmt_template_free(sqlite3_stmt_template *t){
+  int i;
+  if( t==0 ) return;
+  for(i=0; t->aOp && i<t->nOp; i++){
+    TmplOp *pT = &t->aOp[i];
+    free(pT->zName);
+    switch( pT->p4type ){
+      case P4_DYNAMIC:
+        free(pT->p4.z);
+        break;
+      case P4_INTARRAY:
+        free(pT->p4.ai);
+        break;
+      case P4_MEM:
+        free(pT->p4.mem.z);
+        break;
+      case P4_KEYINFO: {
+        TmplKeyInfo *pK = pT->p4.pKeyInfo;
+        int j;
+        if( pK==0 ) break;
+        for(j=0; pK->azColl && j<pK->nField+pK->nXField; j++){
+          free(pK->azColl[j]);
+        }
+        free(pK->azColl);
+        free(pK->aSortOrder);
+        free(pK);
+        break;
+      }
+    }
+  }
+  free(t->aOp);
+  for(i=0; t->azTable && i<t->nTable; i++) free(t->azTable[i]);
+  free(t->azTable);
+  for(i=0; t->azColName && i<t->nResColumn*COLNAME_N; i++){
+    free(t->azColName[i]);
+  }
+  free(t->azColName);
+  for(i=0; t->azVar && i<t->nzVar; i++) free(t->azVar[i]);
+  free(t->azVar);
+  free(t->updCols);
+  free(t);
+}
+
+/*
+** Bytes of memory held by a template.
+*/
+int sqlite3_stmt_template_size(const sqlite3_stmt_template *t){
+  return t ? t->nByte : 0;
+}
+
+/*
+** Find the collating sequence a template recorded, in connection db.
+*/
+static CollSeq *tmplFindColl(sqlite3 *db, const char *zName, u8 enc){
+  CollSeq *pColl = sqlite3FindCollSeq(db, enc, zName, 0);
+  if( pColl==0 || pColl->xCmp==0 ) return 0;
+  return pColl;
+}
+
+/*
+** Rebuild the P4 operand of instruction addr from pT.  Return non-zero if
+** an object it names does not exist, or is different, in db.
+*/
+static int tmplLinkP4(Vdbe *v, sqlite3 *db, int addr, const TmplOp *pT){
+  switch( pT->p4type ){
+    case P4_NOTUSED:
+      break;
+    case P4_INT32:
+      sqlite3VdbeChangeP4(v, addr, (char*)SQLITE_INT_TO_PTR(pT->p4.i), P4_INT32);
+      break;
+    case P4_INT64:
+    case P4_REAL: {
+      char *p = sqlite3DbMallocRawNN(db, 8);
+      if( p==0 ) return 1;
+      memcpy(p, pT->p4type==P4_INT64 ? (void*)&pT->p4.iv : (void*)&pT->p4.r,
+             8);
+      sqlite3VdbeChangeP4(v, addr, p, pT->p4type);
+      break;
+    }
+    case P4_DYNAMIC: {
+      char *z = sqlite3DbMallocRawNN(db, pT->n+1);
+      if( z==0 ) return 1;
+      memcpy(z, pT->p4.z, pT->n+1);
+      sqlite3VdbeChangeP4(v, addr, z, P4_DYNAMIC);
+      break;
+    }
+    case P4_INTARRAY: {
+      int n = (pT->p4.ai[0] + 1)*sizeof(int);
+      int *ai = sqlite3DbMallocRawNN(db, n);
+      if( ai==0 ) return 1;
+      memcpy(ai, pT->p4.ai, n);
+      sqlite3VdbeChangeP4(v, addr, (char*)ai, P4_INTARRAY);
+      break;
+    }
+    case P4_COLLSEQ: {
+      CollSeq *pColl = tmplFindColl(db, pT->zName, pT->p4.coll.enc);
+      if( pColl==0 || pColl->xCmp!=pT->p4.coll.xCmp ) return 1;
+      sqlite3VdbeChangeP4(v, addr, (char*)pColl, P4_COLLSEQ);
+      break;
+    }
+    case P4_FUNCDEF: {
+      FuncDef *pFunc = sqlite3FindFunction(db, pT->zName, pT->p4.func.nArg,
+                           pT->p4.func.funcFlags & SQLITE_FUNC_ENCMASK, 0);
+      if( pFunc==0
+       || pFunc->nArg!=pT->p4.func.nArg
+       || pFunc->funcFlags!=pT->p4.func.funcFlags
+       || pFunc->xSFunc!=pT->p4.func.xSFunc
+       || pFunc->xFinalize!=pT->p4.func.xFinalize
+      ){
+        return 1;
+      }
+      sqlite3VdbeChangeP4(v, addr, (char*)pFunc, P4_FUNCDEF);
+      break;
+    }
+    case P4_KEYINFO: {
+      const TmplKeyInfo *pK = pT->p4.pKeyInfo;
+      KeyInfo *pKeyInfo = sqlite3KeyInfoAlloc(db, pK->nField, pK->nXField);
+      int i, n = pK->nField + pK->nXField;
+      if( pKeyInfo==0 ) return 1;
+      memcpy(pKeyInfo->aSortOrder, pK->aSortOrder, n);
+      for(i=0; i<n; i++){
+        if( pK->azColl[i]==0 ) continue;
+        pKeyInfo->aColl[i] = tmplFindColl(db, pK->azColl[i], ENC(db));
+        if( pKeyInfo->aColl[i]==0 ){
+          sqlite3KeyInfoUnref(pKeyInfo);
+          return 1;
+        }
+      }
+      sqlite3VdbeChangeP4(v, addr, (char*)pKeyInfo, P4_KEYINFO);
+      break;
+    }
+    case P4_MEM: {
+      sqlite3_value *pVal = sqlite3ValueNew(db);
+      if( pVal==0 ) return 1;
+      switch( pT->p4.mem.flags ){
+        case MEM_Int:
+          sqlite3VdbeMemSetInt64(pVal, pT->p4.mem.i);
+          break;
+        case MEM_Real:
+          sqlite3VdbeMemSetDouble(pVal, pT->p4.mem.r);
+          break;
+        case MEM_Str:
+          sqlite3VdbeMemSetStr(pVal, pT->p4.mem.z, pT->n, pT->p4.mem.enc,
+                               SQLITE_TRANSIENT);
+          break;
+        case MEM_Blob:
+          sqlite3VdbeMemSetStr(pVal, pT->p4.mem.z, pT->n, 0, SQLITE_TRANSIENT);
+          break;
+      }
+      sqlite3VdbeChangeP4(v, addr, (const char*)pVal, P4_MEM);
+      break;
+    }
+    case P4_TABLE: {
+      Table *pTab = sqlite3HashFind(&db->aDb[0].pSchema->tblHash, pT->zName);
+      if( pTab==0 ) return 1;
+      sqlite3VdbeChangeP4(v, addr, (char*)pTab, P4_TABLE);
+      break;
+    }
+    default:
+      return 1;
+  }
+  return 0;
+}
+
+/*
+** Rebuild instruction pT at the end of v.  Root pages and schema cookies
+** are taken from db rather than from the template.
+*/
+static int tmplLinkOp(Vdbe *v, sqlite3 *db, const TmplOp *pT){
+  Schema *pSchema = db->aDb[0].pSchema;
+  int p2 = pT->p2;
+  int p3 = pT->p3;
+  int addr;
+
+  switch( pT->opcode ){
+    case OP_OpenRead:
+    case OP_OpenWrite:
+    case OP_ReopenIdx:
+      if( pT->isIndex ){
+        Index *pIdx = sqlite3HashFind(&pSchema->idxHash, pT->zName);
+        if( pIdx==0 ) return 1;
+        p2 = pIdx->tnum;
+      }else{
+        Table *pTab = sqlite3HashFind(&pSchema->tblHash, pT->zName);
+        if( pTab==0 ) return 1;
+        p2 = pTab->tnum;
+      }
+      break;
+    case OP_Transaction:
+      if( pT->p5 ) p3 = pSchema->schema_cookie;
+      break;
+  }
+  addr = sqlite3VdbeAddOp3(v, pT->opcode, pT->p1, p2, p3);
+  sqlite3VdbeChangeP5(v, pT->p5);
+  if( pT->opcode==OP_Transaction && pT->p5 ){
+    sqlite3VdbeChangeP4(v, addr,
+                        (char*)SQLITE_INT_TO_PTR(pSchema->iGeneration),
+                        P4_INT32);
+    return 0;
+  }
+  return tmplLinkP4(v, db, addr, pT);
+}
+
+/*
+** Build a prepared statement for zSql on connection db from template t.
+** Return SQLITE_SCHEMA if the connection's schema, collations, functions
+** or timezone don't match the ones t was compiled against; the caller
+** should then prepare zSql normally.
+*/
+int sqlite3_stmt_template_clone(
+  sqlite3 *db,
+  const sqlite3_stmt_template *t,
+  const char *zSql,
+  sqlite3_stmt **ppStmt
+){
+  Parse sParse;
+  Vdbe *v = 0;
+  int rc = SQLITE_OK;
+  int i;
+
+  *ppStmt = 0;
+  if( db->should_fingerprint && !t->hasFingerprint ) return SQLITE_SCHEMA;
+
+  memset(&sParse, 0, sizeof(sParse));
+  sParse.db = db;
+  sqlite3_mutex_enter(db->mutex);
+  sqlite3BtreeEnterAll(db);
+
+  /* A temp table could hide a main table of the same name from the
+  ** statement, and a connection that hasn't loaded its schema yet has
+  ** nothing to link against. */
+  if( !DbHasProperty(db, 0, DB_SchemaLoaded)
+   || (db->aDb[1].pSchema && sqliteHashFirst(&db->aDb[1].pSchema->tblHash))
+  ){
+    rc = SQLITE_SCHEMA;
+    goto clone_done;
+  }
+
+  v = sParse.pVdbe = sqlite3VdbeCreate(&sParse);
+  if( v==0 ){
+    rc = SQLITE_NOMEM_BKPT;
+    goto clone_done;
+  }
+  if( memcmp(v->tzname, t->tzname, TZNAME_MAX)!=0 ){
+    rc = SQLITE_SCHEMA;
+    goto clone_done;
+  }
+
+  for(i=0; i<t->nOp; i++){
+    if( tmplLinkOp(v, db, &t->aOp[i]) || db->mallocFailed ){
+      rc = SQLITE_SCHEMA;
+      goto clone_done;
+    }
+  }
+
+  sParse.nVar = t->nVar;
+  sParse.nMem = t->nMem - t->nCursor;
+  sParse.nTab = t->nCursor;
+  sParse.isMultiWrite = sParse.mayAbort = t->usesStmtJournal;
+  if( t->nzVar ){
+    sParse.azVar = sqlite3DbMallocZero(db, t->nzVar*sizeof(char*));
+    if( sParse.azVar==0 ){
+      rc = SQLITE_NOMEM_BKPT;
+      goto clone_done;
+    }
+    sParse.nzVar = t->nzVar;
+    for(i=0; i<t->nzVar; i++){
+      if( t->azVar[i] ) sParse.azVar[i] = sqlite3DbStrDup(db, t->azVar[i]);
+    }
+  }
+  sqlite3VdbeMakeReady(v, &sParse);
+
+  if( t->nResColumn ) sqlite3VdbeSetNumCols(v, t->nResColumn);
+  for(i=0; i<t->nResColumn*COLNAME_N; i++){
+    if( t->azColName[i]==0 ) continue;
+    sqlite3VdbeSetColName(v, i%t->nResColumn, i/t->nResColumn,
+                          t->azColName[i], SQLITE_TRANSIENT);
+  }
+  for(i=0; i<t->nTable; i++){
+    Table *pTab = sqlite3HashFind(&db->aDb[0].pSchema->tblHash,t->azTable[i]);
+    if( pTab==0 ){
+      rc = SQLITE_SCHEMA;
+      goto clone_done;
+    }
+    sqlite3VdbeAddTable(v, pTab);
+  }
+  if( t->updCols ){
+    sqlite3CreateUpdCols(v, db, t->updCols[0], &t->updCols[1]);
+  }
+  memcpy(&v->btreeMask, &t->btreeMask, sizeof(yDbMask));
+  memcpy(&v->lockMask, &t->lockMask, sizeof(yDbMask));
+  v->changeCntOn = t->changeCntOn;
+  sqlite3VdbeSetSql(v, zSql, -1, 1);
+  if( db->mallocFailed ){
+    rc = SQLITE_NOMEM_BKPT;
+    goto clone_done;
+  }
+  if( db->should_fingerprint ){
+    memcpy(db->fingerprint, t->fingerprint, sizeof(t->fingerprint));
+  }
+  clock_gettime(CLOCK_REALTIME, &v->tspec);
+  *ppStmt = (sqlite3_stmt*)v;
+  v = 0;
+
+clone_done:
+  if( v ) sqlite3VdbeFinalize(v);
+  sqlite3ParserReset(&sParse);
+  rc = sqlite3ApiExit(db, rc);
+  sqlite3BtreeLeaveAll(db);
+  sqlite3_mutex_leave(db->mutex);
+  return rc;
+}
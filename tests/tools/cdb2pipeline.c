@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <poll.h>
+#include <cdb2api.h>
+
+#define DEPTH 50
+
+static int check_row(cdb2_hndl_tp *hndl, long long expected)
+{
+    int rc = cdb2_next_record(hndl);
+    if (rc != CDB2_OK) {
+        fprintf(stderr, "error in cdb2_next_record %d %s\n", rc,
+                cdb2_errstr(hndl));
+        return -1;
+    }
+    long long *val = cdb2_column_value(hndl, 0);
+    if (*val != expected) {
+        fprintf(stderr, "error got:%lld expected:%lld\n", *val, expected);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    char *dbname = argv[1];
+    cdb2_hndl_tp *hndl = NULL;
+    long long id;
+    int rc;
+
+    if (NULL == dbname) {
+        fprintf(stderr, "Dbname is not set!\n");
+        return -1;
+    }
+
+    char *dest = "local";
+    char *conf = getenv("CDB2_CONFIG");
+    if (conf) {
+        cdb2_set_comdb2db_config(conf);
+        dest = "default";
+    }
+
+    rc = cdb2_open(&hndl, dbname, dest, 0);
+    if (rc != 0) {
+        fprintf(stderr, "error opening sql handle for %s, rc=%d\n", dbname,
+                rc);
+        return rc;
+    }
+
+    /* bound values are captured at submit time */
+    cdb2_bind_param(hndl, "id", CDB2_INTEGER, &id, sizeof(id));
+    for (id = 0; id < DEPTH; id++) {
+        rc = cdb2_submit(hndl, "select @id");
+        if (rc != 0) {
+            fprintf(stderr, "error submitting %lld rc=%d %s\n", id, rc,
+                    cdb2_errstr(hndl));
+            return rc;
+        }
+    }
+    cdb2_clearbindings(hndl);
+
+    if (cdb2_pending(hndl) != DEPTH) {
+        fprintf(stderr, "error pending:%d expected:%d\n", cdb2_pending(hndl),
+                DEPTH);
+        return -1;
+    }
+
+    /* results come back in submission order */
+    for (id = 0; id < DEPTH; id++) {
+        while (!cdb2_ready(hndl)) {
+            struct pollfd pfd = {.fd = cdb2_socket(hndl), .events = POLLIN};
+            poll(&pfd, 1, 1000);
+        }
+        rc = cdb2_receive(hndl);
+        if (rc != 0) {
+            fprintf(stderr, "error receiving %lld rc=%d %s\n", id, rc,
+                    cdb2_errstr(hndl));
+            return rc;
+        }
+        if (check_row(hndl, id))
+            return -1;
+        if (cdb2_next_record(hndl) != CDB2_OK_DONE) {
+            fprintf(stderr, "error expected one row for %lld\n", id);
+            return -1;
+        }
+    }
+
+    /* unread rows are skipped by the next receive */
+    cdb2_submit(hndl, "with recursive c(x) as (select 1 union all select x + 1 "
+                      "from c where x < 1000) select x from c");
+    cdb2_submit(hndl, "select 7");
+    if ((rc = cdb2_receive(hndl)) != 0 || check_row(hndl, 1))
+        return -1;
+    if ((rc = cdb2_receive(hndl)) != 0 || check_row(hndl, 7))
+        return -1;
+
+    /* transaction control isn't pipelined */
+    if (cdb2_submit(hndl, "begin") != CDB2ERR_BADSTATE) {
+        fprintf(stderr, "error begin was pipelined\n");
+        return -1;
+    }
+    if (cdb2_receive(hndl) != CDB2ERR_BADSTATE) {
+        fprintf(stderr, "error receive with nothing pending\n");
+        return -1;
+    }
+
+    /* run_statement discards outstanding results */
+    cdb2_submit(hndl, "select 1");
+    cdb2_submit(hndl, "select 2");
+    rc = cdb2_run_statement(hndl, "select 3");
+    if (rc != 0 || check_row(hndl, 3) || cdb2_pending(hndl) != 0) {
+        fprintf(stderr, "error run_statement after submit rc=%d\n", rc);
+        return -1;
+    }
+
+    cdb2_close(hndl);
+    printf("done\n");
+    return 0;
+}
@@ -34,23 +34,41 @@
 #include <list>
 #include <map>
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <unistd.h>
 
 #include "assert.h"
 #include "cdb2api.h"
 #include "cson_amalgamation_core.h"
 
-static cdb2_hndl_tp *cdb2h = nullptr;
 std::map<std::string, std::string> sqltrack;
 std::map<std::string, std::list<cson_value*>> transactions;
 
-void replay(cdb2_hndl_tp *db, cson_value *val);
+static const char *dbname;
+static const char *dbtier;
+static bool fast = false;       /* ignore the original timing */
+static double speedup = 1.0;    /* replay this many times faster */
+static bool verbose = true;     /* print statements and results */
+static std::mutex output_lk;    /* one statement's output at a time */
+
+void dispatch(cson_value *val);
 
 static const char *usage_text = 
-    "Usage: cdb2sqlreplay dbname [FILE]\n" \
+    "Usage: cdb2sqlreplay [options] dbname [FILE]\n" \
+    "\n" \
+    "Each client connection in the log is replayed on its own handle and\n" \
+    "thread, at the time it originally ran.\n" \
     "\n" \
     "Basic options:\n" \
-    "-f                 run the sql as fast as possible\n";
+    "-f                 run the sql as fast as possible\n" \
+    "-s <factor>        run the sql <factor> times faster than logged\n" \
+    "-b                 benchmark: don't print results, just the summary\n";
 
 /* Start of functions */
 void usage() {
@@ -62,7 +80,8 @@ void usage() {
 void add_fingerprint(std::string fingerprint, std::string sql) {
     std::pair<std::string, std::string> v(fingerprint, sql);
     sqltrack.insert(v);
-    std::cout << fingerprint << " -> " << sql << std::endl;
+    if (verbose)
+        std::cout << fingerprint << " -> " << sql << std::endl;
 }
 
 static bool get_ispropnull(cson_value *objval, const char *key) 
@@ -153,47 +172,51 @@ bool event_is_sql(cson_value *val) {
     return get_strprop(val, "type") == std::string("sql");
 }
 
-void replay_transaction(cdb2_hndl_tp *db, std::list<cson_value*> &list) {
+void replay_transaction(std::list<cson_value*> &list) {
     cson_value *statement;
 
-    std::cout << "replay" << std::endl;
+    if (verbose)
+        std::cout << "replay" << std::endl;
 
     auto it = list.begin();
     while (it != list.end()) {
-        std::cout << "replaying txn" << std::endl;
+        if (verbose)
+            std::cout << "replaying txn" << std::endl;
         if (event_is_sql(*it))
-            replay(db, *it);
-        
-        cson_free_value(*it);
+            dispatch(*it);
+        else
+            cson_free_value(*it);
         it = list.erase(it);
     }
 }
 
-void add_to_transaction(cdb2_hndl_tp *db, cson_value *val) {
+void add_to_transaction(cson_value *val) {
     const char *s = get_strprop(val, "id");
     const char *type = get_strprop(val, "type");
 
     auto i = transactions.find(s);
     if (i == transactions.end()) {
-        std::cout << "new transaction " << s << std::endl;
+        if (verbose)
+            std::cout << "new transaction " << s << std::endl;
         std::list<cson_value*> statements;
         statements.push_back(val);
         transactions.insert(std::pair<std::string, std::list<cson_value*>>(s, statements));
     }
     else {
         auto &list = (*i).second;
-        std::cout << "add to existing transaction " << list.size() << " (" << event_is_txn(list.front()) <<  ") " << s << std::endl;
+        if (verbose)
+            std::cout << "add to existing transaction " << list.size() << " (" << event_is_txn(list.front()) <<  ") " << s << std::endl;
         if (list.size() == 1 && event_is_txn(list.front())) {
             /* This is a single statement, and we just saw it's transaction.  We can 
                now replay the whole list. */
             list.push_back(list.front());
             list.pop_front();
-            replay_transaction(db, list);
+            replay_transaction(list);
         }
         else {
             list.push_back(val);
             if (event_is_txn(val))
-                replay_transaction(db, list);
+                replay_transaction(list);
         }
     }
 }
@@ -214,7 +237,7 @@ void fromhex(uint8_t *out, const uint8_t *in, size_t len)
 
 /* TODO: add all types supported */
 bool do_bindings(cdb2_hndl_tp *db, cson_value *event_val, 
-                 std::vector<uint8_t *> &blobs_vect)
+                 std::vector<uint8_t *> &blobs_vect, std::ostream &out)
 {
     cson_array *bound_parameters = get_arrprop(event_val, "bound_parameters");
     if(bound_parameters == nullptr)
@@ -228,37 +251,42 @@ bool do_bindings(cdb2_hndl_tp *db, cson_value *event_val,
         int ret;
         if(get_ispropnull(bp, "value")) {
             /* bind null value as type INT for simplicity */
-            if ((ret = cdb2_bind_param(cdb2h, name, CDB2_INTEGER, NULL, 0)) != 0) {
+            if ((ret = cdb2_bind_param(db, name, CDB2_INTEGER, NULL, 0)) != 0) {
                 std::cerr << "error binding column " << name << ", ret=" << ret << std::endl;
                 return false;
             }
-            std::cout << "binding "<< type << " column " << name << " to NULL " << std::endl;
+            if (verbose)
+                out << "binding "<< type << " column " << name << " to NULL " << std::endl;
         }
         else if (strcmp(type, "largeint") == 0 || strcmp(type, "int") == 0 || strcmp(type, "smallint") == 0) {
-            int64_t *iv = new int64_t;
+            int64_t *iv = (int64_t *) malloc(sizeof(int64_t));
+            blobs_vect.push_back((uint8_t *) iv);
             bool succ = get_intprop(bp, "value", iv);
             if (!succ) {
                 std::cerr << "error getting " << type << " value of bound parameter " << name << std::endl;
                 return false;
             }
-            if ((ret = cdb2_bind_param(cdb2h, name, CDB2_INTEGER, iv, sizeof(*iv))) != 0) {
+            if ((ret = cdb2_bind_param(db, name, CDB2_INTEGER, iv, sizeof(*iv))) != 0) {
                 std::cerr << "error binding column " << name << ", ret=" << ret << std::endl;
                 return false;
             }
-            std::cout << "binding "<< type << " column " << name << " to value " << *iv << std::endl;
+            if (verbose)
+                out << "binding "<< type << " column " << name << " to value " << *iv << std::endl;
         } 
         else if (strcmp(type, "float") == 0 || strcmp(type, "doublefloat") == 0) {
-            double *dv = new double;
+            double *dv = (double *) malloc(sizeof(double));
+            blobs_vect.push_back((uint8_t *) dv);
             bool succ = get_doubleprop(bp, "value", dv);
             if (!succ) {
                 std::cerr << "error getting " << type << " value of bound parameter " << name << std::endl;
                 return false;
             }
-            if ((ret = cdb2_bind_param(cdb2h, name, CDB2_REAL, dv, sizeof(*dv))) != 0) {
+            if ((ret = cdb2_bind_param(db, name, CDB2_REAL, dv, sizeof(*dv))) != 0) {
                 std::cerr << "error binding column " << name << ", ret=" << ret << std::endl;
                 return false;
             }
-            std::cout << "binding "<< type << " column " << name << " to value " << *dv << std::endl;
+            if (verbose)
+                out << "binding "<< type << " column " << name << " to value " << *dv << std::endl;
         }
         else if (strcmp(type, "char") == 0 || strcmp(type, "datetime") == 0 ||
                  strcmp(type, "datetimeus") == 0 ||
@@ -271,11 +299,12 @@ bool do_bindings(cdb2_hndl_tp *db, cson_value *event_val,
                 std::cerr << "error getting " << type << " value of bound parameter " << name << std::endl;
                 return false;
             }
-            if ((ret = cdb2_bind_param(cdb2h, name, CDB2_CSTRING, strp, strlen(strp) )) != 0) {
+            if ((ret = cdb2_bind_param(db, name, CDB2_CSTRING, strp, strlen(strp) )) != 0) {
                 std::cerr << "error binding column " << name << ", ret=" << ret << std::endl;
                 return false;
             }
-            std::cout << "binding "<< type << " column " << name << " to value " << strp << std::endl;
+            if (verbose)
+                out << "binding "<< type << " column " << name << " to value " << strp << std::endl;
         }
         else if( strcmp(type, "byte") == 0 || strcmp(type, "blob") == 0) {
             const char *strp = get_strprop(bp, "value");
@@ -293,17 +322,18 @@ bool do_bindings(cdb2_hndl_tp *db, cson_value *event_val,
             fromhex(unexpanded, (const uint8_t *) strp + 2, slen); /* no x' */
             unexpanded[unexlen] = '\0';
 
-            if ((ret = cdb2_bind_param(cdb2h, name, CDB2_BLOB, unexpanded, unexlen)) != 0) {
+            if ((ret = cdb2_bind_param(db, name, CDB2_BLOB, unexpanded, unexlen)) != 0) {
                 std::cerr << "error binding column " << name << ", ret=" << ret << std::endl;
                 free(unexpanded);
                 return false;
             }
 
             blobs_vect.push_back(unexpanded);
-            std::cout << "binding "<< type << " column " << name << " to value " << strp << std::endl;
+            if (verbose)
+                out << "binding "<< type << " column " << name << " to value " << strp << std::endl;
         }
         else
-            std::cout << "error binding unknown "<< type << " column " << name << std::endl;
+            std::cerr << "error binding unknown "<< type << " column " << name << std::endl;
     }
 
     return true;
@@ -318,126 +348,136 @@ enum {
     STDERR  = 0x1000
 };
 
-static void hexdump(FILE *f, void *datap, int len)
+static void hexdump(std::ostream &out, void *datap, int len)
 {
     u_char *data = (u_char *)datap;
+    char hex[3];
     int i;
-    for (i = 0; i < len; i++)
-        fprintf(f, "%02x", (unsigned int)data[i]);
+    for (i = 0; i < len; i++) {
+        snprintf(hex, sizeof(hex), "%02x", (unsigned int)data[i]);
+        out << hex;
+    }
 }
 
-void dumpstring(FILE *f, char *s, int quotes, int quote_quotes)
+void dumpstring(std::ostream &out, char *s, int quotes, int quote_quotes)
 {
     if (quotes)
-        fprintf(f, "'");
+        out << "'";
     while (*s) {
         if (*s == '\'' && quote_quotes)
-            fprintf(f, "''");
+            out << "''";
         else
-            fprintf(f, "%c", *s);
+            out << *s;
         s++;
     }
     if (quotes)
-        fprintf(f, "'");
+        out << "'";
 }
 
-void printCol(FILE *f, cdb2_hndl_tp *cdb2h, void *val, int col, int printmode)
+void printCol(std::ostream &out, cdb2_hndl_tp *cdb2h, void *val, int col,
+              int printmode)
 {
   int string_blobs = 1;
+  char buf[128];
   switch (cdb2_column_type(cdb2h, col)) {
     case CDB2_INTEGER:
         if (printmode == DEFAULT)
-            fprintf(f, "%s=%lld", cdb2_column_name(cdb2h, col),
-                    *(long long *)val);
-        else
-            fprintf(f, "%lld", *(long long *)val);
+            out << cdb2_column_name(cdb2h, col) << "=";
+        out << *(long long *)val;
         break;
     case CDB2_REAL:
         if (printmode == DEFAULT)
-            fprintf(f, "%s=", cdb2_column_name(cdb2h, col));
-        fprintf(f, "%f", *(double *)val);
+            out << cdb2_column_name(cdb2h, col) << "=";
+        snprintf(buf, sizeof(buf), "%f", *(double *)val);
+        out << buf;
         break;
     case CDB2_CSTRING:
         if (printmode == DEFAULT) {
-            fprintf(f, "%s=", cdb2_column_name(cdb2h, col));
-            dumpstring(f, (char *)val, 1, 0);
+            out << cdb2_column_name(cdb2h, col) << "=";
+            dumpstring(out, (char *)val, 1, 0);
         } else if (printmode & TABS)
-            dumpstring(f, (char *)val, 0, 0);
+            dumpstring(out, (char *)val, 0, 0);
         else
-            dumpstring(f, (char *)val, 1, 1);
+            dumpstring(out, (char *)val, 1, 1);
         break;
     case CDB2_BLOB:
         if (printmode == DEFAULT)
-            fprintf(f, "%s=", cdb2_column_name(cdb2h, col));
+            out << cdb2_column_name(cdb2h, col) << "=";
         if (string_blobs) {
             char *c = (char*) val;
             int len = cdb2_column_size(cdb2h, col);
-            fputc('\'', stdout);
+            out << '\'';
             while (len > 0) {
                 if (isprint(*c) || *c == '\n' || *c == '\t') {
-                    fputc(*c, stdout);
+                    out << *c;
                 } else {
-                    fprintf(f, "\\x%02x", (int)*c);
+                    snprintf(buf, sizeof(buf), "\\x%02x", (int)*c);
+                    out << buf;
                 }
                 len--;
                 c++;
             }
-            fputc('\'', stdout);
+            out << '\'';
         } else {
             if (printmode == BINARY) {
                 int rc = write(1, val, cdb2_column_size(cdb2h, col));
                 exit(0);
             } else {
-                fprintf(f, "x'");
-                hexdump(f, val, cdb2_column_size(cdb2h, col));
-                fprintf(f, "'");
+                out << "x'";
+                hexdump(out, val, cdb2_column_size(cdb2h, col));
+                out << "'";
             }
         }
         break;
     case CDB2_DATETIME: {
         cdb2_client_datetime_t *cdt = (cdb2_client_datetime_t *)val;
         if (printmode == DEFAULT)
-            fprintf(f, "%s=", cdb2_column_name(cdb2h, col));
-        fprintf(f, "\"%4.4u-%2.2u-%2.2uT%2.2u%2.2u%2.2u.%3.3u %s\"",
-                cdt->tm.tm_year + 1900, cdt->tm.tm_mon + 1, cdt->tm.tm_mday,
-                cdt->tm.tm_hour, cdt->tm.tm_min, cdt->tm.tm_sec, cdt->msec,
-                cdt->tzname);
+            out << cdb2_column_name(cdb2h, col) << "=";
+        snprintf(buf, sizeof(buf), "\"%4.4u-%2.2u-%2.2uT%2.2u%2.2u%2.2u.%3.3u %s\"",
+                 cdt->tm.tm_year + 1900, cdt->tm.tm_mon + 1, cdt->tm.tm_mday,
+                 cdt->tm.tm_hour, cdt->tm.tm_min, cdt->tm.tm_sec, cdt->msec,
+                 cdt->tzname);
+        out << buf;
         break;
     }
     case CDB2_DATETIMEUS: {
         cdb2_client_datetimeus_t *cdt = (cdb2_client_datetimeus_t *)val;
         if (printmode == DEFAULT)
-            fprintf(f, "%s=", cdb2_column_name(cdb2h, col));
-        fprintf(f, "\"%4.4u-%2.2u-%2.2uT%2.2u%2.2u%2.2u.%6.6u %s\"",
-                cdt->tm.tm_year + 1900, cdt->tm.tm_mon + 1, cdt->tm.tm_mday,
-                cdt->tm.tm_hour, cdt->tm.tm_min, cdt->tm.tm_sec, cdt->usec,
-                cdt->tzname);
+            out << cdb2_column_name(cdb2h, col) << "=";
+        snprintf(buf, sizeof(buf), "\"%4.4u-%2.2u-%2.2uT%2.2u%2.2u%2.2u.%6.6u %s\"",
+                 cdt->tm.tm_year + 1900, cdt->tm.tm_mon + 1, cdt->tm.tm_mday,
+                 cdt->tm.tm_hour, cdt->tm.tm_min, cdt->tm.tm_sec, cdt->usec,
+                 cdt->tzname);
+        out << buf;
         break;
     }
     case CDB2_INTERVALYM: {
         cdb2_client_intv_ym_t *ym = (cdb2_client_intv_ym_t *)val;
         if (printmode == DEFAULT)
-            fprintf(f, "%s=", cdb2_column_name(cdb2h, col));
-        fprintf(f, "\"%s%u-%u\"", (ym->sign < 0) ? "- " : "", ym->years,
-                ym->months);
+            out << cdb2_column_name(cdb2h, col) << "=";
+        snprintf(buf, sizeof(buf), "\"%s%u-%u\"", (ym->sign < 0) ? "- " : "",
+                 ym->years, ym->months);
+        out << buf;
         break;
     }
     case CDB2_INTERVALDS: {
         cdb2_client_intv_ds_t *ds = (cdb2_client_intv_ds_t *)val;
         if (printmode == DEFAULT)
-            fprintf(f, "%s=", cdb2_column_name(cdb2h, col));
-        fprintf(f, "\"%s%u %2.2u:%2.2u:%2.2u.%3.3u\"",
-                (ds->sign < 0) ? "- " : "", ds->days, ds->hours, ds->mins,
-                ds->sec, ds->msec);
+            out << cdb2_column_name(cdb2h, col) << "=";
+        snprintf(buf, sizeof(buf), "\"%s%u %2.2u:%2.2u:%2.2u.%3.3u\"",
+                 (ds->sign < 0) ? "- " : "", ds->days, ds->hours, ds->mins,
+                 ds->sec, ds->msec);
+        out << buf;
         break;
     }
     case CDB2_INTERVALDSUS: {
         cdb2_client_intv_dsus_t *ds = (cdb2_client_intv_dsus_t *)val;
         if (printmode == DEFAULT)
-            fprintf(f, "%s=", cdb2_column_name(cdb2h, col));
-        fprintf(f, "\"%s%u %2.2u:%2.2u:%2.2u.%6.6u\"",
-                (ds->sign < 0) ? "- " : "", ds->days, ds->hours, ds->mins,
-                ds->sec, ds->usec);
+            out << cdb2_column_name(cdb2h, col) << "=";
+        snprintf(buf, sizeof(buf), "\"%s%u %2.2u:%2.2u:%2.2u.%6.6u\"",
+                 (ds->sign < 0) ? "- " : "", ds->days, ds->hours, ds->mins,
+                 ds->sec, ds->usec);
+        out << buf;
         break;
     }
   }
@@ -448,58 +488,333 @@ inline void free_blobs(std::vector<uint8_t *> &blobs_vect) {
         free(*it);
 }
 
-void replay(cdb2_hndl_tp *db, cson_value *event_val) {
-    const char *sql = get_strprop(event_val, "sql");
-    if(sql == nullptr) {
-	    const char *fp = get_strprop(event_val, "fingerprint");
-	    if (fp == nullptr) {
-		    std::cerr << "No fingerprint logged?" << std::endl;
-		    return;
-	    }
-	    auto s = sqltrack.find(fp);
-	    if (s == sqltrack.end()) {
-		    std::cerr << "Unknown fingerprint? " << fp << std::endl;
-		    return;
-	    }
-	    sql = (*s).second.c_str();
-    }
+/* Output is collected per statement and written out in one piece, so
+   connections don't hold each other up while they run. */
+static void write_output(const std::ostringstream &out)
+{
+    if (!verbose)
+        return;
+    std::lock_guard<std::mutex> l(output_lk);
+    std::cout << out.str() << std::flush;
+}
 
+int replay(cdb2_hndl_tp *db, cson_value *event_val, const char *sql) {
+    std::ostringstream out;
     std::vector<uint8_t *> blobs_vect;
-    bool ok = do_bindings(db, event_val, blobs_vect);
+    bool ok = do_bindings(db, event_val, blobs_vect, out);
     if (!ok) {
+        cdb2_clearbindings(db);
         free_blobs(blobs_vect);
-        return;
+        write_output(out);
+        return -1;
     }
 
-    std::cout << sql << std::endl;
+    if (verbose)
+        out << sql << std::endl;
     int rc = cdb2_run_statement(db, sql);
     cdb2_clearbindings(db);
     free_blobs(blobs_vect);
 
     if (rc != CDB2_OK) {
+        write_output(out);
         std::cerr << "run rc " << rc << ": " << cdb2_errstr(db) << std::endl;
-        return;
+        return rc;
     }
 
     /* TODO: have switch to print or not results */
     int ncols = cdb2_numcolumns(db);
     while ((rc = cdb2_next_record(db)) == CDB2_OK) {
+        if (!verbose)
+            continue;
         for (int col = 0; col < ncols; col++) {
             void *val = cdb2_column_value(db, col);
             if (val == NULL) {
-                fprintf(stdout, "%s=NULL", cdb2_column_name(db, col));
+                out << cdb2_column_name(db, col) << "=NULL";
             } else {
-                printCol(stdout, db, val, col, DEFAULT);
+                printCol(out, db, val, col, DEFAULT);
             }
             if (col != ncols - 1) {
-                fprintf(stdout, ", ");
+                out << ", ";
             }
         }
-        std::cout << std::endl;
+        out << std::endl;
     }
+    write_output(out);
     if (rc != CDB2_OK_DONE) {
         std::cerr << "next rc " << rc << ": " << cdb2_errstr(db) << std::endl;
+        return rc;
+    }
+    return 0;
+}
+
+typedef std::chrono::steady_clock replay_clock;
+
+/* Replay starts with the first statement; everything after it is scheduled
+   relative to that. */
+static bool replay_started = false;
+static replay_clock::time_point replay_start;
+static int64_t log_start;
+
+static replay_clock::time_point due_time(int64_t logged)
+{
+    int64_t us = (int64_t) ((logged - log_start) / speedup);
+    return replay_start + std::chrono::microseconds(us);
+}
+
+struct statement_stats {
+    std::string sql;
+    std::vector<uint64_t> latencies; /* usec */
+    uint64_t errors = 0;
+};
+
+struct replay_event {
+    cson_value *val;
+    std::string sql;
+    std::string fingerprint;
+    int64_t time;
+};
+
+/* One client connection from the log, replayed on its own handle and thread
+   so that concurrency (and lock contention) look like they did originally. */
+class connection {
+    static const size_t max_queued = 1000;
+
+    std::thread thd;
+    std::mutex lk;
+    std::condition_variable cv;
+    std::deque<replay_event> events;
+    bool done = false;
+
+    void run();
+
+public:
+    std::map<std::string, statement_stats> stats;
+    uint64_t late = 0;       /* statements started behind schedule */
+    uint64_t total_lag = 0;  /* usec behind schedule, summed */
+
+    connection() : thd(&connection::run, this) {}
+    void push(replay_event &&ev);
+    void finish();
+};
+
+void connection::push(replay_event &&ev)
+{
+    std::unique_lock<std::mutex> l(lk);
+    while (events.size() >= max_queued)
+        cv.wait(l);
+    events.push_back(std::move(ev));
+    cv.notify_all();
+}
+
+void connection::finish()
+{
+    {
+        std::lock_guard<std::mutex> l(lk);
+        done = true;
+    }
+    cv.notify_all();
+    thd.join();
+}
+
+void connection::run()
+{
+    cdb2_hndl_tp *db = nullptr;
+    int rc = cdb2_open(&db, dbname, dbtier, 0);
+    if (rc) {
+        std::cerr << "cdb2_open() failed: " << cdb2_errstr(db) << std::endl;
+        cdb2_close(db);
+        db = nullptr;
+    }
+
+    for (;;) {
+        replay_event ev;
+        {
+            std::unique_lock<std::mutex> l(lk);
+            while (events.empty() && !done)
+                cv.wait(l);
+            if (events.empty())
+                break;
+            ev = std::move(events.front());
+            events.pop_front();
+            cv.notify_all();
+        }
+
+        if (db == nullptr) {
+            cson_free_value(ev.val);
+            continue;
+        }
+
+        if (!fast) {
+            replay_clock::time_point due = due_time(ev.time);
+            std::this_thread::sleep_until(due);
+            replay_clock::duration lag = replay_clock::now() - due;
+            /* more than a millisecond late counts as missing the schedule */
+            if (lag > std::chrono::milliseconds(1)) {
+                late++;
+                total_lag +=
+                    std::chrono::duration_cast<std::chrono::microseconds>(lag)
+                        .count();
+            }
+        }
+
+        replay_clock::time_point start = replay_clock::now();
+        rc = replay(db, ev.val, ev.sql.c_str());
+        replay_clock::time_point end = replay_clock::now();
+
+        statement_stats &st = stats[ev.fingerprint];
+        if (st.sql.empty())
+            st.sql = ev.sql;
+        if (rc)
+            st.errors++;
+        else
+            st.latencies.push_back(
+                std::chrono::duration_cast<std::chrono::microseconds>(end - start)
+                    .count());
+        cson_free_value(ev.val);
+    }
+
+    if (db)
+        cdb2_close(db);
+}
+
+std::map<std::string, std::unique_ptr<connection>> connections;
+
+/* Statements from the same client process and thread came over the same
+   connection.  Logs written before the server recorded that fall back to
+   the first context message, and failing that share one connection. */
+static std::string connection_key(cson_value *val)
+{
+    int64_t pid, tid;
+    if (get_intprop(val, "pid", &pid) && get_intprop(val, "tid", &tid)) {
+        const char *origin = get_strprop(val, "origin");
+        std::ostringstream ss;
+        ss << (origin ? origin : "") << "/" << pid << "/" << tid;
+        return ss.str();
+    }
+    cson_array *context = get_arrprop(val, "context");
+    if (context != nullptr && cson_array_length_get(context) > 0) {
+        cson_value *first = cson_array_get(context, 0);
+        if (cson_value_is_string(first))
+            return cson_string_cstr(cson_value_get_string(first));
+    }
+    return "";
+}
+
+/* Hand a statement to the thread replaying its connection.  Takes ownership
+   of val. */
+void dispatch(cson_value *val) {
+    const char *fp = get_strprop(val, "fingerprint");
+    const char *sql = get_strprop(val, "sql");
+    if (sql == nullptr) {
+        if (fp == nullptr) {
+            std::cerr << "No fingerprint logged?" << std::endl;
+            cson_free_value(val);
+            return;
+        }
+        auto s = sqltrack.find(fp);
+        if (s == sqltrack.end()) {
+            std::cerr << "Unknown fingerprint? " << fp << std::endl;
+            cson_free_value(val);
+            return;
+        }
+        sql = (*s).second.c_str();
+    }
+
+    replay_event ev;
+    ev.val = val;
+    ev.sql = sql;
+    ev.fingerprint = fp ? fp : sql;
+    if (!get_intprop(val, "time", &ev.time))
+        ev.time = log_start;
+
+    if (!replay_started) {
+        replay_started = true;
+        replay_start = replay_clock::now();
+        log_start = ev.time;
+    }
+
+    /* Don't read the log too far ahead of the replay: the queued events
+       would only take up memory. */
+    if (!fast)
+        std::this_thread::sleep_until(due_time(ev.time) - std::chrono::seconds(1));
+
+    std::unique_ptr<connection> &c = connections[connection_key(val)];
+    if (!c)
+        c.reset(new connection());
+    c->push(std::move(ev));
+}
+
+static uint64_t percentile(const std::vector<uint64_t> &sorted, double pct)
+{
+    if (sorted.empty())
+        return 0;
+    size_t idx = (size_t) (pct / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[idx];
+}
+
+/* Wait for every connection to drain, then print throughput and latency
+   percentiles per fingerprint, busiest first. */
+void report(void) {
+    std::map<std::string, statement_stats> all;
+    uint64_t late = 0, total_lag = 0;
+
+    for (auto &c : connections) {
+        c.second->finish();
+        for (auto &s : c.second->stats) {
+            statement_stats &st = all[s.first];
+            if (st.sql.empty())
+                st.sql = s.second.sql;
+            st.errors += s.second.errors;
+            st.latencies.insert(st.latencies.end(),
+                                s.second.latencies.begin(),
+                                s.second.latencies.end());
+        }
+        late += c.second->late;
+        total_lag += c.second->total_lag;
+    }
+    if (!replay_started)
         return;
+
+    double elapsed = std::chrono::duration<double>(replay_clock::now() -
+                                                   replay_start).count();
+    uint64_t nstatements = 0, nerrors = 0;
+    std::vector<std::pair<size_t, statement_stats *>> order;
+    for (auto &s : all) {
+        std::sort(s.second.latencies.begin(), s.second.latencies.end());
+        nstatements += s.second.latencies.size() + s.second.errors;
+        nerrors += s.second.errors;
+        order.push_back(std::make_pair(s.second.latencies.size(), &s.second));
+    }
+    std::sort(order.begin(), order.end(),
+              [](const std::pair<size_t, statement_stats *> &a,
+                 const std::pair<size_t, statement_stats *> &b) {
+                  return a.first > b.first;
+              });
+
+    std::cout << "replayed " << nstatements << " statements (" << nerrors
+              << " failed) on " << connections.size() << " connections in "
+              << std::fixed << std::setprecision(3) << elapsed << "s, "
+              << std::setprecision(1) << nstatements / elapsed
+              << " statements/s" << std::endl;
+    if (late)
+        std::cout << late << " statements started late, by "
+                  << total_lag / late << "us on average" << std::endl;
+
+    std::cout << std::setw(10) << "count" << std::setw(8) << "errors"
+              << std::setw(10) << "p50(us)" << std::setw(10) << "p90(us)"
+              << std::setw(10) << "p99(us)" << std::setw(10) << "max(us)"
+              << "  sql" << std::endl;
+    for (auto &o : order) {
+        statement_stats &st = *o.second;
+        std::string sql = st.sql.substr(0, 60);
+        std::replace(sql.begin(), sql.end(), '\n', ' ');
+        std::cout << std::setw(10) << st.latencies.size() << std::setw(8)
+                  << st.errors << std::setw(10)
+                  << percentile(st.latencies, 50) << std::setw(10)
+                  << percentile(st.latencies, 90) << std::setw(10)
+                  << percentile(st.latencies, 99) << std::setw(10)
+                  << (st.latencies.empty() ? 0 : st.latencies.back()) << "  "
+                  << sql << std::endl;
     }
 }
 
@@ -515,7 +830,7 @@ void replay(cdb2_hndl_tp *db, cson_value *event_val) {
      eliminate it.
   */
 
-void handle_sql(cdb2_hndl_tp *db, cson_value *event_val) {
+void handle_sql(cson_value *event_val) {
     int rc;
     /* We can only replay if we have the full SQL, including parameters.
        That means
@@ -540,17 +855,16 @@ void handle_sql(cdb2_hndl_tp *db, cson_value *event_val) {
 
 #if 0
     if (is_transactional(event_val)) {
-        add_to_transaction(db, event_val);
+        add_to_transaction(event_val);
         return;
     }
 #endif
     
-    replay(db, event_val);
-    cson_free_value(event_val);
+    dispatch(event_val);
 }
 
 /* TODO: error messages? */
-void handle_newsql(cdb2_hndl_tp *db, cson_value *val) {
+void handle_newsql(cson_value *val) {
     const char *sql = get_strprop(val, "sql");
     const char *fingerprint = get_strprop(val, "fingerprint");
 
@@ -572,11 +886,11 @@ void handle_newsql(cdb2_hndl_tp *db, cson_value *val) {
 }
 
 
-void handle_txn(cdb2_hndl_tp *db, cson_value *val) {
-    add_to_transaction(db, val);
+void handle_txn(cson_value *val) {
+    add_to_transaction(val);
 }
 
-typedef void (*event_handler)(cdb2_hndl_tp *db, cson_value *val);
+typedef void (*event_handler)(cson_value *val);
 std::map<std::string, event_handler> handlers;
     
 void init_handlers(void) {
@@ -585,17 +899,17 @@ void init_handlers(void) {
     handlers.insert(std::pair<std::string, event_handler>("txn", handle_txn));
 }
 
-void handle(cdb2_hndl_tp *db, const char *event, cson_value *event_val) {
+void handle(const char *event, cson_value *event_val) {
     auto h = handlers.find(event);
     if (h == handlers.end()) {
         cson_free_value(event_val);
         return;
     }
     else
-        h->second(db, event_val);
+        h->second(event_val);
 }
 
-void process_events(cdb2_hndl_tp *db, std::istream &in) {
+void process_events(std::istream &in) {
     std::string line;
     int linenum = 0;
 
@@ -618,45 +932,60 @@ void process_events(cdb2_hndl_tp *db, std::istream &in) {
         const char *type = get_strprop(event_val, "type");
 
         if (type != nullptr)
-            handle(cdb2h, type, event_val);
+            handle(type, event_val);
         else
             cson_free_value(event_val);
     }
-    std::cout << "got " << linenum  << " lines" << std::endl;
+    if (verbose)
+        std::cout << "got " << linenum  << " lines" << std::endl;
 }
 
 int main(int argc, char **argv) {
-    char *dbname;
     char *filename = nullptr;
+    int c;
 
     init_handlers();
 
-    if (argc < 2) {
+    while ((c = getopt(argc, argv, "fs:bh")) != -1) {
+        switch (c) {
+        case 'f':
+            fast = true;
+            break;
+        case 's':
+            speedup = atof(optarg);
+            if (speedup <= 0) {
+                std::cerr << "Invalid speedup factor " << optarg << std::endl;
+                usage();
+            }
+            break;
+        case 'b':
+            verbose = false;
+            break;
+        default:
+            usage();
+        }
+    }
+
+    if (argc - optind < 1) {
         usage();
     }
-    dbname = argv[1];
+    dbname = argv[optind];
 
-    if (argc >= 3)
-        filename = argv[2];
+    if (argc - optind >= 2)
+        filename = argv[optind + 1];
 
     /* TODO: tier should be an option */
-    int rc;
     char *conf = getenv("CDB2_CONFIG");
     if (conf) {
         cdb2_set_comdb2db_config(conf);
-        rc = cdb2_open(&cdb2h, dbname, "default", 0);
+        dbtier = "default";
     }
     else { 
-        rc = cdb2_open(&cdb2h, dbname, "local", 0);
-    }
-
-    if (rc) {
-        std::cerr << "cdb2_open() failed: " << cdb2_errstr(cdb2h) << std::endl;
-        exit(EXIT_FAILURE);
+        dbtier = "local";
     }
 
     if (filename == nullptr) {
-        process_events(cdb2h, std::cin);
+        process_events(std::cin);
     }
     else {
         std::ifstream f;
@@ -666,9 +995,9 @@ int main(int argc, char **argv) {
             return 1;
         }
 
-        process_events(cdb2h, f);
+        process_events(f);
     }
 
-    // cdb2_close(cdb2h);
+    report();
     return 0;
 }
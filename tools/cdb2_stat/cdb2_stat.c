@@ -714,6 +714,11 @@ lock_stats(dbenv, internal, flags)
   "Total number of locks not immediately available due to conflicts.\n",
 	    (u_long)sp->st_nconflicts);
 	dl("Number of deadlocks.\n", (u_long)sp->st_ndeadlocks);
+	dl("Number of deadlock detector passes.\n", (u_long)sp->st_ndetects);
+	dl("Longest deadlock detector pass in microseconds.\n",
+	    (u_long)sp->st_detect_max_usecs);
+	dl("Most waiting lockers seen by a detector pass.\n",
+	    (u_long)sp->st_detect_max_waiters);
 	dl("Lock timeout value.\n", (u_long)sp->st_locktimeout);
 	dl("Number of locks that have timed out.\n",
 	    (u_long)sp->st_nlocktimeouts);
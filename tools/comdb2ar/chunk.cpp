@@ -0,0 +1,238 @@
+#include "chunk.h"
+
+#include "comdb2ar.h"
+#include "error.h"
+#include "riia.h"
+#include "tar_header.h"
+
+#include <cstring>
+#include <sstream>
+#include <string>
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <lz4.h>
+
+#if LZ4_VERSION_NUMBER < 10701
+#define LZ4_compress_default LZ4_compress_limitedOutput
+#endif
+
+static const char chunk_magic[4] = {'C', 'H', 'N', 'K'};
+
+enum { CHUNK_LZ4 = 1 };
+
+// On disk layout of the header at the start of a chunk member's data.  All
+// fields are big endian.
+//   0  magic    "CHNK"
+//   4  flags    CHUNK_LZ4 if the data is compressed
+//   8  offset   where the chunk goes in its file
+//  16  filesize length of the whole file
+//  24  rawlen   length of the chunk once decoded
+//  28  datalen  length of the data that follows
+const size_t CHUNK_HEADER_SIZE = 32;
+
+static void put32(char *p, uint32_t v)
+{
+    for (int ii = 3; ii >= 0; --ii, v >>= 8)
+        p[ii] = (char)(v & 0xff);
+}
+
+static void put64(char *p, uint64_t v)
+{
+    for (int ii = 7; ii >= 0; --ii, v >>= 8)
+        p[ii] = (char)(v & 0xff);
+}
+
+static uint32_t get32(const char *p)
+{
+    uint32_t v = 0;
+    for (int ii = 0; ii < 4; ++ii)
+        v = (v << 8) | (uint8_t)p[ii];
+    return v;
+}
+
+static uint64_t get64(const char *p)
+{
+    uint64_t v = 0;
+    for (int ii = 0; ii < 8; ++ii)
+        v = (v << 8) | (uint8_t)p[ii];
+    return v;
+}
+
+bool parse_chunk_name(const std::string& member, std::string& filename)
+{
+    size_t pos = member.find_last_of('@');
+    if (pos == std::string::npos || pos == 0 || member.length() - pos != 17) {
+        return false;
+    }
+    for (size_t ii = pos + 1; ii < member.length(); ++ii) {
+        if (!isxdigit((unsigned char)member[ii])) {
+            return false;
+        }
+    }
+    filename = member.substr(0, pos);
+    return true;
+}
+
+size_t make_chunk_member(const std::string& filename, off_t offset,
+        off_t filesize, const uint8_t *data, size_t nbytes, bool compress,
+        std::vector<char>& scratch)
+{
+    size_t bound = compress ? LZ4_compressBound(nbytes) : nbytes;
+    scratch.resize(sizeof(tar_block_header) + CHUNK_HEADER_SIZE + bound + 512);
+
+    char *chunkhead = &scratch[sizeof(tar_block_header)];
+    char *payload = chunkhead + CHUNK_HEADER_SIZE;
+    uint32_t flags = 0;
+    size_t datalen = nbytes;
+
+    if (compress && nbytes > 0) {
+        int rc = LZ4_compress_default((const char *)data, payload, nbytes,
+                                      bound);
+        // Keep the chunk as it is if compressing didn't gain anything
+        if (rc > 0 && (size_t)rc < nbytes) {
+            flags |= CHUNK_LZ4;
+            datalen = rc;
+        }
+    }
+    if (!(flags & CHUNK_LZ4)) {
+        std::memcpy(payload, data, nbytes);
+    }
+
+    std::memcpy(chunkhead, chunk_magic, sizeof(chunk_magic));
+    put32(chunkhead + 4, flags);
+    put64(chunkhead + 8, offset);
+    put64(chunkhead + 16, filesize);
+    put32(chunkhead + 24, nbytes);
+    put32(chunkhead + 28, datalen);
+
+    char name[17];
+    snprintf(name, sizeof(name), "%016llx", (unsigned long long)offset);
+
+    struct stat st;
+    st.st_mode = 0664;
+    st.st_uid = getuid();
+    st.st_gid = getgid();
+    st.st_mtime = time(NULL);
+    st.st_size = CHUNK_HEADER_SIZE + datalen;
+
+    TarHeader head;
+    head.set_filename(filename + "@" + name);
+    head.set_attrs(st);
+    head.set_checksum();
+    std::memcpy(&scratch[0], head.get().c, sizeof(tar_block_header));
+
+    // Pad the member out to a whole number of tar blocks
+    size_t len = sizeof(tar_block_header) + st.st_size;
+    size_t padding = (512 - (st.st_size & (512 - 1))) & (512 - 1);
+    std::memset(&scratch[len], 0, padding);
+    len += padding;
+    return len;
+}
+
+static int open_chunk_file(const std::string& path)
+{
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT, 0666);
+    if (fd == -1 && errno == ENOENT) {
+        // Queue extents live in a subdirectory of the data directory.  Other
+        // threads may be restoring into it too, so don't mind losing a race
+        // to create it.
+        std::string dirname(path);
+        makedirname(dirname);
+        if (mkdir(dirname.c_str(), 0777) == 0 || errno == EEXIST) {
+            fd = open(path.c_str(), O_WRONLY | O_CREAT, 0666);
+        }
+    }
+    return fd;
+}
+
+unsigned long long restore_chunk_member(int fd, const std::string& member,
+        unsigned long long size, const std::string& datadestdir,
+        std::vector<char>& scratch)
+{
+    std::string filename;
+    if (!parse_chunk_name(member, filename)) {
+        throw Error("Bad chunk name " + member);
+    }
+
+    unsigned long long padded = (size + 511ULL) & ~511ULL;
+    if (size < CHUNK_HEADER_SIZE ||
+        padded > CHUNK_HEADER_SIZE + LZ4_compressBound(MAX_BUF_SIZE) + 512) {
+        std::ostringstream ss;
+        ss << "Bad size " << size << " for chunk " << member;
+        throw Error(ss);
+    }
+    scratch.resize(padded + MAX_BUF_SIZE);
+    if (readall(fd, &scratch[0], padded) != padded) {
+        std::ostringstream ss;
+        ss << "Error reading chunk " << member << ": " << errno << " "
+           << std::strerror(errno);
+        throw Error(ss);
+    }
+
+    const char *chunkhead = &scratch[0];
+    const char *payload = chunkhead + CHUNK_HEADER_SIZE;
+    uint32_t flags = get32(chunkhead + 4);
+    off_t offset = get64(chunkhead + 8);
+    off_t filesize = get64(chunkhead + 16);
+    uint32_t rawlen = get32(chunkhead + 24);
+    uint32_t datalen = get32(chunkhead + 28);
+
+    if (std::memcmp(chunkhead, chunk_magic, sizeof(chunk_magic)) != 0 ||
+        CHUNK_HEADER_SIZE + datalen != size || rawlen > MAX_BUF_SIZE ||
+        offset + rawlen > filesize) {
+        throw Error("Bad chunk header in " + member);
+    }
+
+    const char *data = payload;
+    if (flags & CHUNK_LZ4) {
+        char *raw = &scratch[padded];
+        int rc = LZ4_decompress_safe(payload, raw, datalen, rawlen);
+        if (rc < 0 || (uint32_t)rc != rawlen) {
+            throw Error("Error decompressing chunk " + member);
+        }
+        data = raw;
+    } else if (datalen != rawlen) {
+        throw Error("Bad chunk header in " + member);
+    }
+
+    std::string path(datadestdir + "/" + filename);
+    int outfd = open_chunk_file(path);
+    if (outfd == -1) {
+        std::ostringstream ss;
+        ss << "Error opening '" << path << "' for writing: " << errno << " "
+           << std::strerror(errno);
+        throw Error(ss);
+    }
+    RIIA_fd outfd_guard(outfd);
+
+    // Every chunk sets the final length.  This trims whatever was left over
+    // from an older copy of the file and never cuts into another chunk.
+    if (ftruncate(outfd, filesize) == -1) {
+        std::ostringstream ss;
+        ss << "Error setting length of '" << path << "': " << errno << " "
+           << std::strerror(errno);
+        throw Error(ss);
+    }
+
+    size_t done = 0;
+    while (done < rawlen) {
+        ssize_t n = pwrite(outfd, data + done, rawlen - done, offset + done);
+        if (n <= 0) {
+            std::ostringstream ss;
+            ss << "Error writing " << path << " at offset " << offset + done
+               << ": " << errno << " " << std::strerror(errno);
+            throw Error(ss);
+        }
+        done += n;
+    }
+    return rawlen;
+}
@@ -0,0 +1,42 @@
+#ifndef INCLUDED_CHUNK
+#define INCLUDED_CHUNK
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <sys/types.h>
+
+#include <string>
+#include <vector>
+
+// When compressing (-z) or writing a multi-part archive (-m), data files are
+// not archived as a single tar member each.  Instead every buffer of the file
+// becomes a chunk member of its own, named "<file>@<offset in hex>", whose
+// data is a small header giving the offset, the file size and the encoding
+// followed by the chunk bytes (lz4 compressed when that makes them smaller).
+// Since each chunk says where it belongs, chunks can be produced by any
+// thread, spread over any archive part and restored in any order.
+
+
+bool parse_chunk_name(const std::string& member, std::string& filename);
+// Return true if member is the name of a chunk member, and set filename to
+// the name of the file it belongs to.
+
+size_t make_chunk_member(const std::string& filename, off_t offset,
+        off_t filesize, const uint8_t *data, size_t nbytes, bool compress,
+        std::vector<char>& scratch);
+// Build the chunk member (tar header, chunk header and padding included) for
+// nbytes of filename read from the given offset in scratch, compressing it if
+// compress is set.  Returns the length of the member, which the caller writes
+// out as it is.  This does no I/O so that callers can compress on many
+// threads and only serialise the writes.
+
+unsigned long long restore_chunk_member(int fd, const std::string& member,
+        unsigned long long size, const std::string& datadestdir,
+        std::vector<char>& scratch);
+// Read the data (and padding) of a chunk member of the given size from fd and
+// write the chunk into its file under datadestdir, creating the file and
+// setting its length if needed.  Returns the number of bytes of file data
+// written.  Throws an Error if the chunk cannot be decoded or written.
+
+#endif // INCLUDED_CHUNK
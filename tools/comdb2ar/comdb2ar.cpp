@@ -11,6 +11,7 @@
 #include <iostream>
 #include <string>
 #include <sstream>
+#include <vector>
 
 #include <cstdlib>
 #include <cstring>
@@ -35,6 +36,10 @@ const char *help_text[] = {
 "  Database mydb is serialised into tape archive format on to stdout.",
 "  -s   serialise support files only (lrl, csc2 etc, no data or log files)",
 "  -L   do not disable log file deletion (dangerous)",
+"  -j N read and verify data files with N threads (default 1)",
+"  -z   compress data files with lz4 as they are read",
+"  -m <path>  also write an archive part to path; data files are spread",
+"             across stdout and all the parts (may be repeated)",
 "",
 "To deserialise a db: comdb2ar.tsk [opts] x [/bb/bin /bb/data/mydb] <input",
 "To deserialise a db incrementally:",
@@ -58,6 +63,8 @@ const char *help_text[] = {
 "  -f           force deserialisation even if checksums fail",
 "  -O           legacy mode, does not delete old format files",
 "  -D           turn off directio",
+"  -m <path>    also restore the archive part at path, in parallel with",
+"               stdin (may be repeated)",
 NULL
 };
 
@@ -107,6 +114,9 @@ int main(int argc, char *argv[])
     bool incr_ex = false;
     std::string incr_path;
     bool incr_path_specified = false;
+    int nthreads = 1;
+    bool compress = false;
+    std::vector<std::string> part_paths;
 
     // TODO: should really consider using comdb2file.c
     char *s = getenv("COMDB2_ROOT");
@@ -120,7 +130,7 @@ int main(int argc, char *argv[])
     ss << root << "/bin/comdb2";
     std::string comdb2_task(ss.str());
 
-    while((c = getopt(argc, argv, "hsSLC:I:b:x:u:rRSkKfOD")) != EOF) {
+    while((c = getopt(argc, argv, "hsSLC:I:b:x:u:rRSkKfODj:zm:")) != EOF) {
         switch(c) {
             case 'O':
                 legacy_mode = true;
@@ -186,6 +196,22 @@ int main(int argc, char *argv[])
             case 'D':
                 do_direct_io = false;
                 break;
+            case 'j':
+                nthreads = std::atoi(optarg);
+                if(nthreads < 1) {
+                    std::cerr << "Invalid thread count for -j: " << optarg
+                        << std::endl;
+                    std::exit(2);
+                }
+                break;
+
+            case 'z':
+                compress = true;
+                break;
+
+            case 'm':
+                part_paths.push_back(optarg);
+                break;
 
             case 'I':
                 if(std::strcmp(optarg, "create") == 0) {
@@ -230,6 +256,15 @@ int main(int argc, char *argv[])
         std::exit(2);
     }
 
+    // Chunked data files carry no per-page incremental state, and the
+    // increments themselves are a single stream.
+    if((incr_gen || incr_create || incr_ex) &&
+       (compress || !part_paths.empty())) {
+        std::cerr << "-z and -m cannot be used in incremental mode"
+            << std::endl;
+        std::exit(2);
+    }
+
     for(const char *cp = argv[0]; *cp; ++cp) {
         switch(*cp) {
             case 'c':
@@ -275,7 +310,10 @@ int main(int argc, char *argv[])
                 do_direct_io,
                 incr_create,
                 incr_gen,
-                incr_path
+                incr_path,
+                nthreads,
+                compress,
+                part_paths
             );
         } catch(std::exception& e) {
             std::cerr << e.what() << std::endl;
@@ -315,7 +353,8 @@ int main(int argc, char *argv[])
              legacy_mode,
              is_disk_full,
              run_with_done_file,
-             incr_ex
+             incr_ex,
+             part_paths
            );
         } catch(std::exception& e) {
             std::cerr << e.what() << std::endl;
@@ -25,6 +25,7 @@
 #include <list>
 #include <string>
 #include <memory>
+#include <vector>
 
 #include "fdostream.h"
 
@@ -103,13 +104,21 @@ void serialise_database(
   bool do_direct_io,
   bool incr_create,
   bool incr_gen,
-  const std::string& incr_path
+  const std::string& incr_path,
+  int nthreads,
+  bool compress,
+  const std::vector<std::string>& part_paths
 );
 // Serialise a database into tape archive format and write it to stdout.
 // If support_only is true then only support files (lrl and schema) will
 // be serialised.  If disable_log_deletion and the database is running then
 // it will be advised to hold log file deletion until the backup is complete
 // (highly recommended!)
+// Data files are read and their page checksums verified by nthreads threads.
+// If compress is set or part_paths is not empty then data files are written
+// as lz4 compressed (if compress) chunks dealt out across stdout and the
+// archive parts written to part_paths; otherwise the archive is written out
+// in order.
 // If legacy_mode is enabled, old file format are not removed after restore
 
 
@@ -125,7 +134,8 @@ void deserialise_database(
   bool legacy_mode,
   bool& is_disk_full,
   bool run_with_done_file,
-  bool incr_mode
+  bool incr_mode,
+  const std::vector<std::string>& part_paths
 );
 // Deserialise a database from serialised form received on stdin.
 // If lrldestdir and datadestdir are not NULL then the lrl and data files
@@ -136,7 +146,8 @@ void deserialise_database(
 // true then full recovery is run on the resulting database using the binary
 // given by comdb2_task.  If the destination disk reaches or exceeds the
 // specified percent_full during the deserialisation then the operation is
-// halted.
+// halted.  The archive parts in part_paths, if any, are restored alongside
+// stdin on a thread each.
 
 bool isDirectory(const std::string& file);
 
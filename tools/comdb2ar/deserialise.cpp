@@ -8,6 +8,7 @@
 #include "tar_header.h"
 #include "riia.h"
 #include "increment.h"
+#include "chunk.h"
 #include "util.h"
 
 #include <cstdlib>
@@ -19,6 +20,10 @@
 #include <fstream>
 #include <vector>
 #include <memory>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
 
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -341,6 +346,154 @@ static bool check_dest_dir(const std::string& dir)
     return true;
 }
 
+static bool would_fill_disk(const std::string& datadestdir,
+        unsigned long long bytes, unsigned percent_full, double& percent_free)
+// Return true if writing another bytes into datadestdir would take the file
+// system to percent_full or beyond.  percent_free is set to what would be
+// left.
+{
+    struct statvfs stfs;
+    int rc = statvfs(datadestdir.c_str(), &stfs);
+    if(rc == -1) {
+        std::ostringstream ss;
+        ss << "Error running statvfs on " << datadestdir
+            << ": " << strerror(errno);
+        throw Error(ss);
+    }
+
+    fsblkcnt_t fsblocks = bytes / stfs.f_bsize;
+    percent_free = 100.00 * ((double)(stfs.f_bavail - fsblocks) / (double)stfs.f_blocks);
+    return 100.00 - percent_free >= percent_full;
+}
+
+namespace {
+
+class PartRestorer {
+// Restores the extra parts of a multi-part archive, a thread per part, while
+// the main stream is restored from stdin.  Parts only hold chunks of data
+// files, which can be written in any order, so the threads need nothing from
+// the main stream but the data directory.
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_lk;
+    std::exception_ptr m_error;
+    std::atomic<bool> m_stop;
+    std::atomic<bool> m_disk_full;
+
+    void restore_part(const std::string& path, const std::string& datadestdir,
+            unsigned percent_full);
+
+public:
+    PartRestorer() : m_stop(false), m_disk_full(false) {}
+    ~PartRestorer();
+
+    void start(const std::vector<std::string>& part_paths,
+            const std::string& datadestdir, unsigned percent_full);
+    // Start restoring each of part_paths into datadestdir
+
+    void finish(bool& is_disk_full);
+    // Wait for every part to be restored.  Rethrows the first error any part
+    // hit, setting is_disk_full if that was running out of space.
+};
+
+}
+
+void PartRestorer::restore_part(const std::string& path,
+        const std::string& datadestdir, unsigned percent_full)
+{
+    static const char zero_head[512] = {0};
+    std::vector<char> scratch;
+    unsigned long long nchunks = 0, nbytes = 0;
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd == -1) {
+        std::ostringstream ss;
+        ss << "Error opening archive part " << path << ": " << strerror(errno);
+        throw Error(ss);
+    }
+    RIIA_fd fd_guard(fd);
+
+    while(!m_stop) {
+        tar_block_header head;
+        if(readall(fd, head.c, sizeof(head.c)) != sizeof(head.c)) {
+            std::ostringstream ss;
+            ss << "Error reading tar block header from " << path << ": "
+                << errno << " " << strerror(errno);
+            throw Error(ss);
+        }
+        if(std::memcmp(head.c, zero_head, 512) == 0) {
+            break;
+        }
+        if(head.h.filename[sizeof(head.h.filename) - 1] != '\0') {
+            throw Error("Bad block in " + path + ": filename is not null terminated");
+        }
+        const std::string member(head.h.filename);
+        std::string filename;
+        if(!parse_chunk_name(member, filename)) {
+            throw Error("Unexpected file " + member + " in archive part " + path);
+        }
+        unsigned long long size;
+        if(!read_octal_ull(head.h.size, sizeof(head.h.size), size)) {
+            throw Error("Bad block in " + path + ": bad size");
+        }
+
+        double percent_free;
+        if(would_fill_disk(datadestdir, MAX_BUF_SIZE, percent_full, percent_free)) {
+            m_disk_full = true;
+            std::ostringstream ss;
+            ss << "Not enough space to deserialise " << member
+                << " from " << path << " - would leave only "
+                << percent_free << "% free space";
+            throw Error(ss);
+        }
+
+        nbytes += restore_chunk_member(fd, member, size, datadestdir, scratch);
+        nchunks++;
+    }
+
+    std::clog << "x part " << path << " chunks=" << nchunks
+              << " size=" << nbytes << std::endl;
+}
+
+void PartRestorer::start(const std::vector<std::string>& part_paths,
+        const std::string& datadestdir, unsigned percent_full)
+{
+    for(size_t ii = 0; ii < part_paths.size(); ++ii) {
+        const std::string path(part_paths[ii]);
+        m_threads.push_back(std::thread([this, path, datadestdir, percent_full]() {
+            try {
+                restore_part(path, datadestdir, percent_full);
+            } catch(...) {
+                std::lock_guard<std::mutex> l(m_lk);
+                if(!m_error) {
+                    m_error = std::current_exception();
+                }
+                m_stop = true;
+            }
+        }));
+    }
+}
+
+void PartRestorer::finish(bool& is_disk_full)
+{
+    for(size_t ii = 0; ii < m_threads.size(); ++ii) {
+        m_threads[ii].join();
+    }
+    m_threads.clear();
+    if(m_error) {
+        is_disk_full = m_disk_full;
+        std::rethrow_exception(m_error);
+    }
+}
+
+PartRestorer::~PartRestorer()
+{
+    m_stop = true;
+    for(size_t ii = 0; ii < m_threads.size(); ++ii) {
+        m_threads[ii].join();
+    }
+}
+
 #define write_size (1000*1024)
 
 void deserialise_database(
@@ -355,7 +508,8 @@ void deserialise_database(
         bool legacy_mode,
         bool& is_disk_full,
         bool run_with_done_file,
-        bool incr_mode
+        bool incr_mode,
+        const std::vector<std::string>& part_paths
 )
 // Deserialise a database from serialised from received on stdin.
 // If lrldestdir and datadestdir are not NULL then the lrl and data files
@@ -420,6 +574,13 @@ void deserialise_database(
     // The manifest map
     std::map<std::string, FileInfo> manifest_map;
 
+    // Archive parts, started once we know where the data goes
+    PartRestorer part_restorer;
+
+    // Data file chunks found on stdin
+    std::vector<char> chunk_scratch;
+    unsigned long long nchunks = 0;
+
     if (run_with_done_file)
     {
        /* remove the DONE file before we start copying */
@@ -468,6 +629,8 @@ void deserialise_database(
             }
 
             inited_txn_dir = true;
+
+            part_restorer.start(part_paths, datadestdir, percent_full);
         }
 
         // Read the tar block header
@@ -521,6 +684,25 @@ void deserialise_database(
         }
         unsigned long long nblocks = (filesize + 511ULL) >> 9;
 
+        // Chunks of data files (see chunk.h) go straight to their file
+        std::string chunk_file;
+        if(parse_chunk_name(filename, chunk_file)) {
+            if(!inited_txn_dir) {
+                throw Error("Stream contains files for data directory before data dir is known");
+            }
+            double percent_free;
+            if(would_fill_disk(datadestdir, MAX_BUF_SIZE, percent_full, percent_free)) {
+                is_disk_full = true;
+                std::ostringstream ss;
+                ss << "Not enough space to deserialise " << filename
+                    << " - would leave only " << percent_free << "% free space";
+                throw Error(ss);
+            }
+            restore_chunk_member(0, filename, filesize, datadestdir, chunk_scratch);
+            nchunks++;
+            continue;
+        }
+
 
         // If this is an .lrl file then we have to read it into memory and
         // then rewrite it to disk.  In getting the extension it is important
@@ -899,6 +1081,12 @@ void deserialise_database(
         throw Error("No valid lrl file seen or txn dir not inited");
     }
 
+    // Every part has to be in place before recovery can run
+    part_restorer.finish(is_disk_full);
+    if(nchunks) {
+        std::clog << "x " << nchunks << " chunks from stdin" << std::endl;
+    }
+
     // Run full recovery
     if(run_full_recovery) {
         std::ostringstream cmdss;
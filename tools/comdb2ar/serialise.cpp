@@ -10,6 +10,7 @@
 #include "serialiseerror.h"
 #include "tar_header.h"
 #include "increment.h"
+#include "chunk.h"
 #include "util.h"
 
 #include <cassert>
@@ -23,6 +24,11 @@
 #include <utility>
 #include <vector>
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
 
 #include <errno.h>
 #include <fcntl.h>
@@ -50,7 +56,7 @@ extern "C" {
 
 
 
-static void writepadding(size_t nbytes)
+static void writepadding(size_t nbytes, int fd = 1)
 {
     static const char zeroes[1024] = {0};
     while(nbytes > 0) {
@@ -58,7 +64,7 @@ static void writepadding(size_t nbytes)
         if(num > sizeof(zeroes)) {
             num = sizeof(zeroes);
         }
-        if(writeall(1, zeroes, num) != num) {
+        if(writeall(fd, zeroes, num) != num) {
             std::ostringstream ss;
             ss << "error writing zero padding: " << std::strerror(errno);
             throw Error(ss);
@@ -118,6 +124,374 @@ static void serialise_string(const std::string& filename,
  * that defines this properly */
 void *memalign(size_t boundary, size_t size);
 
+// Number of threads reading and verifying each data file; set from -j.
+static int serialise_threads = 1;
+
+// Compress data file chunks on the reader threads; set from -z.
+static bool serialise_compress = false;
+
+namespace {
+
+struct ArchivePart {
+    int fd;
+    std::mutex lk;
+};
+
+}
+
+// The parts of a multi-part archive (-m).  Part 0 is stdout.  While this
+// holds more than stdout, data files are written as chunks dealt out across
+// all the parts in turn.
+static std::vector<std::unique_ptr<ArchivePart> > archive_parts;
+static std::atomic<size_t> next_part(0);
+
+static uint8_t *alloc_pagebuf(size_t bufsize)
+{
+    uint8_t *pagebuf = NULL;
+#if ! defined  ( _SUN_SOURCE ) && ! defined ( _HP_SOURCE )
+    if (posix_memalign((void**) &pagebuf, 512, bufsize) != 0)
+        pagebuf = NULL;
+#else
+    pagebuf = (uint8_t*) memalign(512, bufsize);
+#endif
+    if (pagebuf == NULL)
+        throw Error("out of memory allocating page buffer");
+    return pagebuf;
+}
+
+static void wait_for_memptrickle(volatile iomap *iomap, bool& skip_iomap,
+        int& num_waits)
+// Back off while the database is flushing its cache so that we don't compete
+// with it for the disk.
+{
+    while (!skip_iomap && iomap != NULL && iomap->memptrickle_time) {
+        int now = time(NULL);
+        if ((now - iomap->memptrickle_time) > 5*60) {
+            std::clog << "long memptrickle (" << now - iomap->memptrickle_time << " seconds), continuing" << std::endl;
+            skip_iomap = true;
+            break;
+        }
+        num_waits++;
+        poll(0, 0, 100);
+    }
+}
+
+static void read_chunk(int fd, const FileInfo& file, size_t pagesize,
+        off_t offset, size_t nbytes, uint8_t *pagebuf, bool incr_pages,
+        std::string& incr)
+// Read nbytes at offset into pagebuf.  If the file has checksums then every
+// page is verified, and a page that fails is read again (we may have caught
+// it half written) a few times before giving up.  If incr_pages is set the
+// lsn and checksum of each page are appended to incr.
+{
+    const std::string& filename = file.get_filename();
+    size_t got = 0;
+
+    while (got < nbytes) {
+        ssize_t bytesread = pread(fd, pagebuf + got, nbytes - got, offset + got);
+        if (bytesread == 0) {
+            throw SerialiseError(filename, "file shrank while being archived!");
+        }
+        if (bytesread < 0) {
+            std::ostringstream ss;
+            ss << "read error at offset " << offset + got << ", tried to read "
+                << nbytes - got << " bytes " << std::strerror(errno);
+            throw SerialiseError(filename, ss.str());
+        }
+        got += bytesread;
+    }
+
+    if (!file.get_checksums())
+        return;
+
+    int retry = 5;
+    size_t n = 0;
+
+    while (n < nbytes) {
+        bool verify_bool = false;
+        PAGE * pagep = (PAGE *) (pagebuf + n);
+        uint32_t verify_cksum;
+        verify_checksum(pagebuf + n, pagesize, file.get_crypto(), file.get_swapped(), &verify_bool, &verify_cksum);
+
+        if(verify_bool){
+            // checksum verified
+            n += pagesize;
+            retry = 5;
+
+            // If we are in incremental mode, on initial backup creation we want to create the diff files
+            if(incr_pages){
+                incr.append((char *) &(LSN(pagep).file), 4);
+                incr.append((char *) &(LSN(pagep).offset), 4);
+                incr.append((char *) &verify_cksum, 4);
+            }
+
+            continue;
+        }
+
+        // Partial page read. Read the page again to see if it passes
+        // checksum verification.
+        if (--retry == 0) {
+            //giving up on this page
+            std::ostringstream ss;
+            ss << "serialise_file:page failed checksum verification";
+            throw SerialiseError(filename, ss.str());
+        }
+
+        // wait 500ms before reading page again
+        poll(0, 0, 500);
+
+        ssize_t nread, totalread = 0;
+        while (totalread < pagesize) {
+            nread = pread(fd, pagebuf + n + totalread, pagesize - totalread,
+                          offset + n + totalread);
+            if (nread <= 0) {
+                std::ostringstream ss;
+                ss << "serialise_file:read: " << std::strerror(errno);
+                throw SerialiseError(filename, ss.str());
+            }
+            totalread += nread;
+        }
+    }
+}
+
+static void write_chunk(const std::string& filename, const uint8_t *pagebuf,
+        size_t nbytes, std::ofstream& incrFile, const std::string& incr)
+{
+    ssize_t byteswritten = writeall(1, pagebuf, nbytes);
+    if(byteswritten != nbytes) {
+        std::ostringstream ss;
+        ss << "write error: " << std::strerror(errno);
+        throw SerialiseError(filename, ss.str());
+    }
+    if (!incr.empty()) {
+        incrFile.write(incr.data(), incr.size());
+    }
+}
+
+static void copy_file(int fd, const FileInfo& file, size_t pagesize,
+        size_t bufsize, off_t filesize, volatile iomap *iomap,
+        bool incr_pages, std::ofstream& incrFile, int& num_waits)
+// Copy the file to the output one buffer at a time.
+{
+    uint8_t *pagebuf = alloc_pagebuf(bufsize);
+    std::unique_ptr<uint8_t, void (*)(void *)> pagebuf_guard(pagebuf, free);
+    bool skip_iomap = false;
+    std::string incr;
+
+    for (off_t offset = 0; offset < filesize; offset += bufsize) {
+        size_t nbytes = std::min((off_t) bufsize, filesize - offset);
+        wait_for_memptrickle(iomap, skip_iomap, num_waits);
+        incr.clear();
+        read_chunk(fd, file, pagesize, offset, nbytes, pagebuf, incr_pages, incr);
+        write_chunk(file.get_filename(), pagebuf, nbytes, incrFile, incr);
+    }
+}
+
+namespace {
+
+struct Chunk {
+    uint8_t *pagebuf;
+    size_t nbytes;
+    bool ready;
+    std::exception_ptr error;
+    std::string incr;
+};
+
+}
+
+static void copy_file_parallel(int fd, const FileInfo& file, size_t pagesize,
+        size_t bufsize, off_t filesize, volatile iomap *iomap,
+        bool incr_pages, std::ofstream& incrFile, int& num_waits)
+// Copy the file to the output using serialise_threads readers.  Readers claim
+// buffers in file order and read and verify them concurrently; we write them
+// out in order as they complete.  At most two buffers per reader are in
+// flight, so memory use stays bounded however large the file is.
+{
+    const size_t nchunks = (filesize + bufsize - 1) / bufsize;
+    const size_t nthreads = std::min((size_t) serialise_threads, nchunks);
+    const size_t window = std::min(nthreads * 2, nchunks);
+
+    std::vector<Chunk> slots(window);
+    struct SlotsGuard {
+        std::vector<Chunk>& slots;
+        ~SlotsGuard() {
+            for (size_t ii = 0; ii < slots.size(); ++ii)
+                free(slots[ii].pagebuf);
+        }
+    } slots_guard = {slots};
+    for (size_t ii = 0; ii < window; ++ii) {
+        slots[ii].pagebuf = NULL;
+    }
+    for (size_t ii = 0; ii < window; ++ii) {
+        slots[ii].pagebuf = alloc_pagebuf(bufsize);
+        slots[ii].ready = false;
+    }
+
+    std::mutex lk;
+    std::condition_variable cv;
+    size_t next_read = 0;   // next chunk a reader will claim
+    size_t next_write = 0;  // next chunk to go to the output
+    bool stop = false;
+    bool skip_iomap = false;
+
+    auto reader = [&]() {
+        std::unique_lock<std::mutex> l(lk);
+        for (;;) {
+            // A slot is free once the chunk it held has been written out
+            while (!stop && next_read < nchunks &&
+                   next_read >= next_write + window) {
+                cv.wait(l);
+            }
+            if (stop || next_read >= nchunks) {
+                return;
+            }
+            size_t idx = next_read++;
+            // Pausing under the lock holds back every reader
+            wait_for_memptrickle(iomap, skip_iomap, num_waits);
+            l.unlock();
+
+            Chunk& c = slots[idx % window];
+            off_t offset = (off_t) idx * bufsize;
+            c.nbytes = std::min((off_t) bufsize, filesize - offset);
+            c.incr.clear();
+            c.error = nullptr;
+            try {
+                read_chunk(fd, file, pagesize, offset, c.nbytes, c.pagebuf,
+                           incr_pages, c.incr);
+            } catch (...) {
+                c.error = std::current_exception();
+            }
+
+            l.lock();
+            c.ready = true;
+            cv.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    struct ThreadsGuard {
+        std::vector<std::thread>& threads;
+        std::mutex& lk;
+        std::condition_variable& cv;
+        bool& stop;
+        ~ThreadsGuard() {
+            {
+                std::lock_guard<std::mutex> l(lk);
+                stop = true;
+            }
+            cv.notify_all();
+            for (size_t ii = 0; ii < threads.size(); ++ii)
+                threads[ii].join();
+        }
+    } threads_guard = {threads, lk, cv, stop};
+
+    for (size_t ii = 0; ii < nthreads; ++ii) {
+        threads.push_back(std::thread(reader));
+    }
+
+    for (size_t idx = 0; idx < nchunks; ++idx) {
+        Chunk& c = slots[idx % window];
+        {
+            std::unique_lock<std::mutex> l(lk);
+            while (!c.ready) {
+                cv.wait(l);
+            }
+        }
+        if (c.error) {
+            std::rethrow_exception(c.error);
+        }
+        write_chunk(file.get_filename(), c.pagebuf, c.nbytes, incrFile, c.incr);
+        {
+            std::lock_guard<std::mutex> l(lk);
+            c.ready = false;
+            ++next_write;
+        }
+        cv.notify_all();
+    }
+}
+
+static void copy_file_chunked(int fd, const FileInfo& file, size_t pagesize,
+        size_t bufsize, off_t filesize, volatile iomap *iomap, int& num_waits)
+// Copy the file to the archive as chunk members (see chunk.h).  Readers claim
+// buffers in file order, read, verify and (with -z) compress them, and write
+// each one straight out to the next archive part, holding only that part's
+// lock for the write.  Chunks say where they go
+// so nothing needs to be put back in order.
+{
+    // An empty file still gets a chunk so that the restore creates it
+    const size_t nchunks = std::max((size_t) 1, (size_t) ((filesize + bufsize - 1) / bufsize));
+    const size_t nthreads = std::min((size_t) serialise_threads, nchunks);
+
+    std::mutex lk;
+    size_t next_read = 0;
+    bool stop = false;
+    bool skip_iomap = false;
+    std::exception_ptr error;
+
+    auto reader = [&]() {
+        uint8_t *pagebuf = NULL;
+        std::vector<char> scratch;
+        std::string incr;
+        try {
+            pagebuf = alloc_pagebuf(bufsize);
+        } catch (...) {
+            std::lock_guard<std::mutex> l(lk);
+            if (!error)
+                error = std::current_exception();
+            stop = true;
+            return;
+        }
+        std::unique_ptr<uint8_t, void (*)(void *)> pagebuf_guard(pagebuf, free);
+
+        std::unique_lock<std::mutex> l(lk);
+        while (!stop && next_read < nchunks) {
+            size_t idx = next_read++;
+            // Pausing under the lock holds back every reader
+            wait_for_memptrickle(iomap, skip_iomap, num_waits);
+            l.unlock();
+
+            try {
+                off_t offset = (off_t) idx * bufsize;
+                size_t nbytes = std::min((off_t) bufsize, filesize - offset);
+                read_chunk(fd, file, pagesize, offset, nbytes, pagebuf, false,
+                           incr);
+
+                size_t len = make_chunk_member(file.get_filename(), offset,
+                        filesize, pagebuf, nbytes, serialise_compress, scratch);
+
+                ArchivePart& part =
+                    *archive_parts[next_part++ % archive_parts.size()];
+                std::lock_guard<std::mutex> pl(part.lk);
+                if (writeall(part.fd, &scratch[0], len) != len) {
+                    std::ostringstream ss;
+                    ss << "error writing chunk at offset " << offset << ": "
+                       << std::strerror(errno);
+                    throw SerialiseError(file.get_filename(), ss.str());
+                }
+            } catch (...) {
+                l.lock();
+                if (!error)
+                    error = std::current_exception();
+                stop = true;
+                return;
+            }
+
+            l.lock();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t ii = 0; ii < nthreads; ++ii) {
+        threads.push_back(std::thread(reader));
+    }
+    for (size_t ii = 0; ii < threads.size(); ++ii) {
+        threads[ii].join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
 static void serialise_file(const FileInfo& file, volatile iomap *iomap=NULL, const std::string altpath="",
                             const std::string incr_path="", bool incr_create = false)
 // Serialise a single file, in tape archive format, onto stdout.  The input
@@ -128,7 +502,6 @@ static void serialise_file(const FileInfo& file, volatile iomap *iomap=NULL, con
 {
     const std::string& filename = file.get_filename();
     int flags;
-    bool skip_iomap = false;
     std::ostringstream ss;
 
     // Ensure large file support
@@ -195,20 +568,7 @@ reopen:
         throw SerialiseError(filename, "not a regular file");
     }
 
-    // Write the header
-    TarHeader head;
-    head.set_filename(filename);
-    head.set_attrs(st);
-    head.set_checksum();
-
-    if(writeall(1, head.get().c, sizeof(tar_block_header))
-            != sizeof(tar_block_header)) {
-        std::ostringstream ss;
-        ss << "error writing tar block header: " << std::strerror(errno);
-        throw SerialiseError(filename, ss.str());
-    }
-
-    // Read the file a page at a time and copy to the output.
+    // Read the file a buffer at a time and copy to the output.
     // Use a large buffer if possible
     size_t pagesize = file.get_pagesize();
     if(pagesize == 0) {
@@ -220,147 +580,57 @@ reopen:
     while((bufsize << 1) <= MAX_BUF_SIZE) {
         bufsize <<= 1;
     }
-#if 0
-    */
-    std::cerr<<"Computed bufsize="<<bufsize<<" for pagesize="<<pagesize<<" file="<<filename<<"\n";
-
-    std::vector<char> pagebuf(bufsize);
-#endif
-    uint8_t *pagebuf = NULL;
-    off_t bytesleft = st.st_size;
-    unsigned long long pageno = 0;
-
-#if ! defined  ( _SUN_SOURCE ) && ! defined ( _HP_SOURCE )
-        posix_memalign((void**) &pagebuf, 512, bufsize);
-#else
-        pagebuf = (uint8_t*) memalign(512, bufsize);
-#endif
-
-    while(bytesleft > 0) {
-        int now;
-        unsigned long long nbytes = bytesleft > bufsize ? bufsize : bytesleft;
-
-        while (!skip_iomap && iomap != NULL && iomap->memptrickle_time) {
-            now = time(NULL);
-            if ((now - iomap->memptrickle_time) > 5*60) {
-                std::clog << "long memptrickle (" << now - iomap->memptrickle_time << " seconds), continuing" << std::endl;
-                skip_iomap = true;
-                break;
-            }
-            num_waits++;
-            poll(0, 0, 100);
-        }
 
-        ssize_t bytesread = read(fd, &pagebuf[0], nbytes);
-        if(bytesread <= 0) {
-            std::ostringstream ss;
-            ss << "read error after " << bytesleft << " bytes, tried to read " << nbytes << " bytes "
-                << std::strerror(errno);
-            throw SerialiseError(filename, ss.str());
-        }
-
-        if (file.get_checksums()) {
-            // Save current offset
-            const off_t offset = lseek(fd, 0, SEEK_CUR);
-            if (offset == (off_t) -1) {
-                std::ostringstream ss;
-                ss << "serialise_file:lseek:initial: " << std::strerror(errno);
-                throw SerialiseError(filename, ss.str());
-            }
-
-            int retry = 5;
-            ssize_t n = 0;
-
-            std::string incrFilename = incr_path + "/" + filename + ".incr";
-            std::ofstream incrFile(incrFilename,
-                                    std::ofstream::binary |
-                                    std::ofstream::trunc);
-
-            while (n < bytesread && retry) {
-                bool verify_bool = false;
-                PAGE * pagep = (PAGE *) (pagebuf + n);
-                uint32_t verify_cksum;
-                verify_checksum(pagebuf + n, pagesize, file.get_crypto(), file.get_swapped(), &verify_bool, &verify_cksum);
-
-                if(verify_bool){
-                    // checksum verified
-                    n += pagesize;
-                    retry = 5;
-
-                    // If we are in incremental mode, on initial backup creation we want to create the diff files
-                    if(incr_create){
-                        incrFile.write((char *) &(LSN(pagep).file), 4);
-                        incrFile.write((char *) &(LSN(pagep).offset), 4);
-                        incrFile.write((char *) &verify_cksum, 4);
-                    }
-
-                    continue;
-                }
-
-                // Partial page read. Read the page again to see if it passes
-                // checksum verification.
-                if (--retry == 0) {
-                    //giving up on this page
-                    std::ostringstream ss;
-                    ss << "serialise_file:page failed checksum verification";
-                    throw SerialiseError(filename, ss.str());
-                }
-
-                // wait 500ms before reading page again
-                poll(0, 0, 500);
-
-                // rewind and read the page again
-                off_t rewind = offset - (bytesread - n);
-                rewind = lseek(fd, rewind, SEEK_SET);
-                if (rewind == (off_t) -1) {
-                    std::ostringstream ss;
-                    ss << "serialise_file:lseek:rewind: " << std::strerror(errno);
-                    throw SerialiseError(filename, ss.str());
-                }
+    // Data files go out as chunks when compressing or writing several parts.
+    // Log files and support files are always whole members on stdout, since
+    // they need to come ahead of the data in the restore.
+    if (file.get_type() == FileInfo::BERKDB_FILE &&
+        (serialise_compress || archive_parts.size() > 1)) {
+        copy_file_chunked(fd, file, pagesize, bufsize, st.st_size, iomap,
+                          num_waits);
+        if (num_waits)
+            std::clog <<  "paused " << num_waits << " times because db is busy writing." << std::endl;
+        std::clog << "a " << filename << " size=" << st.st_size
+                  << " pagesize=" << pagesize << " chunked" << std::endl;
+        return;
+    }
 
-                ssize_t nread, totalread = 0;
-                while (totalread < pagesize) {
-                    nread = read(fd, &pagebuf[0] + n + totalread,
-                                 pagesize - totalread);
-                    if (nread <= 0) {
-                        std::ostringstream ss;
-                        ss << "serialise_file:read: " << std::strerror(errno);
-                        throw SerialiseError(filename, ss.str());
-                    }
-                    totalread += nread;
-                }
-            }
+    // Write the header
+    TarHeader head;
+    head.set_filename(filename);
+    head.set_attrs(st);
+    head.set_checksum();
 
-            // Restore to original offset
-            if (offset != lseek(fd, offset, SEEK_SET)) {
-                std::ostringstream ss;
-                ss << "serialise_file:lseek:reset: " << std::strerror(errno);
-                throw SerialiseError(filename, ss.str());
-            }
-        }
+    if(writeall(1, head.get().c, sizeof(tar_block_header))
+            != sizeof(tar_block_header)) {
+        std::ostringstream ss;
+        ss << "error writing tar block header: " << std::strerror(errno);
+        throw SerialiseError(filename, ss.str());
+    }
 
-        ssize_t byteswritten = writeall(1, &pagebuf[0], bytesread);
-        if(byteswritten != bytesread) {
-            std::ostringstream ss;
-            ss << "write error after " << bytesleft << "bytes: "
-                << std::strerror(errno);
-            throw SerialiseError(filename, ss.str());
-        }
+    // If we are in incremental mode, on initial backup creation we record the
+    // lsn and checksum of every page
+    bool incr_pages = incr_create && file.get_checksums();
+    std::ofstream incrFile;
+    if (incr_pages) {
+        std::string incrFilename = incr_path + "/" + filename + ".incr";
+        incrFile.open(incrFilename.c_str(),
+                      std::ofstream::binary | std::ofstream::trunc);
+    }
 
-        bytesleft -= bytesread;
+    if (serialise_threads > 1 && st.st_size > bufsize) {
+        copy_file_parallel(fd, file, pagesize, bufsize, st.st_size, iomap,
+                           incr_pages, incrFile, num_waits);
+    } else {
+        copy_file(fd, file, pagesize, bufsize, st.st_size, iomap, incr_pages,
+                  incrFile, num_waits);
     }
 
     if (num_waits)
         std::clog <<  "paused " << num_waits << " times because db is busy writing." << std::endl;
 
-    // This is a fatal error as it will leave the archive corrupt if the
-    // header says the file is longer than it really is.
-    if(bytesleft > 0) {
-        throw SerialiseError(filename, "file shrank while being archived!");
-    }
-
     // The length of the output must be a multiple of 512 bytes
-    bytesleft = st.st_size & (512 - 1);
+    off_t bytesleft = st.st_size & (512 - 1);
     bytesleft = 512 - bytesleft;
     if(bytesleft > 0 && bytesleft < 512) {
         writepadding(bytesleft);
@@ -379,8 +649,6 @@ reopen:
 
 
     std::clog << std::endl;
-    if (pagebuf)
-        free(pagebuf);
 }
 
 
@@ -555,7 +823,10 @@ void serialise_database(
   bool do_direct_io,
   bool incr_create,
   bool incr_gen,
-  const std::string& incr_path
+  const std::string& incr_path,
+  int nthreads,
+  bool compress,
+  const std::vector<std::string>& part_paths
 )
 // Serialise a database into tape archive format and write it to stdout.
 // If support_only is true then only support files (lrl and schema) will
@@ -596,6 +867,34 @@ void serialise_database(
     // Current logfile, log errors
     int curlog=0, logerr=0;
 
+    serialise_threads = nthreads;
+    serialise_compress = compress;
+
+    // Open the extra archive parts up front so that a bad path fails the
+    // backup before we start on it.
+    archive_parts.clear();
+    archive_parts.push_back(std::unique_ptr<ArchivePart>(new ArchivePart));
+    archive_parts.back()->fd = 1;
+    for (size_t ii = 0; ii < part_paths.size(); ++ii) {
+        int fd = open(part_paths[ii].c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+                      0666);
+        if (fd == -1) {
+            std::ostringstream ss;
+            ss << "cannot open archive part " << part_paths[ii] << ": "
+               << std::strerror(errno);
+            throw Error(ss);
+        }
+        archive_parts.push_back(std::unique_ptr<ArchivePart>(new ArchivePart));
+        archive_parts.back()->fd = fd;
+    }
+    struct PartsGuard {
+        ~PartsGuard() {
+            for (size_t ii = 1; ii < archive_parts.size(); ++ii)
+                close(archive_parts[ii]->fd);
+            archive_parts.clear();
+        }
+    } parts_guard;
+
     parse_lrl_file(lrlpath, &dbname, &dbdir, &llmeta, &tagged, &support_files,
             &table_names, &queue_names, &nonames, &has_cluster_info);
 
@@ -1286,6 +1585,9 @@ void serialise_database(
 
     // Complete the archive with two blank 512 byte blocks
     writepadding(2 * 512);
+    for (size_t ii = 1; ii < archive_parts.size(); ++ii) {
+        writepadding(2 * 512, archive_parts[ii]->fd);
+    }
 
     // Success, all done!
 }